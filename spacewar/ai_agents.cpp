@@ -0,0 +1,289 @@
+﻿#include "ai_agents.h"
+#include "game_entities.h"
+#include "game_frame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// a ship within this angle of pointing at an agent is a threat to it
+constexpr float AI_AGENT_THREAT_ANGLE = 15.f;
+constexpr float AI_AGENT_THREAT_DISTANCE_FACTOR = 0.5f;
+// the bench keeps this much world per ship as the ships get more
+constexpr float AI_AGENTS_BENCH_AREA_PER_SHIP = 250.f * 250.f;
+
+static int getCellIndex(const AiShipGrid& grid, const int cellX, const int cellY)
+{
+    return cellY * grid.cellsCountX + cellX;
+}
+
+static int getCellX(const AiShipGrid& grid, const float x)
+{
+    return std::clamp(static_cast<int>(x / AI_AGENT_GRID_CELL_SIZE), 0, grid.cellsCountX - 1);
+}
+
+static int getCellY(const AiShipGrid& grid, const float y)
+{
+    return std::clamp(static_cast<int>(y / AI_AGENT_GRID_CELL_SIZE), 0, grid.cellsCountY - 1);
+}
+
+void attachAiAgent(entt::registry& registry, const entt::registry::entity_type ship)
+{
+    AiAgentComponent agent;
+    agent.ticksUntilDecision = 1 + static_cast<int>(registry.size<AiAgentComponent>()) % AI_AGENT_DECISION_PERIOD_TICKS;
+    registry.emplace<AiAgentComponent>(ship, agent);
+}
+
+void attachAiAgents(entt::registry& registry)
+{
+    const auto view = registry.view<const ShipComponent>(entt::exclude<AiAgentComponent>);
+    for (const auto entity : view)
+    {
+        attachAiAgent(registry, entity);
+    }
+}
+
+void aiShipGridRebuild(AiShipGrid& grid, const entt::registry& registry, const Vec2 worldSize)
+{
+    grid.worldSize = worldSize;
+    grid.cellsCountX = std::max(1, static_cast<int>(std::ceil(worldSize.x / AI_AGENT_GRID_CELL_SIZE)));
+    grid.cellsCountY = std::max(1, static_cast<int>(std::ceil(worldSize.y / AI_AGENT_GRID_CELL_SIZE)));
+
+    const int cellsCount = grid.cellsCountX * grid.cellsCountY;
+    grid.cellStarts.assign(cellsCount + 1, 0);
+    grid.unsortedEntries.clear();
+    grid.unsortedCells.clear();
+
+    const auto view = registry.view<const ShipComponent, const PositionComponent, const RotationComponent>();
+    for (auto [entity, ship, pos, rotation] : view.each())
+    {
+        const int cell = getCellIndex(grid, getCellX(grid, pos.vec.x), getCellY(grid, pos.vec.y));
+        grid.unsortedEntries.push_back({entity, pos.vec, vec2AngleToDir(rotation.angle)});
+        grid.unsortedCells.push_back(cell);
+        ++grid.cellStarts[cell + 1];
+    }
+
+    for (int i = 1; i <= cellsCount; ++i)
+    {
+        grid.cellStarts[i] += grid.cellStarts[i - 1];
+    }
+
+    // filling a cell moves its start to the start of the next one, shifted back after
+    grid.entries.resize(grid.unsortedEntries.size());
+    for (size_t i = 0; i < grid.unsortedEntries.size(); ++i)
+    {
+        grid.entries[grid.cellStarts[grid.unsortedCells[i]]++] = grid.unsortedEntries[i];
+    }
+
+    for (int i = cellsCount; i > 0; --i)
+    {
+        grid.cellStarts[i] = grid.cellStarts[i - 1];
+    }
+    grid.cellStarts[0] = 0;
+}
+
+entt::registry::entity_type aiShipGridFindTarget(const AiShipGrid& grid, const entt::registry::entity_type selfShip, const Vec2 selfPosition,
+                                                 const float maxDistance)
+{
+    if (grid.entries.empty())
+    {
+        return entt::null;
+    }
+
+    const float threatCos = std::cos(AI_AGENT_THREAT_ANGLE * PI / 180.f);
+    const int centerX = getCellX(grid, selfPosition.x);
+    const int centerY = getCellY(grid, selfPosition.y);
+    const int maxRing = std::max(grid.cellsCountX, grid.cellsCountY);
+
+    entt::registry::entity_type bestShip = entt::null;
+    float bestScore = maxDistance;
+
+    const auto visitCell = [&](const int cell)
+    {
+        for (int i = grid.cellStarts[cell]; i < grid.cellStarts[cell + 1]; ++i)
+        {
+            const AiShipGrid::Entry& entry = grid.entries[i];
+            if (entry.ship == selfShip)
+            {
+                continue;
+            }
+
+            const Vec2 toSelf = selfPosition - entry.position;
+            const float distance = vec2Length(toSelf);
+            const bool isThreat = vec2Dot(entry.direction, toSelf) >= threatCos * distance;
+            const float score = isThreat ? distance * AI_AGENT_THREAT_DISTANCE_FACTOR : distance;
+
+            if (score < bestScore)
+            {
+                bestScore = score;
+                bestShip = entry.ship;
+            }
+        }
+    };
+
+    for (int ring = 0; ring <= maxRing; ++ring)
+    {
+        // a ship in this ring is at least a ring less of cells away, a threat counts as nearer by the factor
+        const float minScore = static_cast<float>(std::max(ring - 1, 0)) * AI_AGENT_GRID_CELL_SIZE * AI_AGENT_THREAT_DISTANCE_FACTOR;
+        if (minScore >= bestScore)
+        {
+            break;
+        }
+
+        const int minY = std::max(centerY - ring, 0);
+        const int maxY = std::min(centerY + ring, grid.cellsCountY - 1);
+        for (int y = minY; y <= maxY; ++y)
+        {
+            // rows between the top and the bottom of the ring only have their two ends in it
+            const bool isEdgeRow = y == centerY - ring || y == centerY + ring;
+            const int step = isEdgeRow || ring == 0 ? 1 : 2 * ring;
+
+            for (int x = centerX - ring; x <= centerX + ring; x += step)
+            {
+                if (x >= 0 && x < grid.cellsCountX)
+                {
+                    visitCell(getCellIndex(grid, x, y));
+                }
+            }
+        }
+    }
+
+    return bestShip;
+}
+
+void aiAgentsSystem(entt::registry& registry, const Vec2 worldSize)
+{
+    AiShipGrid& grid = registry.ctx_or_set<AiShipGrid>();
+    aiShipGridRebuild(grid, registry, worldSize);
+
+    const float maxDistance = vec2Length(worldSize);
+
+    const auto view = registry.view<AiAgentComponent>();
+    for (auto [entity, agent] : view.each())
+    {
+        if (--agent.ticksUntilDecision <= 0)
+        {
+            agent.ticksUntilDecision = AI_AGENT_DECISION_PERIOD_TICKS;
+
+            const bool isTargetAlive = registry.valid(agent.target) && registry.has<ShipComponent>(agent.target);
+            if (!isTargetAlive || --agent.decisionsUntilRetarget <= 0)
+            {
+                agent.target = aiShipGridFindTarget(grid, entity, registry.get<PositionComponent>(entity).vec, maxDistance);
+                agent.decisionsUntilRetarget = AI_AGENT_RETARGET_PERIOD_DECISIONS;
+            }
+
+            agent.input = aiGenerateInputForTarget(registry, entity, agent.target, agent.params);
+        }
+
+        applyShipInput(registry, entity, agent.input);
+    }
+}
+
+static void moveBenchShips(entt::registry& registry, const Vec2 worldSize)
+{
+    rotateByInputSystem(registry);
+    applyRotationSpeedSystem(registry, GAME_TICK_DT);
+    accelerateByInputSystem(registry, GAME_TICK_DT);
+    applyVelocitySystem(registry, GAME_TICK_DT);
+    wrapPositionAroundWorldSystem(registry, worldSize);
+}
+
+static void createBenchShips(entt::registry& registry, const int shipsCount, const Vec2 worldSize)
+{
+    registry.clear();
+    randomSeed(static_cast<uint64_t>(shipsCount));
+
+    for (int i = 0; i < shipsCount; ++i)
+    {
+        const Vec2 position{randomFloatRange(0.f, worldSize.x), randomFloatRange(0.f, worldSize.y)};
+        createShipEntity(registry, position, randomFloatRange(0.f, 360.f), sf::Color::White, i);
+    }
+}
+
+bool runAiAgentsBench(const int maxShipsCount, const int ticksCount, const bool verbose)
+{
+    const uint64_t callerRandomState = randomGetState();
+
+    entt::registry registry;
+    std::vector<entt::registry::entity_type> ships;
+    bool isOk = maxShipsCount >= 2 && ticksCount >= AI_AGENT_DECISION_PERIOD_TICKS;
+
+    if (verbose)
+    {
+        std::printf("ai agents: a decision every %d ticks, a new target every %d decisions, %d ticks per run\n", AI_AGENT_DECISION_PERIOD_TICKS,
+                    AI_AGENT_RETARGET_PERIOD_DECISIONS, ticksCount);
+    }
+
+    for (int shipsCount = 2; isOk && shipsCount <= maxShipsCount; shipsCount *= 2)
+    {
+        const float worldSide = std::sqrt(AI_AGENTS_BENCH_AREA_PER_SHIP * shipsCount);
+        const Vec2 worldSize{worldSide, worldSide};
+
+        // every bot looks for the nearest ship among all of them and decides every tick
+        createBenchShips(registry, shipsCount, worldSize);
+        const auto shipsView = registry.view<const ShipComponent>();
+        ships.assign(shipsView.begin(), shipsView.end());
+
+        int64_t allPairsNs = 0;
+        for (int tick = 0; tick < ticksCount; ++tick)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto ship : ships)
+            {
+                const Vec2 selfPos = registry.get<PositionComponent>(ship).vec;
+                entt::registry::entity_type target = entt::null;
+                float targetDistanceSq = 0.f;
+
+                for (const auto other : ships)
+                {
+                    const float distanceSq = vec2LengthSq(registry.get<PositionComponent>(other).vec - selfPos);
+                    if (other != ship && (target == entt::null || distanceSq < targetDistanceSq))
+                    {
+                        target = other;
+                        targetDistanceSq = distanceSq;
+                    }
+                }
+
+                applyShipInput(registry, ship, aiGenerateInputForTarget(registry, ship, target));
+            }
+            allPairsNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            moveBenchShips(registry, worldSize);
+        }
+
+        createBenchShips(registry, shipsCount, worldSize);
+        attachAiAgents(registry);
+
+        int64_t agentsNs = 0;
+        for (int tick = 0; tick < ticksCount; ++tick)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            aiAgentsSystem(registry, worldSize);
+            agentsNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            moveBenchShips(registry, worldSize);
+        }
+
+        for (auto [entity, agent] : registry.view<const AiAgentComponent>().each())
+        {
+            isOk = isOk && registry.valid(agent.target);
+        }
+
+        if (verbose)
+        {
+            const double botTicks = static_cast<double>(shipsCount) * ticksCount;
+            std::printf("%4d bots: all pairs every tick %7.0f ns, agents %7.0f ns per bot per tick\n", shipsCount,
+                        static_cast<double>(allPairsNs) / botTicks, static_cast<double>(agentsNs) / botTicks);
+        }
+    }
+
+    randomSetState(callerRandomState);
+
+    if (verbose)
+    {
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "player.h"
+
+#include <vector>
+
+// an agent decides once in this many ticks, agents are spread over the ticks in turns
+constexpr int AI_AGENT_DECISION_PERIOD_TICKS = 4;
+// the target is picked again once in this many decisions, or right away when it's gone
+constexpr int AI_AGENT_RETARGET_PERIOD_DECISIONS = 8;
+constexpr float AI_AGENT_GRID_CELL_SIZE = 125.f;
+
+// AI that drives a ship among many others. Between decisions it keeps applying its last input
+struct AiAgentComponent
+{
+    AiParams params{};
+    entt::registry::entity_type target = entt::null;
+    ShipInput input{};
+    int ticksUntilDecision = 0;
+    int decisionsUntilRetarget = 0;
+};
+
+// Registry context variable, a uniform grid of ship positions over the world. Rebuilt every tick by counting sort into
+// arrays that are reused, so the rebuild is linear in ships and doesn't allocate once they stop growing
+struct AiShipGrid
+{
+    struct Entry
+    {
+        entt::registry::entity_type ship = entt::null;
+        Vec2 position{};
+        // where the ship is pointing
+        Vec2 direction{};
+    };
+
+    Vec2 worldSize{};
+    int cellsCountX = 0;
+    int cellsCountY = 0;
+    // entries of cell i are [cellStarts[i], cellStarts[i + 1])
+    std::vector<int> cellStarts{};
+    std::vector<Entry> entries{};
+    // ships in view order with their cells, the input of the sort
+    std::vector<Entry> unsortedEntries{};
+    std::vector<int> unsortedCells{};
+};
+
+// first decisions of agents are spread over the next ticks in the order they are attached
+void attachAiAgent(entt::registry& registry, entt::registry::entity_type ship);
+// adds an agent to every ship without one
+void attachAiAgents(entt::registry& registry);
+
+void aiShipGridRebuild(AiShipGrid& grid, const entt::registry& registry, Vec2 worldSize);
+// The nearest other ship, one aiming at the searching ship counts as half as far. Looks at the rings of cells around the
+// ship only until no nearer ship can be in the next ring, entt::null if there is none within maxDistance. Distances are
+// straight ones like the ones aiGenerateInput steers by, not around the world edges
+entt::registry::entity_type aiShipGridFindTarget(const AiShipGrid& grid, entt::registry::entity_type selfShip, Vec2 selfPosition,
+                                                 float maxDistance);
+
+// Rebuilds the grid, lets the agents due this tick pick targets and decide, and applies the inputs of all agents
+void aiAgentsSystem(entt::registry& registry, Vec2 worldSize);
+
+// Times aiAgentsSystem against every bot scanning all ships for the nearest one every tick, for doubling bot counts up
+// to maxShipsCount, and prints the cost per bot if verbose. Returns false if an agent didn't get a target
+bool runAiAgentsBench(int maxShipsCount, int ticksCount, bool verbose);
@@ -0,0 +1,414 @@
+﻿#include "ai_lookahead.h"
+#include "game_entities.h"
+#include "game_frame.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// a bullet that takes longer to get there is likely to be dodged or to time out
+constexpr float AI_LOOKAHEAD_MAX_SHOT_TIME = 2.5f;
+// a ship this close to a well is pulled in before thrust can get it out
+constexpr float AI_LOOKAHEAD_WELL_DANGER_RADIUS = 60.f;
+constexpr float AI_LOOKAHEAD_PROJECTILE_RADIUS = 3.f;
+constexpr float AI_LOOKAHEAD_PREFERRED_DISTANCE = 300.f;
+
+constexpr float AI_LOOKAHEAD_SHOT_REWARD = 3.f;
+constexpr float AI_LOOKAHEAD_HIT_PENALTY = 10.f;
+constexpr float AI_LOOKAHEAD_WELL_PENALTY = 5.f;
+constexpr float AI_LOOKAHEAD_IMPULSE_COST = 0.5f;
+
+static_assert(AI_LOOKAHEAD_CANDIDATES_COUNT % AI_LOOKAHEAD_LANES_COUNT == 0, "candidates must fill whole registers");
+
+// into [0, size) for values less than a world away from it, like floatWrap
+static __m128 wrapLanes(const __m128 value, const __m128 size)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 raised = _mm_add_ps(value, _mm_and_ps(_mm_cmplt_ps(value, zero), size));
+    return _mm_sub_ps(raised, _mm_and_ps(_mm_cmpge_ps(raised, size), size));
+}
+
+// the shortest way around the world, like vec2WrappedDiff
+static __m128 wrappedDiffLanes(const __m128 diff, const __m128 size, const __m128 invSize)
+{
+    const __m128 worlds = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(diff, invSize)));
+    return _mm_sub_ps(diff, _mm_mul_ps(worlds, size));
+}
+
+void aiIntegrateTrajectories(AiTrajectoryBatch& batch, const AiLookaheadWell* wells, const int wellsCount, const int trajectoriesCount,
+                             const Vec2 worldSize, const float dt)
+{
+    const __m128 dtLanes = _mm_set1_ps(dt);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 worldX = _mm_set1_ps(worldSize.x);
+    const __m128 worldY = _mm_set1_ps(worldSize.y);
+
+    for (int lane = 0; lane < trajectoriesCount; lane += AI_LOOKAHEAD_LANES_COUNT)
+    {
+        __m128 positionX = _mm_load_ps(&batch.positionX[lane]);
+        __m128 positionY = _mm_load_ps(&batch.positionY[lane]);
+        __m128 velocityX = _mm_load_ps(&batch.velocityX[lane]);
+        __m128 velocityY = _mm_load_ps(&batch.velocityY[lane]);
+        const __m128 directionX = _mm_load_ps(&batch.directionX[lane]);
+        const __m128 directionY = _mm_load_ps(&batch.directionY[lane]);
+
+        for (int i = 0; i < wellsCount; ++i)
+        {
+            const GravityWellComponent& well = wells[i].well;
+            const __m128 diffX = _mm_sub_ps(_mm_set1_ps(wells[i].position.x), positionX);
+            const __m128 diffY = _mm_sub_ps(_mm_set1_ps(wells[i].position.y), positionY);
+            const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(diffX, diffX), _mm_mul_ps(diffY, diffY)));
+
+            // drag first, then the pull of gameGetGravityWellVectorAtPoint
+            const __m128 drag = _mm_and_ps(_mm_cmplt_ps(length, _mm_set1_ps(well.dragRadius)), _mm_set1_ps(dt * well.dragCoefficient));
+            velocityX = _mm_sub_ps(velocityX, _mm_mul_ps(velocityX, drag));
+            velocityY = _mm_sub_ps(velocityY, _mm_mul_ps(velocityY, drag));
+
+            const __m128 normalized = _mm_min_ps(_mm_mul_ps(length, _mm_set1_ps(1.f / well.maxRadius)), one);
+            const __m128 shifted = _mm_add_ps(normalized, _mm_set1_ps(0.045f));
+            const __m128 power = _mm_div_ps(_mm_set1_ps(0.0025f * well.maxPower), _mm_mul_ps(shifted, shifted));
+            // the infinity of a zero length is masked out, there is no pull at the very center
+            const __m128 pull = _mm_and_ps(_mm_cmpgt_ps(length, _mm_set1_ps(0.001f)), _mm_div_ps(_mm_mul_ps(power, dtLanes), length));
+            velocityX = _mm_add_ps(velocityX, _mm_mul_ps(diffX, pull));
+            velocityY = _mm_add_ps(velocityY, _mm_mul_ps(diffY, pull));
+        }
+
+        // thrust goes along the direction before this step's turn, like accelerateByInputSystem before applyRotationSpeedSystem
+        const __m128 acceleration = _mm_mul_ps(_mm_load_ps(&batch.acceleration[lane]), dtLanes);
+        velocityX = _mm_add_ps(velocityX, _mm_mul_ps(directionX, acceleration));
+        velocityY = _mm_add_ps(velocityY, _mm_mul_ps(directionY, acceleration));
+
+        const __m128 turnCos = _mm_load_ps(&batch.turnCos[lane]);
+        const __m128 turnSin = _mm_load_ps(&batch.turnSin[lane]);
+        _mm_store_ps(&batch.directionX[lane], _mm_sub_ps(_mm_mul_ps(directionX, turnCos), _mm_mul_ps(directionY, turnSin)));
+        _mm_store_ps(&batch.directionY[lane], _mm_add_ps(_mm_mul_ps(directionX, turnSin), _mm_mul_ps(directionY, turnCos)));
+
+        positionX = wrapLanes(_mm_add_ps(positionX, _mm_mul_ps(velocityX, dtLanes)), worldX);
+        positionY = wrapLanes(_mm_add_ps(positionY, _mm_mul_ps(velocityY, dtLanes)), worldY);
+
+        _mm_store_ps(&batch.positionX[lane], positionX);
+        _mm_store_ps(&batch.positionY[lane], positionY);
+        _mm_store_ps(&batch.velocityX[lane], velocityX);
+        _mm_store_ps(&batch.velocityY[lane], velocityY);
+    }
+}
+
+struct AiLookaheadShip
+{
+    Vec2 position{};
+    Vec2 velocity{};
+    float angle = 0.f;
+    float radius = 0.f;
+};
+
+struct AiLookaheadProjectile
+{
+    Vec2 position{};
+    Vec2 velocity{};
+};
+
+static AiLookaheadShip readLookaheadShip(const entt::registry& registry, const entt::registry::entity_type ship)
+{
+    AiLookaheadShip result;
+    result.position = registry.get<PositionComponent>(ship).vec;
+    result.velocity = registry.get<VelocityComponent>(ship).vec;
+    result.angle = registry.get<RotationComponent>(ship).angle;
+    result.radius = registry.get<CircleColliderComponent>(ship).radius;
+    return result;
+}
+
+static void setTrajectory(AiTrajectoryBatch& batch, const int lane, const AiLookaheadShip& ship, const Vec2 velocity, const float acceleration,
+                          const float turnDegrees)
+{
+    const Vec2 direction = vec2AngleToDir(ship.angle);
+    batch.positionX[lane] = ship.position.x;
+    batch.positionY[lane] = ship.position.y;
+    batch.velocityX[lane] = velocity.x;
+    batch.velocityY[lane] = velocity.y;
+    batch.directionX[lane] = direction.x;
+    batch.directionY[lane] = direction.y;
+    batch.acceleration[lane] = acceleration;
+    batch.turnCos[lane] = std::cos(degToRad(turnDegrees));
+    batch.turnSin[lane] = std::sin(degToRad(turnDegrees));
+}
+
+// whether a bullet fired from the given muzzle and direction meets a ship that keeps its velocity, computed per lane.
+// The flight time is taken for the current distance, good enough for bullets much faster than ships
+static __m128 canHitLanes(const __m128 muzzleX, const __m128 muzzleY, const __m128 directionX, const __m128 directionY, const Vec2 targetPosition,
+                          const Vec2 targetVelocity, const float targetRadius, const float projectileSpeed, const Vec2 worldSize)
+{
+    const __m128 worldX = _mm_set1_ps(worldSize.x);
+    const __m128 worldY = _mm_set1_ps(worldSize.y);
+    const __m128 toTargetX = wrappedDiffLanes(_mm_sub_ps(_mm_set1_ps(targetPosition.x), muzzleX), worldX, _mm_set1_ps(1.f / worldSize.x));
+    const __m128 toTargetY = wrappedDiffLanes(_mm_sub_ps(_mm_set1_ps(targetPosition.y), muzzleY), worldY, _mm_set1_ps(1.f / worldSize.y));
+
+    const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(toTargetX, toTargetX), _mm_mul_ps(toTargetY, toTargetY)));
+    const __m128 flightTime = _mm_mul_ps(distance, _mm_set1_ps(1.f / projectileSpeed));
+    const __m128 leadX = _mm_add_ps(toTargetX, _mm_mul_ps(_mm_set1_ps(targetVelocity.x), flightTime));
+    const __m128 leadY = _mm_add_ps(toTargetY, _mm_mul_ps(_mm_set1_ps(targetVelocity.y), flightTime));
+
+    const __m128 along = _mm_add_ps(_mm_mul_ps(directionX, leadX), _mm_mul_ps(directionY, leadY));
+    const __m128 across = _mm_sub_ps(_mm_mul_ps(directionX, leadY), _mm_mul_ps(directionY, leadX));
+    const __m128 acrossSq = _mm_mul_ps(across, across);
+    const float hitRadius = targetRadius * 0.8f;
+
+    return _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(along, _mm_setzero_ps()), _mm_cmplt_ps(acrossSq, _mm_set1_ps(hitRadius * hitRadius))),
+                      _mm_cmplt_ps(flightTime, _mm_set1_ps(AI_LOOKAHEAD_MAX_SHOT_TIME)));
+}
+
+// true in the lanes closer than radius to the point, around the world
+static __m128 isNearLanes(const __m128 positionX, const __m128 positionY, const Vec2 point, const float radius, const Vec2 worldSize)
+{
+    const __m128 diffX = wrappedDiffLanes(_mm_sub_ps(_mm_set1_ps(point.x), positionX), _mm_set1_ps(worldSize.x), _mm_set1_ps(1.f / worldSize.x));
+    const __m128 diffY = wrappedDiffLanes(_mm_sub_ps(_mm_set1_ps(point.y), positionY), _mm_set1_ps(worldSize.y), _mm_set1_ps(1.f / worldSize.y));
+    const __m128 distanceSq = _mm_add_ps(_mm_mul_ps(diffX, diffX), _mm_mul_ps(diffY, diffY));
+    return _mm_cmplt_ps(distanceSq, _mm_set1_ps(radius * radius));
+}
+
+ShipInput aiGenerateLookaheadInput(const entt::registry& registry, const entt::registry::entity_type selfShip, const Vec2 worldSize)
+{
+    entt::registry::entity_type enemyShip = entt::null;
+    for (auto [entity, ship] : registry.view<const ShipComponent>().each())
+    {
+        if (entity != selfShip)
+        {
+            enemyShip = entity;
+            break;
+        }
+    }
+    if (!registry.valid(enemyShip))
+    {
+        return {};
+    }
+
+    std::array<AiLookaheadWell, AI_LOOKAHEAD_MAX_WELLS_COUNT> wells{};
+    int wellsCount = 0;
+    for (auto [entity, well, position] : registry.view<const GravityWellComponent, const PositionComponent>().each())
+    {
+        if (wellsCount < AI_LOOKAHEAD_MAX_WELLS_COUNT)
+        {
+            wells[wellsCount++] = AiLookaheadWell{position.vec, well};
+        }
+    }
+
+    std::array<AiLookaheadProjectile, AI_LOOKAHEAD_MAX_PROJECTILES_COUNT> projectiles{};
+    int projectilesCount = 0;
+    for (auto [entity, position, velocity] : registry.view<const ProjectileComponent, const PositionComponent, const VelocityComponent>().each())
+    {
+        if (projectilesCount < AI_LOOKAHEAD_MAX_PROJECTILES_COUNT)
+        {
+            projectiles[projectilesCount++] = AiLookaheadProjectile{position.vec, velocity.vec};
+        }
+    }
+
+    const AiLookaheadShip self = readLookaheadShip(registry, selfShip);
+    const AiLookaheadShip enemy = readLookaheadShip(registry, enemyShip);
+    const float acceleration = registry.get<AccelerateByInputComponent>(selfShip).acceleration;
+    const float rotationSpeed = registry.get<RotateByInputComponent>(selfShip).rotationSpeed;
+    const ShootingComponent& shooting = registry.get<ShootingComponent>(selfShip);
+    const AccelerateImpulseByInputComponent& impulse = registry.get<AccelerateImpulseByInputComponent>(selfShip);
+    const bool isImpulseReady = impulse.cooldownTimer.timeLeft <= 0.f;
+
+    const float dt = AI_LOOKAHEAD_TICKS_PER_STEP * GAME_TICK_DT;
+    const Vec2 selfDirection = vec2AngleToDir(self.angle);
+
+    AiTrajectoryBatch candidates;
+    for (int i = 0; i < AI_LOOKAHEAD_CANDIDATES_COUNT; ++i)
+    {
+        const float rotate = static_cast<float>(i % 3 - 1);
+        const bool isThrust = i / 3 % 2 != 0;
+        const bool isImpulse = i / 6 % 2 != 0 && isImpulseReady;
+        const Vec2 velocity = isImpulse ? self.velocity + selfDirection * impulse.power : self.velocity;
+        setTrajectory(candidates, i, self, velocity, isThrust ? acceleration : 0.f, rotate * rotationSpeed * dt);
+    }
+
+    // the enemy keeps its current inputs, it only needs the first register
+    AiTrajectoryBatch enemyTrajectory;
+    const float enemyRotate = registry.get<RotateByInputComponent>(enemyShip).input * registry.get<RotateByInputComponent>(enemyShip).rotationSpeed;
+    const AccelerateByInputComponent& enemyAccelerate = registry.get<AccelerateByInputComponent>(enemyShip);
+    for (int i = 0; i < AI_LOOKAHEAD_LANES_COUNT; ++i)
+    {
+        setTrajectory(enemyTrajectory, i, enemy, enemy.velocity, enemyAccelerate.input ? enemyAccelerate.acceleration : 0.f, enemyRotate * dt);
+    }
+
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> scores{};
+    // all bits set in lanes that were hit or have taken their shot, so the same event isn't counted twice
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> isHitMasks{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> hasShotMasks{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> isInWellMasks{};
+
+    for (int step = 1; step <= AI_LOOKAHEAD_STEPS_COUNT; ++step)
+    {
+        aiIntegrateTrajectories(candidates, wells.data(), wellsCount, AI_LOOKAHEAD_CANDIDATES_COUNT, worldSize, dt);
+        aiIntegrateTrajectories(enemyTrajectory, wells.data(), wellsCount, AI_LOOKAHEAD_LANES_COUNT, worldSize, dt);
+
+        const float time = static_cast<float>(step) * dt;
+        // sooner is better, both for shots and for hits
+        const float urgency = 1.f - static_cast<float>(step) / static_cast<float>(AI_LOOKAHEAD_STEPS_COUNT + 1);
+        const Vec2 enemyPosition{enemyTrajectory.positionX[0], enemyTrajectory.positionY[0]};
+        const Vec2 enemyVelocity{enemyTrajectory.velocityX[0], enemyTrajectory.velocityY[0]};
+        const bool isShotReady = shooting.cooldownTimer.timeLeft <= time;
+
+        for (int lane = 0; lane < AI_LOOKAHEAD_CANDIDATES_COUNT; lane += AI_LOOKAHEAD_LANES_COUNT)
+        {
+            const __m128 positionX = _mm_load_ps(&candidates.positionX[lane]);
+            const __m128 positionY = _mm_load_ps(&candidates.positionY[lane]);
+            const __m128 directionX = _mm_load_ps(&candidates.directionX[lane]);
+            const __m128 directionY = _mm_load_ps(&candidates.directionY[lane]);
+            const __m128 wasHit = _mm_load_ps(&isHitMasks[lane]);
+            const __m128 hadShot = _mm_load_ps(&hasShotMasks[lane]);
+            const __m128 wasInWell = _mm_load_ps(&isInWellMasks[lane]);
+            __m128 score = _mm_load_ps(&scores[lane]);
+
+            __m128 isHit = isNearLanes(positionX, positionY, enemyPosition, self.radius + enemy.radius, worldSize);
+            for (int i = 0; i < projectilesCount; ++i)
+            {
+                // projectiles fly straight, gravity doesn't pull them
+                const Vec2 projectilePosition = projectiles[i].position + projectiles[i].velocity * time;
+                isHit = _mm_or_ps(isHit, isNearLanes(positionX, positionY, projectilePosition, self.radius + AI_LOOKAHEAD_PROJECTILE_RADIUS, worldSize));
+            }
+            const __m128 newHit = _mm_andnot_ps(wasHit, isHit);
+            score = _mm_sub_ps(score, _mm_and_ps(newHit, _mm_set1_ps(AI_LOOKAHEAD_HIT_PENALTY * (0.5f + 0.5f * urgency))));
+
+            __m128 isInWell = _mm_setzero_ps();
+            for (int i = 0; i < wellsCount; ++i)
+            {
+                isInWell = _mm_or_ps(isInWell, isNearLanes(positionX, positionY, wells[i].position, AI_LOOKAHEAD_WELL_DANGER_RADIUS, worldSize));
+            }
+            const __m128 newInWell = _mm_andnot_ps(_mm_or_ps(wasInWell, wasHit), isInWell);
+            score = _mm_sub_ps(score, _mm_and_ps(newInWell, _mm_set1_ps(AI_LOOKAHEAD_WELL_PENALTY)));
+
+            __m128 newShot = _mm_setzero_ps();
+            if (isShotReady)
+            {
+                const __m128 muzzleX = _mm_add_ps(positionX, _mm_mul_ps(directionX, _mm_set1_ps(shooting.projectileBirthOffset)));
+                const __m128 muzzleY = _mm_add_ps(positionY, _mm_mul_ps(directionY, _mm_set1_ps(shooting.projectileBirthOffset)));
+                const __m128 canHit = canHitLanes(muzzleX, muzzleY, directionX, directionY, enemyPosition, enemyVelocity, enemy.radius,
+                                                  shooting.projectileSpeed, worldSize);
+                newShot = _mm_andnot_ps(_mm_or_ps(hadShot, _mm_or_ps(wasHit, isHit)), canHit);
+                score = _mm_add_ps(score, _mm_and_ps(newShot, _mm_set1_ps(AI_LOOKAHEAD_SHOT_REWARD * urgency)));
+            }
+
+            _mm_store_ps(&scores[lane], score);
+            _mm_store_ps(&isHitMasks[lane], _mm_or_ps(wasHit, isHit));
+            _mm_store_ps(&hasShotMasks[lane], _mm_or_ps(hadShot, newShot));
+            _mm_store_ps(&isInWellMasks[lane], _mm_or_ps(wasInWell, isInWell));
+        }
+    }
+
+    int bestCandidate = 0;
+    float bestScore = 0.f;
+    const Vec2 enemyEndPosition{enemyTrajectory.positionX[0], enemyTrajectory.positionY[0]};
+    for (int i = 0; i < AI_LOOKAHEAD_CANDIDATES_COUNT; ++i)
+    {
+        // without a shot in sight, get to a distance a shot is likely from
+        const Vec2 endPosition{candidates.positionX[i], candidates.positionY[i]};
+        const float endDistance = vec2Length(vec2WrappedDiff(endPosition, enemyEndPosition, worldSize));
+        float score = scores[i] - std::abs(endDistance - AI_LOOKAHEAD_PREFERRED_DISTANCE) / worldSize.x;
+        score -= i / 6 % 2 != 0 && isImpulseReady ? AI_LOOKAHEAD_IMPULSE_COST : 0.f;
+
+        if (i == 0 || score > bestScore)
+        {
+            bestCandidate = i;
+            bestScore = score;
+        }
+    }
+
+    ShipInput result;
+    result.rotate = static_cast<float>(bestCandidate % 3 - 1);
+    result.thrust = bestCandidate / 3 % 2 != 0;
+    result.thrustBurst = bestCandidate / 6 % 2 != 0 && isImpulseReady;
+
+    // the same test as for the candidates, for a bullet fired right now
+    const Vec2 muzzle = self.position + selfDirection * shooting.projectileBirthOffset;
+    const __m128 canHitNow = canHitLanes(_mm_set1_ps(muzzle.x), _mm_set1_ps(muzzle.y), _mm_set1_ps(selfDirection.x), _mm_set1_ps(selfDirection.y),
+                                         enemy.position, enemy.velocity, enemy.radius, shooting.projectileSpeed, worldSize);
+    result.shoot = shooting.cooldownTimer.timeLeft <= 0.f && _mm_movemask_ps(canHitNow) != 0;
+
+    return result;
+}
+
+bool runAiLookaheadBench(const int matchesCount, const bool verbose)
+{
+    constexpr int playersCount = 2;
+    constexpr int maxMatchTicks = 60 * 60;
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    entt::registry registry;
+    std::vector<Player> players(playersCount);
+
+    int64_t decisionsCount = 0;
+    int64_t totalDecisionNs = 0;
+    int64_t maxDecisionNs = 0;
+    int winsCount = 0;
+    int lossesCount = 0;
+
+    const uint64_t callerRandomState = randomGetState();
+
+    for (int match = 0; match < matchesCount; ++match)
+    {
+        // both sides, the world isn't symmetric for the ships
+        const int lookaheadPlayerIndex = match % 2;
+        randomSeed(static_cast<uint64_t>(match / 2));
+        recreateGameWorld(registry, players, worldSize);
+
+        for (int tick = 0; tick < maxMatchTicks; ++tick)
+        {
+            for (int i = 0; i < playersCount; ++i)
+            {
+                const entt::registry::entity_type ship = players[i].shipEntity;
+                if (!registry.valid(ship))
+                {
+                    continue;
+                }
+
+                if (i != lookaheadPlayerIndex)
+                {
+                    applyShipInput(registry, ship, aiGenerateInput(registry, ship));
+                    continue;
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                const ShipInput input = aiGenerateLookaheadInput(registry, ship, worldSize);
+                const int64_t decisionNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                applyShipInput(registry, ship, input);
+
+                ++decisionsCount;
+                totalDecisionNs += decisionNs;
+                maxDecisionNs = std::max(maxDecisionNs, decisionNs);
+            }
+
+            gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+
+            const std::optional<GameResult> result = tryGetGameResult(registry, playersCount);
+            if (result.has_value())
+            {
+                winsCount += result->victoriousPlayerIndex == lookaheadPlayerIndex ? 1 : 0;
+                lossesCount += !result->isTie() && result->victoriousPlayerIndex != lookaheadPlayerIndex ? 1 : 0;
+                break;
+            }
+        }
+    }
+
+    randomSetState(callerRandomState);
+
+    const double meanDecisionUs = decisionsCount > 0 ? static_cast<double>(totalDecisionNs) / decisionsCount / 1000.0 : 0.0;
+    const bool isOk = decisionsCount > 0 && meanDecisionUs <= AI_LOOKAHEAD_BUDGET_US;
+
+    if (verbose)
+    {
+        std::printf("lookahead ai: %d candidates, %d steps of %d ticks\n", AI_LOOKAHEAD_CANDIDATES_COUNT, AI_LOOKAHEAD_STEPS_COUNT,
+                    AI_LOOKAHEAD_TICKS_PER_STEP);
+        std::printf("%lld decisions, mean %.2f us, max %.2f us, budget %.0f us\n", static_cast<long long>(decisionsCount), meanDecisionUs,
+                    static_cast<double>(maxDecisionNs) / 1000.0, AI_LOOKAHEAD_BUDGET_US);
+        std::printf("against the default ai in %d matches: won %d, lost %d, tied %d\n", matchesCount, winsCount, lossesCount,
+                    matchesCount - winsCount - lossesCount);
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
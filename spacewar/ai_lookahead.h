@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "game_logic.h"
+#include "player.h"
+
+#include <array>
+
+// rotate (left, none, right) x thrust x impulse, a multiple of AI_LOOKAHEAD_LANES_COUNT
+constexpr int AI_LOOKAHEAD_CANDIDATES_COUNT = 12;
+// floats in an SSE register, the integrator steps this many trajectories with one instruction
+constexpr int AI_LOOKAHEAD_LANES_COUNT = 4;
+constexpr int AI_LOOKAHEAD_MAX_WELLS_COUNT = 4;
+constexpr int AI_LOOKAHEAD_MAX_PROJECTILES_COUNT = 16;
+
+// The search is a fixed amount of work rather than a timed one, so the AI stays deterministic for replays and rollback.
+// The defaults look 1.5 s ahead and fit the budget below, runAiLookaheadBench checks it
+constexpr int AI_LOOKAHEAD_STEPS_COUNT = 30;
+constexpr int AI_LOOKAHEAD_TICKS_PER_STEP = 3;
+constexpr float AI_LOOKAHEAD_BUDGET_US = 50.f;
+
+struct AiLookaheadWell
+{
+    Vec2 position{};
+    GravityWellComponent well{};
+};
+
+// Ship trajectories in structure of arrays layout, one per lane. Inputs are held for the whole trajectory,
+// so a turn is a fixed rotation of the direction per step instead of a sine and cosine per step
+struct AiTrajectoryBatch
+{
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> positionX{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> positionY{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> velocityX{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> velocityY{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> directionX{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> directionY{};
+
+    // acceleration of the thrust input, 0 when it's off
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> acceleration{};
+    // cosine and sine of the turn in a step
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> turnCos{};
+    alignas(16) std::array<float, AI_LOOKAHEAD_CANDIDATES_COUNT> turnSin{};
+};
+
+// Advances the first trajectoriesCount trajectories of the batch by dt, a multiple of AI_LOOKAHEAD_LANES_COUNT, in the order
+// of the game systems: gravity and drag, thrust, rotation, velocity, wrap around the world. Teleports and collisions are
+// left to the caller
+void aiIntegrateTrajectories(AiTrajectoryBatch& batch, const AiLookaheadWell* wells, int wellsCount, int trajectoriesCount, Vec2 worldSize,
+                             float dt);
+
+// Forward simulates every candidate input for AI_LOOKAHEAD_STEPS_COUNT steps together with the enemy ship and the
+// projectiles, and takes the one that gets a shot at the predicted intercept soonest without getting hit or falling into
+// a well. Shoots when a bullet fired now would meet the enemy where it's going to be
+ShipInput aiGenerateLookaheadInput(const entt::registry& registry, entt::registry::entity_type selfShip, Vec2 worldSize);
+
+// Plays matchesCount matches of the lookahead AI against the default one on both sides and prints the time per decision
+// and the score if verbose. Returns false if a decision takes longer than AI_LOOKAHEAD_BUDGET_US on average
+bool runAiLookaheadBench(int matchesCount, bool verbose);
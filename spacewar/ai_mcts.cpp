@@ -0,0 +1,600 @@
+﻿#include "ai_mcts.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+// as createProjectileEntity sets its DestroyTimerComponent
+constexpr float AI_MCTS_PROJECTILE_LIFETIME = 5.f;
+constexpr int AI_MCTS_STEPS_PER_ACTION = 2;
+constexpr int AI_MCTS_ROLLOUT_ACTIONS_COUNT = 8;
+constexpr int AI_MCTS_MAX_DEPTH = 16;
+constexpr float AI_MCTS_EXPLORATION = 0.7f;
+// how often a worker publishes its root visits and looks at the clock
+constexpr int AI_MCTS_ITERATIONS_PER_PUBLISH = 32;
+// a ship this close to a well is pulled in before thrust can get it out
+constexpr float AI_MCTS_WELL_DANGER_RADIUS = 60.f;
+
+bool aiMctsCaptureState(const entt::registry& registry, const entt::registry::entity_type selfShip, const Vec2 worldSize, AiMctsState& outState)
+{
+    entt::registry::entity_type enemyShip = entt::null;
+    for (auto [entity, ship] : registry.view<const ShipComponent>().each())
+    {
+        if (entity != selfShip)
+        {
+            enemyShip = entity;
+            break;
+        }
+    }
+    if (!registry.valid(selfShip) || !registry.valid(enemyShip))
+    {
+        return false;
+    }
+
+    const std::array<entt::registry::entity_type, 2> ships{selfShip, enemyShip};
+    for (size_t i = 0; i < ships.size(); ++i)
+    {
+        AiMctsShip& ship = outState.ships[i];
+        ship.position = registry.get<PositionComponent>(ships[i]).vec;
+        ship.velocity = registry.get<VelocityComponent>(ships[i]).vec;
+        ship.angle = registry.get<RotationComponent>(ships[i]).angle;
+        ship.shotCooldownLeft = registry.get<ShootingComponent>(ships[i]).cooldownTimer.timeLeft;
+        ship.isAlive = true;
+    }
+
+    const ShootingComponent& shooting = registry.get<ShootingComponent>(selfShip);
+    outState.rules.acceleration = registry.get<AccelerateByInputComponent>(selfShip).acceleration;
+    outState.rules.rotationSpeed = registry.get<RotateByInputComponent>(selfShip).rotationSpeed;
+    outState.rules.shotCooldown = shooting.cooldownTimer.cooldownTotalTime;
+    outState.rules.projectileSpeed = shooting.projectileSpeed;
+    outState.rules.projectileBirthOffset = shooting.projectileBirthOffset;
+    outState.rules.shipRadius = registry.get<CircleColliderComponent>(selfShip).radius;
+
+    outState.projectilesCount = 0;
+    for (auto [entity, position, velocity, timer] :
+         registry.view<const ProjectileComponent, const PositionComponent, const VelocityComponent, const DestroyTimerComponent>().each())
+    {
+        if (outState.projectilesCount < AI_MCTS_MAX_PROJECTILES_COUNT)
+        {
+            outState.projectiles[outState.projectilesCount++] = AiMctsProjectile{position.vec, velocity.vec, timer.timeLeft};
+        }
+    }
+
+    outState.wellsCount = 0;
+    for (auto [entity, well, position] : registry.view<const GravityWellComponent, const PositionComponent>().each())
+    {
+        if (outState.wellsCount < AI_LOOKAHEAD_MAX_WELLS_COUNT)
+        {
+            outState.wells[outState.wellsCount++] = AiLookaheadWell{position.vec, well};
+        }
+    }
+
+    outState.worldSize = worldSize;
+    return true;
+}
+
+void aiMctsStep(AiMctsState& state, const std::array<ShipInput, 2>& inputs, const float dt)
+{
+    const AiMctsRules& rules = state.rules;
+
+    for (size_t i = 0; i < state.ships.size(); ++i)
+    {
+        AiMctsShip& ship = state.ships[i];
+        if (!ship.isAlive)
+        {
+            continue;
+        }
+
+        for (int wellIndex = 0; wellIndex < state.wellsCount; ++wellIndex)
+        {
+            const AiLookaheadWell& well = state.wells[wellIndex];
+            if (vec2Dist(well.position, ship.position) < well.well.dragRadius)
+            {
+                ship.velocity -= ship.velocity * dt * well.well.dragCoefficient;
+            }
+            ship.velocity += gameGetGravityWellVectorAtPoint(well.well, well.position, ship.position) * dt;
+        }
+
+        const Vec2 direction = vec2AngleToDir(ship.angle);
+        if (inputs[i].thrust)
+        {
+            ship.velocity += direction * rules.acceleration * dt;
+        }
+        ship.angle = floatWrap(ship.angle + inputs[i].rotate * rules.rotationSpeed * dt, 360.f);
+        ship.position = vec2Wrap(ship.position + ship.velocity * dt, state.worldSize);
+
+        // like CooldownTimer::updateAndGetWasUsed
+        ship.shotCooldownLeft -= dt;
+        if (ship.shotCooldownLeft <= 0.f)
+        {
+            ship.shotCooldownLeft = 0.f;
+            if (inputs[i].shoot && state.projectilesCount < AI_MCTS_MAX_PROJECTILES_COUNT)
+            {
+                const Vec2 shotDirection = vec2AngleToDir(ship.angle);
+                state.projectiles[state.projectilesCount++] = AiMctsProjectile{ship.position + shotDirection * rules.projectileBirthOffset,
+                                                                               shotDirection * rules.projectileSpeed, AI_MCTS_PROJECTILE_LIFETIME};
+                ship.shotCooldownLeft = rules.shotCooldown;
+            }
+        }
+    }
+
+    for (int i = 0; i < state.projectilesCount;)
+    {
+        AiMctsProjectile& projectile = state.projectiles[i];
+        const Vec2 newPosition = projectile.position + projectile.velocity * dt;
+
+        bool isHit = false;
+        for (AiMctsShip& ship : state.ships)
+        {
+            if (ship.isAlive && isSegmentIntersectCircle(projectile.position, newPosition, ship.position, rules.shipRadius))
+            {
+                ship.isAlive = false;
+                isHit = true;
+                break;
+            }
+        }
+
+        projectile.position = vec2Wrap(newPosition, state.worldSize);
+        projectile.timeLeft -= dt;
+
+        if (isHit || projectile.timeLeft <= 0.f)
+        {
+            projectile = state.projectiles[--state.projectilesCount];
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    AiMctsShip& first = state.ships[0];
+    AiMctsShip& second = state.ships[1];
+    if (first.isAlive && second.isAlive && isCircleIntersectCircle(first.position, rules.shipRadius, second.position, rules.shipRadius))
+    {
+        first.isAlive = false;
+        second.isAlive = false;
+    }
+}
+
+ShipInput aiMctsGetActionInput(const int action)
+{
+    ShipInput input;
+    input.rotate = static_cast<float>(action % 3 - 1);
+    input.thrust = action / 3 % 2 != 0;
+    input.shoot = action / 6 != 0;
+    return input;
+}
+
+// aiGenerateInput with the default params, on the compact state
+static ShipInput getDefaultAiInput(const AiMctsState& state, const int shipIndex)
+{
+    const AiMctsShip& self = state.ships[shipIndex];
+    const AiMctsShip& enemy = state.ships[1 - shipIndex];
+    if (!self.isAlive || !enemy.isAlive)
+    {
+        return {};
+    }
+
+    const AiParams params{};
+    const Vec2 vecToEnemy = enemy.position - self.position;
+    const float distToEnemy = vec2Length(vecToEnemy);
+    const float angleDiff = vec2DirToAngle(vecToEnemy) - self.angle;
+    const float angleDiffAbs = std::abs(angleDiff);
+
+    ShipInput result;
+    result.rotate = angleDiff > 0 ? 1.f : -1.f;
+    if (angleDiffAbs < params.thrustAngle)
+    {
+        result.thrust = distToEnemy > params.thrustDistance;
+    }
+    result.shoot = angleDiffAbs < params.shootAngle;
+    return result;
+}
+
+static bool isStateTerminal(const AiMctsState& state)
+{
+    return !state.ships[0].isAlive || !state.ships[1].isAlive;
+}
+
+AiMctsTree::AiMctsTree(const uint64_t seed)
+{
+    m_nodes.reserve(AI_MCTS_MAX_NODES_COUNT);
+    m_path.reserve(AI_MCTS_MAX_DEPTH + 1);
+    // splitmix64 step, like randomSeed, the tree has its own sequence so it doesn't touch the game's one
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    m_randomState = (z ^ (z >> 31)) | 1ull;
+}
+
+void AiMctsTree::reset(const AiMctsState& rootState)
+{
+    m_rootState = rootState;
+    m_nodes.clear();
+    m_nodes.emplace_back();
+    m_iterationsCount = 0;
+}
+
+void AiMctsTree::runIterations(const int iterationsCount)
+{
+    for (int i = 0; i < iterationsCount; ++i)
+    {
+        runIteration();
+    }
+}
+
+int AiMctsTree::getBestAction() const
+{
+    int bestAction = 0;
+    for (int action = 1; action < AI_MCTS_ACTIONS_COUNT; ++action)
+    {
+        bestAction = getRootVisits(action) > getRootVisits(bestAction) ? action : bestAction;
+    }
+    return bestAction;
+}
+
+uint32_t AiMctsTree::getRootVisits(const int action) const
+{
+    const int32_t firstChildIndex = m_nodes.empty() ? -1 : m_nodes.front().firstChildIndex;
+    return firstChildIndex < 0 ? 0 : m_nodes[firstChildIndex + action].visitsCount;
+}
+
+int64_t AiMctsTree::getIterationsCount() const
+{
+    return m_iterationsCount;
+}
+
+void AiMctsTree::runIteration()
+{
+    AiMctsState state = m_rootState;
+    m_path.clear();
+    m_path.push_back(0);
+
+    // selection and expansion, a node gets children on its second visit, the first one only gets a rollout
+    int32_t nodeIndex = 0;
+    while (!isStateTerminal(state) && static_cast<int>(m_path.size()) <= AI_MCTS_MAX_DEPTH)
+    {
+        if (m_nodes[nodeIndex].firstChildIndex < 0)
+        {
+            if (m_nodes[nodeIndex].visitsCount == 0 || m_nodes.size() + AI_MCTS_ACTIONS_COUNT > AI_MCTS_MAX_NODES_COUNT)
+            {
+                break;
+            }
+            m_nodes[nodeIndex].firstChildIndex = static_cast<int32_t>(m_nodes.size());
+            m_nodes.resize(m_nodes.size() + AI_MCTS_ACTIONS_COUNT);
+        }
+
+        const Node& node = m_nodes[nodeIndex];
+        const float logVisits = std::log(static_cast<float>(std::max(1u, node.visitsCount)));
+        int bestAction = -1;
+        float bestPriority = 0.f;
+
+        for (int action = 0; action < AI_MCTS_ACTIONS_COUNT; ++action)
+        {
+            const Node& child = m_nodes[node.firstChildIndex + action];
+            if (child.visitsCount == 0)
+            {
+                bestAction = action;
+                break;
+            }
+
+            const float visits = static_cast<float>(child.visitsCount);
+            const float priority = child.valueSum / visits + AI_MCTS_EXPLORATION * std::sqrt(logVisits / visits);
+            if (bestAction < 0 || priority > bestPriority)
+            {
+                bestAction = action;
+                bestPriority = priority;
+            }
+        }
+
+        stepAction(state, bestAction);
+        nodeIndex = node.firstChildIndex + bestAction;
+        m_path.push_back(nodeIndex);
+
+        if (m_nodes[nodeIndex].visitsCount == 0)
+        {
+            break;
+        }
+    }
+
+    for (int i = 0; i < AI_MCTS_ROLLOUT_ACTIONS_COUNT && !isStateTerminal(state); ++i)
+    {
+        stepAction(state, static_cast<int>(nextRandom() % AI_MCTS_ACTIONS_COUNT));
+    }
+
+    const float value = evaluate(state);
+    for (const int32_t index : m_path)
+    {
+        ++m_nodes[index].visitsCount;
+        m_nodes[index].valueSum += value;
+    }
+
+    ++m_iterationsCount;
+}
+
+void AiMctsTree::stepAction(AiMctsState& state, const int action) const
+{
+    const float dt = static_cast<float>(AI_MCTS_TICKS_PER_ACTION) / AI_MCTS_STEPS_PER_ACTION * GAME_TICK_DT;
+    const ShipInput input = aiMctsGetActionInput(action);
+
+    for (int i = 0; i < AI_MCTS_STEPS_PER_ACTION && !isStateTerminal(state); ++i)
+    {
+        aiMctsStep(state, {input, getDefaultAiInput(state, 1)}, dt);
+    }
+}
+
+// 1 for a win, 0 for a loss, a tie and an open game are in between
+float AiMctsTree::evaluate(const AiMctsState& state) const
+{
+    const AiMctsShip& self = state.ships[0];
+    const AiMctsShip& enemy = state.ships[1];
+    if (!self.isAlive)
+    {
+        return enemy.isAlive ? 0.f : 0.5f;
+    }
+    if (!enemy.isAlive)
+    {
+        return 1.f;
+    }
+
+    // pointing at the enemy from shooting range is a good place to be, being about to fall into a well isn't
+    const Vec2 toEnemy = vec2WrappedDiff(self.position, enemy.position, state.worldSize);
+    const float distance = vec2Length(toEnemy);
+    const float aim = distance > 0.f && distance < 600.f ? std::max(0.f, vec2Dot(vec2AngleToDir(self.angle), toEnemy / distance)) : 0.f;
+
+    bool isNearWell = false;
+    for (int i = 0; i < state.wellsCount; ++i)
+    {
+        isNearWell = isNearWell || vec2Dist(self.position, state.wells[i].position) < AI_MCTS_WELL_DANGER_RADIUS;
+    }
+
+    return 0.5f + 0.2f * aim - (isNearWell ? 0.2f : 0.f);
+}
+
+uint32_t AiMctsTree::nextRandom()
+{
+    // xorshift64*
+    m_randomState ^= m_randomState >> 12;
+    m_randomState ^= m_randomState << 25;
+    m_randomState ^= m_randomState >> 27;
+    return static_cast<uint32_t>((m_randomState * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+AiMctsSearcher::AiMctsSearcher(const int threadsCount, const float decisionBudgetMs) : m_decisionBudgetMs(decisionBudgetMs)
+{
+    const int workersCount = threadsCount > 0 ? threadsCount : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    for (int i = 0; i < workersCount; ++i)
+    {
+        m_slots.push_back(std::make_unique<WorkerSlot>());
+    }
+    for (int i = 0; i < workersCount; ++i)
+    {
+        m_slots[i]->thread = std::thread{[this, i]()
+        {
+            workerLoop(i);
+        }};
+    }
+}
+
+AiMctsSearcher::~AiMctsSearcher()
+{
+    {
+        const std::lock_guard<std::mutex> lock{m_stateMutex};
+        m_isStopping = true;
+    }
+    m_stateCondition.notify_all();
+
+    for (const std::unique_ptr<WorkerSlot>& slot : m_slots)
+    {
+        slot->thread.join();
+    }
+}
+
+void AiMctsSearcher::publishState(const AiMctsState& state)
+{
+    std::unique_lock<std::mutex> lock{m_stateMutex, std::try_to_lock};
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+
+    m_state = state;
+    ++m_stateVersion;
+    lock.unlock();
+
+    m_stateCondition.notify_all();
+}
+
+ShipInput AiMctsSearcher::getBestInput() const
+{
+    uint64_t newestVersion = 0;
+    for (const std::unique_ptr<WorkerSlot>& slot : m_slots)
+    {
+        newestVersion = std::max(newestVersion, slot->stateVersion.load(std::memory_order_acquire));
+    }
+    if (newestVersion == 0)
+    {
+        return {};
+    }
+
+    std::array<uint64_t, AI_MCTS_ACTIONS_COUNT> visits{};
+    for (const std::unique_ptr<WorkerSlot>& slot : m_slots)
+    {
+        if (slot->stateVersion.load(std::memory_order_acquire) != newestVersion)
+        {
+            continue;
+        }
+        for (int action = 0; action < AI_MCTS_ACTIONS_COUNT; ++action)
+        {
+            visits[action] += slot->rootVisits[action].load(std::memory_order_relaxed);
+        }
+    }
+
+    const auto bestVisits = std::max_element(visits.begin(), visits.end());
+    return *bestVisits > 0 ? aiMctsGetActionInput(static_cast<int>(bestVisits - visits.begin())) : ShipInput{};
+}
+
+AiMctsStats AiMctsSearcher::getStats() const
+{
+    AiMctsStats stats;
+    for (const std::unique_ptr<WorkerSlot>& slot : m_slots)
+    {
+        stats.iterationsCount += slot->iterationsCount.load(std::memory_order_relaxed);
+        stats.searchesCount += slot->searchesCount.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+int AiMctsSearcher::getThreadsCount() const
+{
+    return static_cast<int>(m_slots.size());
+}
+
+void AiMctsSearcher::workerLoop(const int workerIndex)
+{
+    profilerSetThreadName("mcts " + std::to_string(workerIndex));
+
+    WorkerSlot& slot = *m_slots[workerIndex];
+    // the workers differ only in their rollouts
+    AiMctsTree tree{static_cast<uint64_t>(workerIndex) + 1};
+    const auto budget = std::chrono::duration<float, std::milli>(m_decisionBudgetMs);
+    uint64_t searchedVersion = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_stateMutex};
+            m_stateCondition.wait(lock, [this, searchedVersion]()
+            {
+                return m_isStopping || m_stateVersion != searchedVersion;
+            });
+            if (m_isStopping)
+            {
+                return;
+            }
+
+            tree.reset(m_state);
+            searchedVersion = m_stateVersion;
+        }
+
+        slot.searchesCount.fetch_add(1, std::memory_order_relaxed);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+        int64_t publishedIterationsCount = 0;
+
+        do
+        {
+            tree.runIterations(AI_MCTS_ITERATIONS_PER_PUBLISH);
+
+            for (int action = 0; action < AI_MCTS_ACTIONS_COUNT; ++action)
+            {
+                slot.rootVisits[action].store(tree.getRootVisits(action), std::memory_order_relaxed);
+            }
+            slot.stateVersion.store(searchedVersion, std::memory_order_release);
+
+            slot.iterationsCount.fetch_add(tree.getIterationsCount() - publishedIterationsCount, std::memory_order_relaxed);
+            publishedIterationsCount = tree.getIterationsCount();
+        } while (std::chrono::steady_clock::now() < deadline && m_stateVersion == searchedVersion && !m_isStopping);
+    }
+}
+
+bool runAiMctsBench(const int matchesCount, const int threadsCount, const float decisionBudgetMs, const bool verbose)
+{
+    constexpr int playersCount = 2;
+    constexpr int maxMatchTicks = 60 * 60;
+    const Vec2 worldSize{1000.f, 1000.f};
+    const auto tickPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(GAME_TICK_DT));
+
+    AiMctsSearcher searcher{threadsCount, decisionBudgetMs};
+    entt::registry registry;
+    std::vector<Player> players(playersCount);
+    AiMctsState state;
+
+    int64_t ticksCount = 0;
+    int64_t totalAiNs = 0;
+    int64_t maxAiNs = 0;
+    int winsCount = 0;
+    int lossesCount = 0;
+
+    const uint64_t callerRandomState = randomGetState();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int match = 0; match < matchesCount; ++match)
+    {
+        // both sides, the world isn't symmetric for the ships
+        const int mctsPlayerIndex = match % 2;
+        randomSeed(static_cast<uint64_t>(match / 2));
+        recreateGameWorld(registry, players, worldSize);
+        auto nextTickTime = std::chrono::steady_clock::now();
+
+        for (int tick = 0; tick < maxMatchTicks; ++tick)
+        {
+            for (int i = 0; i < playersCount; ++i)
+            {
+                const entt::registry::entity_type ship = players[i].shipEntity;
+                if (!registry.valid(ship))
+                {
+                    continue;
+                }
+
+                if (i != mctsPlayerIndex)
+                {
+                    applyShipInput(registry, ship, aiGenerateInput(registry, ship));
+                    continue;
+                }
+
+                // all the tick does for the MCTS AI, it must not wait for the search
+                const auto aiStart = std::chrono::steady_clock::now();
+                if (aiMctsCaptureState(registry, ship, worldSize, state))
+                {
+                    searcher.publishState(state);
+                }
+                applyShipInput(registry, ship, searcher.getBestInput());
+                const int64_t aiNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - aiStart).count();
+
+                totalAiNs += aiNs;
+                maxAiNs = std::max(maxAiNs, aiNs);
+            }
+
+            gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+            ++ticksCount;
+
+            const std::optional<GameResult> result = tryGetGameResult(registry, playersCount);
+            if (result.has_value())
+            {
+                winsCount += result->victoriousPlayerIndex == mctsPlayerIndex ? 1 : 0;
+                lossesCount += !result->isTie() && result->victoriousPlayerIndex != mctsPlayerIndex ? 1 : 0;
+                break;
+            }
+
+            // the search runs in real time, so the match has to as well
+            nextTickTime += tickPeriod;
+            std::this_thread::sleep_until(nextTickTime);
+        }
+    }
+
+    randomSetState(callerRandomState);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const AiMctsStats stats = searcher.getStats();
+    const bool isOk = stats.searchesCount > 0 && stats.iterationsCount > 0;
+
+    if (verbose)
+    {
+        std::printf("mcts ai: %d threads, %.1f ms per decision, %d matches in %.1f s\n", searcher.getThreadsCount(), decisionBudgetMs, matchesCount,
+                    seconds);
+        std::printf("%.0f iterations per second, %.0f per searched state\n", static_cast<double>(stats.iterationsCount) / seconds,
+                    stats.searchesCount > 0 ? static_cast<double>(stats.iterationsCount) / stats.searchesCount : 0.0);
+        std::printf("time in the tick: mean %.2f us, max %.2f us\n", ticksCount > 0 ? static_cast<double>(totalAiNs) / ticksCount / 1000.0 : 0.0,
+                    static_cast<double>(maxAiNs) / 1000.0);
+        std::printf("against the default ai: won %d, lost %d, tied %d\n", winsCount, lossesCount, matchesCount - winsCount - lossesCount);
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
@@ -0,0 +1,155 @@
+﻿#pragma once
+
+#include "ai_lookahead.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// rotate (left, none, right) x thrust x shoot
+constexpr int AI_MCTS_ACTIONS_COUNT = 12;
+// an action of the tree is held for this many ticks, simulated in two steps
+constexpr int AI_MCTS_TICKS_PER_ACTION = 6;
+constexpr int AI_MCTS_MAX_PROJECTILES_COUNT = 32;
+constexpr int AI_MCTS_MAX_NODES_COUNT = 1 << 15;
+// half a tick of search, a result is at most a couple of ticks old when the tick uses it
+constexpr float AI_MCTS_DECISION_BUDGET_MS = 8.f;
+
+struct AiMctsShip
+{
+    Vec2 position{};
+    Vec2 velocity{};
+    float angle = 0.f;
+    float shotCooldownLeft = 0.f;
+    bool isAlive = false;
+};
+
+struct AiMctsProjectile
+{
+    Vec2 position{};
+    Vec2 velocity{};
+    float timeLeft = 0.f;
+};
+
+// ship constants, both ships are built by createShipEntity
+struct AiMctsRules
+{
+    float acceleration = 0.f;
+    float rotationSpeed = 0.f;
+    float shotCooldown = 0.f;
+    float projectileSpeed = 0.f;
+    float projectileBirthOffset = 0.f;
+    float shipRadius = 0.f;
+};
+
+// Plain copyable game state for the search, the searching ship is the first one. Teleports and impulses are left out
+struct AiMctsState
+{
+    std::array<AiMctsShip, 2> ships{};
+    std::array<AiMctsProjectile, AI_MCTS_MAX_PROJECTILES_COUNT> projectiles{};
+    int projectilesCount = 0;
+    std::array<AiLookaheadWell, AI_LOOKAHEAD_MAX_WELLS_COUNT> wells{};
+    int wellsCount = 0;
+    AiMctsRules rules{};
+    Vec2 worldSize{};
+};
+
+// returns false if there is no enemy ship to search against
+bool aiMctsCaptureState(const entt::registry& registry, entt::registry::entity_type selfShip, Vec2 worldSize, AiMctsState& outState);
+// advances the state like the game systems would with the given inputs of both ships
+void aiMctsStep(AiMctsState& state, const std::array<ShipInput, 2>& inputs, float dt);
+ShipInput aiMctsGetActionInput(int action);
+
+// Single agent UCT search over the actions of the first ship, the enemy is played by the default AI. Nodes don't keep
+// states, every iteration replays its path from the root, so a node is a few bytes and the pool is allocated once
+class AiMctsTree
+{
+public:
+    explicit AiMctsTree(uint64_t seed);
+
+    void reset(const AiMctsState& rootState);
+    void runIterations(int iterationsCount);
+
+    int getBestAction() const;
+    uint32_t getRootVisits(int action) const;
+    int64_t getIterationsCount() const;
+
+private:
+    struct Node
+    {
+        // children are AI_MCTS_ACTIONS_COUNT nodes in a row, -1 while not expanded
+        int32_t firstChildIndex = -1;
+        uint32_t visitsCount = 0;
+        float valueSum = 0.f;
+    };
+
+    void runIteration();
+    void stepAction(AiMctsState& state, int action) const;
+    float evaluate(const AiMctsState& state) const;
+    uint32_t nextRandom();
+
+    AiMctsState m_rootState{};
+    std::vector<Node> m_nodes{};
+    std::vector<int32_t> m_path{};
+    int64_t m_iterationsCount = 0;
+    uint64_t m_randomState = 0;
+};
+
+struct AiMctsStats
+{
+    int64_t iterationsCount = 0;
+    // states a search was started from
+    int64_t searchesCount = 0;
+};
+
+// Runs the search on background threads, the game tick only hands states over and reads results, it never waits.
+// Every worker grows its own tree from the newest state with its own random rollouts and publishes the root visits to
+// its slot as it goes, the reader sums the slots of the newest state, so more cores give more iterations per decision
+class AiMctsSearcher
+{
+public:
+    // threadsCount 0 means one worker per core. A search stops after decisionBudgetMs or when a newer state comes
+    AiMctsSearcher(int threadsCount, float decisionBudgetMs);
+    ~AiMctsSearcher();
+
+    AiMctsSearcher(const AiMctsSearcher&) = delete;
+    AiMctsSearcher& operator=(const AiMctsSearcher&) = delete;
+
+    // skips the state if a worker is taking the previous one right now, the next tick brings a fresh one anyway
+    void publishState(const AiMctsState& state);
+    // the most visited action so far for the newest searched state, no input before the first search
+    ShipInput getBestInput() const;
+    AiMctsStats getStats() const;
+    int getThreadsCount() const;
+
+private:
+    struct alignas(64) WorkerSlot
+    {
+        // written after the visits, a reader that sees it sees visits of that state or a newer one
+        std::atomic<uint64_t> stateVersion{0};
+        std::array<std::atomic<uint32_t>, AI_MCTS_ACTIONS_COUNT> rootVisits{};
+        std::atomic<int64_t> iterationsCount{0};
+        std::atomic<int64_t> searchesCount{0};
+        std::thread thread{};
+    };
+
+    void workerLoop(int workerIndex);
+
+    std::vector<std::unique_ptr<WorkerSlot>> m_slots{};
+    const float m_decisionBudgetMs;
+
+    std::mutex m_stateMutex{};
+    std::condition_variable m_stateCondition{};
+    AiMctsState m_state{};
+    std::atomic<uint64_t> m_stateVersion{0};
+    std::atomic<bool> m_isStopping{false};
+};
+
+// Plays matchesCount real time matches of the MCTS AI against the default one and prints the iterations per decision,
+// the time the tick spent on the AI and the score if verbose. Returns false if no search ran
+bool runAiMctsBench(int matchesCount, int threadsCount, float decisionBudgetMs, bool verbose);
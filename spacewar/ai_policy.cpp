@@ -0,0 +1,607 @@
+﻿#include "ai_policy.h"
+#include "ai_policy_avx2.h"
+#include "game_entities.h"
+
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// File layout, numbers in native byte order like replays:
+// "SWNN", u16 version, u8 layers count, then per layer u16 inputs count, u16 outputs count, f32 weights row by row, f32 biases
+constexpr char AI_POLICY_MAGIC[4] = {'S', 'W', 'N', 'N'};
+constexpr uint16_t AI_POLICY_VERSION = 1;
+constexpr int AI_POLICY_MAX_LAYER_SIZE = 4096;
+
+// floats in an SSE register
+constexpr int AI_POLICY_LANES_COUNT = 4;
+// outputs a kernel computes at once, two registers
+constexpr int AI_POLICY_OUTPUTS_BLOCK_SIZE = 2 * AI_POLICY_LANES_COUNT;
+// velocities are divided by it, ships and projectiles rarely go faster
+constexpr float AI_POLICY_SPEED_SCALE = 400.f;
+
+bool isAiPolicyValid(const AiPolicy& policy)
+{
+    if (policy.layers.empty() || policy.layers.front().inputsCount != SPACEWAR_ENV_OBSERVATION_SIZE ||
+        policy.layers.back().outputsCount != SPACEWAR_ENV_ACTIONS_COUNT)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < policy.layers.size(); ++i)
+    {
+        const AiPolicyLayer& layer = policy.layers[i];
+        const bool isChained = i == 0 || policy.layers[i - 1].outputsCount == layer.inputsCount;
+        const bool isSized = layer.weights.size() == static_cast<size_t>(layer.inputsCount) * layer.outputsCount &&
+            layer.biases.size() == static_cast<size_t>(layer.outputsCount);
+        if (!isChained || !isSized || layer.inputsCount <= 0 || layer.inputsCount > AI_POLICY_MAX_LAYER_SIZE || layer.outputsCount <= 0 ||
+            layer.outputsCount > AI_POLICY_MAX_LAYER_SIZE)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+AiPolicy createRandomAiPolicy(const int hiddenSize, const int hiddenLayersCount, const uint64_t seed)
+{
+    const uint64_t callerRandomState = randomGetState();
+    randomSeed(seed);
+
+    AiPolicy policy;
+    int inputsCount = SPACEWAR_ENV_OBSERVATION_SIZE;
+    for (int i = 0; i <= hiddenLayersCount; ++i)
+    {
+        AiPolicyLayer layer;
+        layer.inputsCount = inputsCount;
+        layer.outputsCount = i < hiddenLayersCount ? hiddenSize : SPACEWAR_ENV_ACTIONS_COUNT;
+
+        // keeps the activations in the same range through the ReLUs
+        const float range = std::sqrt(6.f / static_cast<float>(layer.inputsCount));
+        layer.weights.resize(static_cast<size_t>(layer.inputsCount) * layer.outputsCount);
+        for (float& weight : layer.weights)
+        {
+            weight = randomFloatRange(-range, range);
+        }
+        layer.biases.assign(layer.outputsCount, 0.f);
+
+        inputsCount = layer.outputsCount;
+        policy.layers.push_back(std::move(layer));
+    }
+
+    randomSetState(callerRandomState);
+    return policy;
+}
+
+template <typename T>
+static void writeRaw(std::vector<uint8_t>& buffer, const T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.insert(buffer.end(), std::begin(bytes), std::end(bytes));
+}
+
+// every read after the end of the buffer fails and leaves the reader failed
+struct AiPolicyReader
+{
+    const std::vector<uint8_t>& buffer;
+    size_t offset = 0;
+    bool failed = false;
+
+    template <typename T>
+    T readRaw()
+    {
+        T value{};
+        if (offset + sizeof(T) > buffer.size())
+        {
+            failed = true;
+            return value;
+        }
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+};
+
+bool saveAiPolicy(const AiPolicy& policy, const std::string& filePath)
+{
+    if (!isAiPolicyValid(policy))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer;
+    buffer.insert(buffer.end(), std::begin(AI_POLICY_MAGIC), std::end(AI_POLICY_MAGIC));
+    writeRaw(buffer, AI_POLICY_VERSION);
+    writeRaw(buffer, static_cast<uint8_t>(policy.layers.size()));
+
+    for (const AiPolicyLayer& layer : policy.layers)
+    {
+        writeRaw(buffer, static_cast<uint16_t>(layer.inputsCount));
+        writeRaw(buffer, static_cast<uint16_t>(layer.outputsCount));
+        for (const float weight : layer.weights)
+        {
+            writeRaw(buffer, weight);
+        }
+        for (const float bias : layer.biases)
+        {
+            writeRaw(buffer, bias);
+        }
+    }
+
+    std::ofstream file{filePath, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return static_cast<bool>(file);
+}
+
+bool loadAiPolicy(const std::string& filePath, AiPolicy& outPolicy)
+{
+    std::ifstream file{filePath, std::ios::binary};
+    if (!file)
+    {
+        return false;
+    }
+
+    const std::vector<uint8_t> buffer{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    AiPolicyReader reader{buffer};
+
+    for (const char magicChar : AI_POLICY_MAGIC)
+    {
+        if (reader.readRaw<char>() != magicChar)
+        {
+            return false;
+        }
+    }
+
+    if (reader.readRaw<uint16_t>() != AI_POLICY_VERSION)
+    {
+        return false;
+    }
+
+    AiPolicy policy;
+    const int layersCount = reader.readRaw<uint8_t>();
+    for (int i = 0; i < layersCount && !reader.failed; ++i)
+    {
+        AiPolicyLayer layer;
+        layer.inputsCount = reader.readRaw<uint16_t>();
+        layer.outputsCount = reader.readRaw<uint16_t>();
+        if (layer.inputsCount > AI_POLICY_MAX_LAYER_SIZE || layer.outputsCount > AI_POLICY_MAX_LAYER_SIZE)
+        {
+            return false;
+        }
+
+        layer.weights.resize(static_cast<size_t>(layer.inputsCount) * layer.outputsCount);
+        for (float& weight : layer.weights)
+        {
+            weight = reader.readRaw<float>();
+        }
+        layer.biases.resize(layer.outputsCount);
+        for (float& bias : layer.biases)
+        {
+            bias = reader.readRaw<float>();
+        }
+
+        policy.layers.push_back(std::move(layer));
+    }
+
+    if (reader.failed || reader.offset != buffer.size() || !isAiPolicyValid(policy))
+    {
+        return false;
+    }
+
+    outPolicy = std::move(policy);
+    return true;
+}
+
+static float* writeShipObservation(float* out, const entt::registry& registry, const entt::registry::entity_type ship,
+                                   const Vec2 position, const Vec2 worldSize)
+{
+    if (!registry.valid(ship))
+    {
+        std::fill(out, out + SPACEWAR_ENV_SHIP_OBSERVATION_SIZE, 0.f);
+        return out + SPACEWAR_ENV_SHIP_OBSERVATION_SIZE;
+    }
+
+    const Vec2 velocity = registry.get<VelocityComponent>(ship).vec;
+    const Vec2 direction = vec2AngleToDir(registry.get<RotationComponent>(ship).angle);
+    const CooldownTimer& shotCooldown = registry.get<ShootingComponent>(ship).cooldownTimer;
+    const CooldownTimer& impulseCooldown = registry.get<AccelerateImpulseByInputComponent>(ship).cooldownTimer;
+
+    *out++ = 1.f;
+    *out++ = position.x / worldSize.x;
+    *out++ = position.y / worldSize.y;
+    *out++ = velocity.x / AI_POLICY_SPEED_SCALE;
+    *out++ = velocity.y / AI_POLICY_SPEED_SCALE;
+    *out++ = direction.x;
+    *out++ = direction.y;
+    *out++ = shotCooldown.timeLeft / shotCooldown.cooldownTotalTime;
+    *out++ = impulseCooldown.timeLeft / impulseCooldown.cooldownTotalTime;
+    return out;
+}
+
+void aiPolicyWriteObservation(float* out, const entt::registry& registry, const entt::registry::entity_type ownShip,
+                              const entt::registry::entity_type enemyShip, const Vec2 worldSize)
+{
+    // vec_env ends the episode when the own ship is destroyed, so there is always a point to look from
+    const Vec2 ownPosition = registry.valid(ownShip) ? registry.get<PositionComponent>(ownShip).vec : worldSize / 2.f;
+    out = writeShipObservation(out, registry, ownShip, ownPosition, worldSize);
+
+    const Vec2 enemyOffset = registry.valid(enemyShip) ? vec2WrappedDiff(ownPosition, registry.get<PositionComponent>(enemyShip).vec, worldSize)
+                                                       : Vec2{};
+    out = writeShipObservation(out, registry, enemyShip, enemyOffset, worldSize);
+
+    Vec2 wellOffset{};
+    registry.view<const GravityWellComponent, const PositionComponent>().each([&](const GravityWellComponent&, const PositionComponent& position)
+    {
+        wellOffset = vec2WrappedDiff(ownPosition, position.vec, worldSize);
+    });
+    *out++ = wellOffset.x / worldSize.x;
+    *out++ = wellOffset.y / worldSize.y;
+    *out++ = vec2Length(wellOffset) / worldSize.x;
+
+    // insertion into a fixed array keeps the nearest ones in order without allocating
+    struct ObservedProjectile
+    {
+        float distanceSq = 0.f;
+        Vec2 offset{};
+        Vec2 velocity{};
+    };
+    std::array<ObservedProjectile, SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT> nearest{};
+    int nearestCount = 0;
+
+    registry.view<const ProjectileComponent, const PositionComponent, const VelocityComponent>().each(
+        [&](const PositionComponent& position, const VelocityComponent& velocity)
+        {
+            const Vec2 offset = vec2WrappedDiff(ownPosition, position.vec, worldSize);
+            const float distanceSq = vec2LengthSq(offset);
+            if (nearestCount == SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT && distanceSq >= nearest[nearestCount - 1].distanceSq)
+            {
+                return;
+            }
+
+            int index = std::min(nearestCount, SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT - 1);
+            for (; index > 0 && nearest[index - 1].distanceSq > distanceSq; --index)
+            {
+                nearest[index] = nearest[index - 1];
+            }
+            nearest[index] = ObservedProjectile{distanceSq, offset, velocity.vec};
+            nearestCount = std::min(nearestCount + 1, static_cast<int>(SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT));
+        });
+
+    for (int i = 0; i < SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT; ++i)
+    {
+        const bool isPresent = i < nearestCount;
+        *out++ = isPresent ? 1.f : 0.f;
+        *out++ = isPresent ? nearest[i].offset.x / worldSize.x : 0.f;
+        *out++ = isPresent ? nearest[i].offset.y / worldSize.y : 0.f;
+        *out++ = isPresent ? nearest[i].velocity.x / AI_POLICY_SPEED_SCALE : 0.f;
+        *out++ = isPresent ? nearest[i].velocity.y / AI_POLICY_SPEED_SCALE : 0.f;
+    }
+}
+
+ShipInput aiPolicyGetActionInput(const int32_t action)
+{
+    const int clampedAction = std::clamp(action, 0, SPACEWAR_ENV_ACTIONS_COUNT - 1);
+
+    ShipInput input;
+    input.rotate = static_cast<float>(clampedAction % 3 - 1);
+    input.thrust = clampedAction / 3 % 2 != 0;
+    input.thrustBurst = clampedAction / 6 % 2 != 0;
+    input.shoot = clampedAction / 12 != 0;
+    return input;
+}
+
+bool aiPolicyIsAvx2Supported()
+{
+#ifdef _MSC_VER
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // AVX and OSXSAVE, then the OS has to save the xmm and ymm state
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+AiPolicyNetwork::AiPolicyNetwork(const AiPolicy& policy, const bool isAvx2Allowed)
+{
+    assert(isAiPolicyValid(policy));
+
+    static const bool isAvx2Supported = aiPolicyIsAvx2Supported();
+    m_isAvx2 = isAvx2Allowed && isAvx2Supported;
+
+    for (const AiPolicyLayer& layer : policy.layers)
+    {
+        PackedLayer packed;
+        packed.inputsCount = layer.inputsCount;
+        packed.outputsCount = layer.outputsCount;
+        packed.stride = (layer.outputsCount + AI_POLICY_OUTPUTS_BLOCK_SIZE - 1) / AI_POLICY_OUTPUTS_BLOCK_SIZE * AI_POLICY_OUTPUTS_BLOCK_SIZE;
+
+        // padding outputs have zero weights and bias, so they stay zero and the next layer can read them
+        packed.weights.assign(static_cast<size_t>(packed.inputsCount) * packed.stride, 0.f);
+        for (int output = 0; output < layer.outputsCount; ++output)
+        {
+            for (int input = 0; input < layer.inputsCount; ++input)
+            {
+                packed.weights[input * packed.stride + output] = layer.weights[output * layer.inputsCount + input];
+            }
+        }
+        packed.biases.assign(packed.stride, 0.f);
+        std::copy(layer.biases.begin(), layer.biases.end(), packed.biases.begin());
+
+        m_maxStride = std::max(m_maxStride, packed.stride);
+        m_layers.push_back(std::move(packed));
+    }
+}
+
+static __m128 activate(const __m128 sum, const bool isHidden)
+{
+    return isHidden ? _mm_max_ps(sum, _mm_setzero_ps()) : sum;
+}
+
+// y = x W + b for a block of outputs of four ships, with ReLU if isHidden. Every weight load is shared by the ships and
+// the eight sums are independent, so the adds don't wait for each other. Written out because compilers keep an array
+// of sums in memory
+static void evaluateFourShips(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x,
+                              const int xStride, float* y, const bool isHidden)
+{
+    const __m128 bias0 = _mm_loadu_ps(biases);
+    const __m128 bias1 = _mm_loadu_ps(biases + AI_POLICY_LANES_COUNT);
+    __m128 sum00 = bias0, sum01 = bias1, sum10 = bias0, sum11 = bias1, sum20 = bias0, sum21 = bias1, sum30 = bias0, sum31 = bias1;
+
+    for (int input = 0; input < inputsCount; ++input)
+    {
+        const __m128 weights0 = _mm_loadu_ps(weights + input * stride);
+        const __m128 weights1 = _mm_loadu_ps(weights + input * stride + AI_POLICY_LANES_COUNT);
+
+        const __m128 value0 = _mm_set1_ps(x[input]);
+        const __m128 value1 = _mm_set1_ps(x[xStride + input]);
+        const __m128 value2 = _mm_set1_ps(x[2 * xStride + input]);
+        const __m128 value3 = _mm_set1_ps(x[3 * xStride + input]);
+
+        sum00 = _mm_add_ps(sum00, _mm_mul_ps(value0, weights0));
+        sum01 = _mm_add_ps(sum01, _mm_mul_ps(value0, weights1));
+        sum10 = _mm_add_ps(sum10, _mm_mul_ps(value1, weights0));
+        sum11 = _mm_add_ps(sum11, _mm_mul_ps(value1, weights1));
+        sum20 = _mm_add_ps(sum20, _mm_mul_ps(value2, weights0));
+        sum21 = _mm_add_ps(sum21, _mm_mul_ps(value2, weights1));
+        sum30 = _mm_add_ps(sum30, _mm_mul_ps(value3, weights0));
+        sum31 = _mm_add_ps(sum31, _mm_mul_ps(value3, weights1));
+    }
+
+    _mm_storeu_ps(y, activate(sum00, isHidden));
+    _mm_storeu_ps(y + AI_POLICY_LANES_COUNT, activate(sum01, isHidden));
+    _mm_storeu_ps(y + stride, activate(sum10, isHidden));
+    _mm_storeu_ps(y + stride + AI_POLICY_LANES_COUNT, activate(sum11, isHidden));
+    _mm_storeu_ps(y + 2 * stride, activate(sum20, isHidden));
+    _mm_storeu_ps(y + 2 * stride + AI_POLICY_LANES_COUNT, activate(sum21, isHidden));
+    _mm_storeu_ps(y + 3 * stride, activate(sum30, isHidden));
+    _mm_storeu_ps(y + 3 * stride + AI_POLICY_LANES_COUNT, activate(sum31, isHidden));
+}
+
+// the same for the ships left over after the blocks of four
+static void evaluateOneShip(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x, float* y,
+                            const bool isHidden)
+{
+    __m128 sum0 = _mm_loadu_ps(biases);
+    __m128 sum1 = _mm_loadu_ps(biases + AI_POLICY_LANES_COUNT);
+
+    for (int input = 0; input < inputsCount; ++input)
+    {
+        const __m128 value = _mm_set1_ps(x[input]);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(value, _mm_loadu_ps(weights + input * stride)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(value, _mm_loadu_ps(weights + input * stride + AI_POLICY_LANES_COUNT)));
+    }
+
+    _mm_storeu_ps(y, activate(sum0, isHidden));
+    _mm_storeu_ps(y + AI_POLICY_LANES_COUNT, activate(sum1, isHidden));
+}
+
+bool AiPolicyNetwork::isAvx2() const
+{
+    return m_isAvx2;
+}
+
+static void evaluateLayerSse(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x,
+                             const int xStride, const int count, float* y, const bool isHidden)
+{
+    // four ships at a time, then the rest one by one, two registers of outputs at a time
+    int ship = 0;
+    for (; ship + 4 <= count; ship += 4)
+    {
+        for (int output = 0; output < stride; output += AI_POLICY_OUTPUTS_BLOCK_SIZE)
+        {
+            evaluateFourShips(weights + output, biases + output, stride, inputsCount, x + ship * xStride, xStride, y + ship * stride + output,
+                              isHidden);
+        }
+    }
+    for (; ship < count; ++ship)
+    {
+        for (int output = 0; output < stride; output += AI_POLICY_OUTPUTS_BLOCK_SIZE)
+        {
+            evaluateOneShip(weights + output, biases + output, stride, inputsCount, x + ship * xStride, y + ship * stride + output, isHidden);
+        }
+    }
+}
+
+void AiPolicyNetwork::evaluate(const float* observations, const int count, int32_t* outActions)
+{
+    for (std::vector<float>& activations : m_activations)
+    {
+        if (activations.size() < static_cast<size_t>(count) * m_maxStride)
+        {
+            activations.resize(static_cast<size_t>(count) * m_maxStride);
+        }
+    }
+
+    const float* inputs = observations;
+    int inputsStride = SPACEWAR_ENV_OBSERVATION_SIZE;
+
+    for (size_t layerIndex = 0; layerIndex < m_layers.size(); ++layerIndex)
+    {
+        const PackedLayer& layer = m_layers[layerIndex];
+        const bool isHidden = layerIndex + 1 < m_layers.size();
+        m_outputActivations = static_cast<int>(layerIndex % 2);
+        float* outputs = m_activations[m_outputActivations].data();
+
+        const auto evaluateLayer = m_isAvx2 ? aiPolicyEvaluateLayerAvx2 : evaluateLayerSse;
+        evaluateLayer(layer.weights.data(), layer.biases.data(), layer.stride, layer.inputsCount, inputs, inputsStride, count, outputs,
+                      isHidden);
+
+        inputs = outputs;
+        inputsStride = layer.stride;
+    }
+
+    const int outputsCount = m_layers.back().outputsCount;
+    for (int ship = 0; ship < count; ++ship)
+    {
+        const float* scores = getOutputs(ship);
+        outActions[ship] = static_cast<int32_t>(std::max_element(scores, scores + outputsCount) - scores);
+    }
+}
+
+const float* AiPolicyNetwork::getOutputs(const int index) const
+{
+    return m_activations[m_outputActivations].data() + index * m_layers.back().stride;
+}
+
+void AiPolicyNetwork::generateInputs(const entt::registry& registry, const entt::registry::entity_type* ships, const int count,
+                                     const Vec2 worldSize, ShipInput* outInputs)
+{
+    m_observations.resize(static_cast<size_t>(count) * SPACEWAR_ENV_OBSERVATION_SIZE);
+    m_actions.resize(count);
+
+    const auto shipsView = registry.view<const ShipComponent>();
+    for (int i = 0; i < count; ++i)
+    {
+        entt::registry::entity_type enemyShip = entt::null;
+        for (const auto entity : shipsView)
+        {
+            if (entity != ships[i])
+            {
+                enemyShip = entity;
+                break;
+            }
+        }
+
+        aiPolicyWriteObservation(m_observations.data() + i * SPACEWAR_ENV_OBSERVATION_SIZE, registry, ships[i], enemyShip, worldSize);
+    }
+
+    evaluate(m_observations.data(), count, m_actions.data());
+
+    for (int i = 0; i < count; ++i)
+    {
+        outInputs[i] = aiPolicyGetActionInput(m_actions[i]);
+    }
+}
+
+bool runAiPolicyBench(const int shipsCount, const int passesCount, const bool verbose)
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    const uint64_t callerRandomState = randomGetState();
+    randomSeed(1);
+
+    entt::registry registry;
+    createGravityWellEntity(registry, worldSize);
+    std::vector<entt::registry::entity_type> ships;
+    for (int i = 0; i < shipsCount; ++i)
+    {
+        const Vec2 position{randomFloatRange(0.f, worldSize.x), randomFloatRange(0.f, worldSize.y)};
+        ships.push_back(createShipEntity(registry, position, randomFloatRange(0.f, 360.f), sf::Color::White, i));
+    }
+
+    const AiPolicy policy = createRandomAiPolicy(AI_POLICY_DEFAULT_HIDDEN_SIZE, AI_POLICY_DEFAULT_HIDDEN_LAYERS_COUNT, 1);
+    AiPolicyNetwork network{policy};
+    // the SSE kernels on the same observations, for the comparison with AVX2
+    AiPolicyNetwork sseNetwork{policy, false};
+    std::vector<int32_t> sseActions(shipsCount);
+    std::vector<float> observations(static_cast<size_t>(shipsCount) * SPACEWAR_ENV_OBSERVATION_SIZE);
+    std::vector<int32_t> actions(shipsCount);
+    std::array<int, SPACEWAR_ENV_ACTIONS_COUNT> actionsCounts{};
+
+    int64_t observationsNs = 0;
+    int64_t forwardNs = 0;
+    int64_t sseForwardNs = 0;
+    for (int pass = 0; pass < passesCount; ++pass)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < shipsCount; ++i)
+        {
+            aiPolicyWriteObservation(observations.data() + i * SPACEWAR_ENV_OBSERVATION_SIZE, registry, ships[i], ships[(i + 1) % shipsCount],
+                                     worldSize);
+        }
+        const auto observed = std::chrono::steady_clock::now();
+        network.evaluate(observations.data(), shipsCount, actions.data());
+        const auto finish = std::chrono::steady_clock::now();
+        if (network.isAvx2())
+        {
+            sseNetwork.evaluate(observations.data(), shipsCount, sseActions.data());
+        }
+        const auto sseFinish = std::chrono::steady_clock::now();
+
+        observationsNs += std::chrono::duration_cast<std::chrono::nanoseconds>(observed - start).count();
+        forwardNs += std::chrono::duration_cast<std::chrono::nanoseconds>(finish - observed).count();
+        sseForwardNs += std::chrono::duration_cast<std::chrono::nanoseconds>(sseFinish - finish).count();
+
+        for (const int32_t action : actions)
+        {
+            ++actionsCounts[action];
+        }
+
+        // a different world for the next pass
+        for (const auto ship : ships)
+        {
+            registry.get<RotationComponent>(ship).angle += 7.f;
+        }
+    }
+
+    randomSetState(callerRandomState);
+
+    const double passes = std::max(passesCount, 1);
+    const double forwardUs = static_cast<double>(forwardNs) / passes / 1000.0;
+    const bool isOk = shipsCount > 0 && passesCount > 0 && forwardUs * AI_POLICY_BENCH_SHIPS_COUNT / shipsCount <= AI_POLICY_BUDGET_US;
+
+    if (verbose)
+    {
+        const int distinctActions = static_cast<int>(std::count_if(actionsCounts.begin(), actionsCounts.end(), [](const int c) { return c > 0; }));
+        std::printf("ai policy: %d x %d hidden, %d observations, %d actions\n", AI_POLICY_DEFAULT_HIDDEN_LAYERS_COUNT,
+                    AI_POLICY_DEFAULT_HIDDEN_SIZE, SPACEWAR_ENV_OBSERVATION_SIZE, SPACEWAR_ENV_ACTIONS_COUNT);
+        std::printf("%d ships, %d passes: observations %.2f us, forward pass %.2f us per pass, %d distinct actions\n", shipsCount, passesCount,
+                    static_cast<double>(observationsNs) / passes / 1000.0, forwardUs, distinctActions);
+        if (network.isAvx2())
+        {
+            std::printf("avx2 kernels, the sse ones take %.2f us per pass\n", static_cast<double>(sseForwardNs) / passes / 1000.0);
+        }
+        else
+        {
+            std::printf("sse kernels, the cpu has no avx2\n");
+        }
+        std::printf("budget %.0f us per %d ships\n", AI_POLICY_BUDGET_US, AI_POLICY_BENCH_SHIPS_COUNT);
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include "player.h"
+#include "vec_env.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a forward pass for this many ships takes less than AI_POLICY_BUDGET_US with the default sizes, runAiPolicyBench checks it
+constexpr int AI_POLICY_BENCH_SHIPS_COUNT = 64;
+constexpr float AI_POLICY_BUDGET_US = 50.f;
+constexpr int AI_POLICY_DEFAULT_HIDDEN_SIZE = 32;
+constexpr int AI_POLICY_DEFAULT_HIDDEN_LAYERS_COUNT = 2;
+
+// A fully connected layer as trainers store it, weights are outputsCount rows of inputsCount
+struct AiPolicyLayer
+{
+    int inputsCount = 0;
+    int outputsCount = 0;
+    std::vector<float> weights{};
+    std::vector<float> biases{};
+};
+
+// Multilayer perceptron from the observation of vec_env to a score per action of vec_env, hidden layers use ReLU.
+// The AI takes the action with the highest score, so a policy trained on SpacewarVecEnv plays the game as is
+struct AiPolicy
+{
+    std::vector<AiPolicyLayer> layers{};
+};
+
+// false if the layer sizes don't chain or don't match the observation and the actions
+bool isAiPolicyValid(const AiPolicy& policy);
+AiPolicy createRandomAiPolicy(int hiddenSize, int hiddenLayersCount, uint64_t seed);
+bool saveAiPolicy(const AiPolicy& policy, const std::string& filePath);
+bool loadAiPolicy(const std::string& filePath, AiPolicy& outPolicy);
+
+// the observation of ownShip against enemyShip, SPACEWAR_ENV_OBSERVATION_SIZE floats, shared with vec_env
+void aiPolicyWriteObservation(float* out, const entt::registry& registry, entt::registry::entity_type ownShip,
+                              entt::registry::entity_type enemyShip, Vec2 worldSize);
+ShipInput aiPolicyGetActionInput(int32_t action);
+
+// the CPU has AVX2 and the OS saves its registers
+bool aiPolicyIsAvx2Supported();
+
+// A valid policy repacked for SIMD: weights are transposed to a row of outputs per input, padded to blocks of eight outputs.
+// A batch of ships goes through every layer before the next one, so the weights of a layer are read from cache.
+// The layers run on the AVX2 kernels where the CPU has them and on the SSE ones otherwise, the outputs are the same
+class AiPolicyNetwork
+{
+public:
+    // isAvx2Allowed false keeps the SSE kernels, to compare them with the AVX2 ones
+    explicit AiPolicyNetwork(const AiPolicy& policy, bool isAvx2Allowed = true);
+
+    bool isAvx2() const;
+
+    // observations has SPACEWAR_ENV_OBSERVATION_SIZE floats per ship, outActions gets the best action of every ship
+    void evaluate(const float* observations, int count, int32_t* outActions);
+    // scores of the actions of a ship of the last evaluate
+    const float* getOutputs(int index) const;
+
+    // one pass for all the ships, each one plays against the first other ship like aiGenerateInput
+    void generateInputs(const entt::registry& registry, const entt::registry::entity_type* ships, int count, Vec2 worldSize,
+                        ShipInput* outInputs);
+
+private:
+    struct PackedLayer
+    {
+        int inputsCount = 0;
+        int outputsCount = 0;
+        // outputsCount rounded up to whole blocks of outputs
+        int stride = 0;
+        std::vector<float> weights{};
+        std::vector<float> biases{};
+    };
+
+    std::vector<PackedLayer> m_layers{};
+    int m_maxStride = 0;
+    bool m_isAvx2 = false;
+    std::vector<float> m_activations[2]{};
+    // the buffer the last layer wrote to
+    int m_outputActivations = 0;
+    std::vector<float> m_observations{};
+    std::vector<int32_t> m_actions{};
+};
+
+// Times the observations and the forward pass of a random policy of the default sizes for shipsCount ships and prints them
+// if verbose. Returns false if the pass takes longer than AI_POLICY_BUDGET_US per AI_POLICY_BENCH_SHIPS_COUNT ships
+bool runAiPolicyBench(int shipsCount, int passesCount, bool verbose);
@@ -0,0 +1,76 @@
+﻿#include "ai_policy_avx2.h"
+
+#include <immintrin.h>
+
+// floats in an AVX register, a block of outputs of the packed layers
+constexpr int AI_POLICY_AVX2_LANES_COUNT = 8;
+// ships a kernel computes at once, one sum each, enough independent adds to keep both units busy
+constexpr int AI_POLICY_AVX2_SHIPS_BLOCK_SIZE = 8;
+
+static __m256 activate(const __m256 sum, const bool isHidden)
+{
+    return isHidden ? _mm256_max_ps(sum, _mm256_setzero_ps()) : sum;
+}
+
+// a block of outputs of eight ships, written out like evaluateFourShips of the SSE kernels
+static void evaluateEightShips(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x,
+                               const int xStride, float* y, const bool isHidden)
+{
+    const __m256 bias = _mm256_loadu_ps(biases);
+    __m256 sum0 = bias, sum1 = bias, sum2 = bias, sum3 = bias, sum4 = bias, sum5 = bias, sum6 = bias, sum7 = bias;
+
+    for (int input = 0; input < inputsCount; ++input)
+    {
+        const __m256 w = _mm256_loadu_ps(weights + input * stride);
+
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_broadcast_ss(x + input), w));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_broadcast_ss(x + xStride + input), w));
+        sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_broadcast_ss(x + 2 * xStride + input), w));
+        sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_broadcast_ss(x + 3 * xStride + input), w));
+        sum4 = _mm256_add_ps(sum4, _mm256_mul_ps(_mm256_broadcast_ss(x + 4 * xStride + input), w));
+        sum5 = _mm256_add_ps(sum5, _mm256_mul_ps(_mm256_broadcast_ss(x + 5 * xStride + input), w));
+        sum6 = _mm256_add_ps(sum6, _mm256_mul_ps(_mm256_broadcast_ss(x + 6 * xStride + input), w));
+        sum7 = _mm256_add_ps(sum7, _mm256_mul_ps(_mm256_broadcast_ss(x + 7 * xStride + input), w));
+    }
+
+    _mm256_storeu_ps(y, activate(sum0, isHidden));
+    _mm256_storeu_ps(y + stride, activate(sum1, isHidden));
+    _mm256_storeu_ps(y + 2 * stride, activate(sum2, isHidden));
+    _mm256_storeu_ps(y + 3 * stride, activate(sum3, isHidden));
+    _mm256_storeu_ps(y + 4 * stride, activate(sum4, isHidden));
+    _mm256_storeu_ps(y + 5 * stride, activate(sum5, isHidden));
+    _mm256_storeu_ps(y + 6 * stride, activate(sum6, isHidden));
+    _mm256_storeu_ps(y + 7 * stride, activate(sum7, isHidden));
+}
+
+static void evaluateOneShip(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x, float* y,
+                            const bool isHidden)
+{
+    __m256 sum = _mm256_loadu_ps(biases);
+    for (int input = 0; input < inputsCount; ++input)
+    {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_broadcast_ss(x + input), _mm256_loadu_ps(weights + input * stride)));
+    }
+    _mm256_storeu_ps(y, activate(sum, isHidden));
+}
+
+void aiPolicyEvaluateLayerAvx2(const float* weights, const float* biases, const int stride, const int inputsCount, const float* x,
+                               const int xStride, const int count, float* y, const bool isHidden)
+{
+    int ship = 0;
+    for (; ship + AI_POLICY_AVX2_SHIPS_BLOCK_SIZE <= count; ship += AI_POLICY_AVX2_SHIPS_BLOCK_SIZE)
+    {
+        for (int output = 0; output < stride; output += AI_POLICY_AVX2_LANES_COUNT)
+        {
+            evaluateEightShips(weights + output, biases + output, stride, inputsCount, x + ship * xStride, xStride, y + ship * stride + output,
+                               isHidden);
+        }
+    }
+    for (; ship < count; ++ship)
+    {
+        for (int output = 0; output < stride; output += AI_POLICY_AVX2_LANES_COUNT)
+        {
+            evaluateOneShip(weights + output, biases + output, stride, inputsCount, x + ship * xStride, y + ship * stride + output, isHidden);
+        }
+    }
+}
@@ -0,0 +1,7 @@
+﻿#pragma once
+
+// y = x W + b for count ships through one layer packed by AiPolicyNetwork, with ReLU if isHidden. stride is a multiple of
+// eight outputs. ai_policy_avx2.cpp is the only file built with AVX2, call it only if aiPolicyIsAvx2Supported.
+// Every lane does the same multiplies and adds in the same order as the SSE kernels, so both give the same outputs
+void aiPolicyEvaluateLayerAvx2(const float* weights, const float* biases, int stride, int inputsCount, const float* x, int xStride,
+                               int count, float* y, bool isHidden);
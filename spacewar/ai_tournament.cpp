@@ -0,0 +1,346 @@
+﻿#include "ai_tournament.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+constexpr int AI_TOURNAMENT_PLAYERS_COUNT = 2;
+constexpr float AI_TOURNAMENT_ELO_K = 16.f;
+// a mutation moves a threshold by up to this fraction of its range
+constexpr float AI_TOURNAMENT_MUTATION_SCALE = 0.15f;
+
+struct AiParamRange
+{
+    float AiParams::*field = nullptr;
+    float min = 0.f;
+    float max = 0.f;
+};
+
+static const std::array<AiParamRange, 4> aiParamRanges{{
+    {&AiParams::thrustAngle, 5.f, 180.f},
+    {&AiParams::thrustDistance, 0.f, 800.f},
+    {&AiParams::thrustBurstDistance, 0.f, 1200.f},
+    {&AiParams::shootAngle, 1.f, 60.f},
+}};
+
+// registry and players of a worker, every match it plays reuses them instead of building new ones
+struct AiTournamentArena
+{
+    entt::registry registry{};
+    std::vector<Player> players{};
+};
+
+struct AiTournamentMatch
+{
+    int firstEntryIndex = 0;
+    int secondEntryIndex = 0;
+    uint64_t seed = 0;
+    AiMatchResult result{};
+};
+
+AiMatchResult playAiMatch(entt::registry& registry, std::vector<Player>& players, const AiParams& firstParams, const AiParams& secondParams,
+                          const Vec2 worldSize, const int maxTicks)
+{
+    players.resize(AI_TOURNAMENT_PLAYERS_COUNT);
+    recreateGameWorld(registry, players, worldSize);
+
+    const std::array<const AiParams*, AI_TOURNAMENT_PLAYERS_COUNT> params{&firstParams, &secondParams};
+    AiMatchResult result;
+
+    while (result.ticksCount < maxTicks)
+    {
+        for (int i = 0; i < AI_TOURNAMENT_PLAYERS_COUNT; ++i)
+        {
+            const entt::registry::entity_type ship = players[i].shipEntity;
+            if (registry.valid(ship))
+            {
+                applyShipInput(registry, ship, aiGenerateInput(registry, ship, *params[i]));
+            }
+        }
+
+        gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+        ++result.ticksCount;
+
+        const std::optional<GameResult> gameResult = tryGetGameResult(registry, AI_TOURNAMENT_PLAYERS_COUNT);
+        if (gameResult.has_value())
+        {
+            result.victoriousPlayerIndex = gameResult->victoriousPlayerIndex;
+            break;
+        }
+    }
+
+    return result;
+}
+
+float aiTournamentExpectedScore(const float ratingA, const float ratingB)
+{
+    return 1.f / (1.f + std::pow(10.f, (ratingB - ratingA) / 400.f));
+}
+
+static float getFirstPlayerScore(const AiMatchResult& result)
+{
+    return result.victoriousPlayerIndex == 0 ? 1.f : result.victoriousPlayerIndex == 1 ? 0.f : 0.5f;
+}
+
+// every match has its own seed, so a result doesn't depend on which worker played it or when
+static void playTournamentMatches(ThreadPool& pool, std::vector<std::unique_ptr<AiTournamentArena>>& arenas,
+                                  const std::vector<AiTournamentEntry>& entries, std::vector<AiTournamentMatch>& matches,
+                                  const AiTournamentSettings& settings)
+{
+    std::atomic<int> nextMatchIndex{0};
+
+    // an arena per worker, the matches are taken one by one so a long match doesn't leave the other workers idle
+    pool.parallelFor(static_cast<int>(arenas.size()), [&](const int begin, const int end)
+    {
+        for (int arenaIndex = begin; arenaIndex < end; ++arenaIndex)
+        {
+            AiTournamentArena& arena = *arenas[arenaIndex];
+
+            for (int i = nextMatchIndex++; i < static_cast<int>(matches.size()); i = nextMatchIndex++)
+            {
+                AiTournamentMatch& match = matches[i];
+                randomSeed(match.seed);
+                match.result = playAiMatch(arena.registry, arena.players, entries[match.firstEntryIndex].params,
+                                           entries[match.secondEntryIndex].params, settings.worldSize, settings.maxMatchTicks);
+            }
+        }
+    });
+}
+
+static void addMatchStats(const std::vector<AiTournamentMatch>& matches, AiTournamentStats& stats)
+{
+    for (const AiTournamentMatch& match : matches)
+    {
+        ++stats.matchesCount;
+        stats.ticksCount += match.result.ticksCount;
+        stats.tiesCount += match.result.victoriousPlayerIndex == -1 ? 1 : 0;
+        stats.firstPlayerWinsCount += match.result.victoriousPlayerIndex == 0 ? 1 : 0;
+    }
+}
+
+// in the order the matches were scheduled, so the ratings are the same whatever order they were played in
+static void updateRatings(const std::vector<AiTournamentMatch>& matches, std::vector<AiTournamentEntry>& entries)
+{
+    for (const AiTournamentMatch& match : matches)
+    {
+        AiTournamentEntry& first = entries[match.firstEntryIndex];
+        AiTournamentEntry& second = entries[match.secondEntryIndex];
+
+        const float score = getFirstPlayerScore(match.result);
+        const float delta = AI_TOURNAMENT_ELO_K * (score - aiTournamentExpectedScore(first.rating, second.rating));
+        first.rating += delta;
+        second.rating -= delta;
+
+        first.winsCount += match.result.victoriousPlayerIndex == 0 ? 1 : 0;
+        first.lossesCount += match.result.victoriousPlayerIndex == 1 ? 1 : 0;
+        second.winsCount += match.result.victoriousPlayerIndex == 1 ? 1 : 0;
+        second.lossesCount += match.result.victoriousPlayerIndex == 0 ? 1 : 0;
+        first.tiesCount += match.result.victoriousPlayerIndex == -1 ? 1 : 0;
+        second.tiesCount += match.result.victoriousPlayerIndex == -1 ? 1 : 0;
+    }
+}
+
+static uint64_t getMatchSeed(const uint64_t tournamentSeed, const int generation, const int matchIndex)
+{
+    return tournamentSeed * 0x9E3779B97F4A7C15ull + (static_cast<uint64_t>(generation) << 32) + static_cast<uint64_t>(matchIndex);
+}
+
+static void scheduleRoundRobin(const int entriesCount, const int matchesPerPairSide, const int generation, const uint64_t seed,
+                               std::vector<AiTournamentMatch>& outMatches)
+{
+    outMatches.clear();
+
+    for (int first = 0; first < entriesCount; ++first)
+    {
+        for (int second = 0; second < entriesCount; ++second)
+        {
+            for (int i = 0; i < matchesPerPairSide && first != second; ++i)
+            {
+                AiTournamentMatch match;
+                match.firstEntryIndex = first;
+                match.secondEntryIndex = second;
+                match.seed = getMatchSeed(seed, generation, static_cast<int>(outMatches.size()));
+                outMatches.push_back(match);
+            }
+        }
+    }
+}
+
+// uniform crossover of the parents, then every threshold is moved a bit at random. Uses the random state of the calling thread
+static AiParams breedAiParams(const AiParams& firstParent, const AiParams& secondParent)
+{
+    AiParams child;
+
+    for (const AiParamRange& range : aiParamRanges)
+    {
+        const AiParams& parent = randomFloatRange(0.f, 1.f) < 0.5f ? firstParent : secondParent;
+        const float mutation = randomFloatRange(-1.f, 1.f) * AI_TOURNAMENT_MUTATION_SCALE * (range.max - range.min);
+        child.*range.field = std::clamp(parent.*range.field + mutation, range.min, range.max);
+    }
+
+    return child;
+}
+
+static void sortByRating(std::vector<AiTournamentEntry>& entries)
+{
+    std::stable_sort(entries.begin(), entries.end(), [](const AiTournamentEntry& a, const AiTournamentEntry& b)
+    {
+        return a.rating > b.rating;
+    });
+}
+
+std::vector<AiTournamentEntry> runAiTournament(const AiTournamentSettings& settings, AiTournamentStats& outStats, const bool verbose)
+{
+    outStats = AiTournamentStats{};
+
+    ThreadPool pool{settings.threadsCount};
+    outStats.threadsCount = pool.getThreadsCount();
+
+    std::vector<std::unique_ptr<AiTournamentArena>> arenas;
+    for (int i = 0; i < pool.getThreadsCount(); ++i)
+    {
+        arenas.push_back(std::make_unique<AiTournamentArena>());
+    }
+
+    // breeding runs here, on its own random sequence
+    const uint64_t callerRandomState = randomGetState();
+    randomSeed(settings.seed);
+
+    const int populationSize = std::max(2, settings.populationSize);
+    std::vector<AiTournamentEntry> population(populationSize);
+    for (int i = 1; i < populationSize; ++i)
+    {
+        population[i].params = breedAiParams(AiParams{}, AiParams{});
+    }
+
+    std::vector<AiTournamentMatch> matches;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int generation = 0; generation < settings.generationsCount; ++generation)
+    {
+        scheduleRoundRobin(populationSize, settings.matchesPerPairSide, generation, settings.seed, matches);
+        playTournamentMatches(pool, arenas, population, matches, settings);
+        addMatchStats(matches, outStats);
+        updateRatings(matches, population);
+        sortByRating(population);
+
+        if (verbose)
+        {
+            const AiParams& best = population.front().params;
+            std::printf("generation %d: best rating %.0f (gen %d), thrust angle %.1f, thrust %.0f, burst %.0f, shoot angle %.1f\n", generation,
+                        population.front().rating, population.front().generation, best.thrustAngle, best.thrustDistance,
+                        best.thrustBurstDistance, best.shootAngle);
+        }
+
+        if (generation + 1 == settings.generationsCount)
+        {
+            break;
+        }
+
+        // the stronger half survives, the rest is replaced with its children
+        const int survivorsCount = (populationSize + 1) / 2;
+        for (int i = survivorsCount; i < populationSize; ++i)
+        {
+            const AiTournamentEntry& firstParent = population[static_cast<int>(randomFloatRange(0.f, static_cast<float>(survivorsCount))) % survivorsCount];
+            const AiTournamentEntry& secondParent = population[static_cast<int>(randomFloatRange(0.f, static_cast<float>(survivorsCount))) % survivorsCount];
+
+            AiTournamentEntry child;
+            child.params = breedAiParams(firstParent.params, secondParent.params);
+            child.rating = (firstParent.rating + secondParent.rating) / 2.f;
+            child.generation = generation + 1;
+            population[i] = child;
+        }
+    }
+
+    randomSetState(callerRandomState);
+
+    // the best one against the hand-tuned one, on both sides
+    std::vector<AiTournamentEntry> finalists{population.front(), AiTournamentEntry{}};
+    matches.clear();
+    for (int i = 0; i < 2 * settings.evaluationMatchesPerSide; ++i)
+    {
+        AiTournamentMatch match;
+        match.firstEntryIndex = i % 2;
+        match.secondEntryIndex = 1 - i % 2;
+        match.seed = getMatchSeed(settings.seed, settings.generationsCount, i);
+        matches.push_back(match);
+    }
+    playTournamentMatches(pool, arenas, finalists, matches, settings);
+    addMatchStats(matches, outStats);
+
+    float bestScore = 0.f;
+    for (const AiTournamentMatch& match : matches)
+    {
+        const float firstScore = getFirstPlayerScore(match.result);
+        bestScore += match.firstEntryIndex == 0 ? firstScore : 1.f - firstScore;
+    }
+    outStats.bestScoreAgainstHandTuned = matches.empty() ? 0.5f : bestScore / static_cast<float>(matches.size());
+
+    outStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    outStats.busySeconds = static_cast<double>(pool.getStats().busyNs) / 1e9;
+
+    if (verbose)
+    {
+        std::printf("%lld matches in %.2f s on %d threads, %.0f matches per second, %.0f per busy core second, %.0f ticks per match\n",
+                    static_cast<long long>(outStats.matchesCount), outStats.seconds, outStats.threadsCount,
+                    static_cast<double>(outStats.matchesCount) / outStats.seconds,
+                    outStats.busySeconds > 0.0 ? static_cast<double>(outStats.matchesCount) / outStats.busySeconds : 0.0,
+                    outStats.matchesCount > 0 ? static_cast<double>(outStats.ticksCount) / outStats.matchesCount : 0.0);
+        std::printf("best AI scores %.2f against the hand-tuned one\n", outStats.bestScoreAgainstHandTuned);
+    }
+
+    return population;
+}
+
+bool runAiTournamentToFile(const AiTournamentSettings& settings, const std::string& outputPath)
+{
+    AiTournamentStats stats;
+    const std::vector<AiTournamentEntry> population = runAiTournament(settings, stats, outputPath != "-");
+
+    FILE* file = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "ai tournament: can't open output file %s\n", outputPath.c_str());
+        return false;
+    }
+
+    const double matchesCount = static_cast<double>(std::max<int64_t>(1, stats.matchesCount));
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"settings\": {\"generations\": %d, \"population\": %d, \"matchesPerPairSide\": %d, \"evaluationMatchesPerSide\": %d, "
+                 "\"maxMatchTicks\": %d, \"threads\": %d, \"seed\": %llu},\n",
+                 settings.generationsCount, settings.populationSize, settings.matchesPerPairSide, settings.evaluationMatchesPerSide,
+                 settings.maxMatchTicks, stats.threadsCount, static_cast<unsigned long long>(settings.seed));
+    std::fprintf(file, "  \"stats\": {\"matches\": %lld, \"seconds\": %.3f, \"busySeconds\": %.3f, \"matchesPerSecond\": %.1f, "
+                 "\"matchesPerCoreSecond\": %.1f, \"ticksPerMatch\": %.1f, \"tieRate\": %.3f, \"firstPlayerWinRate\": %.3f, "
+                 "\"bestScoreAgainstHandTuned\": %.3f},\n",
+                 static_cast<long long>(stats.matchesCount), stats.seconds, stats.busySeconds, stats.matchesCount / stats.seconds,
+                 stats.busySeconds > 0.0 ? stats.matchesCount / stats.busySeconds : 0.0, stats.ticksCount / matchesCount,
+                 stats.tiesCount / matchesCount, stats.firstPlayerWinsCount / matchesCount, stats.bestScoreAgainstHandTuned);
+    std::fprintf(file, "  \"ratings\": [\n");
+
+    for (size_t i = 0; i < population.size(); ++i)
+    {
+        const AiTournamentEntry& entry = population[i];
+        std::fprintf(file, "    {\"rating\": %.1f, \"generation\": %d, \"wins\": %d, \"losses\": %d, \"ties\": %d, \"thrustAngle\": %.2f, "
+                     "\"thrustDistance\": %.1f, \"thrustBurstDistance\": %.1f, \"shootAngle\": %.2f}%s\n",
+                     entry.rating, entry.generation, entry.winsCount, entry.lossesCount, entry.tiesCount, entry.params.thrustAngle,
+                     entry.params.thrustDistance, entry.params.thrustBurstDistance, entry.params.shootAngle, i + 1 < population.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+
+    if (file != stdout)
+    {
+        std::fclose(file);
+    }
+
+    return true;
+}
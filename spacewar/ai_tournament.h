@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include "player.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr float AI_TOURNAMENT_INITIAL_RATING = 1500.f;
+
+struct AiMatchResult
+{
+    // -1 for a tie, including a match that ran out of ticks
+    int victoriousPlayerIndex = -1;
+    int ticksCount = 0;
+};
+
+struct AiTournamentSettings
+{
+    int generationsCount = 20;
+    int populationSize = 16;
+    // every pair meets this many times on each side
+    int matchesPerPairSide = 1;
+    // the final best AI plays the hand-tuned one this many times on each side
+    int evaluationMatchesPerSide = 32;
+    int maxMatchTicks = 60 * 60;
+    // threadsCount 0 means one worker per core
+    int threadsCount = 0;
+    uint64_t seed = 1;
+    Vec2 worldSize{1000.f, 1000.f};
+};
+
+struct AiTournamentEntry
+{
+    AiParams params{};
+    float rating = AI_TOURNAMENT_INITIAL_RATING;
+    int winsCount = 0;
+    int lossesCount = 0;
+    int tiesCount = 0;
+    // the generation it was born in, the hand-tuned AI is in generation 0
+    int generation = 0;
+};
+
+struct AiTournamentStats
+{
+    int64_t matchesCount = 0;
+    int64_t ticksCount = 0;
+    int64_t tiesCount = 0;
+    // wins of the ship that starts top left, the world should be fair for both sides
+    int64_t firstPlayerWinsCount = 0;
+    double seconds = 0.0;
+    // time the workers spent in matches, matches per busy second is the throughput of one core
+    double busySeconds = 0.0;
+    int threadsCount = 0;
+    // score of the final best AI against the hand-tuned one, a win is 1 and a tie 0.5
+    float bestScoreAgainstHandTuned = 0.f;
+};
+
+// Plays one headless match between two AIs in the given registry, which is recreated and can be reused for the next one.
+// Uses the random state of the calling thread
+AiMatchResult playAiMatch(entt::registry& registry, std::vector<Player>& players, const AiParams& firstParams, const AiParams& secondParams,
+                          Vec2 worldSize, int maxTicks);
+
+// expected score of a against b, a win is 1, a tie is 0.5
+float aiTournamentExpectedScore(float ratingA, float ratingB);
+
+// Evolves the AI thresholds with a genetic search: every generation plays a round robin of headless matches on all cores,
+// updates Elo ratings and replaces the weaker half with mutated crossovers of the stronger one. The hand-tuned AI is in the
+// first population. Match results don't depend on the threads count. Returns the population sorted by rating, strongest first
+std::vector<AiTournamentEntry> runAiTournament(const AiTournamentSettings& settings, AiTournamentStats& outStats, bool verbose);
+
+// Runs the search and writes the ratings and match stats as json to outputPath, "-" for stdout
+bool runAiTournamentToFile(const AiTournamentSettings& settings, const std::string& outputPath);
@@ -1,8 +1,59 @@
 ﻿#include "app_state.h"
+#include "ai_agents.h"
+#include "ai_lookahead.h"
 #include "draw_game.h"
 #include "draw_ui.h"
 #include "game_entities.h"
 #include "game_frame.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+
+// with more players than this, default AI players are agents that pick the nearest or a threatening target
+constexpr size_t APP_MAX_PLAYERS_WITHOUT_AI_AGENTS = 2;
+
+static ShipInput generateAiInput(AppPersistent& app, const entt::registry& registry, const entt::registry::entity_type ship)
+{
+    if (app.policyNetwork != nullptr)
+    {
+        ShipInput input;
+        app.policyNetwork->generateInputs(registry, &ship, 1, app.worldSize, &input);
+        return input;
+    }
+
+    if (const AiAgentComponent* agent = registry.try_get<AiAgentComponent>(ship))
+    {
+        return agent->input;
+    }
+
+    if (app.isMctsAi)
+    {
+        const size_t playerIndex = static_cast<size_t>(registry.get<ShipComponent>(ship).playerIndex);
+        if (app.mctsSearchers.size() <= playerIndex)
+        {
+            app.mctsSearchers.resize(playerIndex + 1);
+        }
+
+        std::unique_ptr<AiMctsSearcher>& searcher = app.mctsSearchers[playerIndex];
+        if (searcher == nullptr)
+        {
+            searcher = std::make_unique<AiMctsSearcher>(app.mctsThreadsCount, AI_MCTS_DECISION_BUDGET_MS);
+        }
+
+        // the search of this state ends up in a later tick, the tick itself never waits for it
+        AiMctsState state;
+        if (aiMctsCaptureState(registry, ship, app.worldSize, state))
+        {
+            searcher->publishState(state);
+        }
+        return searcher->getBestInput();
+    }
+
+    return app.isLookaheadAi ? aiGenerateLookaheadInput(registry, ship, app.worldSize) : aiGenerateInput(registry, ship);
+}
 
 void AppStateBase::trySwitchDbgDrawMode(AppPersistent& app, const sf::Event& event)
 {
@@ -12,13 +63,102 @@ void AppStateBase::trySwitchDbgDrawMode(AppPersistent& app, const sf::Event& eve
     }
 }
 
+void AppStateBase::trySwitchProfilerDrawMode(AppPersistent& app, const sf::Event& event)
+{
+    if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F1)
+    {
+        app.isProfilerRender = !app.isProfilerRender;
+    }
+}
+
+void AppStateBase::tryZoomCamera(AppPersistent& app, const sf::Event& event)
+{
+    if (event.type == sf::Event::MouseWheelScrolled)
+    {
+        cameraZoomByWheel(app.camera, event.mouseWheelScroll.delta);
+    }
+}
+
+void AppStateBase::tryStartTraceCapture(const sf::Event& event)
+{
+    if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F2)
+    {
+        profilerStartTraceCapture(300, "trace.json");
+    }
+}
+
+void AppStateBase::switchState(AppPersistent& app, std::unique_ptr<AppStateBase> newState)
+{
+    profilerTraceInstant(newState->getName());
+    app.appStatePtr = std::move(newState);
+}
+
+// keyframes are saved next to the replay when there are any
+static void saveRoundReplay(const AppPersistent& app, const Replay& replay, const ReplayKeyframes* keyframes)
+{
+    if (app.replaysDirectory.empty())
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(app.replaysDirectory, error);
+
+    const long long unixTime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), "round_%lld_%016" PRIx64 ".swrp", unixTime, replay.seed);
+    const std::string filePath = (std::filesystem::path{app.replaysDirectory} / fileName).string();
+
+    if (!saveReplay(replay, filePath))
+    {
+        std::fprintf(stderr, "can't save replay %s\n", filePath.c_str());
+    }
+
+    const std::string keyframesFilePath = getReplayKeyframesFilePath(filePath);
+    if (keyframes && !keyframes->snapshots.empty() && !saveReplayKeyframes(replay, *keyframes, keyframesFilePath))
+    {
+        std::fprintf(stderr, "can't save replay keyframes %s\n", keyframesFilePath.c_str());
+    }
+}
+
+// the world is drawn through the camera, what's drawn after is in window pixels as before
+static void drawWorldInCamera(const AppPersistent& app, sf::RenderWindow& window, const bool isDebugRender)
+{
+    const Vec2 viewportSize{window.getSize()};
+    window.setView(sf::View{app.camera.center, cameraGetViewSize(app.camera, viewportSize)});
+
+    if (isDebugRender)
+    {
+        drawGameDebug(app.registry, window, app.font);
+    }
+    else
+    {
+        drawGame(window, app.drawGrids, app.shipTexture, app.registry, app.worldSize, app.time);
+    }
+
+    window.setView(window.getDefaultView());
+}
+
+static void drawRound(const AppPersistent& app, sf::RenderWindow& window)
+{
+    drawWorldInCamera(app, window, app.isDebugRender);
+}
+
 AppStateStarting::AppStateStarting(const int playersCount)
 {
     m_playersReady.resize(playersCount, false);
 }
 
+const char* AppStateStarting::getName() const
+{
+    return "AppStateStarting";
+}
+
 void AppStateStarting::processSfmlEvent(AppPersistent& app, const sf::Event& event)
 {
+    trySwitchProfilerDrawMode(app, event);
+    tryStartTraceCapture(event);
+
     if (event.type != sf::Event::KeyReleased)
     {
         return;
@@ -45,14 +185,18 @@ void AppStateStarting::processSfmlEvent(AppPersistent& app, const sf::Event& eve
 
 void AppStateStarting::updateFrame(AppPersistent& app, float dt)
 {
+    for (size_t i = 0; i < app.players.size(); ++i)
+    {
+        m_playersReady[i] = m_playersReady[i] || app.players[i].isBot;
+    }
+
     const bool everyoneReady = std::all_of(m_playersReady.begin(), m_playersReady.end(), [](const bool ready)
     {
         return ready;
     });
     if (everyoneReady)
     {
-        recreateGameWorld(app.registry, app.players, app.worldSize);
-        app.appStatePtr = std::make_unique<AppStateGame>();
+        switchState(app, std::make_unique<AppStateGame>(app));
     }
 }
 
@@ -61,51 +205,325 @@ void AppStateStarting::drawFrame(const AppPersistent& app, sf::RenderWindow& win
     drawStartingUi(m_playersReady, app.players, window, app.font, timeInState);
 }
 
+AppStateGame::AppStateGame(AppPersistent& app)
+{
+    const uint64_t seed = randomGenerateSeed();
+    m_recording = replayCreate(seed, app.worldSize, app.tickDt, app.players);
+    m_recording.asteroidsCount = app.asteroidsCount;
+    m_recording.gravityIntegrator = app.gravityIntegrator;
+    m_recording.isShipHitMasks = app.shipHitMasks != nullptr;
+    replayCreateWorld(app.registry, app.players, m_recording, app.shipHitMasks.get());
+
+    const bool isDefaultAi = !app.isLookaheadAi && !app.isMctsAi && app.policyNetwork == nullptr;
+    if (isDefaultAi && app.players.size() > APP_MAX_PLAYERS_WITHOUT_AI_AGENTS)
+    {
+        for (const Player& player : app.players)
+        {
+            if (player.isAi)
+            {
+                attachAiAgent(app.registry, player.shipEntity);
+            }
+        }
+    }
+}
+
+AppStateGame::AppStateGame(AppPersistent& app, std::shared_ptr<const Replay> replay): m_playback(std::move(replay))
+{
+    app.worldSize = m_playback->worldSize;
+    for (int i = 0; i < m_playback->getPlayersCount() && i < static_cast<int>(app.players.size()); ++i)
+    {
+        app.players[i].isAi = m_playback->playersAi[i];
+    }
+
+    replayCreateWorld(app.registry, app.players, *m_playback, app.shipHitMasks.get());
+    replayTryCaptureKeyframe(app.replayKeyframes, app.registry, 0);
+}
+
+const char* AppStateGame::getName() const
+{
+    return "AppStateGame";
+}
+
 void AppStateGame::processSfmlEvent(AppPersistent& app, const sf::Event& event)
 {
     trySwitchDbgDrawMode(app, event);
+    trySwitchProfilerDrawMode(app, event);
+    tryStartTraceCapture(event);
+    tryZoomCamera(app, event);
+
+    if (m_playback)
+    {
+        trySeekPlayback(app, event);
+    }
+}
+
+void AppStateGame::trySeekPlayback(AppPersistent& app, const sf::Event& event)
+{
+    if (event.type != sf::Event::KeyPressed)
+    {
+        return;
+    }
+
+    const int seekStepTicks = static_cast<int>(5.f / m_playback->tickDt);
+    int targetTick = m_tick;
+
+    switch (event.key.code)
+    {
+    case sf::Keyboard::Left:
+        targetTick -= seekStepTicks;
+        break;
+    case sf::Keyboard::Right:
+        targetTick += seekStepTicks;
+        break;
+    case sf::Keyboard::Home:
+        targetTick = 0;
+        break;
+    default:
+        return;
+    }
+
+    PROFILE_SCOPE("replaySeek");
+    m_tick = replaySeek(app.registry, app.players, *m_playback, app.replayKeyframes, targetTick);
+    m_tickTimeAccumulator = 0.f;
 }
 
 void AppStateGame::updateFrame(AppPersistent& app, const float dt)
+{
+    const float tickDt = m_playback ? m_playback->tickDt : m_recording.tickDt;
+
+    // the world always advances by whole ticks, frame time that is left goes to the next frame
+    m_tickTimeAccumulator += dt;
+    while (m_tickTimeAccumulator >= tickDt)
+    {
+        m_tickTimeAccumulator -= tickDt;
+
+        if (!updateTick(app))
+        {
+            return;
+        }
+    }
+}
+
+bool AppStateGame::updateTick(AppPersistent& app)
 {
     entt::registry& registry = app.registry;
 
-    for (const Player& player : app.players)
+    if (m_playback)
+    {
+        // recording stopped before the round was over
+        if (m_tick >= m_playback->getTicksCount())
+        {
+            app.replayToPlay.reset();
+            app.replayKeyframes = ReplayKeyframes{};
+            switchState(app, std::make_unique<AppStateStarting>(static_cast<int>(app.players.size())));
+            return false;
+        }
+
+        replayTryCaptureKeyframe(app.replayKeyframes, registry, m_tick);
+    }
+    else
     {
-        if (registry.valid(player.shipEntity))
+        replayTryCaptureKeyframe(m_recordingKeyframes, registry, m_tick);
+
+        // agents decide for all their ships at once, generateAiInput only reads their inputs
+        if (registry.size<AiAgentComponent>() > 0)
+        {
+            aiAgentsSystem(registry, app.worldSize);
+        }
+
+        for (const Player& player : app.players)
         {
-            const ShipInput input = player.isAi ? aiGenerateInput(registry, player.shipEntity) : readPlayerInput(player.keymap);
-            registry.get<AccelerateByInputComponent>(player.shipEntity).input = input.thrust;
-            registry.get<RotateByInputComponent>(player.shipEntity).input = input.rotate;
-            registry.get<ShootingComponent>(player.shipEntity).input = input.shoot;
-            registry.get<AccelerateImpulseByInputComponent>(player.shipEntity).input = input.thrustBurst;
+            ShipInput input;
+            if (registry.valid(player.shipEntity))
+            {
+                input = player.isAi ? generateAiInput(app, registry, player.shipEntity) : readPlayerInput(player.keymap);
+            }
+            m_recording.addInput(input);
         }
     }
 
-    gameFrameUpdate(registry, dt, app.worldSize);
+    const Replay& replay = m_playback ? *m_playback : m_recording;
+    replaySimulateTick(registry, app.players, replay, m_tick);
+    ++m_tick;
 
     std::optional<GameResult> optGameResult = tryGetGameResult(registry, app.players.size());
 
-    if (optGameResult.has_value())
+    if (!optGameResult.has_value())
+    {
+        return true;
+    }
+
+    if (!optGameResult->isTie())
+    {
+        app.players[optGameResult->victoriousPlayerIndex].score++;
+    }
+
+    if (!m_playback)
+    {
+        saveRoundReplay(app, m_recording, &m_recordingKeyframes);
+    }
+
+    switchState(app, std::make_unique<AppStateGameOver>(optGameResult.value()));
+    return false;
+}
+
+void AppStateGame::drawFrame(const AppPersistent& app, sf::RenderWindow& window)
+{
+    drawRound(app, window);
+}
+
+AppStateNetplayGame::AppStateNetplayGame(AppPersistent& app)
+{
+    // both peers count rounds the same way, so the round id is also the seed they share
+    const uint32_t roundId = ++app.netplayRoundsCount;
+    const uint64_t seed = roundId;
+
+    // it would take packets of the new round
+    app.netplayFinishedSession.reset();
+
+    Replay roundReplay = replayCreate(seed, app.worldSize, GAME_TICK_DT, app.players);
+    roundReplay.isShipHitMasks = app.shipHitMasks != nullptr;
+    replayCreateWorld(app.registry, app.players, roundReplay, app.shipHitMasks.get());
+
+    m_session = std::make_unique<RollbackSession>(*app.netplayTransport, app.registry, app.netplayLocalPlayerIndex, roundId, roundReplay,
+                                                  INPUT_DELAY_TICKS);
+}
+
+const char* AppStateNetplayGame::getName() const
+{
+    return "AppStateNetplayGame";
+}
+
+void AppStateNetplayGame::processSfmlEvent(AppPersistent& app, const sf::Event& event)
+{
+    trySwitchDbgDrawMode(app, event);
+    trySwitchProfilerDrawMode(app, event);
+    tryStartTraceCapture(event);
+    tryZoomCamera(app, event);
+}
+
+void AppStateNetplayGame::updateFrame(AppPersistent& app, const float dt)
+{
+    entt::registry& registry = app.registry;
+    const Player& localPlayer = app.players[app.netplayLocalPlayerIndex];
+
+    m_tickTimeAccumulator += dt;
+    while (m_tickTimeAccumulator >= GAME_TICK_DT)
     {
-        if (!optGameResult->isTie())
+        m_tickTimeAccumulator -= GAME_TICK_DT;
+
+        ShipInput localInput;
+        if (registry.valid(localPlayer.shipEntity))
+        {
+            localInput = localPlayer.isAi ? generateAiInput(app, registry, localPlayer.shipEntity) : readPlayerInput(localPlayer.keymap);
+        }
+
+        if (!m_session->advanceTick(registry, app.players, localInput))
         {
-            app.players[optGameResult->victoriousPlayerIndex].score++;
+            // waiting for the remote peer, the lost time is not made up later
+            m_tickTimeAccumulator = 0.f;
+            return;
         }
 
-        app.appStatePtr = std::make_unique<AppStateGameOver>(optGameResult.value());
+        if (tryFinishRound(app))
+        {
+            return;
+        }
     }
 }
 
-void AppStateGame::drawFrame(const AppPersistent& app, sf::RenderWindow& window)
+bool AppStateNetplayGame::tryFinishRound(AppPersistent& app)
 {
-    if (app.isDebugRender)
+    const std::optional<GameResult> optGameResult = tryGetGameResult(app.registry, app.players.size());
+
+    if (!optGameResult.has_value())
     {
-        drawGameDebug(app.registry, window, app.font);
+        m_pendingResult.reset();
+        return false;
     }
-    else
+
+    if (!m_pendingResult.has_value() || m_pendingResult->victoriousPlayerIndex != optGameResult->victoriousPlayerIndex)
+    {
+        m_pendingResult = optGameResult;
+        m_pendingResultTick = m_session->getCurrentTick();
+    }
+
+    if (m_session->getConfirmedTick() < m_pendingResultTick)
+    {
+        return false;
+    }
+
+    if (!optGameResult->isTie())
+    {
+        app.players[optGameResult->victoriousPlayerIndex].score++;
+    }
+
+    // only confirmed ticks, the rest may still be mispredicted
+    Replay replay = m_session->getReplay();
+    replay.packedInputs.resize(m_session->getConfirmedTick() * replay.getPlayersCount());
+    saveRoundReplay(app, replay, nullptr);
+
+    app.netplayFinishedSession = std::move(m_session);
+    switchState(app, std::make_unique<AppStateGameOver>(optGameResult.value()));
+    return true;
+}
+
+void AppStateNetplayGame::drawFrame(const AppPersistent& app, sf::RenderWindow& window)
+{
+    drawRound(app, window);
+}
+
+AppStateClientGame::AppStateClientGame(AppPersistent& app) : m_client(*app.serverTransport)
+{
+    // the world is created when the first snapshot of a round comes
+    app.registry.clear();
+}
+
+const char* AppStateClientGame::getName() const
+{
+    return "AppStateClientGame";
+}
+
+void AppStateClientGame::processSfmlEvent(AppPersistent& app, const sf::Event& event)
+{
+    trySwitchDbgDrawMode(app, event);
+    trySwitchProfilerDrawMode(app, event);
+    tryStartTraceCapture(event);
+    tryZoomCamera(app, event);
+}
+
+void AppStateClientGame::updateFrame(AppPersistent& app, const float dt)
+{
+    m_tickTimeAccumulator += dt;
+    while (m_tickTimeAccumulator >= GAME_TICK_DT)
+    {
+        m_tickTimeAccumulator -= GAME_TICK_DT;
+
+        const Player& localPlayer = app.players[m_client.getLocalPlayerIndex()];
+        ShipInput localInput;
+        if (app.registry.valid(localPlayer.shipEntity))
+        {
+            localInput = localPlayer.isAi ? generateAiInput(app, app.registry, localPlayer.shipEntity) : readPlayerInput(localPlayer.keymap);
+        }
+
+        m_client.tick(app.registry, app.players, localInput);
+
+        if (m_client.isConnected())
+        {
+            app.worldSize = m_client.getWorldSize();
+        }
+    }
+
+    m_timeSinceRoundOver = m_client.getRoundResult().has_value() ? m_timeSinceRoundOver + dt : 0.f;
+}
+
+void AppStateClientGame::drawFrame(const AppPersistent& app, sf::RenderWindow& window)
+{
+    drawRound(app, window);
+
+    if (const std::optional<GameResult> optRoundResult = m_client.getRoundResult())
     {
-        drawGame(window, app.shipTexture, app.registry, app.worldSize, app.time);
+        drawGameOverUi(optRoundResult.value(), SERVER_ROUND_OVER_TICKS * GAME_TICK_DT, m_timeSinceRoundOver, app.players, window, app.font);
     }
 }
 
@@ -113,9 +531,17 @@ AppStateGameOver::AppStateGameOver(const GameResult& gameResult): m_gameResult(g
 {
 }
 
+const char* AppStateGameOver::getName() const
+{
+    return "AppStateGameOver";
+}
+
 void AppStateGameOver::processSfmlEvent(AppPersistent& app, const sf::Event& event)
 {
     trySwitchDbgDrawMode(app, event);
+    trySwitchProfilerDrawMode(app, event);
+    tryStartTraceCapture(event);
+    tryZoomCamera(app, event);
 }
 
 void AppStateGameOver::updateFrame(AppPersistent& app, const float dt)
@@ -127,16 +553,31 @@ void AppStateGameOver::updateFrame(AppPersistent& app, const float dt)
 
     gameFrameUpdate(app.registry, slowMotionDt, app.worldSize);
 
+    if (app.netplayFinishedSession)
+    {
+        app.netplayFinishedSession->flushLocalInputs();
+    }
+
     const bool restartButtonPressed = sf::Keyboard::isKeyPressed(sf::Keyboard::Space);
     if (restartButtonPressed || timeInState > TIME_WHEN_RESTART)
     {
-        recreateGameWorld(app.registry, app.players, app.worldSize);
-        app.appStatePtr = std::make_unique<AppStateGame>();
+        if (app.netplayTransport)
+        {
+            switchState(app, std::make_unique<AppStateNetplayGame>(app));
+        }
+        else if (app.replayToPlay)
+        {
+            switchState(app, std::make_unique<AppStateGame>(app, app.replayToPlay));
+        }
+        else
+        {
+            switchState(app, std::make_unique<AppStateGame>(app));
+        }
     }
 }
 
 void AppStateGameOver::drawFrame(const AppPersistent& app, sf::RenderWindow& window)
 {
-    drawGame(window, app.shipTexture, app.registry, app.worldSize, app.time);
+    drawWorldInCamera(app, window, false);
     drawGameOverUi(m_gameResult, TIME_WHEN_RESTART, timeInState, app.players, window, app.font);
 }
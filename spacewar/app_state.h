@@ -1,8 +1,17 @@
 ﻿#pragma once
 
+#include "ai_mcts.h"
+#include "ai_policy.h"
+#include "camera.h"
+#include "draw_game.h"
+#include "game_client.h"
+#include "game_frame.h"
 #include "player.h"
+#include "rollback.h"
+#include "ship_hit_mask.h"
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <SFML/Graphics.hpp>
 
@@ -11,13 +20,53 @@ struct AppPersistent
     entt::registry registry{};
     Vec2 worldSize{};
     std::vector<Player> players{};
+    // local rounds are played in a field of this many asteroids
+    int asteroidsCount = 0;
+    // local rounds tick at this rate and move bodies in gravity wells with this integrator
+    float tickDt = GAME_TICK_DT;
+    GravityIntegrator gravityIntegrator = GravityIntegrator::Euler;
 
     sf::Texture shipTexture{};
     sf::Font font{};
+    // made from the ship image, local and netplay rounds collide ships by them. A client of the dedicated server has none,
+    // it predicts ships colliding as circles like the server does
+    std::unique_ptr<ShipHitMasks> shipHitMasks{};
+
+    // AI players search ahead with aiGenerateLookaheadInput instead of the default AI
+    bool isLookaheadAi = false;
+    // AI players search on background threads with AiMctsSearcher, one searcher per player index
+    bool isMctsAi = false;
+    int mctsThreadsCount = 0;
+    std::vector<std::unique_ptr<AiMctsSearcher>> mctsSearchers{};
+    // when set, AI players are driven by this trained policy
+    std::unique_ptr<AiPolicyNetwork> policyNetwork{};
+
+    // the window shows the world around the ships through it
+    Camera camera{};
+    // scratch of drawGame, drawing doesn't change the app otherwise
+    mutable GameDrawGrids drawGrids{};
 
     bool isDebugRender = false;
+    bool isProfilerRender = false;
     float time = 0.f;
 
+    // finished rounds are saved here, empty disables recording
+    std::string replaysDirectory{};
+    // when set, rounds are played back from it instead of being played
+    std::shared_ptr<const Replay> replayToPlay{};
+    // keyframes of replayToPlay, loaded with it and added to while it's played back
+    ReplayKeyframes replayKeyframes{};
+
+    // when set, rounds are played against the remote peer over it
+    std::unique_ptr<NetTransport> netplayTransport{};
+    int netplayLocalPlayerIndex = 0;
+    uint32_t netplayRoundsCount = 0;
+    // the remote may still need our last inputs of the finished round to see its end
+    std::unique_ptr<RollbackSession> netplayFinishedSession{};
+
+    // when set, the game is played on a dedicated server over it
+    std::unique_ptr<NetTransport> serverTransport{};
+
     std::unique_ptr<class AppStateBase> appStatePtr{};
 };
 
@@ -28,11 +77,16 @@ public:
 
     virtual ~AppStateBase() = default;
 
+    virtual const char* getName() const = 0;
     virtual void processSfmlEvent(AppPersistent& app, const sf::Event& event) = 0;
     virtual void updateFrame(AppPersistent& app, float dt) = 0;
     virtual void drawFrame(const AppPersistent& app, sf::RenderWindow& window) = 0;
 
     static void trySwitchDbgDrawMode(AppPersistent& app, const sf::Event& event);
+    static void trySwitchProfilerDrawMode(AppPersistent& app, const sf::Event& event);
+    static void tryStartTraceCapture(const sf::Event& event);
+    static void tryZoomCamera(AppPersistent& app, const sf::Event& event);
+    static void switchState(AppPersistent& app, std::unique_ptr<AppStateBase> newState);
 };
 
 class AppStateStarting : public AppStateBase
@@ -40,6 +94,7 @@ class AppStateStarting : public AppStateBase
 public:
     explicit AppStateStarting(int playersCount);
 
+    const char* getName() const override;
     void processSfmlEvent(AppPersistent& app, const sf::Event& event) override;
     void updateFrame(AppPersistent& app, float dt) override;
     void drawFrame(const AppPersistent& app, sf::RenderWindow& window) override;
@@ -50,9 +105,70 @@ private:
 class AppStateGame : public AppStateBase
 {
 public:
+    // starts a new round with a new random seed and records its input
+    explicit AppStateGame(AppPersistent& app);
+    // starts the recorded round and plays it back, player input is ignored, arrows and Home seek
+    AppStateGame(AppPersistent& app, std::shared_ptr<const Replay> replay);
+
+    virtual const char* getName() const override;
     virtual void processSfmlEvent(AppPersistent& app, const sf::Event& event) override;
     virtual void updateFrame(AppPersistent& app, float dt) override;
     virtual void drawFrame(const AppPersistent& app, sf::RenderWindow& window) override;
+
+private:
+    // returns false if the round is over, the state is already switched and destroyed then
+    bool updateTick(AppPersistent& app);
+    void trySeekPlayback(AppPersistent& app, const sf::Event& event);
+
+    Replay m_recording{};
+    std::shared_ptr<const Replay> m_playback{};
+    // keyframes of the recorded round, they are saved with its replay
+    ReplayKeyframes m_recordingKeyframes{};
+    int m_tick = 0;
+    float m_tickTimeAccumulator = 0.f;
+};
+
+// Round against the remote peer, the world is simulated with rollback
+class AppStateNetplayGame : public AppStateBase
+{
+public:
+    explicit AppStateNetplayGame(AppPersistent& app);
+
+    virtual const char* getName() const override;
+    virtual void processSfmlEvent(AppPersistent& app, const sf::Event& event) override;
+    virtual void updateFrame(AppPersistent& app, float dt) override;
+    virtual void drawFrame(const AppPersistent& app, sf::RenderWindow& window) override;
+
+private:
+    // returns true if the result is final, the state is already switched and destroyed then
+    bool tryFinishRound(AppPersistent& app);
+
+    std::unique_ptr<RollbackSession> m_session{};
+    float m_tickTimeAccumulator = 0.f;
+
+    // a result seen in the predicted world is final only when the tick it appeared at gets confirmed
+    std::optional<GameResult> m_pendingResult{};
+    int m_pendingResultTick = 0;
+
+    constexpr static int INPUT_DELAY_TICKS = 2;
+};
+
+// Rounds played on a dedicated server, which decides everything. The state stays for the whole session,
+// the server starts new rounds by itself
+class AppStateClientGame : public AppStateBase
+{
+public:
+    explicit AppStateClientGame(AppPersistent& app);
+
+    virtual const char* getName() const override;
+    virtual void processSfmlEvent(AppPersistent& app, const sf::Event& event) override;
+    virtual void updateFrame(AppPersistent& app, float dt) override;
+    virtual void drawFrame(const AppPersistent& app, sf::RenderWindow& window) override;
+
+private:
+    GameClient m_client;
+    float m_tickTimeAccumulator = 0.f;
+    float m_timeSinceRoundOver = 0.f;
 };
 
 class AppStateGameOver : public AppStateBase
@@ -60,6 +176,7 @@ class AppStateGameOver : public AppStateBase
 public:
     explicit AppStateGameOver(const GameResult& gameResult);
 
+    virtual const char* getName() const override;
     virtual void processSfmlEvent(AppPersistent& app, const sf::Event& event) override;
     virtual void updateFrame(AppPersistent& app, float dt) override;
     virtual void drawFrame(const AppPersistent& app, sf::RenderWindow& window) override;
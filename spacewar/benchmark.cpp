@@ -0,0 +1,389 @@
+﻿#include "benchmark.h"
+#include "ai_agents.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "game_visual.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <random>
+
+constexpr float BENCHMARK_DT = 1.f / 60.f;
+
+struct SystemBenchmark
+{
+    const char* name = nullptr;
+    std::function<void(entt::registry&)> run;
+    // entities the system iterates over, used for the ns per entity metric
+    std::function<size_t(const entt::registry&)> countEntities;
+    // not timed, runs before every iteration
+    std::function<void(entt::registry&)> prepare;
+};
+
+struct SystemBenchmarkResult
+{
+    const char* name = nullptr;
+    size_t entitiesCount = 0;
+    BenchmarkStats stats{};
+};
+
+template <typename... Component>
+static size_t countEntitiesWith(const entt::registry& registry)
+{
+    const auto view = registry.view<const Component...>();
+    return static_cast<size_t>(std::distance(view.begin(), view.end()));
+}
+
+static void clearOneshotComponents(entt::registry& registry)
+{
+    registry.clear<CollisionHappenedOneshotComponent, AccelerateImpulseAppliedOneshotComponent>();
+}
+
+BenchmarkStats benchmarkComputeStats(std::vector<double> samplesNs)
+{
+    BenchmarkStats stats;
+    if (samplesNs.empty())
+    {
+        return stats;
+    }
+
+    std::sort(samplesNs.begin(), samplesNs.end());
+
+    double sum = 0.0;
+    for (const double sample : samplesNs)
+    {
+        sum += sample;
+    }
+
+    const auto percentile = [&samplesNs](const double p)
+    {
+        const size_t index = static_cast<size_t>(p * (samplesNs.size() - 1) + 0.5);
+        return samplesNs[index];
+    };
+
+    stats.samplesCount = static_cast<int>(samplesNs.size());
+    stats.minNs = samplesNs.front();
+    stats.maxNs = samplesNs.back();
+    stats.meanNs = sum / samplesNs.size();
+    stats.medianNs = percentile(0.5);
+    stats.p99Ns = percentile(0.99);
+    return stats;
+}
+
+void benchmarkPopulateWorld(entt::registry& registry, const BenchmarkWorldSettings& settings)
+{
+    registry.clear();
+
+    std::mt19937 rnd{settings.seed};
+    const auto randomRange = [&rnd](const float min, const float max)
+    {
+        return std::uniform_real_distribution<float>{min, max}(rnd);
+    };
+    const auto randomPosition = [&randomRange, &settings]()
+    {
+        return Vec2{randomRange(0.f, settings.worldSize.x), randomRange(0.f, settings.worldSize.y)};
+    };
+
+    for (int i = 0; i < settings.wellsCount; ++i)
+    {
+        const auto entity = createGravityWellEntity(registry, settings.worldSize);
+        if (i > 0)
+        {
+            registry.get<PositionComponent>(entity).vec = randomPosition();
+        }
+    }
+
+    for (int i = 0; i < settings.shipsCount; ++i)
+    {
+        const auto entity = createShipEntity(registry, randomPosition(), randomRange(0.f, 360.f), sf::Color::White, i);
+        registry.get<AccelerateByInputComponent>(entity).input = settings.shipsActive;
+        registry.get<RotateByInputComponent>(entity).input = settings.shipsActive ? 1.f : 0.f;
+        registry.get<ShootingComponent>(entity).input = settings.shipsActive;
+        registry.get<AccelerateImpulseByInputComponent>(entity).input = settings.shipsActive;
+    }
+
+    for (int i = 0; i < settings.projectilesCount; ++i)
+    {
+        const float angle = randomRange(0.f, 360.f);
+        const auto entity = createProjectileEntity(registry);
+        registry.emplace<PositionComponent>(entity, randomPosition());
+        registry.emplace<RotationComponent>(entity, angle);
+        registry.emplace<VelocityComponent>(entity, vec2AngleToDir(angle) * 200.f);
+    }
+
+    for (int i = 0; i < settings.collidersCount; ++i)
+    {
+        const auto entity = registry.create();
+        registry.emplace<PositionComponent>(entity, randomPosition());
+        registry.emplace<VelocityComponent>(entity, vec2AngleToDir(randomRange(0.f, 360.f)) * randomRange(0.f, 30.f));
+        registry.emplace<CircleColliderComponent>(entity, randomRange(5.f, 20.f));
+        registry.emplace<DestroyByCollisionComponent>(entity);
+        registry.emplace<WrapPositionAroundWorldComponent>(entity);
+        registry.emplace<SusceptibleToGravityWellComponent>(entity);
+    }
+
+    for (int i = 0; i < settings.asteroidsCount; ++i)
+    {
+        const Vec2 velocity = vec2AngleToDir(randomRange(0.f, 360.f)) * randomRange(ASTEROID_SPEED_RANGE.min, ASTEROID_SPEED_RANGE.max);
+        createAsteroidEntity(registry, randomPosition(), velocity, randomRange(ASTEROID_RADIUS_RANGE.min, ASTEROID_RADIUS_RANGE.max));
+    }
+
+    for (int i = 0; i < settings.particlesCount; ++i)
+    {
+        const auto entity = registry.create();
+        registry.emplace<PositionComponent>(entity, randomPosition());
+        registry.emplace<VelocityComponent>(entity, vec2AngleToDir(randomRange(0.f, 360.f)) * randomRange(10.f, 200.f));
+
+        ParticleComponent particle;
+        particle.totalLifetime = 1000.f;
+        particle.startRadius = randomRange(4.f, 10.f);
+        particle.finishRadius = randomRange(1.f, 2.f);
+        particle.startColor = sf::Color{255, 100, 0, 150};
+        particle.finishColor = sf::Color{0, 0, 0, 0};
+        registry.emplace<ParticleComponent>(entity, particle);
+
+        // long enough to not expire during the benchmark
+        registry.emplace<DestroyTimerComponent>(entity, particle.totalLifetime);
+    }
+}
+
+static std::vector<SystemBenchmark> createSystemBenchmarks(const BenchmarkWorldSettings& settings)
+{
+    const Vec2 worldSize = settings.worldSize;
+
+    const auto repopulateWithCollidedShips = [settings](entt::registry& registry)
+    {
+        benchmarkPopulateWorld(registry, settings);
+        const auto view = registry.view<const ShipComponent>();
+        registry.insert<CollisionHappenedOneshotComponent>(view.begin(), view.end());
+    };
+
+    const auto repopulateWithCollidedDestroyables = [settings](entt::registry& registry)
+    {
+        benchmarkPopulateWorld(registry, settings);
+        const auto view = registry.view<const DestroyByCollisionComponent>();
+        registry.insert<CollisionHappenedOneshotComponent>(view.begin(), view.end());
+    };
+
+    const auto attachAgents = [](entt::registry& registry)
+    {
+        clearOneshotComponents(registry);
+        attachAiAgents(registry);
+    };
+
+    const auto markShipsImpulseApplied = [](entt::registry& registry)
+    {
+        clearOneshotComponents(registry);
+        const auto view = registry.view<const ShipComponent>();
+        registry.insert<AccelerateImpulseAppliedOneshotComponent>(view.begin(), view.end());
+    };
+
+    return std::vector<SystemBenchmark>{
+        {
+            "gravityWellSystem",
+            [](entt::registry& registry) { gravityWellSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<SusceptibleToGravityWellComponent>,
+            clearOneshotComponents
+        },
+        {
+            "integrateGravityWellsSystem",
+            [](entt::registry& registry) { integrateGravityWellsSystem(registry, BENCHMARK_DT, GravityIntegrator::VelocityVerlet); },
+            countEntitiesWith<SusceptibleToGravityWellComponent>,
+            clearOneshotComponents
+        },
+        {
+            "rotateByInputSystem",
+            [](entt::registry& registry) { rotateByInputSystem(registry); },
+            countEntitiesWith<RotateByInputComponent>,
+            clearOneshotComponents
+        },
+        {
+            "accelerateByInputSystem",
+            [](entt::registry& registry) { accelerateByInputSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<AccelerateByInputComponent>,
+            clearOneshotComponents
+        },
+        {
+            "accelerateImpulseSystem",
+            [](entt::registry& registry) { accelerateImpulseSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<AccelerateImpulseByInputComponent>,
+            clearOneshotComponents
+        },
+        {
+            "applyRotationSpeedSystem",
+            [](entt::registry& registry) { applyRotationSpeedSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<RotationSpeedComponent>,
+            clearOneshotComponents
+        },
+        {
+            "applyVelocitySystem",
+            [](entt::registry& registry) { applyVelocitySystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<VelocityComponent>,
+            clearOneshotComponents
+        },
+        {
+            "wrapPositionAroundWorldSystem",
+            [worldSize](entt::registry& registry) { wrapPositionAroundWorldSystem(registry, worldSize); },
+            countEntitiesWith<WrapPositionAroundWorldComponent>,
+            clearOneshotComponents
+        },
+        {
+            "shootingSystem",
+            [](entt::registry& registry) { shootingSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<ShootingComponent>,
+            clearOneshotComponents
+        },
+        {
+            "projectileMoveSystem",
+            [](entt::registry& registry) { projectileMoveSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<ProjectileComponent>,
+            clearOneshotComponents
+        },
+        {
+            "circleVsCircleCollisionSystem",
+            [](entt::registry& registry) { circleVsCircleCollisionSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<CircleColliderComponent>,
+            clearOneshotComponents
+        },
+        {
+            "teleportSystem",
+            [](entt::registry& registry) { teleportSystem(registry); },
+            countEntitiesWith<TeleportableComponent>,
+            clearOneshotComponents
+        },
+        {
+            "spawnDeadShipPiecesOnCollisionSystem",
+            [](entt::registry& registry) { spawnDeadShipPiecesOnCollisionSystem(registry); },
+            countEntitiesWith<ShipComponent, CollisionHappenedOneshotComponent>,
+            repopulateWithCollidedShips
+        },
+        {
+            "enableParticleEmitterByAccelerateInputSystem",
+            [](entt::registry& registry) { enableParticleEmitterByAccelerateInputSystem(registry); },
+            countEntitiesWith<EnableParticleEmitterByAccelerateInputComponent>,
+            clearOneshotComponents
+        },
+        {
+            "emitParticlesOnAccelerateImpulseSystem",
+            [](entt::registry& registry) { emitParticlesOnAccelerateImpulseSystem(registry); },
+            countEntitiesWith<ParticleEmitterOnAccelerateImpulseComponent>,
+            markShipsImpulseApplied
+        },
+        {
+            "particleEmitterSystem",
+            [](entt::registry& registry) { particleEmitterSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<ParticleEmitterComponent>,
+            clearOneshotComponents
+        },
+        {
+            "accelerateImpulseAppliedOneshotComponentClearSystem",
+            [](entt::registry& registry) { accelerateImpulseAppliedOneshotComponentClearSystem(registry); },
+            countEntitiesWith<AccelerateImpulseAppliedOneshotComponent>,
+            markShipsImpulseApplied
+        },
+        {
+            "destroyByCollisionSystem",
+            [](entt::registry& registry) { destroyByCollisionSystem(registry); },
+            countEntitiesWith<DestroyByCollisionComponent, CollisionHappenedOneshotComponent>,
+            repopulateWithCollidedDestroyables
+        },
+        {
+            "destroyTimerSystem",
+            [](entt::registry& registry) { destroyTimerSystem(registry, BENCHMARK_DT); },
+            countEntitiesWith<DestroyTimerComponent>,
+            clearOneshotComponents
+        },
+        {
+            "aiAgentsSystem",
+            [worldSize](entt::registry& registry) { aiAgentsSystem(registry, worldSize); },
+            countEntitiesWith<AiAgentComponent>,
+            attachAgents
+        },
+        {
+            "gameFrameUpdate",
+            [worldSize](entt::registry& registry) { gameFrameUpdate(registry, BENCHMARK_DT, worldSize); },
+            [](const entt::registry& registry) { return registry.alive(); },
+            nullptr
+        },
+    };
+}
+
+static SystemBenchmarkResult runSystemBenchmark(const SystemBenchmark& benchmark, const BenchmarkWorldSettings& settings, const int iterations)
+{
+    entt::registry registry;
+    benchmarkPopulateWorld(registry, settings);
+
+    SystemBenchmarkResult result;
+    result.name = benchmark.name;
+
+    std::vector<double> samplesNs;
+    samplesNs.reserve(iterations);
+
+    size_t entitiesSum = 0;
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        if (benchmark.prepare)
+        {
+            benchmark.prepare(registry);
+        }
+
+        entitiesSum += benchmark.countEntities(registry);
+
+        const auto start = std::chrono::steady_clock::now();
+        benchmark.run(registry);
+        const auto finish = std::chrono::steady_clock::now();
+
+        samplesNs.push_back(std::chrono::duration<double, std::nano>(finish - start).count());
+    }
+
+    result.entitiesCount = iterations > 0 ? entitiesSum / iterations : 0;
+    result.stats = benchmarkComputeStats(std::move(samplesNs));
+    return result;
+}
+
+bool runBenchmarks(const BenchmarkWorldSettings& settings, const int iterations, const std::string& outputPath)
+{
+    std::vector<SystemBenchmarkResult> results;
+    for (const SystemBenchmark& benchmark : createSystemBenchmarks(settings))
+    {
+        results.push_back(runSystemBenchmark(benchmark, settings, iterations));
+    }
+
+    FILE* file = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "benchmark: can't open output file %s\n", outputPath.c_str());
+        return false;
+    }
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"settings\": {\"ships\": %d, \"projectiles\": %d, \"particles\": %d, \"colliders\": %d, \"asteroids\": %d, \"wells\": %d, "
+                 "\"shipsActive\": %s, \"worldSize\": [%.0f, %.0f], \"seed\": %u, \"iterations\": %d},\n",
+                 settings.shipsCount, settings.projectilesCount, settings.particlesCount, settings.collidersCount, settings.asteroidsCount,
+                 settings.wellsCount, settings.shipsActive ? "true" : "false", settings.worldSize.x, settings.worldSize.y, settings.seed, iterations);
+    std::fprintf(file, "  \"systems\": [\n");
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SystemBenchmarkResult& result = results[i];
+        const double nsPerEntity = result.entitiesCount > 0 ? result.stats.medianNs / result.entitiesCount : 0.0;
+
+        std::fprintf(file, "    {\"name\": \"%s\", \"entities\": %zu, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"min_ns\": %.1f, "
+                     "\"p99_ns\": %.1f, \"max_ns\": %.1f, \"ns_per_entity\": %.3f}%s\n",
+                     result.name, result.entitiesCount, result.stats.medianNs, result.stats.meanNs, result.stats.minNs,
+                     result.stats.p99Ns, result.stats.maxNs, nsPerEntity, i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+
+    if (file != stdout)
+    {
+        std::fclose(file);
+    }
+
+    return true;
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "game_logic.h"
+
+#include <string>
+#include <vector>
+
+struct BenchmarkWorldSettings
+{
+    int shipsCount = 2;
+    int projectilesCount = 100;
+    int particlesCount = 1000;
+    int collidersCount = 100;
+    int asteroidsCount = 0;
+    int wellsCount = 1;
+    // ships accelerate, rotate and shoot all the time, otherwise they idle
+    bool shipsActive = true;
+    Vec2 worldSize{1000.f, 1000.f};
+    unsigned seed = 1;
+};
+
+struct BenchmarkStats
+{
+    int samplesCount = 0;
+    double minNs = 0.0;
+    double meanNs = 0.0;
+    double medianNs = 0.0;
+    double p99Ns = 0.0;
+    double maxNs = 0.0;
+};
+
+BenchmarkStats benchmarkComputeStats(std::vector<double> samplesNs);
+
+// Fills the registry with a reproducible world, same seed gives the same world
+void benchmarkPopulateWorld(entt::registry& registry, const BenchmarkWorldSettings& settings);
+
+// Times every system in isolation and the whole gameFrameUpdate, writes json to outputPath ("-" for stdout)
+bool runBenchmarks(const BenchmarkWorldSettings& settings, int iterations, const std::string& outputPath);
@@ -0,0 +1,87 @@
+﻿#include "camera.h"
+#include "game_logic.h"
+
+#include <algorithm>
+#include <cmath>
+
+static float getMaxZoom(const Vec2 worldSize, const Vec2 viewportSize)
+{
+    // any farther and the window would show parts of the world twice
+    return std::max(CAMERA_MIN_ZOOM, std::min(worldSize.x / viewportSize.x, worldSize.y / viewportSize.y));
+}
+
+void cameraUpdate(Camera& camera, const entt::registry& registry, const Vec2 worldSize, const Vec2 viewportSize, const float dt)
+{
+    const float maxZoom = getMaxZoom(worldSize, viewportSize);
+
+    Vec2 targetCenter = camera.zoom > 0.f ? camera.center : worldSize / 2.f;
+    float targetZoom = maxZoom;
+
+    // the box around the ships is measured from the first one the short way around the world edges
+    const auto view = registry.view<const ShipComponent, const PositionComponent>();
+    bool isFirstShip = true;
+    Vec2 firstShipPos{};
+    Vec2 boxMin{};
+    Vec2 boxMax{};
+
+    for (auto [entity, ship, pos] : view.each())
+    {
+        if (isFirstShip)
+        {
+            isFirstShip = false;
+            firstShipPos = pos.vec;
+        }
+
+        const Vec2 offset = vec2WrappedDiff(firstShipPos, pos.vec, worldSize);
+        boxMin = Vec2{std::min(boxMin.x, offset.x), std::min(boxMin.y, offset.y)};
+        boxMax = Vec2{std::max(boxMax.x, offset.x), std::max(boxMax.y, offset.y)};
+    }
+
+    if (!isFirstShip)
+    {
+        const Vec2 boxSize = boxMax - boxMin + Vec2{CAMERA_SHIPS_MARGIN, CAMERA_SHIPS_MARGIN} * 2.f;
+        targetCenter = vec2Wrap(firstShipPos + (boxMin + boxMax) / 2.f, worldSize);
+        targetZoom = std::max(boxSize.x / viewportSize.x, boxSize.y / viewportSize.y) * camera.userZoom;
+    }
+
+    targetZoom = std::clamp(targetZoom, CAMERA_MIN_ZOOM, maxZoom);
+
+    if (camera.zoom <= 0.f)
+    {
+        camera.center = targetCenter;
+        camera.zoom = targetZoom;
+    }
+    else
+    {
+        const float t = 1.f - std::exp(-CAMERA_FOLLOW_RATE * dt);
+        camera.center = vec2Wrap(camera.center + vec2WrappedDiff(camera.center, targetCenter, worldSize) * t, worldSize);
+        camera.zoom = floatLerp(camera.zoom, targetZoom, t);
+    }
+
+    // along a side the window shows whole there is nothing to follow, and the world stays where it always was
+    const Vec2 viewSize = cameraGetViewSize(camera, viewportSize);
+    if (viewSize.x >= worldSize.x)
+    {
+        camera.center.x = worldSize.x / 2.f;
+    }
+    if (viewSize.y >= worldSize.y)
+    {
+        camera.center.y = worldSize.y / 2.f;
+    }
+}
+
+void cameraZoomByWheel(Camera& camera, const float wheelDelta)
+{
+    camera.userZoom = std::clamp(camera.userZoom * std::pow(CAMERA_WHEEL_ZOOM_STEP, -wheelDelta), CAMERA_MIN_USER_ZOOM, CAMERA_MAX_USER_ZOOM);
+}
+
+Vec2 cameraGetViewSize(const Camera& camera, const Vec2 viewportSize)
+{
+    return viewportSize * camera.zoom;
+}
+
+sf::FloatRect cameraGetBounds(const Camera& camera, const Vec2 viewportSize)
+{
+    const Vec2 viewSize = cameraGetViewSize(camera, viewportSize);
+    return sf::FloatRect{camera.center - viewSize / 2.f, viewSize};
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "game_math.h"
+#include "entt.hpp"
+
+#include <SFML/Graphics/Rect.hpp>
+
+// the camera keeps this much world around the ships it follows
+constexpr float CAMERA_SHIPS_MARGIN = 250.f;
+// one world unit per window pixel is the scale the game is drawn at, the camera never zooms closer
+constexpr float CAMERA_MIN_ZOOM = 1.f;
+constexpr float CAMERA_MIN_USER_ZOOM = 0.25f;
+constexpr float CAMERA_MAX_USER_ZOOM = 4.f;
+constexpr float CAMERA_WHEEL_ZOOM_STEP = 1.1f;
+// how fast the camera catches up with where it should be, a fraction per second as in exp decay
+constexpr float CAMERA_FOLLOW_RATE = 4.f;
+
+// Follows the ships alive around the wrapped world and zooms out to keep them all in the window. A world that fits the
+// window is always shown whole, as it was before the world could be larger than the window
+struct Camera
+{
+    // may be out of the world, what's seen there is the world wrapped around
+    Vec2 center{};
+    // world units per window pixel, zero until the first update snaps it
+    float zoom = 0.f;
+    // the mouse wheel scales the zoom that fits the ships by this
+    float userZoom = 1.f;
+};
+
+void cameraUpdate(Camera& camera, const entt::registry& registry, Vec2 worldSize, Vec2 viewportSize, float dt);
+void cameraZoomByWheel(Camera& camera, float wheelDelta);
+// the part of the world the window shows, the size of an sf::View around center
+Vec2 cameraGetViewSize(const Camera& camera, Vec2 viewportSize);
+sf::FloatRect cameraGetBounds(const Camera& camera, Vec2 viewportSize);
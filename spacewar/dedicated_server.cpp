@@ -0,0 +1,260 @@
+﻿#include "dedicated_server.h"
+#include "game_frame.h"
+#include "match_host.h"
+#include "profiler.h"
+#include "udp_socket.h"
+
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+constexpr float SERVER_CLIENT_TIMEOUT = 5.f;
+constexpr float SERVER_STATS_INTERVAL = 10.f;
+
+using ServerClock = std::chrono::steady_clock;
+
+// One client on the shared server socket, the server loop hands it packets that came from the client's address.
+// Its match reads them on a worker thread
+class ServerClientTransport : public NetTransport
+{
+public:
+    ServerClientTransport(UdpSocket& socket, const UdpAddress address)
+        : m_socket(socket), m_address(address)
+    {
+    }
+
+    bool isFrom(const UdpAddress address) const
+    {
+        return address == m_address;
+    }
+
+    void addReceived(const uint8_t* data, const size_t size)
+    {
+        const std::lock_guard<std::mutex> lock{m_mutex};
+        m_receivedPackets.emplace_back(data, data + size);
+        m_lastReceiveTime = ServerClock::now();
+    }
+
+    bool isTimedOut() const
+    {
+        return std::chrono::duration<float>(ServerClock::now() - m_lastReceiveTime).count() > SERVER_CLIENT_TIMEOUT;
+    }
+
+    void send(const std::vector<uint8_t>& packet) override
+    {
+        // the socket is non-blocking, a packet that doesn't fit into the send buffer is lost like any other
+        m_socket.send(packet.data(), packet.size(), m_address);
+    }
+
+    bool receive(std::vector<uint8_t>& outPacket) override
+    {
+        const std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_receivedPackets.empty())
+        {
+            return false;
+        }
+
+        outPacket = std::move(m_receivedPackets.front());
+        m_receivedPackets.pop_front();
+        return true;
+    }
+
+private:
+    UdpSocket& m_socket;
+    UdpAddress m_address{};
+    std::mutex m_mutex{};
+    std::deque<std::vector<uint8_t>> m_receivedPackets{};
+    ServerClock::time_point m_lastReceiveTime = ServerClock::now();
+};
+
+using ServerMatchClients = std::array<std::unique_ptr<ServerClientTransport>, NET_PLAYERS_COUNT>;
+
+struct ServerClientSlot
+{
+    int matchIndex = 0;
+    int playerIndex = 0;
+};
+
+static uint64_t getClientKey(const UdpAddress address)
+{
+    return (static_cast<uint64_t>(address.ip) << 16) | address.port;
+}
+
+// a waiting player gets an opponent first, then empty matches are filled, then a new one is started
+static bool tryFindFreeSlot(MatchHost& host, std::vector<ServerMatchClients>& matchClients, const Vec2 worldSize, const int maxMatchesCount,
+                            ServerClientSlot& outSlot)
+{
+    for (const int wantedClientsCount : {NET_PLAYERS_COUNT - 1, 0})
+    {
+        for (int matchIndex = 0; matchIndex < static_cast<int>(matchClients.size()); ++matchIndex)
+        {
+            const ServerMatchClients& clients = matchClients[matchIndex];
+            const int clientsCount = static_cast<int>(std::count_if(clients.begin(), clients.end(), [](const auto& client)
+            {
+                return client != nullptr;
+            }));
+            if (clientsCount == wantedClientsCount)
+            {
+                outSlot.matchIndex = matchIndex;
+                outSlot.playerIndex = static_cast<int>(std::find(clients.begin(), clients.end(), nullptr) - clients.begin());
+                return true;
+            }
+        }
+    }
+
+    if (host.getMatchesCount() >= maxMatchesCount)
+    {
+        return false;
+    }
+
+    outSlot.matchIndex = host.addMatch(worldSize);
+    outSlot.playerIndex = 0;
+    matchClients.emplace_back();
+    return true;
+}
+
+static void receiveDatagrams(UdpSocket& socket, std::vector<uint8_t>& buffer, MatchHost& host, std::vector<ServerMatchClients>& matchClients,
+                             std::unordered_map<uint64_t, ServerClientSlot>& clientSlots, const Vec2 worldSize, const int maxMatchesCount)
+{
+    std::size_t receivedSize = 0;
+    UdpAddress sender;
+
+    while (socket.receive(buffer.data(), buffer.size(), receivedSize, sender))
+    {
+        const auto slotIt = clientSlots.find(getClientKey(sender));
+        if (slotIt != clientSlots.end())
+        {
+            matchClients[slotIt->second.matchIndex][slotIt->second.playerIndex]->addReceived(buffer.data(), receivedSize);
+            continue;
+        }
+
+        // strangers get a slot only if they ask for it
+        ServerClientSlot slot;
+        if (receivedSize == 0 || buffer[0] != static_cast<uint8_t>(NetPacketType::Hello) ||
+            !tryFindFreeSlot(host, matchClients, worldSize, maxMatchesCount, slot))
+        {
+            continue;
+        }
+
+        std::unique_ptr<ServerClientTransport>& client = matchClients[slot.matchIndex][slot.playerIndex];
+        client = std::make_unique<ServerClientTransport>(socket, sender);
+        client->addReceived(buffer.data(), receivedSize);
+        host.getIdleMatch(slot.matchIndex).setClientTransport(slot.playerIndex, client.get());
+        clientSlots[getClientKey(sender)] = slot;
+        std::printf("server: player %d of match %d joined from %s:%u\n", slot.playerIndex, slot.matchIndex, udpAddressToString(sender).c_str(),
+                    sender.port);
+    }
+}
+
+static void dropSilentClients(MatchHost& host, std::vector<ServerMatchClients>& matchClients, std::unordered_map<uint64_t, ServerClientSlot>& clientSlots)
+{
+    for (auto it = clientSlots.begin(); it != clientSlots.end();)
+    {
+        const ServerClientSlot slot = it->second;
+        std::unique_ptr<ServerClientTransport>& client = matchClients[slot.matchIndex][slot.playerIndex];
+        if (!client->isTimedOut())
+        {
+            ++it;
+            continue;
+        }
+
+        host.getIdleMatch(slot.matchIndex).setClientTransport(slot.playerIndex, nullptr);
+        client.reset();
+        it = clientSlots.erase(it);
+        std::printf("server: player %d of match %d timed out\n", slot.playerIndex, slot.matchIndex);
+    }
+}
+
+static void printServerStats(MatchHost& host, const double seconds, const MatchHostStats& lastHostStats, const ThreadPoolStats& lastPoolStats,
+                             GameServerStats& lastServerStats)
+{
+    GameServerStats serverStats{};
+    int playingMatchesCount = 0;
+    for (int matchIndex = 0; matchIndex < host.getMatchesCount(); ++matchIndex)
+    {
+        const GameServer& server = host.getIdleMatch(matchIndex);
+        playingMatchesCount += server.isPlaying() ? 1 : 0;
+        serverStats.snapshotBytesSentCount += server.getStats().snapshotBytesSentCount;
+        serverStats.missingInputsCount += server.getStats().missingInputsCount;
+    }
+
+    const MatchHostStats& hostStats = host.getStats();
+    const ThreadPoolStats poolStats = host.getPoolStats();
+    const int64_t ticksCount = hostStats.ticksCount - lastHostStats.ticksCount;
+    const double busyShare = (poolStats.busyNs - lastPoolStats.busyNs) / (seconds * 1e9 * host.getThreadsCount());
+
+    std::printf("server: %d of %d matches playing, %lld ticks, %.3f ms per tick, %lld late, %lld skipped, workers %.2f%% busy, "
+                "snapshots %.1f KB/s, missing inputs %lld\n",
+                playingMatchesCount, host.getMatchesCount(), static_cast<long long>(ticksCount),
+                ticksCount ? (hostStats.totalTickNs - lastHostStats.totalTickNs) / 1e6 / ticksCount : 0.0,
+                static_cast<long long>(hostStats.lateTicksCount - lastHostStats.lateTicksCount),
+                static_cast<long long>(hostStats.skippedTicksCount - lastHostStats.skippedTicksCount), busyShare * 100.0,
+                (serverStats.snapshotBytesSentCount - lastServerStats.snapshotBytesSentCount) / (seconds * 1024.0),
+                static_cast<long long>(serverStats.missingInputsCount - lastServerStats.missingInputsCount));
+    std::fflush(stdout);
+
+    lastServerStats = serverStats;
+}
+
+bool runDedicatedServer(const unsigned short port, const Vec2 worldSize, const int maxMatchesCount, const int ticksCount)
+{
+    UdpSocket socket;
+    if (!socket.bind(port))
+    {
+        std::fprintf(stderr, "server: can't bind port %u\n", port);
+        return false;
+    }
+
+    MatchHost host;
+    std::printf("server: listening on port %u, up to %d matches on %d threads\n", port, maxMatchesCount, host.getThreadsCount());
+
+    std::vector<ServerMatchClients> matchClients;
+    std::unordered_map<uint64_t, ServerClientSlot> clientSlots;
+    std::vector<uint8_t> receiveBuffer(UDP_MAX_DATAGRAM_SIZE);
+
+    const auto tickDuration = std::chrono::duration_cast<ServerClock::duration>(std::chrono::duration<float>(GAME_TICK_DT));
+    const auto start = ServerClock::now();
+    const auto finish = start + tickDuration * ticksCount;
+    auto timeoutsCheckTime = start;
+    auto statsTime = start;
+    MatchHostStats lastHostStats{};
+    ThreadPoolStats lastPoolStats{};
+    GameServerStats lastServerStats{};
+
+    for (auto now = start; ticksCount == 0 || now < finish; now = ServerClock::now())
+    {
+        receiveDatagrams(socket, receiveBuffer, host, matchClients, clientSlots, worldSize, maxMatchesCount);
+        if (now - timeoutsCheckTime >= tickDuration)
+        {
+            dropSilentClients(host, matchClients, clientSlots);
+            timeoutsCheckTime = now;
+        }
+
+        const auto nextUpdateTime = host.update();
+        profilerEndFrame();
+
+        if (now - statsTime >= std::chrono::duration<float>(SERVER_STATS_INTERVAL))
+        {
+            printServerStats(host, std::chrono::duration<double>(now - statsTime).count(), lastHostStats, lastPoolStats, lastServerStats);
+            statsTime = now;
+            lastHostStats = host.getStats();
+            lastPoolStats = host.getPoolStats();
+        }
+
+        // sf::sleep raises the system timer resolution while sleeping, a plain sleep may oversleep by a whole tick on Windows
+        const auto sleepDuration = std::chrono::duration_cast<std::chrono::microseconds>(nextUpdateTime - ServerClock::now());
+        if (sleepDuration.count() > 0)
+        {
+            sf::sleep(sf::microseconds(sleepDuration.count()));
+        }
+    }
+
+    host.waitIdle();
+    return true;
+}
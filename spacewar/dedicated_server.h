@@ -0,0 +1,8 @@
+﻿#pragma once
+
+#include "game_math.h"
+
+// Runs matches on the UDP port for as long as ticksCount ticks take, or until the process is killed if it's 0. Clients that
+// say hello are paired into matches, a new match is started when all matches are full, up to maxMatchesCount of them.
+// A slot is freed when its client goes silent. Matches tick on a MatchHost, the thread only moves datagrams around
+bool runDedicatedServer(unsigned short port, Vec2 worldSize, int maxMatchesCount, int ticksCount);
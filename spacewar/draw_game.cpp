@@ -1,5 +1,7 @@
 ﻿#include "draw_game.h"
+#include "game_entities.h"
 #include "game_visual.h"
+#include "profiler.h"
 
 #include <array>
 #include <SFML/Graphics.hpp>
@@ -25,49 +27,75 @@ private:
     const sf::Texture* m_texture;
 };
 
-static void drawShipTexture9times(const Vec2 pos, const float rotation, const Vec2& worldSize, sf::Drawable& drawable, sf::Transformable& transformable, sf::RenderWindow& window)
+// how far out of the view things are still drawn, they are seen partly up to their size around their position
+constexpr float DRAW_STAR_MARGIN = 2.f;
+constexpr float DRAW_PARTICLE_MARGIN = 20.f;
+constexpr float DRAW_GRAVITY_WELL_RADIUS = 100.f;
+constexpr float DRAW_USING_SHIP_TEXTURE_MARGIN = 50.f;
+constexpr float DRAW_GRID_CELL_SIZE = 250.f;
+// corners of an asteroid, each one a bit in or out of the collider circle
+constexpr int DRAW_ASTEROID_CORNERS_COUNT = 7;
+constexpr float DRAW_ASTEROID_CORNER_JITTER = 0.25f;
+
+static sf::FloatRect getViewBounds(const sf::RenderWindow& window)
+{
+    const sf::View& view = window.getView();
+    return sf::FloatRect{view.getCenter() - view.getSize() / 2.f, view.getSize()};
+}
+
+static void drawShipTexture(const Vec2 pos, const float rotation, sf::Drawable& drawable, sf::Transformable& transformable, sf::RenderWindow& window)
 {
     // sprite is pointing upwards, but with zero rotation it must be pointing right, so offset the rotation
     transformable.setRotation(rotation + 90.f);
+    transformable.setPosition(pos);
+    window.draw(drawable);
+}
 
-    // draw obj 9 times for wrap around world case, hoping sfml will do the culling 
-    {
-        transformable.setPosition(pos);
-        window.draw(drawable);
-
-        transformable.setPosition(pos + Vec2{worldSize.x, 0.f});
-        window.draw(drawable);
-
-        transformable.setPosition(pos + Vec2{-worldSize.x, 0.f});
-        window.draw(drawable);
-
-        transformable.setPosition(pos + Vec2{0.f, worldSize.y});
-        window.draw(drawable);
-
-        transformable.setPosition(pos + Vec2{0.f, -worldSize.y});
-        window.draw(drawable);
+static void rebuildDrawGrids(GameDrawGrids& grids, const entt::registry& registry, const Vec2 worldSize)
+{
+    PROFILE_FUNCTION();
 
-        transformable.setPosition(pos + worldSize);
-        window.draw(drawable);
+    spatialGridStart(grids.stars, worldSize, DRAW_GRID_CELL_SIZE);
+    for (auto [entity, position, star] : registry.view<const PositionComponent, const StarComponent>().each())
+    {
+        spatialGridAdd(grids.stars, entity, vec2Wrap(position.vec, worldSize));
+    }
+    spatialGridFinish(grids.stars);
 
-        transformable.setPosition(pos - worldSize);
-        window.draw(drawable);
+    spatialGridStart(grids.particles, worldSize, DRAW_GRID_CELL_SIZE);
+    for (auto [entity, position, particle, destroyTimer] :
+         registry.view<const PositionComponent, const ParticleComponent, const DestroyTimerComponent>().each())
+    {
+        spatialGridAdd(grids.particles, entity, vec2Wrap(position.vec, worldSize));
+    }
+    spatialGridFinish(grids.particles);
 
-        transformable.setPosition(pos + Vec2{-worldSize.x, worldSize.y});
-        window.draw(drawable);
+    spatialGridStart(grids.usingShipTexture, worldSize, DRAW_GRID_CELL_SIZE);
+    for (auto [entity, position, rotation, draw] :
+         registry.view<const PositionComponent, const RotationComponent, const DrawUsingShipTextureComponent>().each())
+    {
+        spatialGridAdd(grids.usingShipTexture, entity, vec2Wrap(position.vec, worldSize));
+    }
+    spatialGridFinish(grids.usingShipTexture);
 
-        transformable.setPosition(pos + Vec2{worldSize.x, -worldSize.y});
-        window.draw(drawable);
+    spatialGridStart(grids.asteroids, worldSize, DRAW_GRID_CELL_SIZE);
+    for (auto [entity, position, collider] :
+         registry.view<const PositionComponent, const CircleColliderComponent, const AsteroidComponent>().each())
+    {
+        spatialGridAdd(grids.asteroids, entity, vec2Wrap(position.vec, worldSize), collider.radius);
     }
+    spatialGridFinish(grids.asteroids);
 }
 
-void drawStarsSystem(const entt::registry& registry, sf::RenderWindow& window, const float time)
+void drawStarsSystem(const entt::registry& registry, const SpatialGrid& grid, sf::RenderWindow& window, const float time)
 {
-    const auto view = registry.view<const PositionComponent, const StarComponent>();
+    PROFILE_FUNCTION();
+
     sf::CircleShape starShape;
 
-    for (auto [_, position, star] : view.each())
+    spatialGridQueryWrapped(grid, getViewBounds(window), DRAW_STAR_MARGIN, [&](const SpatialGrid::Entry& entry, const Vec2 position)
     {
+        const StarComponent& star = registry.get<StarComponent>(entry.entity);
         const float angle = floatWrap(time * star.brightnessPeriodsPerSec * 360.f, 360.f);
         const float brightnessT = std::sin(degToRad(angle)) / 2.f + 0.5f;
 
@@ -75,82 +103,139 @@ void drawStarsSystem(const entt::registry& registry, sf::RenderWindow& window, c
         const sf::Uint8 colorMagnitude = static_cast<sf::Uint8>(brightness * 255.f);
         const sf::Color color = sf::Color{colorMagnitude, colorMagnitude, colorMagnitude, 255};
 
-        starShape.setPosition(position.vec);
+        starShape.setPosition(position);
         starShape.setFillColor(color);
         starShape.setRadius(star.radius);
         starShape.setOrigin(Vec2{starShape.getRadius(), starShape.getRadius()});
         window.draw(starShape);
+    });
+}
+
+static void drawGravityWell(const Vec2 position, sf::RenderWindow& window, const float time)
+{
+    sf::CircleShape gravityWellShape;
+    gravityWellShape.setPosition(position);
+
+    const int count = 20;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const float angle = floatWrap(time * 30.f + i * 260.f / count, 360.f);
+        const float radiusMultiplier = std::cos(degToRad(angle)) / 2.f + 0.5f;
+        const float radius = DRAW_GRAVITY_WELL_RADIUS * radiusMultiplier;
+
+        gravityWellShape.setFillColor(colorLerp(sf::Color{0, 0, 0, 120}, sf::Color{0, 0, 0, 0}, radiusMultiplier));
+        gravityWellShape.setRadius(radius);
+        gravityWellShape.setOrigin(Vec2{gravityWellShape.getRadius(), gravityWellShape.getRadius()});
+        window.draw(gravityWellShape);
     }
 }
 
-void drawGravityWellsSystem(const entt::registry& registry, sf::RenderWindow& window, const float time)
+void drawGravityWellsSystem(const entt::registry& registry, sf::RenderWindow& window, const Vec2 worldSize, const float time)
 {
+    PROFILE_FUNCTION();
+
+    // there are few wells, each one is just checked against the view
     const auto view = registry.view<const PositionComponent, const GravityWellComponent>();
 
-    for (auto [_, position, gravityWell] : view.each())
+    forEachWorldCopyInRect(worldSize, getViewBounds(window), DRAW_GRAVITY_WELL_RADIUS, [&](const Vec2 worldOffset, const sf::FloatRect& localRect)
+    {
+        for (auto [_, position, gravityWell] : view.each())
+        {
+            if (localRect.contains(position.vec))
+            {
+                drawGravityWell(position.vec + worldOffset, window, time);
+            }
+        }
+    });
+}
+
+void drawAsteroidsSystem(GameDrawGrids& grids, sf::RenderWindow& window)
+{
+    PROFILE_FUNCTION();
+
+    std::vector<sf::Vertex>& vertices = grids.asteroidsVertices;
+    vertices.clear();
+
+    spatialGridQueryWrapped(grids.asteroids, getViewBounds(window), ASTEROID_RADIUS_RANGE.max * (1.f + DRAW_ASTEROID_CORNER_JITTER),
+                            [&vertices](const SpatialGrid::Entry& entry, const Vec2 position)
     {
-        sf::CircleShape gravityWellShape;
-        gravityWellShape.setPosition(position.vec);
+        // the outline only depends on the entity, so an asteroid keeps its look from frame to frame
+        const uint32_t id = static_cast<uint32_t>(entt::to_integral(entry.entity));
+        const sf::Uint8 shade = static_cast<sf::Uint8>(110 + id % 40);
+        const sf::Color color{shade, static_cast<sf::Uint8>(shade - 10), static_cast<sf::Uint8>(shade - 20), 255};
 
-        const int count = 20;
+        Vec2 corners[DRAW_ASTEROID_CORNERS_COUNT];
+        for (int i = 0; i < DRAW_ASTEROID_CORNERS_COUNT; ++i)
+        {
+            const uint32_t hash = (id * 2654435761u) ^ (static_cast<uint32_t>(i) * 40503u);
+            const float jitter = (static_cast<float>(hash % 1000) / 999.f * 2.f - 1.f) * DRAW_ASTEROID_CORNER_JITTER;
+            const float angle = (id % 360) + i * 360.f / DRAW_ASTEROID_CORNERS_COUNT;
+            corners[i] = position + vec2AngleToDir(angle) * entry.radius * (1.f + jitter);
+        }
 
-        for (int i = 0; i < count; ++i)
+        for (int i = 0; i < DRAW_ASTEROID_CORNERS_COUNT; ++i)
         {
-            const float angle = floatWrap(time * 30.f + i * 260.f / count, 360.f);
-            const float radiusMultiplier = std::cos(degToRad(angle)) / 2.f + 0.5f;
-            const float radius = 100.f * radiusMultiplier;
-
-            gravityWellShape.setFillColor(colorLerp(sf::Color{0, 0, 0, 120}, sf::Color{0, 0, 0, 0}, radiusMultiplier));
-            gravityWellShape.setRadius(radius);
-            gravityWellShape.setOrigin(Vec2{gravityWellShape.getRadius(), gravityWellShape.getRadius()});
-            window.draw(gravityWellShape);
+            vertices.emplace_back(position, color);
+            vertices.emplace_back(corners[i], color);
+            vertices.emplace_back(corners[(i + 1) % DRAW_ASTEROID_CORNERS_COUNT], color);
         }
+    });
+
+    if (!vertices.empty())
+    {
+        window.draw(vertices.data(), vertices.size(), sf::Triangles);
     }
 }
 
-void drawParticlesSystem(const entt::registry& registry, sf::RenderWindow& window)
+void drawParticlesSystem(const entt::registry& registry, const SpatialGrid& grid, sf::RenderWindow& window)
 {
+    PROFILE_FUNCTION();
+
     sf::CircleShape particleShape;
-    const auto view = registry.view<const PositionComponent, const ParticleComponent, const DestroyTimerComponent>();
 
-    for (auto [_, position, particle, destroyTimer] : view.each())
+    spatialGridQueryWrapped(grid, getViewBounds(window), DRAW_PARTICLE_MARGIN, [&](const SpatialGrid::Entry& entry, const Vec2 position)
     {
+        const auto [particle, destroyTimer] = registry.get<ParticleComponent, DestroyTimerComponent>(entry.entity);
         const float t = (particle.totalLifetime - destroyTimer.timeLeft) / particle.totalLifetime;
         const float radius = floatLerp(particle.startRadius, particle.finishRadius, t);
         const sf::Color color = colorLerp(particle.startColor, particle.finishColor, t);
 
         particleShape.setRadius(radius);
         particleShape.setOrigin(Vec2{particleShape.getRadius(), particleShape.getRadius()});
-        particleShape.setPosition(position.vec);
+        particleShape.setPosition(position);
         particleShape.setFillColor(color);
         window.draw(particleShape);
-    }
+    });
 }
 
-void drawUsingShipTextureSystem(const entt::registry& registry, sf::RenderWindow& window, const sf::Texture& shipTexture, const Vec2 worldSize)
+void drawUsingShipTextureSystem(const entt::registry& registry, const SpatialGrid& grid, sf::RenderWindow& window, const sf::Texture& shipTexture)
 {
+    PROFILE_FUNCTION();
+
     sf::RectangleShape shipShape;
     shipShape.setTexture(&shipTexture);
 
-    const auto view = registry.view<const PositionComponent, const RotationComponent, const DrawUsingShipTextureComponent>();
-
-    for (auto [entity, pos, rotation, draw] : view.each())
+    spatialGridQueryWrapped(grid, getViewBounds(window), DRAW_USING_SHIP_TEXTURE_MARGIN, [&](const SpatialGrid::Entry& entry, const Vec2 position)
     {
-        // somehow exclude does not work on view
-        if (registry.try_get<DeadShipPieceComponent>(entity) != nullptr)
+        // dead ship pieces share the grid and are drawn by drawDeadShipPiecesSystem
+        if (registry.try_get<DeadShipPieceComponent>(entry.entity) != nullptr)
         {
-            continue;
+            return;
         }
 
+        const auto [rotation, draw] = registry.get<RotationComponent, DrawUsingShipTextureComponent>(entry.entity);
         shipShape.setSize(draw.size);
         shipShape.setOrigin(draw.size / 2.f);
         shipShape.setFillColor(draw.color);
-        drawShipTexture9times(pos.vec, rotation.angle, worldSize, shipShape, shipShape, window);
-    }
+        drawShipTexture(position, rotation.angle, shipShape, shipShape, window);
+    });
 }
 
-void drawDeadShipPiecesSystem(const entt::registry& registry, sf::RenderWindow& window, const sf::Texture& shipTexture, const Vec2 worldSize)
+void drawDeadShipPiecesSystem(const entt::registry& registry, const SpatialGrid& grid, sf::RenderWindow& window, const sf::Texture& shipTexture)
 {
+    PROFILE_FUNCTION();
+
     std::array<sf::Vertex, DEAD_SHIP_PIECES_COUNT + 1> shipPiecesVertices;
     shipPiecesVertices[0].position = Vec2{0.5f, 0.5f};
     shipPiecesVertices[1].position = Vec2{0.0f, 0.0f};
@@ -170,15 +255,16 @@ void drawDeadShipPiecesSystem(const entt::registry& registry, sf::RenderWindow&
         vertex.texCoords.y *= shipTextureSize.y;
     }
 
-    const auto view = registry.view<
-        const PositionComponent,
-        const RotationComponent,
-        const DrawUsingShipTextureComponent,
-        const DeadShipPieceComponent>();
-
-    for (auto [entity, pos, rotation, draw, deadPiece] : view.each())
+    spatialGridQueryWrapped(grid, getViewBounds(window), DRAW_USING_SHIP_TEXTURE_MARGIN, [&](const SpatialGrid::Entry& entry, const Vec2 position)
     {
-        const int i = deadPiece.pieceIndex;
+        const DeadShipPieceComponent* deadPiece = registry.try_get<DeadShipPieceComponent>(entry.entity);
+        if (deadPiece == nullptr)
+        {
+            return;
+        }
+
+        const auto [rotation, draw] = registry.get<RotationComponent, DrawUsingShipTextureComponent>(entry.entity);
+        const int i = deadPiece->pieceIndex;
         sf::VertexArray triangleVertices{sf::Triangles, 3};
         triangleVertices[0] = shipPiecesVertices[0];
         triangleVertices[1] = shipPiecesVertices[i + 1];
@@ -193,17 +279,23 @@ void drawDeadShipPiecesSystem(const entt::registry& registry, sf::RenderWindow&
         customShape.setOrigin(Vec2{0.5, 0.5});
         customShape.setScale(draw.size);
 
-        drawShipTexture9times(pos.vec, rotation.angle, worldSize, customShape, customShape, window);
-    }
+        drawShipTexture(position, rotation.angle, customShape, customShape, window);
+    });
 }
 
-void drawGame(sf::RenderWindow& window, const sf::Texture& shipTexture, const entt::registry& registry, const Vec2 worldSize, const float time)
+void drawGame(sf::RenderWindow& window, GameDrawGrids& grids, const sf::Texture& shipTexture, const entt::registry& registry, const Vec2 worldSize,
+              const float time)
 {
-    drawStarsSystem(registry, window, time);
-    drawGravityWellsSystem(registry, window, time);
-    drawParticlesSystem(registry, window);
-    drawUsingShipTextureSystem(registry, window, shipTexture, worldSize);
-    drawDeadShipPiecesSystem(registry, window, shipTexture, worldSize);
+    PROFILE_FUNCTION();
+
+    rebuildDrawGrids(grids, registry, worldSize);
+
+    drawStarsSystem(registry, grids.stars, window, time);
+    drawGravityWellsSystem(registry, window, worldSize, time);
+    drawAsteroidsSystem(grids, window);
+    drawParticlesSystem(registry, grids.particles, window);
+    drawUsingShipTextureSystem(registry, grids.usingShipTexture, window, shipTexture);
+    drawDeadShipPiecesSystem(registry, grids.usingShipTexture, window, shipTexture);
 }
 
 
@@ -223,6 +315,8 @@ static void drawThickLine(const Vec2 a, const Vec2 b, const float thickness, con
 
 void drawGravityWellDebugSystem(const entt::registry& registry, sf::RenderWindow& window, const sf::Font& font)
 {
+    PROFILE_FUNCTION();
+
     const auto gravityWellView = registry.view<const PositionComponent, const GravityWellComponent>();
 
     for (auto [_, position, well] : gravityWellView.each())
@@ -293,6 +387,8 @@ void drawGravityWellDebugSystem(const entt::registry& registry, sf::RenderWindow
 
 void drawShipDebugSystem(const entt::registry& registry, sf::RenderWindow& window)
 {
+    PROFILE_FUNCTION();
+
     const auto shipView = registry.view<
         const PositionComponent,
         const RotationComponent,
@@ -345,6 +441,8 @@ void drawShipDebugSystem(const entt::registry& registry, sf::RenderWindow& windo
 
 void drawProjectileDebugSystem(const entt::registry& registry, sf::RenderWindow& window)
 {
+    PROFILE_FUNCTION();
+
     sf::CircleShape projectileShape{5.f};
     projectileShape.setOrigin(Vec2{projectileShape.getRadius(), projectileShape.getRadius()});
     projectileShape.setFillColor(sf::Color::Red);
@@ -362,6 +460,8 @@ void drawProjectileDebugSystem(const entt::registry& registry, sf::RenderWindow&
 
 void drawGameDebug(const entt::registry& registry, sf::RenderWindow& window, const sf::Font& font)
 {
+    PROFILE_FUNCTION();
+
     drawGravityWellDebugSystem(registry, window, font);
     drawShipDebugSystem(registry, window);
     drawProjectileDebugSystem(registry, window);
@@ -1,8 +1,24 @@
 ﻿#pragma once
 
 #include "game_logic.h"
+#include "spatial_grid.h"
 
 #include <SFML/Graphics.hpp>
 
-void drawGame(sf::RenderWindow& window, const sf::Texture& shipTexture, const entt::registry& registry, Vec2 worldSize, float time);
+// What drawGame draws by where it is, rebuilt every frame to draw only what the window view shows, wrapped copies included.
+// Kept between frames so the rebuild doesn't allocate
+struct GameDrawGrids
+{
+    SpatialGrid stars{};
+    SpatialGrid particles{};
+    // ships, projectiles and dead ship pieces
+    SpatialGrid usingShipTexture{};
+    SpatialGrid asteroids{};
+    // all the asteroids in view go to the window in one draw call of these triangles
+    std::vector<sf::Vertex> asteroidsVertices{};
+};
+
+// draws the part of the world under the current view of window
+void drawGame(sf::RenderWindow& window, GameDrawGrids& grids, const sf::Texture& shipTexture, const entt::registry& registry, Vec2 worldSize,
+              float time);
 void drawGameDebug(const entt::registry& registry, sf::RenderWindow& window, const sf::Font& font);
@@ -1,11 +1,48 @@
 ﻿#include "draw_ui.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <numeric>
+
+// rows of the free for all scoreboard, the rest of the players don't fit on the screen
+constexpr int SCOREBOARD_ROWS_COUNT = 8;
+
 static void positionTextWithCenterAlignment(sf::Text& textRender, const Vec2 pos)
 {
     const sf::FloatRect localBounds = textRender.getLocalBounds();
     textRender.setPosition(pos - Vec2{localBounds.width / 2.f, localBounds.height / 2.f});
 }
 
+// best scores first, ties in player order
+static void drawScoreboard(const std::vector<Player>& players, const Vec2 center, sf::Text& textRender, sf::RenderWindow& window)
+{
+    std::vector<int> order(players.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&players](const int a, const int b)
+    {
+        return players[a].score > players[b].score;
+    });
+
+    constexpr float lineHeight = 40.f;
+    const int rowsCount = std::min(static_cast<int>(order.size()), SCOREBOARD_ROWS_COUNT);
+    Vec2 pos = center - Vec2{0.f, lineHeight * (rowsCount - 1) / 2.f};
+
+    for (int row = 0; row < rowsCount; ++row)
+    {
+        const Player& player = players[order[row]];
+        textRender.setString(player.name);
+        positionTextWithCenterAlignment(textRender, pos + Vec2{-150.f, 0.f});
+        window.draw(textRender);
+
+        textRender.setString(std::to_string(player.score));
+        positionTextWithCenterAlignment(textRender, pos + Vec2{150.f, 0.f});
+        window.draw(textRender);
+
+        pos.y += lineHeight;
+    }
+}
+
 void drawGameOverUi(const GameResult gameResult, const float timeWhenRestart, const float timeInState, const std::vector<Player>& players, sf::RenderWindow& window, const sf::Font& font)
 {
     const float time = timeInState;
@@ -41,7 +78,14 @@ void drawGameOverUi(const GameResult gameResult, const float timeWhenRestart, co
         animationTime += 1.f;
     }
 
-    if (players.size() > 0 && time > animationTime)
+    if (players.size() > 2 && time > animationTime)
+    {
+        textRender.setCharacterSize(30);
+        drawScoreboard(players, windowCenter + Vec2{0.f, 25.f}, textRender, window);
+        textRender.setCharacterSize(40);
+    }
+
+    if (players.size() <= 2 && players.size() > 0 && time > animationTime)
     {
         const Player& player = players[0];
         textRender.setString(player.name + " score");
@@ -53,7 +97,7 @@ void drawGameOverUi(const GameResult gameResult, const float timeWhenRestart, co
         window.draw(textRender);
     }
 
-    if (players.size() > 1 && time > animationTime)
+    if (players.size() == 2 && time > animationTime)
     {
         const Player& player = players[1];
         textRender.setString(player.name + " score");
@@ -182,11 +226,71 @@ void drawStartingUi(const std::vector<bool>& playersReady, const std::vector<Pla
         }
     }
 
+    const long long botsCount = std::count_if(players.begin(), players.end(), [](const Player& player)
+    {
+        return player.isBot;
+    });
+    if (botsCount > 0 && time > animationTime)
+    {
+        textRender.setString("+ " + std::to_string(botsCount) + " bots, free for all");
+        positionTextWithCenterAlignment(textRender, windowCenter + Vec2{0.f, 420.f});
+        window.draw(textRender);
+    }
+
     if (time > animationTime)
     {
         textRender.setCharacterSize(30);
-        textRender.setString("press ~ in game for debug view");
+        textRender.setString("press ~ in game for debug view, F1 for profiler");
         positionTextWithCenterAlignment(textRender, windowCenter + Vec2{0.f, 475.f});
         window.draw(textRender);
     }
 }
+
+void drawProfilerUi(const std::vector<ProfilerScopeStats>& scopesStats, sf::RenderWindow& window, const sf::Font& font)
+{
+    constexpr float lineHeight = 16.f;
+    constexpr float nameColumnWidth = 330.f;
+    constexpr float valueColumnWidth = 70.f;
+    const Vec2 origin{10.f, 10.f};
+
+    sf::RectangleShape background{Vec2{nameColumnWidth + valueColumnWidth * 3.f + 10.f, lineHeight * (scopesStats.size() + 1) + 10.f}};
+    background.setPosition(origin - Vec2{5.f, 5.f});
+    background.setFillColor(sf::Color{0, 0, 0, 180});
+    window.draw(background);
+
+    sf::Text textRender;
+    textRender.setFont(font);
+    textRender.setCharacterSize(13);
+    textRender.setFillColor(sf::Color::White);
+
+    const auto drawLine = [&](const int lineIndex, const std::string& name, const std::array<std::string, 3>& values)
+    {
+        const float y = origin.y + lineIndex * lineHeight;
+
+        textRender.setString(name);
+        textRender.setPosition(Vec2{origin.x, y});
+        window.draw(textRender);
+
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            textRender.setString(values[i]);
+            textRender.setPosition(Vec2{origin.x + nameColumnWidth + i * valueColumnWidth, y});
+            window.draw(textRender);
+        }
+    };
+
+    const auto msToString = [](const float ms)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", ms);
+        return std::string{buffer};
+    };
+
+    drawLine(0, "scope (ms)", {"last", "avg", "max"});
+
+    for (size_t i = 0; i < scopesStats.size(); ++i)
+    {
+        const ProfilerScopeStats& stats = scopesStats[i];
+        drawLine(static_cast<int>(i) + 1, stats.name, {msToString(stats.lastMs), msToString(stats.avgMs), msToString(stats.maxMs)});
+    }
+}
@@ -2,8 +2,10 @@
 
 #include "app_state.h"
 #include "player.h"
+#include "profiler.h"
 
 #include <SFML/Graphics.hpp>
 
 void drawGameOverUi(GameResult gameResult, float timeWhenRestart, float timeInState, const std::vector<Player>& players, sf::RenderWindow& window, const sf::Font& font);
 void drawStartingUi(const std::vector<bool>& playersReady, const std::vector<Player>& players, sf::RenderWindow& window, const sf::Font& font, float timeInState);
+void drawProfilerUi(const std::vector<ProfilerScopeStats>& scopesStats, sf::RenderWindow& window, const sf::Font& font);
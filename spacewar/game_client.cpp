@@ -0,0 +1,505 @@
+﻿#include "game_client.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "profiler.h"
+#include "replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+constexpr int CLIENT_HELLO_INTERVAL_TICKS = 30;
+constexpr size_t CLIENT_MAX_SNAPSHOTS = 32;
+// older inputs than these are either acked or were skipped by the server long ago
+constexpr size_t CLIENT_MAX_PENDING_INPUTS = 120;
+
+// the shortest way between two points may go across the world edge
+static NetEntityState interpolateEntityState(const NetEntityState& from, const NetEntityState& to, const float t, const Vec2 worldSize)
+{
+    NetEntityState result = t < 0.5f ? from : to;
+
+    const Vec2 positionDiff = vec2WrappedDiff(from.position, to.position, worldSize);
+    // teleported, there is nothing in between
+    if (vec2Length(positionDiff) > worldSize.x / 4.f)
+    {
+        return result;
+    }
+
+    result.position = vec2Wrap(from.position + positionDiff * t, worldSize);
+    result.velocity = from.velocity + (to.velocity - from.velocity) * t;
+
+    const float rotationDiff = floatWrap(to.rotation - from.rotation + 180.f, 360.f) - 180.f;
+    result.rotation = floatWrap(from.rotation + rotationDiff * t, 360.f);
+
+    return result;
+}
+
+GameClient::GameClient(NetTransport& transport) : m_transport(transport)
+{
+}
+
+void GameClient::tick(entt::registry& registry, std::vector<Player>& players, const ShipInput& localInput)
+{
+    PROFILE_FUNCTION();
+
+    ++m_tick;
+    m_serverTickEstimate += 1.f;
+
+    receivePackets(registry, players);
+
+    if (!m_isConnected)
+    {
+        if (m_tick % CLIENT_HELLO_INTERVAL_TICKS == 1)
+        {
+            writeHelloPacket(m_packet);
+            m_transport.send(m_packet);
+        }
+        return;
+    }
+
+    const PendingInput input{++m_lastInputSeq, packShipInput(localInput)};
+    m_pendingInputs.push_back(input);
+    if (m_pendingInputs.size() > CLIENT_MAX_PENDING_INPUTS)
+    {
+        m_pendingInputs.pop_front();
+    }
+    sendInputs();
+
+    // no round yet
+    if (m_snapshots.empty())
+    {
+        return;
+    }
+
+    predictTick(input.packedInput);
+    interpolateEntities(m_serverTickEstimate - CLIENT_INTERPOLATION_DELAY_TICKS);
+
+    gameVisualFrameUpdate(registry, GAME_TICK_DT, m_worldSize);
+    applyToWorld(registry, players);
+}
+
+bool GameClient::isConnected() const
+{
+    return m_isConnected;
+}
+
+int GameClient::getLocalPlayerIndex() const
+{
+    return m_localPlayerIndex;
+}
+
+Vec2 GameClient::getWorldSize() const
+{
+    return m_worldSize;
+}
+
+std::optional<GameResult> GameClient::getRoundResult() const
+{
+    if (m_snapshots.empty() || !m_snapshots.back().isRoundOver)
+    {
+        return {};
+    }
+    return m_snapshots.back().roundResult;
+}
+
+const GameClientStats& GameClient::getStats() const
+{
+    return m_stats;
+}
+
+void GameClient::receivePackets(entt::registry& registry, std::vector<Player>& players)
+{
+    while (m_transport.receive(m_packet))
+    {
+        if (m_packet.empty())
+        {
+            continue;
+        }
+
+        switch (static_cast<NetPacketType>(m_packet[0]))
+        {
+        case NetPacketType::Welcome:
+            if (!m_isConnected && readWelcomePacket(m_packet, m_localPlayerIndex, m_worldSize))
+            {
+                m_isConnected = true;
+                m_snapshotDecoder.reset(m_worldSize);
+            }
+            break;
+
+        case NetPacketType::Snapshot:
+            receiveSnapshot(registry, players);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+void GameClient::receiveSnapshot(entt::registry& registry, std::vector<Player>& players)
+{
+    if (!m_isConnected || !m_snapshotDecoder.readPacket(m_packet, m_receivedSnapshot) || m_receivedSnapshot.roundId < m_roundId)
+    {
+        return;
+    }
+
+    ++m_stats.snapshotsReceivedCount;
+    m_stats.snapshotBytesReceivedCount += static_cast<int64_t>(m_packet.size());
+
+    if (m_receivedSnapshot.roundId > m_roundId)
+    {
+        startRound(registry, players, m_receivedSnapshot.roundId);
+    }
+
+    // snapshots may come in any order or twice
+    const auto it = std::find_if(m_snapshots.begin(), m_snapshots.end(), [this](const NetSnapshot& snapshot)
+    {
+        return snapshot.tick >= m_receivedSnapshot.tick;
+    });
+    if (it != m_snapshots.end() && it->tick == m_receivedSnapshot.tick)
+    {
+        return;
+    }
+
+    const bool isNewest = it == m_snapshots.end();
+    m_snapshots.insert(it, m_receivedSnapshot);
+    if (m_snapshots.size() > CLIENT_MAX_SNAPSHOTS)
+    {
+        m_snapshots.pop_front();
+    }
+
+    if (!isNewest)
+    {
+        return;
+    }
+
+    // arrival times jitter, so the estimate only drifts towards them unless it's way off
+    const float snapshotTick = static_cast<float>(m_receivedSnapshot.tick);
+    if (std::abs(snapshotTick - m_serverTickEstimate) > 30.f)
+    {
+        m_serverTickEstimate = snapshotTick;
+    }
+    else
+    {
+        m_serverTickEstimate += (snapshotTick - m_serverTickEstimate) * 0.1f;
+    }
+
+    for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT && playerIndex < static_cast<int>(players.size()); ++playerIndex)
+    {
+        players[playerIndex].score = m_receivedSnapshot.scores[playerIndex];
+    }
+
+    reconcile(m_snapshots.back());
+}
+
+void GameClient::startRound(entt::registry& registry, std::vector<Player>& players, const uint32_t roundId)
+{
+    m_roundId = roundId;
+    m_snapshots.clear();
+
+    // the same stars as everybody else has
+    randomSeed(roundId);
+    recreateGameWorld(registry, players, m_worldSize);
+    m_projectileProxies.clear();
+
+    // the first snapshot of the round moves it where it should be
+    m_predictionRegistry.clear();
+    createGravityWellEntity(m_predictionRegistry, m_worldSize);
+    m_predictedShip = createShipEntity(m_predictionRegistry, Vec2{}, 0.f, sf::Color::White, m_localPlayerIndex);
+}
+
+void GameClient::reconcile(const NetSnapshot& snapshot)
+{
+    while (!m_pendingInputs.empty() && m_pendingInputs.front().seq <= snapshot.ackedInputSeq)
+    {
+        m_pendingInputs.pop_front();
+    }
+
+    if (!m_predictionRegistry.valid(m_predictedShip))
+    {
+        return;
+    }
+
+    const auto it = std::find_if(snapshot.entities.begin(), snapshot.entities.end(), [this](const NetEntityState& state)
+    {
+        return state.kind == NetEntityKind::Ship && state.playerIndex == m_localPlayerIndex;
+    });
+    if (it == snapshot.entities.end())
+    {
+        // only the server decides who dies
+        m_predictionRegistry.destroy(m_predictedShip);
+        return;
+    }
+
+    PositionComponent& position = m_predictionRegistry.get<PositionComponent>(m_predictedShip);
+    const Vec2 predictedPosition = position.vec;
+
+    // the server state is after the acked input, the ones after it are simulated again on top of it
+    position.vec = it->position;
+    m_predictionRegistry.get<VelocityComponent>(m_predictedShip).vec = it->velocity;
+    m_predictionRegistry.get<RotationComponent>(m_predictedShip).angle = it->rotation;
+    m_predictionRegistry.get<AccelerateImpulseByInputComponent>(m_predictedShip).cooldownTimer.timeLeft = it->impulseCooldownLeft;
+
+    for (const PendingInput& input : m_pendingInputs)
+    {
+        predictTick(input.packedInput);
+    }
+
+    // the ship of a new round has nothing predicted yet
+    if (m_snapshots.size() == 1)
+    {
+        return;
+    }
+
+    const float predictionError = vec2Length(vec2WrappedDiff(predictedPosition, position.vec, m_worldSize));
+    ++m_stats.reconciliationsCount;
+    m_stats.totalPredictionError += predictionError;
+    m_stats.maxPredictionError = std::max(m_stats.maxPredictionError, predictionError);
+    // snapshots are quantized, a ship where it should be is still off by a fraction of a pixel
+    if (predictionError > 0.1f)
+    {
+        ++m_stats.mispredictionsCount;
+    }
+}
+
+void GameClient::predictTick(const uint8_t packedInput)
+{
+    entt::registry& registry = m_predictionRegistry;
+    if (!registry.valid(m_predictedShip))
+    {
+        return;
+    }
+
+    applyShipInput(registry, m_predictedShip, unpackShipInput(packedInput));
+
+    // the same movement systems in the same order as on the server, nothing else can move the ship
+    accelerateImpulseAppliedOneshotComponentClearSystem(registry);
+    gravityWellSystem(registry, GAME_TICK_DT);
+    rotateByInputSystem(registry);
+    accelerateByInputSystem(registry, GAME_TICK_DT);
+    accelerateImpulseSystem(registry, GAME_TICK_DT);
+    applyRotationSpeedSystem(registry, GAME_TICK_DT);
+    applyVelocitySystem(registry, GAME_TICK_DT);
+    wrapPositionAroundWorldSystem(registry, m_worldSize);
+    teleportSystem(registry);
+}
+
+void GameClient::sendInputs()
+{
+    const size_t inputsCount = std::min(m_pendingInputs.size(), static_cast<size_t>(CLIENT_MAX_INPUTS_PER_PACKET));
+
+    m_inputsToSend.clear();
+    for (auto it = m_pendingInputs.end() - inputsCount; it != m_pendingInputs.end(); ++it)
+    {
+        m_inputsToSend.push_back(it->packedInput);
+    }
+
+    writeInputPacket(m_packet, m_snapshotDecoder.getLatestTick(), m_lastInputSeq, m_inputsToSend.data(), static_cast<int>(inputsCount));
+    m_transport.send(m_packet);
+}
+
+void GameClient::interpolateEntities(const float renderTick)
+{
+    // only the last snapshot before the render tick and the ones after it are needed
+    while (m_snapshots.size() > 2 && static_cast<float>(m_snapshots[1].tick) <= renderTick)
+    {
+        m_snapshots.pop_front();
+    }
+
+    const NetSnapshot& from = m_snapshots[0];
+    if (m_snapshots.size() == 1 || static_cast<float>(from.tick) >= renderTick)
+    {
+        m_interpolatedEntities = from.entities;
+        return;
+    }
+
+    // it's the newest one when snapshots stopped coming, entities stay where they were last seen then
+    const NetSnapshot& to = m_snapshots[1];
+    const float t = std::min((renderTick - from.tick) / static_cast<float>(to.tick - from.tick), 1.f);
+
+    m_interpolatedEntities.clear();
+
+    // both are sorted by net id, entities that are gone in the next snapshot stay until it's reached
+    auto toIt = to.entities.begin();
+    for (const NetEntityState& fromState : from.entities)
+    {
+        while (toIt != to.entities.end() && toIt->netId < fromState.netId)
+        {
+            ++toIt;
+        }
+
+        const bool isInBoth = toIt != to.entities.end() && toIt->netId == fromState.netId;
+        m_interpolatedEntities.push_back(isInBoth ? interpolateEntityState(fromState, *toIt, t, m_worldSize) : fromState);
+    }
+}
+
+void GameClient::applyToWorld(entt::registry& registry, std::vector<Player>& players)
+{
+    for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT; ++playerIndex)
+    {
+        const entt::registry::entity_type ship = players[playerIndex].shipEntity;
+        if (!registry.valid(ship) || registry.has<CollisionHappenedOneshotComponent>(ship))
+        {
+            continue;
+        }
+
+        if (playerIndex == m_localPlayerIndex)
+        {
+            if (!m_predictionRegistry.valid(m_predictedShip))
+            {
+                registry.emplace<CollisionHappenedOneshotComponent>(ship);
+                continue;
+            }
+
+            registry.get<PositionComponent>(ship) = m_predictionRegistry.get<PositionComponent>(m_predictedShip);
+            registry.get<VelocityComponent>(ship) = m_predictionRegistry.get<VelocityComponent>(m_predictedShip);
+            registry.get<RotationComponent>(ship) = m_predictionRegistry.get<RotationComponent>(m_predictedShip);
+            registry.get<AccelerateByInputComponent>(ship).input = m_predictionRegistry.get<AccelerateByInputComponent>(m_predictedShip).input;
+            if (m_predictionRegistry.has<AccelerateImpulseAppliedOneshotComponent>(m_predictedShip))
+            {
+                registry.emplace_or_replace<AccelerateImpulseAppliedOneshotComponent>(ship);
+            }
+            continue;
+        }
+
+        const auto it = std::find_if(m_interpolatedEntities.begin(), m_interpolatedEntities.end(), [playerIndex](const NetEntityState& state)
+        {
+            return state.kind == NetEntityKind::Ship && state.playerIndex == playerIndex;
+        });
+        if (it == m_interpolatedEntities.end())
+        {
+            // blows up with pieces flying around on the next tick
+            registry.emplace<CollisionHappenedOneshotComponent>(ship);
+            continue;
+        }
+
+        registry.get<PositionComponent>(ship).vec = it->position;
+        registry.get<VelocityComponent>(ship).vec = it->velocity;
+        registry.get<RotationComponent>(ship).angle = it->rotation;
+        registry.get<AccelerateByInputComponent>(ship).input = it->isThrusting;
+    }
+
+    // both are sorted by net id, proxies of projectiles that are gone are destroyed on the way
+    m_nextProjectileProxies.clear();
+    auto proxyIt = m_projectileProxies.begin();
+    const auto destroyProxy = [&registry](const ProjectileProxy& proxy)
+    {
+        if (registry.valid(proxy.entity))
+        {
+            registry.destroy(proxy.entity);
+        }
+    };
+
+    for (const NetEntityState& state : m_interpolatedEntities)
+    {
+        if (state.kind != NetEntityKind::Projectile)
+        {
+            continue;
+        }
+
+        for (; proxyIt != m_projectileProxies.end() && proxyIt->netId < state.netId; ++proxyIt)
+        {
+            destroyProxy(*proxyIt);
+        }
+
+        entt::registry::entity_type entity = entt::null;
+        if (proxyIt != m_projectileProxies.end() && proxyIt->netId == state.netId)
+        {
+            entity = proxyIt->entity;
+            ++proxyIt;
+        }
+
+        if (!registry.valid(entity))
+        {
+            entity = createProjectileEntity(registry);
+            registry.emplace<PositionComponent>(entity);
+            registry.emplace<RotationComponent>(entity);
+            registry.emplace<VelocityComponent>(entity);
+        }
+
+        registry.get<PositionComponent>(entity).vec = state.position;
+        registry.get<RotationComponent>(entity).angle = state.rotation;
+        registry.get<VelocityComponent>(entity).vec = state.velocity;
+
+        m_nextProjectileProxies.push_back(ProjectileProxy{state.netId, entity});
+    }
+
+    for (; proxyIt != m_projectileProxies.end(); ++proxyIt)
+    {
+        destroyProxy(*proxyIt);
+    }
+
+    m_projectileProxies.swap(m_nextProjectileProxies);
+}
+
+struct ServerLoopbackClient
+{
+    entt::registry registry{};
+    std::vector<Player> players{};
+    std::unique_ptr<GameClient> client{};
+};
+
+bool runServerLoopback(const int ticksCount, const float latency, const float packetLossRate, const bool verbose)
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    GameServer server{worldSize};
+    std::unique_ptr<LoopbackNetwork> networks[NET_PLAYERS_COUNT];
+    ServerLoopbackClient clients[NET_PLAYERS_COUNT];
+
+    for (int i = 0; i < NET_PLAYERS_COUNT; ++i)
+    {
+        networks[i] = std::make_unique<LoopbackNetwork>(latency, packetLossRate, i + 1);
+        server.setClientTransport(i, &networks[i]->getEnd(0));
+
+        clients[i].players.resize(NET_PLAYERS_COUNT);
+        clients[i].client = std::make_unique<GameClient>(networks[i]->getEnd(1));
+    }
+
+    for (int tick = 0; tick < ticksCount; ++tick)
+    {
+        for (int i = 0; i < NET_PLAYERS_COUNT; ++i)
+        {
+            networks[i]->advanceTime(GAME_TICK_DT);
+
+            ServerLoopbackClient& client = clients[i];
+            const entt::registry::entity_type ship = client.players[client.client->getLocalPlayerIndex()].shipEntity;
+            const ShipInput input = client.registry.valid(ship) ? aiGenerateInput(client.registry, ship) : ShipInput{};
+            client.client->tick(client.registry, client.players, input);
+        }
+
+        server.tick();
+    }
+
+    bool isOk = true;
+
+    if (verbose)
+    {
+        const GameServerStats& serverStats = server.getStats();
+        std::printf("server loopback: %d ticks, latency %.0f ms, packet loss %.0f%%\n", ticksCount, latency * 1000.f, packetLossRate * 100.f);
+        std::printf("server: %d ticks, %u rounds, %.1f bytes per snapshot (%.1f naive), %.1f bytes per tick per client, %lld missing inputs\n",
+                    server.getTick(), server.getRoundId(),
+                    serverStats.snapshotsSentCount ? static_cast<double>(serverStats.snapshotBytesSentCount) / serverStats.snapshotsSentCount : 0.0,
+                    serverStats.snapshotsSentCount ? static_cast<double>(serverStats.naiveSnapshotBytesCount) / serverStats.snapshotsSentCount : 0.0,
+                    server.getTick() ? static_cast<double>(serverStats.snapshotBytesSentCount) / (server.getTick() * NET_PLAYERS_COUNT) : 0.0,
+                    static_cast<long long>(serverStats.missingInputsCount));
+    }
+
+    for (int i = 0; i < NET_PLAYERS_COUNT; ++i)
+    {
+        const GameClient& client = *clients[i].client;
+        const GameClientStats& stats = client.getStats();
+        const float avgPredictionError = stats.reconciliationsCount ? stats.totalPredictionError / stats.reconciliationsCount : 0.f;
+
+        if (verbose)
+        {
+            std::printf("client %d: %d snapshots, mispredicted %d of %d, avg error %.3f, max error %.3f\n", i, stats.snapshotsReceivedCount,
+                        stats.mispredictionsCount, stats.reconciliationsCount, avgPredictionError, stats.maxPredictionError);
+        }
+
+        isOk = isOk && client.isConnected() && client.getLocalPlayerIndex() == i && stats.snapshotsReceivedCount > 0 && avgPredictionError < 1.f;
+    }
+
+    return isOk;
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "game_server.h"
+
+#include <deque>
+
+// Remote entities are shown this far in the past, so there are usually two snapshots around to interpolate between
+constexpr int CLIENT_INTERPOLATION_DELAY_TICKS = 3 * SERVER_SNAPSHOT_INTERVAL_TICKS;
+// inputs the server may not have yet, each input packet repeats them
+constexpr int CLIENT_MAX_INPUTS_PER_PACKET = 32;
+
+struct GameClientStats
+{
+    int snapshotsReceivedCount = 0;
+    int64_t snapshotBytesReceivedCount = 0;
+    // snapshots where the predicted local ship turned out to be off
+    int mispredictionsCount = 0;
+    float maxPredictionError = 0.f;
+    float totalPredictionError = 0.f;
+    int reconciliationsCount = 0;
+};
+
+// Client of a GameServer. The world in the registry is only a picture of the server one: the local ship is predicted from
+// local input and corrected by snapshots, everything else is interpolated between snapshots. Nothing is decided locally
+class GameClient
+{
+public:
+    explicit GameClient(NetTransport& transport);
+
+    // one fixed tick: takes what the server has sent, sends the local input and moves the world
+    void tick(entt::registry& registry, std::vector<Player>& players, const ShipInput& localInput);
+
+    bool isConnected() const;
+    int getLocalPlayerIndex() const;
+    Vec2 getWorldSize() const;
+    // the result of the current round as the server sees it, if it's over
+    std::optional<GameResult> getRoundResult() const;
+    const GameClientStats& getStats() const;
+
+private:
+    struct PendingInput
+    {
+        uint32_t seq = 0;
+        uint8_t packedInput = 0;
+    };
+
+    struct ProjectileProxy
+    {
+        uint32_t netId = 0;
+        entt::registry::entity_type entity = entt::null;
+    };
+
+    void receivePackets(entt::registry& registry, std::vector<Player>& players);
+    void receiveSnapshot(entt::registry& registry, std::vector<Player>& players);
+    void startRound(entt::registry& registry, std::vector<Player>& players, uint32_t roundId);
+    void reconcile(const NetSnapshot& snapshot);
+    void predictTick(uint8_t packedInput);
+    void sendInputs();
+    void interpolateEntities(float renderTick);
+    void applyToWorld(entt::registry& registry, std::vector<Player>& players);
+
+    NetTransport& m_transport;
+    bool m_isConnected = false;
+    int m_localPlayerIndex = 0;
+    Vec2 m_worldSize{};
+    int m_tick = 0;
+
+    uint32_t m_roundId = 0;
+    // by tick, only of the current round
+    std::deque<NetSnapshot> m_snapshots{};
+    // where the server is now as far as we know, moves on every tick and gets pulled towards snapshot ticks
+    float m_serverTickEstimate = 0.f;
+
+    uint32_t m_lastInputSeq = 0;
+    std::deque<PendingInput> m_pendingInputs{};
+
+    // only the local ship and what moves it, so it can be simulated again from a snapshot without touching the rest
+    entt::registry m_predictionRegistry{};
+    entt::registry::entity_type m_predictedShip = entt::null;
+
+    std::vector<NetEntityState> m_interpolatedEntities{};
+    std::vector<ProjectileProxy> m_projectileProxies{};
+    std::vector<ProjectileProxy> m_nextProjectileProxies{};
+
+    GameClientStats m_stats{};
+    NetSnapshotDecoder m_snapshotDecoder{};
+    NetSnapshot m_receivedSnapshot{};
+    std::vector<uint8_t> m_packet{};
+    std::vector<uint8_t> m_inputsToSend{};
+};
+
+// Runs a GameServer with two AI clients over LoopbackNetworks, prints traffic and prediction stats if verbose.
+// Returns false if the clients didn't connect or their predicted ships were too far off
+bool runServerLoopback(int ticksCount, float latency, float packetLossRate, bool verbose);
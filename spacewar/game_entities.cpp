@@ -1,12 +1,22 @@
 ﻿#include "game_entities.h"
 #include "game_visual.h"
 
+#include <algorithm>
+#include <cmath>
+
+constexpr float SHIP_SPAWN_SPACING = 60.f;
+// of the smaller side of the world, the outer ring
+constexpr float SHIP_SPAWN_RING_RADIUS = 0.4f;
+// the default world of 1000 by 1000 has 50 stars, larger ones keep the same density
+constexpr float STARS_PER_WORLD_AREA = 50.f / (1000.f * 1000.f);
+
 entt::registry::entity_type createProjectileEntity(entt::registry& registry)
 {
     const auto entity = registry.create();
     registry.emplace<DrawUsingShipTextureComponent>(entity, Vec2{10, 15}, sf::Color{255, 100, 100, 255});
     registry.emplace<WrapPositionAroundWorldComponent>(entity);
     registry.emplace<ProjectileComponent>(entity);
+    registry.emplace<ProjectileCollisionComponent>(entity);
     registry.emplace<DestroyTimerComponent>(entity, 5.f);
     registry.emplace<DestroyByCollisionComponent>(entity);
 
@@ -28,21 +38,28 @@ entt::registry::entity_type createProjectileEntity(entt::registry& registry)
     return entity;
 }
 
+void registerProjectileFactories(entt::registry& registry)
+{
+    ProjectileFactories& factories = registry.ctx_or_set<ProjectileFactories>();
+    factories.createFuncs[static_cast<size_t>(ProjectileType::Bullet)] = createProjectileEntity;
+}
+
 entt::registry::entity_type createShipEntity(entt::registry& registry, Vec2 position, float rotation, sf::Color color, int playerIndex)
 {
     const auto entity = registry.create();
     registry.emplace<ShipComponent>(entity, playerIndex);
     registry.emplace<PositionComponent>(entity, position);
-    registry.emplace<DrawUsingShipTextureComponent>(entity, Vec2{35.f, 35.f}, color);
+    registry.emplace<DrawUsingShipTextureComponent>(entity, Vec2{SHIP_SIZE, SHIP_SIZE}, color);
     registry.emplace<VelocityComponent>(entity);
     registry.emplace<RotationComponent>(entity, rotation);
     registry.emplace<RotationSpeedComponent>(entity, 45.f);
     registry.emplace<AccelerateByInputComponent>(entity, false, 25.f);
     registry.emplace<RotateByInputComponent>(entity, 0.f, 180.f);
-    registry.emplace<ShootingComponent>(entity, false, CooldownTimer{1.f}, 40.f, 200.f, createProjectileEntity);
+    registry.emplace<ShootingComponent>(entity, false, CooldownTimer{1.f}, 40.f, 200.f, ProjectileType::Bullet);
+    registerProjectileFactories(registry);
     registry.emplace<WrapPositionAroundWorldComponent>(entity);
     registry.emplace<AccelerateImpulseByInputComponent>(entity, false, CooldownTimer{3.f}, 75.f);
-    registry.emplace<CircleColliderComponent>(entity, 15.f);
+    registry.emplace<CircleColliderComponent>(entity, 15.f, COLLISION_LAYER_SHIP);
     registry.emplace<DestroyByCollisionComponent>(entity);
     registry.emplace<SusceptibleToGravityWellComponent>(entity);
     registry.emplace<TeleportableComponent>(entity);
@@ -106,9 +123,63 @@ entt::registry::entity_type createGravityWellEntity(entt::registry& registry, co
     return entity;
 }
 
+entt::registry::entity_type createAsteroidEntity(entt::registry& registry, const Vec2 position, const Vec2 velocity, const float radius)
+{
+    const auto entity = registry.create();
+    registry.emplace<AsteroidComponent>(entity);
+    registry.emplace<PositionComponent>(entity, position);
+    registry.emplace<VelocityComponent>(entity, velocity);
+    registry.emplace<CircleColliderComponent>(entity, radius, COLLISION_LAYER_ASTEROID,
+                                              static_cast<CollisionLayers>(COLLISION_LAYERS_ALL & ~COLLISION_LAYER_ASTEROID));
+    registry.emplace<DestroyByCollisionComponent>(entity);
+    registry.emplace<WrapPositionAroundWorldComponent>(entity);
+    registry.emplace<SusceptibleToGravityWellComponent>(entity);
+    registry.emplace<TeleportableComponent>(entity);
+    return entity;
+}
+
+void createAsteroidEntities(entt::registry& registry, const int count, const Vec2 worldSize)
+{
+    std::vector<Vec2> keepClearPositions;
+    for (auto [entity, ship, pos] : registry.view<const ShipComponent, const PositionComponent>().each())
+    {
+        keepClearPositions.push_back(pos.vec);
+    }
+    for (auto [entity, well, pos] : registry.view<const GravityWellComponent, const PositionComponent>().each())
+    {
+        keepClearPositions.push_back(pos.vec);
+    }
+
+    const auto isClear = [&keepClearPositions](const Vec2 pos)
+    {
+        return std::none_of(keepClearPositions.begin(), keepClearPositions.end(), [pos](const Vec2 clearPos)
+        {
+            return vec2DistSq(pos, clearPos) < ASTEROID_SPAWN_CLEARANCE * ASTEROID_SPAWN_CLEARANCE;
+        });
+    };
+
+    for (int i = 0; i < count; ++i)
+    {
+        // a world too small to keep clear takes the last try
+        Vec2 pos{};
+        for (int attempt = 0; attempt < 16; ++attempt)
+        {
+            pos = Vec2{randomFloatRange(0.f, worldSize.x), randomFloatRange(0.f, worldSize.y)};
+            if (isClear(pos))
+            {
+                break;
+            }
+        }
+
+        const Vec2 velocity = vec2AngleToDir(randomFloatRange(0.f, 360.f)) * ASTEROID_SPEED_RANGE.getRandom();
+        createAsteroidEntity(registry, pos, velocity, ASTEROID_RADIUS_RANGE.getRandom());
+    }
+}
+
 void createStarEntities(entt::registry& registry, const Vec2 worldSize)
 {
-    for (int i = 0; i < 50; ++i)
+    const int starsCount = static_cast<int>(std::round(STARS_PER_WORLD_AREA * worldSize.x * worldSize.y));
+    for (int i = 0; i < starsCount; ++i)
     {
         const auto entity = registry.create();
 
@@ -122,16 +193,64 @@ void createStarEntities(entt::registry& registry, const Vec2 worldSize)
     }
 }
 
+ShipSpawn getShipSpawn(const int playerIndex, const int playersCount, const Vec2 worldSize)
+{
+    if (playersCount <= 2)
+    {
+        return playerIndex == 0 ? ShipSpawn{worldSize / 2.f - worldSize / 4.f, 180.f + 45.f} : ShipSpawn{worldSize / 2.f + worldSize / 4.f, 45.f};
+    }
+
+    // rings from the outside in, each one takes as many ships as fit and shares them out evenly
+    float radius = std::min(worldSize.x, worldSize.y) * SHIP_SPAWN_RING_RADIUS;
+    int ringFirstIndex = 0;
+    int ring = 0;
+    while (true)
+    {
+        const int capacity = std::max(1, static_cast<int>(2.f * PI * radius / SHIP_SPAWN_SPACING));
+        const int ringShipsCount = std::min(capacity, playersCount - ringFirstIndex);
+        if (playerIndex < ringFirstIndex + ringShipsCount || radius <= SHIP_SPAWN_SPACING)
+        {
+            // rings are turned by half a step against each other, so the ships don't line up
+            const float angle = 180.f + 45.f + (360.f * (playerIndex - ringFirstIndex) + 180.f * ring) / ringShipsCount;
+            return ShipSpawn{worldSize / 2.f + vec2AngleToDir(angle) * radius, angle};
+        }
+
+        ringFirstIndex += ringShipsCount;
+        radius -= SHIP_SPAWN_SPACING;
+        ++ring;
+    }
+}
+
+sf::Color getPlayerColor(const int playerIndex)
+{
+    if (playerIndex < 2)
+    {
+        return playerIndex == 0 ? sf::Color::Cyan : sf::Color::White;
+    }
+
+    // hues a golden angle apart don't repeat and neighbours differ the most
+    const float hue = std::fmod(static_cast<float>(playerIndex) * 137.508f, 360.f) / 60.f;
+    const float x = 1.f - std::abs(std::fmod(hue, 2.f) - 1.f);
+    const float rgb[6][3] = {{1.f, x, 0.f}, {x, 1.f, 0.f}, {0.f, 1.f, x}, {0.f, x, 1.f}, {x, 0.f, 1.f}, {1.f, 0.f, x}};
+    const float* color = rgb[static_cast<int>(hue) % 6];
+    const auto channel = [](const float value)
+    {
+        return static_cast<sf::Uint8>(100.f + 155.f * value);
+    };
+    return sf::Color{channel(color[0]), channel(color[1]), channel(color[2])};
+}
+
 void recreateGameWorld(entt::registry& registry, std::vector<Player>& players, const Vec2 worldSize)
 {
     registry.clear();
 
-    const auto shipEntity1 = createShipEntity(registry, worldSize / 2.f - worldSize / 4.f, 180.f + 45.f, sf::Color::Cyan, 0);
-    const auto shipEntity2 = createShipEntity(registry, worldSize / 2.f + worldSize / 4.f, 45.f, sf::Color::White, 1);
+    const int playersCount = static_cast<int>(players.size());
+    for (int i = 0; i < playersCount; ++i)
+    {
+        const ShipSpawn spawn = getShipSpawn(i, playersCount, worldSize);
+        players[i].shipEntity = createShipEntity(registry, spawn.position, spawn.rotation, getPlayerColor(i), i);
+    }
 
     createGravityWellEntity(registry, worldSize);
     createStarEntities(registry, worldSize);
-
-    players[0].shipEntity = shipEntity1;
-    players[1].shipEntity = shipEntity2;
 }
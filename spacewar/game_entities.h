@@ -3,8 +3,40 @@
 #include "game_logic.h"
 #include "player.h"
 
+// side of the square the ship texture is drawn in, ShipHitMasks are made for it
+constexpr float SHIP_SIZE = 35.f;
+
 entt::registry::entity_type createProjectileEntity(entt::registry& registry);
+// Sets ProjectileFactories in the registry context, ShootingComponent needs it
+void registerProjectileFactories(entt::registry& registry);
 entt::registry::entity_type createShipEntity(entt::registry& registry, Vec2 position, float rotation, sf::Color color, int playerIndex);
 entt::registry::entity_type createGravityWellEntity(entt::registry& registry, Vec2 worldSize);
+
+// an asteroid breaks into this many pieces of this part of its radius, unless they would be smaller than the minimum
+constexpr int ASTEROID_PIECES_COUNT = 3;
+constexpr float ASTEROID_PIECE_RADIUS_FACTOR = 0.5f;
+constexpr float ASTEROID_MIN_RADIUS = 6.f;
+// pieces start this part of the broken radius away from its center, far enough not to touch each other
+constexpr float ASTEROID_PIECE_SPREAD_FACTOR = 0.6f;
+constexpr FloatRange ASTEROID_PIECE_SPEED_RANGE{20.f, 60.f};
+constexpr FloatRange ASTEROID_RADIUS_RANGE{16.f, 32.f};
+constexpr FloatRange ASTEROID_SPEED_RANGE{10.f, 50.f};
+// asteroids are spread over the world but not this close to ships and wells
+constexpr float ASTEROID_SPAWN_CLEARANCE = 150.f;
+
+entt::registry::entity_type createAsteroidEntity(entt::registry& registry, Vec2 position, Vec2 velocity, float radius);
+// after the ships and the wells, so it keeps clear of them
+void createAsteroidEntities(entt::registry& registry, int count, Vec2 worldSize);
 void createStarEntities(entt::registry& registry, Vec2 worldSize);
+struct ShipSpawn
+{
+    Vec2 position{};
+    float rotation = 0.f;
+};
+
+// Two players start on the diagonal like always, more players start on rings around the well in the center, facing
+// away from it, with at least SHIP_SPAWN_SPACING between neighbours
+ShipSpawn getShipSpawn(int playerIndex, int playersCount, Vec2 worldSize);
+sf::Color getPlayerColor(int playerIndex);
+// every player gets a ship, the round is free for all
 void recreateGameWorld(entt::registry& registry, std::vector<Player>& players, Vec2 worldSize);
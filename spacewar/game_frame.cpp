@@ -1,21 +1,70 @@
 ﻿#include "game_frame.h"
 #include "game_logic.h"
 #include "game_visual.h"
+#include "profiler.h"
 
-void gameFrameUpdate(entt::registry& registry, const float dt, const Vec2 worldSize)
+static void updateGameSystems(entt::registry& registry, const float dt, const Vec2 worldSize, const bool isVisualEnabled)
 {
-    gravityWellSystem(registry, dt);
+    const GravityIntegrator gravityIntegrator = getGravityIntegrator(registry);
+    if (gravityIntegrator == GravityIntegrator::Euler)
+    {
+        gravityWellSystem(registry, dt);
+    }
     rotateByInputSystem(registry);
     accelerateByInputSystem(registry, dt);
     accelerateImpulseSystem(registry, dt);
     applyRotationSpeedSystem(registry, dt);
-    applyVelocitySystem(registry, dt);
+    if (gravityIntegrator == GravityIntegrator::Euler)
+    {
+        applyVelocitySystem(registry, dt);
+    }
+    else
+    {
+        applyVelocityOutsideGravitySystem(registry, dt);
+        integrateGravityWellsSystem(registry, dt, gravityIntegrator);
+    }
     wrapPositionAroundWorldSystem(registry, worldSize);
     shootingSystem(registry, dt);
     projectileMoveSystem(registry, dt);
-    circleVsCircleCollisionSystem(registry);
+    circleVsCircleCollisionSystem(registry, dt);
+    splitAsteroidsOnCollisionSystem(registry);
     teleportSystem(registry);
 
+    if (isVisualEnabled)
+    {
+        spawnDeadShipPiecesOnCollisionSystem(registry);
+        enableParticleEmitterByAccelerateInputSystem(registry);
+        emitParticlesOnAccelerateImpulseSystem(registry);
+        particleEmitterSystem(registry, dt);
+    }
+
+    accelerateImpulseAppliedOneshotComponentClearSystem(registry);
+
+    destroyByCollisionSystem(registry);
+    destroyTimerSystem(registry, dt);
+}
+
+void gameFrameUpdate(entt::registry& registry, const float dt, const Vec2 worldSize)
+{
+    PROFILE_FUNCTION();
+
+    updateGameSystems(registry, dt, worldSize, true);
+}
+
+void gameLogicFrameUpdate(entt::registry& registry, const float dt, const Vec2 worldSize)
+{
+    PROFILE_FUNCTION();
+
+    updateGameSystems(registry, dt, worldSize, false);
+}
+
+void gameVisualFrameUpdate(entt::registry& registry, const float dt, const Vec2 worldSize)
+{
+    PROFILE_FUNCTION();
+
+    applyVelocitySystem(registry, dt);
+    wrapPositionAroundWorldSystem(registry, worldSize);
+
     spawnDeadShipPiecesOnCollisionSystem(registry);
     enableParticleEmitterByAccelerateInputSystem(registry);
     emitParticlesOnAccelerateImpulseSystem(registry);
@@ -3,4 +3,11 @@
 #include "entt.hpp"
 #include "game_math.h"
 
+// Game rounds are simulated in fixed ticks, so they can be replayed exactly
+constexpr float GAME_TICK_DT = 1.f / 60.f;
+
 void gameFrameUpdate(entt::registry& registry, float dt, Vec2 worldSize);
+// Same gameplay without particles and other effects, for worlds nobody looks at
+void gameLogicFrameUpdate(entt::registry& registry, float dt, Vec2 worldSize);
+// Only effects, movement of particles and lifetimes, for worlds whose gameplay state comes from a server
+void gameVisualFrameUpdate(entt::registry& registry, float dt, Vec2 worldSize);
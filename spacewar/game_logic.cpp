@@ -1,9 +1,26 @@
 ﻿#include "game_logic.h"
+#include "game_entities.h"
+#include "profiler.h"
+#include "ship_hit_mask.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+constexpr float COLLIDER_GRID_MIN_CELL_SIZE = 32.f;
+// the pull of a well rises as 1 / (radius / maxRadius + this) squared
+constexpr float GRAVITY_WELL_SOFTENING = 0.045f;
+// a substep moves a body at most this part of its distance to the softened center of a well
+constexpr float GRAVITY_SUBSTEP_DISTANCE_FACTOR = 0.05f;
+constexpr int GRAVITY_MAX_SUBSTEPS = 32;
+// after the circles of a swept hit touch, silhouettes of ships are checked at steps of this distance of the moves apart
+constexpr float SHIP_HIT_MASK_SWEEP_STEP = 4.f;
+constexpr int SHIP_HIT_MASK_MAX_SWEEP_STEPS = 16;
 
 float gameGetGravityWellPowerAtRadius(const GravityWellComponent& well, const float radius)
 {
     const float normalized = std::clamp(radius / well.maxRadius, 0.f, 1.f);
-    const float powerFactor = 0.0025f / std::pow(normalized + 0.045f, 2.f);
+    const float powerFactor = 0.0025f / std::pow(normalized + GRAVITY_WELL_SOFTENING, 2.f);
     return powerFactor * well.maxPower;
 }
 
@@ -22,8 +39,89 @@ Vec2 gameGetGravityWellVectorAtPoint(const GravityWellComponent& well, const Vec
     return powerDir * power;
 }
 
+GravityIntegrator getGravityIntegrator(const entt::registry& registry)
+{
+    const GravityIntegratorSettings* settings = registry.try_ctx<GravityIntegratorSettings>();
+    return settings ? settings->integrator : GravityIntegrator::Euler;
+}
+
+const char* getGravityIntegratorName(const GravityIntegrator integrator)
+{
+    switch (integrator)
+    {
+    case GravityIntegrator::Euler:
+        return "euler";
+    case GravityIntegrator::SemiImplicitEuler:
+        return "semi-implicit";
+    case GravityIntegrator::VelocityVerlet:
+        return "verlet";
+    default:
+        return "unknown";
+    }
+}
+
+static const std::vector<GravityWellAtPosition>& gatherGravityWells(entt::registry& registry)
+{
+    std::vector<GravityWellAtPosition>& wells = registry.ctx_or_set<GravityWellsAtPositions>().wells;
+    wells.clear();
+    for (auto [entity, well, position] : registry.view<const GravityWellComponent, const PositionComponent>().each())
+    {
+        wells.push_back({well, position.vec});
+    }
+    return wells;
+}
+
+// the pull of all the wells and their drag, like gravityWellSystem does it over a tick
+static Vec2 getGravityAcceleration(const std::vector<GravityWellAtPosition>& wells, const Vec2 position, const Vec2 velocity)
+{
+    Vec2 acceleration{};
+    for (const GravityWellAtPosition& well : wells)
+    {
+        if (vec2Dist(well.position, position) < well.well.dragRadius)
+        {
+            acceleration -= velocity * well.well.dragCoefficient;
+        }
+        acceleration += gameGetGravityWellVectorAtPoint(well.well, well.position, position);
+    }
+    return acceleration;
+}
+
+static int getGravitySubstepsCount(const std::vector<GravityWellAtPosition>& wells, const Vec2 position, const Vec2 velocity,
+                                   const Vec2 acceleration, const float dt)
+{
+    const float speed = vec2Length(velocity);
+    const float accelerationLength = vec2Length(acceleration);
+    float stepDt = dt;
+
+    for (const GravityWellAtPosition& well : wells)
+    {
+        const float maxStepDistance = GRAVITY_SUBSTEP_DISTANCE_FACTOR *
+                                      (vec2Dist(well.position, position) + GRAVITY_WELL_SOFTENING * well.well.maxRadius);
+
+        // both the distance flown and the distance the pull adds over the step are bound
+        if (speed * stepDt > maxStepDistance)
+        {
+            stepDt = maxStepDistance / speed;
+        }
+        if (0.5f * accelerationLength * stepDt * stepDt > maxStepDistance)
+        {
+            stepDt = std::sqrt(2.f * maxStepDistance / accelerationLength);
+        }
+    }
+
+    return std::clamp(static_cast<int>(std::ceil(dt / stepDt)), 1, GRAVITY_MAX_SUBSTEPS);
+}
+
+int getGravitySubstepsCount(entt::registry& registry, const Vec2 position, const Vec2 velocity, const float dt)
+{
+    const std::vector<GravityWellAtPosition>& wells = gatherGravityWells(registry);
+    return getGravitySubstepsCount(wells, position, velocity, getGravityAcceleration(wells, position, velocity), dt);
+}
+
 void wrapPositionAroundWorldSystem(entt::registry& registry, const Vec2 worldSize)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<PositionComponent, WrapPositionAroundWorldComponent>();
 
     for (auto [entity, position] : view.each())
@@ -34,6 +132,8 @@ void wrapPositionAroundWorldSystem(entt::registry& registry, const Vec2 worldSiz
 
 void applyVelocitySystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     // projectile has it's own move system with collision check
     const auto view = registry.view<PositionComponent, const VelocityComponent>(entt::exclude<ProjectileComponent>);
 
@@ -43,8 +143,23 @@ void applyVelocitySystem(entt::registry& registry, const float dt)
     }
 }
 
+void applyVelocityOutsideGravitySystem(entt::registry& registry, const float dt)
+{
+    PROFILE_FUNCTION();
+
+    const auto view = registry.view<PositionComponent, const VelocityComponent>(
+        entt::exclude<ProjectileComponent, SusceptibleToGravityWellComponent>);
+
+    for (auto [entity, position, velocity] : view.each())
+    {
+        position.vec += velocity.vec * dt;
+    }
+}
+
 void applyRotationSpeedSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<RotationComponent, const RotationSpeedComponent>();
 
     for (auto [entity, rotation, angular] : view.each())
@@ -56,6 +171,8 @@ void applyRotationSpeedSystem(entt::registry& registry, const float dt)
 
 void rotateByInputSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<RotationComponent, RotationSpeedComponent, const RotateByInputComponent>();
 
     for (auto [entity, rotation, angularSpeedComponent, rotateByInput] : view.each())
@@ -66,6 +183,8 @@ void rotateByInputSystem(entt::registry& registry)
 
 void accelerateByInputSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<VelocityComponent, const AccelerateByInputComponent, const RotationComponent>();
 
     for (auto [entity, velocity, accelerateByInput, rotation] : view.each())
@@ -80,6 +199,8 @@ void accelerateByInputSystem(entt::registry& registry, const float dt)
 
 void shootingSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<ShootingComponent, const PositionComponent, const RotationComponent>();
 
     for (auto [entity, shooting, position, rotation] : view.each())
@@ -89,17 +210,24 @@ void shootingSystem(entt::registry& registry, const float dt)
             const Vec2 forwardDir = vec2AngleToDir(rotation.angle);
             const Vec2 projectilePos = position.vec + forwardDir * shooting.projectileBirthOffset;
 
-            const auto projectileEntity = shooting.createProjectileFunc(registry);
+            const CreateProjectileFunc createProjectile = registry.ctx<ProjectileFactories>().createFuncs[static_cast<size_t>(shooting.projectileType)];
+            const auto projectileEntity = createProjectile(registry);
 
             registry.emplace<PositionComponent>(projectileEntity, projectilePos);
             registry.emplace<RotationComponent>(projectileEntity, rotation);
             registry.emplace<VelocityComponent>(projectileEntity, forwardDir * shooting.projectileSpeed);
+
+            ProjectileCollisionComponent& projectileCollision = registry.get_or_emplace<ProjectileCollisionComponent>(projectileEntity);
+            projectileCollision.owner = entity;
+            projectileCollision.ownerIgnoreTimeLeft = PROJECTILE_OWNER_IGNORE_TIME;
         }
     }
 }
 
 void accelerateImpulseSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<AccelerateImpulseByInputComponent, VelocityComponent, const RotationComponent>();
 
     for (auto [entity, accelerateImpulse, velocity, rotation] : view.each())
@@ -116,6 +244,8 @@ void accelerateImpulseSystem(entt::registry& registry, const float dt)
 
 void accelerateImpulseAppliedOneshotComponentClearSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<const AccelerateImpulseAppliedOneshotComponent>();
 
     for (auto [entity] : view.each())
@@ -124,22 +254,184 @@ void accelerateImpulseAppliedOneshotComponentClearSystem(entt::registry& registr
     }
 }
 
+// the category in the high half, the mask in the low one
+static uint32_t packCollisionLayers(const CollisionLayers category, const CollisionLayers mask)
+{
+    return static_cast<uint32_t>(category) << 16 | mask;
+}
+
+static bool isCollisionLayersMatch(const uint32_t packedA, const uint32_t packedB)
+{
+    return ((packedA >> 16) & packedB & 0xffff) != 0 && ((packedB >> 16) & packedA & 0xffff) != 0;
+}
+
+// the silhouette of the entity if it's a ship in a world with ShipHitMasks, otherwise it collides as its circle
+static const ShipHitMask* tryGetShipHitMask(const entt::registry& registry, const ShipHitMasks* masks, const entt::registry::entity_type entity)
+{
+    const RotationComponent* rotation = registry.try_get<RotationComponent>(entity);
+    if (masks == nullptr || rotation == nullptr || !registry.has<ShipComponent>(entity))
+    {
+        return nullptr;
+    }
+    return &getShipHitMask(*masks, rotation->angle);
+}
+
+static bool isHitWithShipHitMasks(const ShipHitMask* mask1, const Vec2 center1, const float radius1, const ShipHitMask* mask2,
+                                  const Vec2 center2, const float radius2)
+{
+    if (mask1 != nullptr && mask2 != nullptr)
+    {
+        return isShipHitMaskOverlap(*mask1, center1, *mask2, center2);
+    }
+    if (mask1 != nullptr)
+    {
+        return isShipHitMaskHitByCircle(*mask1, center1, center2, radius2);
+    }
+    if (mask2 != nullptr)
+    {
+        return isShipHitMaskHitByCircle(*mask2, center2, center1, radius1);
+    }
+    return isCircleIntersectCircle(center1, radius1, center2, radius2);
+}
+
+struct ColliderMove
+{
+    Vec2 start{};
+    Vec2 end{};
+    Vec2 boundsCenter{};
+    float boundsRadius = 0.f;
+};
+
+// Where the collider was over the last moveDt, moving by its velocity to where it is. The circle around that move for
+// the grid, both ends for the swept test
+static ColliderMove getColliderMove(const entt::registry& registry, const entt::registry::entity_type entity, const Vec2 position,
+                                    const float radius, const float moveDt)
+{
+    const VelocityComponent* velocity = registry.try_get<VelocityComponent>(entity);
+    const Vec2 move = velocity != nullptr ? velocity->vec * moveDt : Vec2{};
+
+    ColliderMove result;
+    result.start = position - move;
+    result.end = position;
+    result.boundsCenter = position - move / 2.f;
+    result.boundsRadius = radius + vec2Length(move) / 2.f;
+    return result;
+}
+
+// Cells are at least as big as the largest collider, so colliding ones are in the same or neighbouring cells. With moveDt
+// the colliders are the circles around their moves over it, only the ones that can touch on the way are neighbours
+static const CircleColliderGrid& rebuildCircleColliderGrid(entt::registry& registry, const float moveDt)
+{
+    CircleColliderGrid& colliders = registry.ctx_or_set<CircleColliderGrid>();
+    const auto view = registry.view<const PositionComponent, const CircleColliderComponent>();
+
+    colliders.bounds.clear();
+    Vec2 boxMin{};
+    Vec2 boxMax{};
+    float maxRadius = 0.f;
+
+    for (auto [entity, position, collider] : view.each())
+    {
+        const ColliderMove move = getColliderMove(registry, entity, position.vec, collider.radius, moveDt);
+        const bool isFirst = colliders.bounds.empty();
+        boxMin = isFirst ? move.boundsCenter : Vec2{std::min(boxMin.x, move.boundsCenter.x), std::min(boxMin.y, move.boundsCenter.y)};
+        boxMax = isFirst ? move.boundsCenter : Vec2{std::max(boxMax.x, move.boundsCenter.x), std::max(boxMax.y, move.boundsCenter.y)};
+        maxRadius = std::max(maxRadius, move.boundsRadius);
+        colliders.bounds.push_back({entity, move.boundsCenter, move.boundsRadius, packCollisionLayers(collider.category, collider.mask)});
+    }
+
+    // and about as many cells as colliders, so few colliders far apart don't make a big empty grid
+    const Vec2 boxSize = boxMax - boxMin;
+    const float cellSizeForCount = std::sqrt(boxSize.x * boxSize.y / std::max(static_cast<int>(colliders.bounds.size()), 1));
+    const float cellSize = std::max({2.f * maxRadius, COLLIDER_GRID_MIN_CELL_SIZE, cellSizeForCount});
+
+    colliders.origin = boxMin;
+    colliders.maxRadius = maxRadius;
+    spatialGridStart(colliders.grid, boxSize, cellSize);
+
+    for (const SpatialGrid::Entry& bounds : colliders.bounds)
+    {
+        spatialGridAdd(colliders.grid, bounds.entity, bounds.position - boxMin, bounds.radius, bounds.filterBits);
+    }
+    spatialGridFinish(colliders.grid);
+
+    colliders.centersX.resize(colliders.grid.entries.size());
+    colliders.centersY.resize(colliders.grid.entries.size());
+    colliders.radii.resize(colliders.grid.entries.size());
+    for (size_t i = 0; i < colliders.grid.entries.size(); ++i)
+    {
+        const SpatialGrid::Entry& entry = colliders.grid.entries[i];
+        colliders.centersX[i] = entry.position.x;
+        colliders.centersY[i] = entry.position.y;
+        colliders.radii[i] = entry.radius;
+    }
+
+    return colliders;
+}
+
 void projectileMoveSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto projectilesView = registry.view<PositionComponent, const VelocityComponent, const ProjectileComponent>();
-    const auto collidersView = registry.view<const PositionComponent, const CircleColliderComponent>();
+    // projectiles are checked against where the colliders are now
+    const CircleColliderGrid& colliders = rebuildCircleColliderGrid(registry, 0.f);
+    const SpatialGrid& grid = colliders.grid;
+    const ShipHitMasks* shipHitMasks = registry.try_ctx<ShipHitMasks>();
 
     for (auto [pjlEnt, pjlPos, velocity] : projectilesView.each())
     {
         const Vec2 newPos = pjlPos.vec + velocity.vec * dt;
 
-        for (auto [colliderEnt, colliderPos, circleCollider] : collidersView.each())
+        uint32_t pjlLayers = packCollisionLayers(COLLISION_LAYER_PROJECTILE, COLLISION_LAYERS_ALL);
+        entt::registry::entity_type ignoredOwner = entt::null;
+        if (ProjectileCollisionComponent* pjlCollision = registry.try_get<ProjectileCollisionComponent>(pjlEnt))
         {
-            if (isSegmentIntersectCircle(pjlPos.vec, newPos, colliderPos.vec, circleCollider.radius))
+            pjlLayers = packCollisionLayers(pjlCollision->category, pjlCollision->mask);
+            if (pjlCollision->ownerIgnoreTimeLeft > 0.f)
             {
-                registry.emplace_or_replace<CollisionHappenedOneshotComponent>(pjlEnt);
-                registry.emplace_or_replace<CollisionHappenedOneshotComponent>(colliderEnt);
-                break;
+                ignoredOwner = pjlCollision->owner;
+                pjlCollision->ownerIgnoreTimeLeft -= dt;
+            }
+        }
+
+        if (!grid.entries.empty())
+        {
+            // the cells under the box around the move, grown by the largest collider
+            const Vec2 from = pjlPos.vec - colliders.origin;
+            const Vec2 to = newPos - colliders.origin;
+            const int minX = std::clamp(static_cast<int>((std::min(from.x, to.x) - colliders.maxRadius) / grid.cellSize), 0, grid.cellsCountX - 1);
+            const int minY = std::clamp(static_cast<int>((std::min(from.y, to.y) - colliders.maxRadius) / grid.cellSize), 0, grid.cellsCountY - 1);
+            const int maxX = std::clamp(static_cast<int>((std::max(from.x, to.x) + colliders.maxRadius) / grid.cellSize), 0, grid.cellsCountX - 1);
+            const int maxY = std::clamp(static_cast<int>((std::max(from.y, to.y) + colliders.maxRadius) / grid.cellSize), 0, grid.cellsCountY - 1);
+
+            // the cells of a row are one run of colliders, tested in batches until one of the hits is let through by the layers
+            bool isHit = false;
+            for (int y = minY; y <= maxY && !isHit; ++y)
+            {
+                const int rowStart = y * grid.cellsCountX;
+                const int rowEnd = grid.cellStarts[rowStart + maxX + 1];
+                for (int i = grid.cellStarts[rowStart + minX]; i < rowEnd && !isHit; ++i)
+                {
+                    const int hitOffset = findFirstCircleHitBySegment(from, to, &colliders.centersX[i], &colliders.centersY[i],
+                                                                      &colliders.radii[i], rowEnd - i);
+                    if (hitOffset < 0)
+                    {
+                        break;
+                    }
+
+                    i += hitOffset;
+                    const SpatialGrid::Entry& collider = grid.entries[i];
+                    const ShipHitMask* shipHitMask = tryGetShipHitMask(registry, shipHitMasks, collider.entity);
+                    if (isCollisionLayersMatch(pjlLayers, collider.filterBits) && collider.entity != ignoredOwner &&
+                        (shipHitMask == nullptr ||
+                         isShipHitMaskHitBySegment(*shipHitMask, registry.get<PositionComponent>(collider.entity).vec, pjlPos.vec, newPos)))
+                    {
+                        registry.emplace_or_replace<CollisionHappenedOneshotComponent>(pjlEnt);
+                        registry.emplace_or_replace<CollisionHappenedOneshotComponent>(collider.entity);
+                        isHit = true;
+                    }
+                }
             }
         }
 
@@ -147,31 +439,148 @@ void projectileMoveSystem(entt::registry& registry, const float dt)
     }
 }
 
-void circleVsCircleCollisionSystem(entt::registry& registry)
+void circleVsCircleCollisionSystem(entt::registry& registry, const float dt)
 {
-    const auto view = registry.view<const PositionComponent, const CircleColliderComponent>();
+    PROFILE_FUNCTION();
+
+    const CircleColliderGrid& colliders = rebuildCircleColliderGrid(registry, dt);
+    const SpatialGrid& grid = colliders.grid;
 
-    for (auto i = view.begin(); i != view.end(); ++i)
+    // colliders moved by their velocity during the tick, they collide if they touched anywhere on the way, so fast ones
+    // don't pass through each other at low tick rates
+    const ShipHitMasks* shipHitMasks = registry.try_ctx<ShipHitMasks>();
+    const auto isSweptHit = [&registry, dt, shipHitMasks](const entt::registry::entity_type a, const entt::registry::entity_type b)
     {
-        auto j = i;
-        ++j;
-        for (; j != view.end(); ++j)
+        const float radiusA = registry.get<CircleColliderComponent>(a).radius;
+        const float radiusB = registry.get<CircleColliderComponent>(b).radius;
+        const ColliderMove moveA = getColliderMove(registry, a, registry.get<PositionComponent>(a).vec, radiusA, dt);
+        const ColliderMove moveB = getColliderMove(registry, b, registry.get<PositionComponent>(b).vec, radiusB, dt);
+
+        float time = 0.f;
+        if (!isSweptCircleIntersectCircle(moveA.start, moveA.end, radiusA, moveB.start, moveB.end, radiusB, &time))
         {
-            auto [pos1, coll1] = view.get(*i);
-            auto [pos2, coll2] = view.get(*j);
+            return false;
+        }
 
-            // note: no continuous collision here yet
-            if (isCircleIntersectCircle(pos1.vec, coll1.radius, pos2.vec, coll2.radius))
+        const ShipHitMask* maskA = tryGetShipHitMask(registry, shipHitMasks, a);
+        const ShipHitMask* maskB = tryGetShipHitMask(registry, shipHitMasks, b);
+        if (maskA == nullptr && maskB == nullptr)
+        {
+            return true;
+        }
+
+        // ships may pass by each other after their circles touch, their silhouettes are checked over the rest of the moves
+        const Vec2 relativeMove = (moveB.end - moveB.start) - (moveA.end - moveA.start);
+        const int stepsCount = std::clamp(static_cast<int>(std::ceil(vec2Length(relativeMove) * (1.f - time) / SHIP_HIT_MASK_SWEEP_STEP)), 1,
+                                          SHIP_HIT_MASK_MAX_SWEEP_STEPS);
+        for (int step = 0; step <= stepsCount; ++step)
+        {
+            const float t = time + (1.f - time) * step / stepsCount;
+            const Vec2 centerA = moveA.start + (moveA.end - moveA.start) * t;
+            const Vec2 centerB = moveB.start + (moveB.end - moveB.start) * t;
+            if (isHitWithShipHitMasks(maskA, centerA, radiusA, maskB, centerB, radiusB))
             {
-                registry.emplace<CollisionHappenedOneshotComponent>(*i);
-                registry.emplace<CollisionHappenedOneshotComponent>(*j);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // the bounds of entry i against the run of entries [start, end) in batches, every overlap goes on to the finer tests
+    const auto testRun = [&registry, &colliders, &grid, &isSweptHit](const int i, const int start, const int end)
+    {
+        const SpatialGrid::Entry& a = grid.entries[i];
+        for (int j = start; j < end; ++j)
+        {
+            const int hitOffset = findFirstCircleHitByCircle(a.position, a.radius, &colliders.centersX[j], &colliders.centersY[j],
+                                                             &colliders.radii[j], end - j);
+            if (hitOffset < 0)
+            {
+                break;
+            }
+
+            j += hitOffset;
+            const SpatialGrid::Entry& b = grid.entries[j];
+            if (isCollisionLayersMatch(a.filterBits, b.filterBits) && isSweptHit(a.entity, b.entity))
+            {
+                registry.emplace_or_replace<CollisionHappenedOneshotComponent>(a.entity);
+                registry.emplace_or_replace<CollisionHappenedOneshotComponent>(b.entity);
+            }
+        }
+    };
+
+    // every pair once: the rest of the own cell and the next one in the row, then the three cells below, each is one run
+    for (int y = 0; y < grid.cellsCountY; ++y)
+    {
+        for (int x = 0; x < grid.cellsCountX; ++x)
+        {
+            const int cell = y * grid.cellsCountX + x;
+            const int rowRunEnd = grid.cellStarts[std::min(x + 1, grid.cellsCountX - 1) + y * grid.cellsCountX + 1];
+
+            for (int i = grid.cellStarts[cell]; i < grid.cellStarts[cell + 1]; ++i)
+            {
+                testRun(i, i + 1, rowRunEnd);
+
+                if (y + 1 < grid.cellsCountY)
+                {
+                    const int belowRowStart = (y + 1) * grid.cellsCountX;
+                    testRun(i, grid.cellStarts[belowRowStart + std::max(x - 1, 0)],
+                            grid.cellStarts[belowRowStart + std::min(x + 1, grid.cellsCountX - 1) + 1]);
+                }
             }
         }
     }
 }
 
+void splitAsteroidsOnCollisionSystem(entt::registry& registry)
+{
+    PROFILE_FUNCTION();
+
+    const auto view = registry.view<
+        const PositionComponent,
+        const VelocityComponent,
+        const CircleColliderComponent,
+        const AsteroidComponent,
+        const CollisionHappenedOneshotComponent>();
+
+    // pieces are created after the view is walked, they are asteroids too and would join it
+    struct Broken
+    {
+        Vec2 position{};
+        Vec2 velocity{};
+        float radius = 0.f;
+    };
+    std::vector<Broken> brokenAsteroids;
+
+    for (auto [_, position, velocity, collider] : view.each())
+    {
+        brokenAsteroids.push_back({position.vec, velocity.vec, collider.radius});
+    }
+
+    for (const Broken& broken : brokenAsteroids)
+    {
+        const float pieceRadius = broken.radius * ASTEROID_PIECE_RADIUS_FACTOR;
+        if (pieceRadius < ASTEROID_MIN_RADIUS)
+        {
+            continue;
+        }
+
+        const float firstAngle = randomFloatRange(0.f, 360.f);
+        for (int pieceIndex = 0; pieceIndex < ASTEROID_PIECES_COUNT; ++pieceIndex)
+        {
+            // spread so the pieces don't touch each other, they fly apart
+            const Vec2 dir = vec2AngleToDir(firstAngle + pieceIndex * 360.f / ASTEROID_PIECES_COUNT);
+            const Vec2 piecePosition = broken.position + dir * broken.radius * ASTEROID_PIECE_SPREAD_FACTOR;
+            const Vec2 pieceVelocity = broken.velocity + dir * randomFloatRange(ASTEROID_PIECE_SPEED_RANGE.min, ASTEROID_PIECE_SPEED_RANGE.max);
+            createAsteroidEntity(registry, piecePosition, pieceVelocity, pieceRadius);
+        }
+    }
+}
+
 void destroyByCollisionSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<const CollisionHappenedOneshotComponent, const DestroyByCollisionComponent>();
 
     for (auto [entity] : view.each())
@@ -182,6 +591,8 @@ void destroyByCollisionSystem(entt::registry& registry)
 
 void destroyTimerSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<DestroyTimerComponent>();
 
     for (auto [entity, timer] : view.each())
@@ -196,6 +607,8 @@ void destroyTimerSystem(entt::registry& registry, const float dt)
 
 void gravityWellSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto gravityWellsView = registry.view<const GravityWellComponent, const PositionComponent>();
     const auto affectedEntitiesView = registry.view<
         VelocityComponent, const PositionComponent, const SusceptibleToGravityWellComponent>();
@@ -213,8 +626,54 @@ void gravityWellSystem(entt::registry& registry, const float dt)
     }
 }
 
+void integrateGravityWellsSystem(entt::registry& registry, const float dt, const GravityIntegrator integrator)
+{
+    PROFILE_FUNCTION();
+
+    const std::vector<GravityWellAtPosition>& wells = gatherGravityWells(registry);
+
+    const auto view = registry.view<PositionComponent, VelocityComponent, const SusceptibleToGravityWellComponent>(
+        entt::exclude<ProjectileComponent>);
+
+    for (auto [entity, position, velocity] : view.each())
+    {
+        Vec2 pos = position.vec;
+        Vec2 vel = velocity.vec;
+        Vec2 acceleration = getGravityAcceleration(wells, pos, vel);
+
+        const int substepsCount = getGravitySubstepsCount(wells, pos, vel, acceleration, dt);
+        const float stepDt = dt / static_cast<float>(substepsCount);
+
+        for (int i = 0; i < substepsCount; ++i)
+        {
+            if (integrator == GravityIntegrator::VelocityVerlet)
+            {
+                pos += vel * stepDt + acceleration * (0.5f * stepDt * stepDt);
+                // drag depends on the velocity at the end of the step, the one after the old pull stands for it
+                const Vec2 nextAcceleration = getGravityAcceleration(wells, pos, vel + acceleration * stepDt);
+                vel += (acceleration + nextAcceleration) * (0.5f * stepDt);
+                acceleration = nextAcceleration;
+            }
+            else
+            {
+                vel += acceleration * stepDt;
+                pos += vel * stepDt;
+                if (i + 1 < substepsCount)
+                {
+                    acceleration = getGravityAcceleration(wells, pos, vel);
+                }
+            }
+        }
+
+        position.vec = pos;
+        velocity.vec = vel;
+    }
+}
+
 void teleportSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto teleportsView = registry.view<const TeleportComponent, const PositionComponent>();
     const auto teleportablesView = registry.view<PositionComponent, VelocityComponent, TeleportableComponent>();
 
@@ -254,8 +713,8 @@ std::optional<GameResult> tryGetGameResult(const entt::registry& registry, const
         return GameResult{};
     }
 
-    // win
-    if (aliveShipsCount < playersCount)
+    // win, the last one standing in free for all
+    if (aliveShipsCount == 1 && aliveShipsCount < playersCount)
     {
         assert(anyAliveShipPlayerIndex != -1);
         return GameResult{anyAliveShipPlayerIndex};
@@ -2,7 +2,9 @@
 
 #include "game_math.h"
 #include "entt.hpp"
+#include "spatial_grid.h"
 
+#include <array>
 #include <optional>
 
 struct PositionComponent
@@ -52,6 +54,20 @@ struct RotateByInputComponent
     float rotationSpeed = 0.f;
 };
 
+enum class ProjectileType : uint8_t
+{
+    Bullet,
+    Count
+};
+
+using CreateProjectileFunc = entt::registry::entity_type (*)(entt::registry&);
+
+// Registry context variable. Components refer to projectiles by type, so they stay plain data that can be saved and copied
+struct ProjectileFactories
+{
+    std::array<CreateProjectileFunc, static_cast<size_t>(ProjectileType::Count)> createFuncs{};
+};
+
 struct ShootingComponent
 {
     bool input = false;
@@ -60,13 +76,25 @@ struct ShootingComponent
     float projectileBirthOffset = 0.f;
     float projectileSpeed = 0.f;
 
-    // Not really a good solution. If entt supported entity cloning, it could be just a prototype entity
-    std::function<entt::registry::entity_type(entt::registry&)> createProjectileFunc;
+    ProjectileType projectileType = ProjectileType::Bullet;
 };
 
+// Bits of the kinds of colliders. Two colliders only collide if the category of each one is in the mask of the other
+using CollisionLayers = uint16_t;
+constexpr CollisionLayers COLLISION_LAYER_DEFAULT = 1 << 0;
+constexpr CollisionLayers COLLISION_LAYER_SHIP = 1 << 1;
+constexpr CollisionLayers COLLISION_LAYER_PROJECTILE = 1 << 2;
+constexpr CollisionLayers COLLISION_LAYER_ASTEROID = 1 << 3;
+constexpr CollisionLayers COLLISION_LAYERS_ALL = 0xffff;
+
+// a projectile passes through the ship that fired it for this long, so it can't fly into its own shot
+constexpr float PROJECTILE_OWNER_IGNORE_TIME = 0.25f;
+
 struct CircleColliderComponent
 {
     float radius = 0.f;
+    CollisionLayers category = COLLISION_LAYER_DEFAULT;
+    CollisionLayers mask = COLLISION_LAYERS_ALL;
 };
 
 // projectile moves with collision check against colliders
@@ -74,6 +102,15 @@ struct ProjectileComponent
 {
 };
 
+// the collision layers of a projectile and who fired it, projectiles without it collide with every collider
+struct ProjectileCollisionComponent
+{
+    CollisionLayers category = COLLISION_LAYER_PROJECTILE;
+    CollisionLayers mask = COLLISION_LAYERS_ALL;
+    entt::registry::entity_type owner = entt::null;
+    float ownerIgnoreTimeLeft = 0.f;
+};
+
 struct CollisionHappenedOneshotComponent
 {
 };
@@ -100,6 +137,22 @@ struct SusceptibleToGravityWellComponent
 {
 };
 
+// How the bodies susceptible to gravity wells move over a tick. Euler adds the pull at the start of the tick to the velocity
+// and moves once by it. The others split the tick into substeps where the pull is steep, so orbits hold at lower tick rates
+enum class GravityIntegrator : uint8_t
+{
+    Euler,
+    SemiImplicitEuler,
+    VelocityVerlet,
+    Count
+};
+
+// Registry context variable, worlds without it use GravityIntegrator::Euler
+struct GravityIntegratorSettings
+{
+    GravityIntegrator integrator = GravityIntegrator::Euler;
+};
+
 struct TeleportComponent
 {
     float radius = 0.f;
@@ -116,6 +169,40 @@ struct ShipComponent
     int playerIndex = -1;
 };
 
+// breaks into smaller asteroids when it collides, the collision layers of asteroids let them pass through each other
+struct AsteroidComponent
+{
+};
+
+// Registry context variable, the circle colliders in a uniform grid over the box around them. Rebuilt by the collision
+// systems every tick, so they only test colliders in neighbouring cells instead of every pair
+struct CircleColliderGrid
+{
+    SpatialGrid grid{};
+    // world position of the grid corner, positions in the grid are relative to it
+    Vec2 origin{};
+    float maxRadius = 0.f;
+    // the circles of the colliders in view order while the grid is built, filterBits of the entries are packed collision layers
+    std::vector<SpatialGrid::Entry> bounds{};
+    // the entries of the grid by coordinate, for the batched tests of findFirstCircleHitBySegment and findFirstCircleHitByCircle
+    std::vector<float> centersX{};
+    std::vector<float> centersY{};
+    std::vector<float> radii{};
+};
+
+struct GravityWellAtPosition
+{
+    GravityWellComponent well{};
+    Vec2 position{};
+};
+
+// Registry context variable, the gravity wells gathered by integrateGravityWellsSystem every tick. Kept between ticks,
+// so stepping doesn't allocate
+struct GravityWellsAtPositions
+{
+    std::vector<GravityWellAtPosition> wells{};
+};
+
 struct GameResult
 {
     int victoriousPlayerIndex = -1;
@@ -128,8 +215,14 @@ struct GameResult
 
 float gameGetGravityWellPowerAtRadius(const GravityWellComponent& well, float radius);
 Vec2 gameGetGravityWellVectorAtPoint(const GravityWellComponent& well, Vec2 wellPos, Vec2 point);
+GravityIntegrator getGravityIntegrator(const entt::registry& registry);
+const char* getGravityIntegratorName(GravityIntegrator integrator);
+// substeps a body needs over dt so that each one moves it a small part of its distance to the steep centers of the wells
+int getGravitySubstepsCount(entt::registry& registry, Vec2 position, Vec2 velocity, float dt);
 
 void applyVelocitySystem(entt::registry& registry, float dt);
+// applyVelocitySystem for the bodies integrateGravityWellsSystem doesn't move
+void applyVelocityOutsideGravitySystem(entt::registry& registry, float dt);
 void applyRotationSpeedSystem(entt::registry& registry, float dt);
 void rotateByInputSystem(entt::registry& registry);
 void accelerateByInputSystem(entt::registry& registry, float dt);
@@ -138,10 +231,15 @@ void accelerateImpulseAppliedOneshotComponentClearSystem(entt::registry& registr
 void shootingSystem(entt::registry& registry, float dt);
 void wrapPositionAroundWorldSystem(entt::registry& registry, Vec2 worldSize);
 void projectileMoveSystem(entt::registry& registry, float dt);
-void circleVsCircleCollisionSystem(entt::registry& registry);
+// swept over the last dt of the colliders moving by their velocity, run it after applyVelocitySystem with the same dt
+void circleVsCircleCollisionSystem(entt::registry& registry, float dt);
+void splitAsteroidsOnCollisionSystem(entt::registry& registry);
 void destroyByCollisionSystem(entt::registry& registry);
 void destroyTimerSystem(entt::registry& registry, float dt);
 void gravityWellSystem(entt::registry& registry, float dt);
+// pulls and moves the bodies susceptible to gravity wells with a substepping integrator, instead of gravityWellSystem
+// and applyVelocitySystem. Run it after the thrust systems, their acceleration is held over the tick
+void integrateGravityWellsSystem(entt::registry& registry, float dt, GravityIntegrator integrator);
 void teleportSystem(entt::registry& registry);
 
 std::optional<GameResult> tryGetGameResult(const entt::registry& registry, int playersCount);
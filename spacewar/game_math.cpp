@@ -1,6 +1,7 @@
 ﻿#include "game_math.h"
 
 #include <cmath>
+#include <emmintrin.h>
 #include <random>
 
 float radToDeg(const float rad)
@@ -59,6 +60,14 @@ float vec2Dist(const Vec2 a, const Vec2 b)
     return std::sqrt(vec2DistSq(a, b));
 }
 
+Vec2 vec2WrappedDiff(const Vec2 from, const Vec2 to, const Vec2 worldSize)
+{
+    Vec2 diff = to - from;
+    diff.x -= worldSize.x * std::round(diff.x / worldSize.x);
+    diff.y -= worldSize.y * std::round(diff.y / worldSize.y);
+    return diff;
+}
+
 Vec2 vec2AngleToDir(const float angle)
 {
     const float rad = degToRad(floatWrap(angle, 360.f));
@@ -88,39 +97,181 @@ bool isPointOnSegment(const Vec2 point, const Vec2 segmentP1, const Vec2 segment
 bool isSegmentIntersectCircle(const Vec2 segmentP1, const Vec2 segmentP2, const Vec2 circleCenter,
                               const float circleRadius)
 {
-    if (isPointInsideCircle(segmentP1, circleCenter, circleRadius))
+    // the point of the segment closest to the center is an end if the center projects outside of it, otherwise
+    // the distance to the line is the cross product over the length, compared squared and times the squared length
+    const Vec2 segment = segmentP2 - segmentP1;
+    const Vec2 toCenter = circleCenter - segmentP1;
+    const float lengthSq = vec2Dot(segment, segment);
+    const float along = vec2Dot(toCenter, segment);
+    const float radiusSq = circleRadius * circleRadius;
+
+    if (along <= 0.f)
     {
-        return true;
+        return vec2Dot(toCenter, toCenter) <= radiusSq;
     }
 
-    if (isPointInsideCircle(segmentP2, circleCenter, circleRadius))
+    if (along >= lengthSq)
     {
-        return true;
+        return vec2DistSq(segmentP2, circleCenter) <= radiusSq;
+    }
+
+    const float cross = toCenter.x * segment.y - toCenter.y * segment.x;
+    return cross * cross <= radiusSq * lengthSq;
+}
+
+bool isCircleIntersectCircle(const Vec2 circle1Center, const float circle1Radius, const Vec2 circle2Center,
+                             const float circle2Radius)
+{
+    const float radiusSum = circle1Radius + circle2Radius;
+    return vec2DistSq(circle1Center, circle2Center) <= radiusSum * radiusSum;
+}
+
+static int getFirstLane(const int lanesMask)
+{
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        if (lanesMask & (1 << lane))
+        {
+            return lane;
+        }
     }
+    return -1;
+}
 
-    const float lineLengthSq = vec2DistSq(segmentP1, segmentP2);
+int findFirstCircleHitBySegment(const Vec2 segmentP1, const Vec2 segmentP2, const float* centersX, const float* centersY,
+                                const float* radii, const int count)
+{
+    // isSegmentIntersectCircle for four circles, all three cases are computed and the one of each lane is picked
+    const Vec2 segment = segmentP2 - segmentP1;
+    const __m128 p1X = _mm_set1_ps(segmentP1.x);
+    const __m128 p1Y = _mm_set1_ps(segmentP1.y);
+    const __m128 p2X = _mm_set1_ps(segmentP2.x);
+    const __m128 p2Y = _mm_set1_ps(segmentP2.y);
+    const __m128 segmentX = _mm_set1_ps(segment.x);
+    const __m128 segmentY = _mm_set1_ps(segment.y);
+    const __m128 lengthSq = _mm_set1_ps(vec2Dot(segment, segment));
+    const __m128 zero = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 centerX = _mm_loadu_ps(centersX + i);
+        const __m128 centerY = _mm_loadu_ps(centersY + i);
+        const __m128 radius = _mm_loadu_ps(radii + i);
+        const __m128 radiusSq = _mm_mul_ps(radius, radius);
+
+        const __m128 toCenterX = _mm_sub_ps(centerX, p1X);
+        const __m128 toCenterY = _mm_sub_ps(centerY, p1Y);
+        const __m128 along = _mm_add_ps(_mm_mul_ps(toCenterX, segmentX), _mm_mul_ps(toCenterY, segmentY));
+
+        const __m128 toP2X = _mm_sub_ps(p2X, centerX);
+        const __m128 toP2Y = _mm_sub_ps(p2Y, centerY);
+        const __m128 cross = _mm_sub_ps(_mm_mul_ps(toCenterX, segmentY), _mm_mul_ps(toCenterY, segmentX));
+
+        const __m128 isStartHit = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(toCenterX, toCenterX), _mm_mul_ps(toCenterY, toCenterY)), radiusSq);
+        const __m128 isEndHit = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(toP2X, toP2X), _mm_mul_ps(toP2Y, toP2Y)), radiusSq);
+        const __m128 isMiddleHit = _mm_cmple_ps(_mm_mul_ps(cross, cross), _mm_mul_ps(radiusSq, lengthSq));
+
+        const __m128 isBeforeStart = _mm_cmple_ps(along, zero);
+        const __m128 isAfterEnd = _mm_andnot_ps(isBeforeStart, _mm_cmpge_ps(along, lengthSq));
+        const __m128 isMiddle = _mm_andnot_ps(_mm_or_ps(isBeforeStart, isAfterEnd), isMiddleHit);
+
+        const __m128 isHit = _mm_or_ps(_mm_or_ps(_mm_and_ps(isBeforeStart, isStartHit), _mm_and_ps(isAfterEnd, isEndHit)), isMiddle);
+        const int hitLanes = _mm_movemask_ps(isHit);
+        if (hitLanes != 0)
+        {
+            return i + getFirstLane(hitLanes);
+        }
+    }
 
-    const float dot = (
-        (circleCenter.x - segmentP1.x) * (segmentP2.x - segmentP1.x)
-        + (circleCenter.y - segmentP1.y) * (segmentP2.y - segmentP1.y)
-    ) / lineLengthSq;
+    for (; i < count; ++i)
+    {
+        if (isSegmentIntersectCircle(segmentP1, segmentP2, Vec2{centersX[i], centersY[i]}, radii[i]))
+        {
+            return i;
+        }
+    }
 
-    const Vec2 closest = segmentP1 + dot * (segmentP2 - segmentP1);
+    return -1;
+}
 
-    if (!isPointOnSegment(closest, segmentP1, segmentP2))
+int findFirstCircleHitByCircle(const Vec2 circleCenter, const float circleRadius, const float* centersX, const float* centersY,
+                               const float* radii, const int count)
+{
+    const __m128 selfX = _mm_set1_ps(circleCenter.x);
+    const __m128 selfY = _mm_set1_ps(circleCenter.y);
+    const __m128 selfRadius = _mm_set1_ps(circleRadius);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
     {
-        return false;
+        const __m128 diffX = _mm_sub_ps(selfX, _mm_loadu_ps(centersX + i));
+        const __m128 diffY = _mm_sub_ps(selfY, _mm_loadu_ps(centersY + i));
+        const __m128 radiusSum = _mm_add_ps(selfRadius, _mm_loadu_ps(radii + i));
+
+        const __m128 distSq = _mm_add_ps(_mm_mul_ps(diffX, diffX), _mm_mul_ps(diffY, diffY));
+        const int hitLanes = _mm_movemask_ps(_mm_cmple_ps(distSq, _mm_mul_ps(radiusSum, radiusSum)));
+        if (hitLanes != 0)
+        {
+            return i + getFirstLane(hitLanes);
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        if (isCircleIntersectCircle(circleCenter, circleRadius, Vec2{centersX[i], centersY[i]}, radii[i]))
+        {
+            return i;
+        }
     }
 
-    const float distClosestToCircleOriginSq = vec2DistSq(closest, circleCenter);
-    return distClosestToCircleOriginSq <= circleRadius * circleRadius;
+    return -1;
 }
 
-bool isCircleIntersectCircle(const Vec2 circle1Center, const float circle1Radius, const Vec2 circle2Center,
-                             const float circle2Radius)
+bool isSweptCircleIntersectCircle(const Vec2 circle1Start, const Vec2 circle1End, const float circle1Radius, const Vec2 circle2Start,
+                                  const Vec2 circle2End, const float circle2Radius, float* outTime)
 {
+    // in the frame of the first circle the second one moves by the difference of the moves,
+    // they touch when |diff + move * t| == radiusSum, the smaller root of a quadratic in t
+    const Vec2 diff = circle2Start - circle1Start;
+    const Vec2 move = (circle2End - circle2Start) - (circle1End - circle1Start);
     const float radiusSum = circle1Radius + circle2Radius;
-    return vec2DistSq(circle1Center, circle2Center) <= radiusSum * radiusSum;
+
+    const float c = vec2Dot(diff, diff) - radiusSum * radiusSum;
+    if (c <= 0.f)
+    {
+        if (outTime != nullptr)
+        {
+            *outTime = 0.f;
+        }
+        return true;
+    }
+
+    const float a = vec2Dot(move, move);
+    const float b = 2.f * vec2Dot(diff, move);
+    // not moving towards each other
+    if (a <= 0.f || b >= 0.f)
+    {
+        return false;
+    }
+
+    const float discriminant = b * b - 4.f * a * c;
+    if (discriminant < 0.f)
+    {
+        return false;
+    }
+
+    const float time = (-b - std::sqrt(discriminant)) / (2.f * a);
+    if (time > 1.f)
+    {
+        return false;
+    }
+
+    if (outTime != nullptr)
+    {
+        *outTime = time;
+    }
+    return true;
 }
 
 float floatLerp(const float from, const float to, const float t)
@@ -138,12 +289,48 @@ sf::Color colorLerp(const sf::Color from, const sf::Color to, const float t)
     return result;
 }
 
-std::default_random_engine rndEngine{std::random_device{}()};
+// xorshift64* instead of the std engines: its output is the same with every compiler and standard library,
+// so a seed fully reproduces the random sequence (replays depend on it). Every thread has its own sequence
+static thread_local uint64_t rndState = 0x9E3779B97F4A7C15ull;
+
+static uint64_t randomNext()
+{
+    rndState ^= rndState >> 12;
+    rndState ^= rndState << 25;
+    rndState ^= rndState >> 27;
+    return rndState * 0x2545F4914F6CDD1Dull;
+}
+
+void randomSeed(const uint64_t seed)
+{
+    // splitmix64 step, spreads similar seeds apart and never gives the zero state xorshift can't leave
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    rndState = (z ^ (z >> 31)) | 1ull;
+}
+
+uint64_t randomGetState()
+{
+    return rndState;
+}
+
+void randomSetState(const uint64_t state)
+{
+    rndState = state;
+}
+
+uint64_t randomGenerateSeed()
+{
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
 
 float randomFloatRange(const float min, const float max)
 {
-    const std::uniform_real_distribution<float> distribution{min, max};
-    return distribution(rndEngine);
+    // top 24 bits give every representable float in [0, 1) with equal step
+    const float t = static_cast<float>(randomNext() >> 40) / 16777216.f;
+    return min + (max - min) * t;
 }
 
 float FloatRange::getRandom() const
@@ -2,6 +2,7 @@
 
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/Color.hpp>
+#include <cstdint>
 
 using Vec2 = sf::Vector2f;
 
@@ -11,6 +12,11 @@ bool floatEq(float a, float b, float tolerance = 0.0001);
 float floatWrap(float val, float max);
 float floatLerp(float from, float to, float t);
 
+void randomSeed(uint64_t seed);
+// the whole generator state, for saving and restoring the game world
+uint64_t randomGetState();
+void randomSetState(uint64_t state);
+uint64_t randomGenerateSeed();
 float randomFloatRange(float min, float max);
 
 float radToDeg(float rad);
@@ -22,6 +28,8 @@ float vec2Length(Vec2 vec);
 float vec2DistSq(Vec2 a, Vec2 b);
 float vec2Dist(Vec2 a, Vec2 b);
 Vec2 vec2Wrap(Vec2 val, Vec2 max);
+// the shortest way from one point to another in a world that wraps around
+Vec2 vec2WrappedDiff(Vec2 from, Vec2 to, Vec2 worldSize);
 Vec2 vec2AngleToDir(float angle);
 float vec2DirToAngle(Vec2 dir);
 
@@ -29,6 +37,16 @@ bool isPointInsideCircle(Vec2 point, Vec2 circleCenter, float circleRadius);
 bool isPointOnSegment(Vec2 point, Vec2 segmentP1, Vec2 segmentP2, float precision = 0.0001);
 bool isSegmentIntersectCircle(Vec2 segmentP1, Vec2 segmentP2, Vec2 circleCenter, float circleRadius);
 bool isCircleIntersectCircle(Vec2 circle1Center, float circle1Radius, Vec2 circle2Center, float circle2Radius);
+// Index of the first of count circles the segment or the circle touches, -1 if none. The circles are packed by coordinate
+// and tested four at a time, they agree with isSegmentIntersectCircle and isCircleIntersectCircle
+int findFirstCircleHitBySegment(Vec2 segmentP1, Vec2 segmentP2, const float* centersX, const float* centersY, const float* radii,
+                                int count);
+int findFirstCircleHitByCircle(Vec2 circleCenter, float circleRadius, const float* centersX, const float* centersY, const float* radii,
+                               int count);
+// Both circles move in a straight line from start to end over the same time. outTime gets the part of that time when they
+// first touch, 0 if they touch at the start
+bool isSweptCircleIntersectCircle(Vec2 circle1Start, Vec2 circle1End, float circle1Radius, Vec2 circle2Start, Vec2 circle2End,
+                                  float circle2Radius, float* outTime = nullptr);
 
 sf::Color colorLerp(sf::Color from, sf::Color to, float t);
 
@@ -0,0 +1,338 @@
+﻿#include "game_server.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "profiler.h"
+#include "replay.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+GameServer::GameServer(const Vec2 worldSize) : m_worldSize(worldSize), m_snapshotEncoder(worldSize)
+{
+    m_players.resize(NET_PLAYERS_COUNT);
+}
+
+void GameServer::setClientTransport(const int playerIndex, NetTransport* transport)
+{
+    assert(playerIndex >= 0 && playerIndex < NET_PLAYERS_COUNT);
+
+    m_clients[playerIndex] = ClientSlot{};
+    m_clients[playerIndex].transport = transport;
+
+    // a new player doesn't join the round in the middle, everybody starts a new one when all are here
+    m_isPlaying = false;
+}
+
+void GameServer::tick()
+{
+    PROFILE_FUNCTION();
+
+    for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT; ++playerIndex)
+    {
+        receiveClientPackets(playerIndex);
+    }
+
+    const bool isEverybodyHere = std::all_of(m_clients.begin(), m_clients.end(), [](const ClientSlot& client)
+    {
+        return client.isWelcomed;
+    });
+    if (!isEverybodyHere)
+    {
+        return;
+    }
+
+    // the random sequence belongs to the match, other matches may tick on the same thread in between
+    const uint64_t callerRandomState = randomGetState();
+    randomSetState(m_randomState);
+
+    if (!m_isPlaying || m_roundOverTicks >= SERVER_ROUND_OVER_TICKS)
+    {
+        startRound();
+    }
+
+    simulateTick();
+
+    m_randomState = randomGetState();
+    randomSetState(callerRandomState);
+
+    if (m_tick % SERVER_SNAPSHOT_INTERVAL_TICKS == 0)
+    {
+        sendSnapshots();
+    }
+}
+
+int GameServer::getTick() const
+{
+    return m_tick;
+}
+
+uint32_t GameServer::getRoundId() const
+{
+    return m_roundId;
+}
+
+bool GameServer::isPlaying() const
+{
+    return m_isPlaying;
+}
+
+const entt::registry& GameServer::getRegistry() const
+{
+    return m_registry;
+}
+
+const std::vector<Player>& GameServer::getPlayers() const
+{
+    return m_players;
+}
+
+const GameServerStats& GameServer::getStats() const
+{
+    return m_stats;
+}
+
+void GameServer::receiveClientPackets(const int playerIndex)
+{
+    ClientSlot& client = m_clients[playerIndex];
+    if (!client.transport)
+    {
+        return;
+    }
+
+    while (client.transport->receive(m_packet))
+    {
+        if (m_packet.empty())
+        {
+            continue;
+        }
+
+        switch (static_cast<NetPacketType>(m_packet[0]))
+        {
+        case NetPacketType::Hello:
+            // the welcome may get lost, the client says hello until it comes
+            client.isWelcomed = true;
+            writeWelcomePacket(m_packet, playerIndex, m_worldSize);
+            client.transport->send(m_packet);
+            break;
+
+        case NetPacketType::Input:
+        {
+            uint32_t ackedSnapshotTick = 0;
+            uint32_t lastSeq = 0;
+            if (!client.isWelcomed || !readInputPacket(m_packet, ackedSnapshotTick, lastSeq, m_receivedInputs))
+            {
+                break;
+            }
+            client.lastAckedSnapshotTick = std::max(client.lastAckedSnapshotTick, ackedSnapshotTick);
+
+            // inputs lost for longer than a packet carries are skipped, the pending ones always go right after the applied one
+            const uint32_t firstSeq = lastSeq - static_cast<uint32_t>(m_receivedInputs.size()) + 1;
+            if (firstSeq > client.lastReceivedSeq + 1)
+            {
+                client.pendingInputs.clear();
+                client.lastReceivedSeq = firstSeq - 1;
+                client.lastAppliedSeq = firstSeq - 1;
+            }
+
+            // packets repeat inputs the server may have already, only the new ones are taken
+            for (uint32_t seq = client.lastReceivedSeq + 1; seq <= lastSeq; ++seq)
+            {
+                client.pendingInputs.push_back(m_receivedInputs[seq - firstSeq]);
+            }
+            client.lastReceivedSeq = std::max(client.lastReceivedSeq, lastSeq);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+}
+
+void GameServer::startRound()
+{
+    ++m_roundId;
+    m_isPlaying = true;
+    m_roundResult.reset();
+    m_roundOverTicks = 0;
+
+    randomSeed(m_roundId);
+    recreateGameWorld(m_registry, m_players, m_worldSize);
+}
+
+void GameServer::simulateTick()
+{
+    for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT; ++playerIndex)
+    {
+        ClientSlot& client = m_clients[playerIndex];
+
+        // the client is ahead, the oldest inputs are dropped so its input doesn't lag more and more
+        while (client.pendingInputs.size() > SERVER_MAX_BUFFERED_INPUTS)
+        {
+            client.pendingInputs.pop_front();
+            ++client.lastAppliedSeq;
+        }
+
+        if (client.pendingInputs.empty())
+        {
+            // players mostly hold the same keys, repeating the last input is the best guess
+            ++m_stats.missingInputsCount;
+        }
+        else
+        {
+            client.lastAppliedInput = client.pendingInputs.front();
+            client.pendingInputs.pop_front();
+            ++client.lastAppliedSeq;
+        }
+
+        const entt::registry::entity_type ship = m_players[playerIndex].shipEntity;
+        if (m_registry.valid(ship))
+        {
+            applyShipInput(m_registry, ship, unpackShipInput(client.lastAppliedInput));
+        }
+    }
+
+    gameLogicFrameUpdate(m_registry, GAME_TICK_DT, m_worldSize);
+    ++m_tick;
+
+    if (m_roundResult.has_value())
+    {
+        ++m_roundOverTicks;
+        return;
+    }
+
+    m_roundResult = tryGetGameResult(m_registry, NET_PLAYERS_COUNT);
+    if (m_roundResult.has_value() && !m_roundResult->isTie())
+    {
+        m_players[m_roundResult->victoriousPlayerIndex].score++;
+    }
+}
+
+void GameServer::sendSnapshots()
+{
+    PROFILE_FUNCTION();
+
+    captureNetSnapshot(m_registry, m_snapshot);
+    m_snapshot.roundId = m_roundId;
+    m_snapshot.tick = static_cast<uint32_t>(m_tick);
+    m_snapshot.isRoundOver = m_roundResult.has_value();
+    m_snapshot.roundResult = m_roundResult.value_or(GameResult{});
+    for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT; ++playerIndex)
+    {
+        m_snapshot.scores[playerIndex] = static_cast<uint16_t>(m_players[playerIndex].score);
+    }
+
+    m_snapshotEncoder.addSnapshot(m_snapshot);
+    const size_t naiveSnapshotSize = getNaiveNetSnapshotSize(m_snapshot);
+
+    for (ClientSlot& client : m_clients)
+    {
+        m_snapshotEncoder.writePacket(m_packet, client.lastAppliedSeq, client.lastAckedSnapshotTick);
+        client.transport->send(m_packet);
+
+        ++m_stats.snapshotsSentCount;
+        m_stats.snapshotBytesSentCount += static_cast<int64_t>(m_packet.size());
+        m_stats.naiveSnapshotBytesCount += static_cast<int64_t>(naiveSnapshotSize);
+    }
+}
+
+static bool isSameQuantizedNetEntity(const NetQuantizedEntity& a, const NetQuantizedEntity& b)
+{
+    return a.netId == b.netId && a.kind == b.kind && a.playerIndex == b.playerIndex && a.flags == b.flags &&
+        a.impulseCooldownTicks == b.impulseCooldownTicks && a.position[0] == b.position[0] && a.position[1] == b.position[1] &&
+        a.velocity[0] == b.velocity[0] && a.velocity[1] == b.velocity[1] && a.rotation == b.rotation;
+}
+
+bool runSnapshotCompressionBench(const int ticksCount, const bool verbose)
+{
+    // about a round trip at 100 ms ping
+    constexpr int ACK_LAG_TICKS = 3 * SERVER_SNAPSHOT_INTERVAL_TICKS;
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    entt::registry registry;
+    std::vector<Player> players(NET_PLAYERS_COUNT);
+    randomSeed(1);
+    recreateGameWorld(registry, players, worldSize);
+    registry.view<ShipComponent, ShootingComponent>().each([&registry](const auto ship, const ShipComponent&, ShootingComponent& shooting)
+    {
+        shooting.cooldownTimer.cooldownTotalTime = 0.05f;
+        registry.remove_if_exists<DestroyByCollisionComponent>(ship);
+    });
+
+    NetSnapshotEncoder encoder(worldSize);
+    NetSnapshotDecoder decoder;
+    decoder.reset(worldSize);
+    NetSnapshot snapshot;
+    NetSnapshot decoded;
+    std::vector<uint8_t> packet;
+
+    int snapshotsCount = 0;
+    int64_t entitiesCount = 0;
+    int64_t naiveBytesCount = 0;
+    int64_t quantizedBytesCount = 0;
+    int64_t deltaBytesCount = 0;
+    bool isOk = true;
+
+    for (int tick = 1; tick <= ticksCount; ++tick)
+    {
+        for (const Player& player : players)
+        {
+            if (registry.valid(player.shipEntity))
+            {
+                ShipInput input = aiGenerateInput(registry, player.shipEntity);
+                input.shoot = true;
+                applyShipInput(registry, player.shipEntity, input);
+            }
+        }
+        gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+
+        if (tick % SERVER_SNAPSHOT_INTERVAL_TICKS != 0)
+        {
+            continue;
+        }
+
+        captureNetSnapshot(registry, snapshot);
+        snapshot.roundId = 1;
+        snapshot.tick = static_cast<uint32_t>(tick);
+        encoder.addSnapshot(snapshot);
+
+        ++snapshotsCount;
+        entitiesCount += static_cast<int64_t>(snapshot.entities.size());
+        naiveBytesCount += static_cast<int64_t>(getNaiveNetSnapshotSize(snapshot));
+
+        encoder.writePacket(packet, 0, 0);
+        quantizedBytesCount += static_cast<int64_t>(packet.size());
+
+        encoder.writePacket(packet, 0, tick > ACK_LAG_TICKS ? static_cast<uint32_t>(tick - ACK_LAG_TICKS) : 0);
+        deltaBytesCount += static_cast<int64_t>(packet.size());
+
+        if (!decoder.readPacket(packet, decoded) || decoded.tick != snapshot.tick || decoded.entities.size() != snapshot.entities.size())
+        {
+            isOk = false;
+            continue;
+        }
+        for (size_t i = 0; i < snapshot.entities.size(); ++i)
+        {
+            if (!isSameQuantizedNetEntity(quantizeNetEntity(snapshot.entities[i], worldSize), quantizeNetEntity(decoded.entities[i], worldSize)))
+            {
+                isOk = false;
+            }
+        }
+    }
+
+    isOk = isOk && snapshotsCount > 0 && deltaBytesCount < naiveBytesCount;
+
+    if (verbose && snapshotsCount > 0)
+    {
+        const double ticks = static_cast<double>(ticksCount);
+        std::printf("snapshot bench: %d ticks, %d snapshots, %.1f entities per snapshot, acks %d ticks late\n",
+                    ticksCount, snapshotsCount, static_cast<double>(entitiesCount) / snapshotsCount, ACK_LAG_TICKS);
+        std::printf("naive: %.1f bytes per tick\n", naiveBytesCount / ticks);
+        std::printf("quantized: %.1f bytes per tick (%.1f%% of naive)\n", quantizedBytesCount / ticks, 100.0 * quantizedBytesCount / naiveBytesCount);
+        std::printf("quantized delta: %.1f bytes per tick (%.1f%% of naive)\n", deltaBytesCount / ticks, 100.0 * deltaBytesCount / naiveBytesCount);
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
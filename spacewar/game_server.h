@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include "net_protocol.h"
+#include "net_transport.h"
+#include "player.h"
+
+#include <deque>
+
+constexpr int SERVER_SNAPSHOT_INTERVAL_TICKS = 2;
+// a client that runs ahead of the server can't make its input lag grow beyond this
+constexpr int SERVER_MAX_BUFFERED_INPUTS = 8;
+// the finished round is simulated for a while, so clients can see how it ended
+constexpr int SERVER_ROUND_OVER_TICKS = 300;
+
+struct GameServerStats
+{
+    int64_t snapshotsSentCount = 0;
+    int64_t snapshotBytesSentCount = 0;
+    // what the same snapshots would take with every entity sent whole in floats
+    int64_t naiveSnapshotBytesCount = 0;
+    // ticks a client's input wasn't there in time and its last one was repeated
+    int64_t missingInputsCount = 0;
+};
+
+// Authoritative world for two players connected over transports. The world is simulated without any visual effects,
+// clients get snapshots of what is in it and send back their inputs. A server only touches its own state, so different
+// servers can tick on different threads
+class GameServer
+{
+public:
+    explicit GameServer(Vec2 worldSize);
+
+    // nullptr frees the slot, rounds are played only when both players are connected
+    void setClientTransport(int playerIndex, NetTransport* transport);
+
+    // receives client packets, simulates one tick if everybody is here and sends snapshots
+    void tick();
+
+    int getTick() const;
+    uint32_t getRoundId() const;
+    bool isPlaying() const;
+    const entt::registry& getRegistry() const;
+    const std::vector<Player>& getPlayers() const;
+    const GameServerStats& getStats() const;
+
+private:
+    struct ClientSlot
+    {
+        NetTransport* transport = nullptr;
+        bool isWelcomed = false;
+
+        // inputs by sequence number, front is lastAppliedSeq + 1
+        std::deque<uint8_t> pendingInputs{};
+        uint32_t lastReceivedSeq = 0;
+        uint32_t lastAppliedSeq = 0;
+        uint8_t lastAppliedInput = 0;
+
+        // the newest snapshot the client has, snapshots to it are deltas from this one
+        uint32_t lastAckedSnapshotTick = 0;
+    };
+
+    void receiveClientPackets(int playerIndex);
+    void startRound();
+    void simulateTick();
+    void sendSnapshots();
+
+    Vec2 m_worldSize{};
+    std::array<ClientSlot, NET_PLAYERS_COUNT> m_clients{};
+
+    entt::registry m_registry{};
+    std::vector<Player> m_players{};
+    int m_tick = 0;
+    uint32_t m_roundId = 0;
+    bool m_isPlaying = false;
+    std::optional<GameResult> m_roundResult{};
+    int m_roundOverTicks = 0;
+    uint64_t m_randomState = 0;
+
+    GameServerStats m_stats{};
+    NetSnapshot m_snapshot{};
+    NetSnapshotEncoder m_snapshotEncoder;
+    std::vector<uint8_t> m_packet{};
+    std::vector<uint8_t> m_receivedInputs{};
+};
+
+// Plays a bullet-heavy match where ships fire all the time and can't die, encodes its snapshots as the server does against
+// a baseline acked a round trip late and prints their sizes next to the naive ones if verbose.
+// Returns false if a snapshot didn't decode to what was encoded or deltas weren't smaller than the naive encoding
+bool runSnapshotCompressionBench(int ticksCount, bool verbose);
@@ -1,4 +1,5 @@
 ﻿#include "game_visual.h"
+#include "profiler.h"
 
 static void emitParticles(entt::registry& registry, const ParticleEmitterSettings& settings, const PositionComponent position, const RotationComponent rotationComponent)
 {
@@ -32,6 +33,8 @@ static void emitParticles(entt::registry& registry, const ParticleEmitterSetting
 
 void particleEmitterSystem(entt::registry& registry, const float dt)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<ParticleEmitterComponent, const PositionComponent, const RotationComponent>();
 
     for (auto [_, emitter, position, rotation] : view.each())
@@ -54,6 +57,8 @@ void particleEmitterSystem(entt::registry& registry, const float dt)
 
 void enableParticleEmitterByAccelerateInputSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<ParticleEmitterComponent, const AccelerateByInputComponent>();
 
     for (auto [_, emitter, accelerate] : view.each())
@@ -64,6 +69,8 @@ void enableParticleEmitterByAccelerateInputSystem(entt::registry& registry)
 
 void emitParticlesOnAccelerateImpulseSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<
         ParticleEmitterOnAccelerateImpulseComponent,
         const PositionComponent,
@@ -78,6 +85,8 @@ void emitParticlesOnAccelerateImpulseSystem(entt::registry& registry)
 
 void spawnDeadShipPiecesOnCollisionSystem(entt::registry& registry)
 {
+    PROFILE_FUNCTION();
+
     const auto view = registry.view<
         const PositionComponent,
         const RotationComponent,
@@ -0,0 +1,53 @@
+﻿#include "headless.h"
+#include "game_entities.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <thread>
+
+void runHeadless(AppPersistent& app, const int framesCount, const float dt)
+{
+    if (app.replayToPlay)
+    {
+        AppStateBase::switchState(app, std::make_unique<AppStateGame>(app, app.replayToPlay));
+    }
+    else
+    {
+        for (Player& player : app.players)
+        {
+            player.isAi = true;
+        }
+
+        if (app.serverTransport)
+        {
+            AppStateBase::switchState(app, std::make_unique<AppStateClientGame>(app));
+        }
+        else
+        {
+            AppStateBase::switchState(app, std::make_unique<AppStateGame>(app));
+        }
+    }
+
+    // the server runs in real time, a client that is ahead of it would only have its inputs dropped
+    const bool isRealTime = app.serverTransport != nullptr;
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto frameDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(dt));
+
+    for (int frame = 0; frame < framesCount; ++frame)
+    {
+        if (isRealTime)
+        {
+            std::this_thread::sleep_until(startTime + frameDuration * frame);
+        }
+
+        app.time += dt;
+        app.appStatePtr->timeInState += dt;
+
+        {
+            PROFILE_SCOPE("updateFrame");
+            app.appStatePtr->updateFrame(app, dt);
+        }
+
+        profilerEndFrame();
+    }
+}
@@ -0,0 +1,7 @@
+﻿#pragma once
+
+#include "app_state.h"
+
+// Runs the app without a window: all players are AI (or app.replayToPlay is played back) and frames are stepped with a fixed dt.
+// With app.serverTransport it's a client of a dedicated server instead, and frames go in real time
+void runHeadless(AppPersistent& app, int framesCount, float dt);
@@ -1,34 +1,370 @@
-#include "game_logic.h"
+﻿#include "game_logic.h"
+#include "game_entities.h"
 #include "player.h"
+#include "ai_agents.h"
+#include "ai_lookahead.h"
+#include "ai_policy.h"
+#include "ai_mcts.h"
+#include "ai_tournament.h"
 #include "app_state.h"
+#include "benchmark.h"
+#include "dedicated_server.h"
+#include "game_client.h"
 #include "game_frame.h"
+#include "draw_ui.h"
+#include "headless.h"
+#include "match_host.h"
+#include "perf_gate.h"
+#include "profiler.h"
+#include "replay.h"
+#include "ship_hit_mask.h"
+#include "rollback.h"
+#include "udp_transport.h"
+#include "vec_env.h"
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
+#include <string>
 
 void runTests();
 
-int main()
+int main(int argc, char* argv[])
 {
     runTests();
 
-    sf::ContextSettings settings;
-    settings.antialiasingLevel = 8;
-    sf::RenderWindow window{sf::VideoMode{1000, 1000}, "Spacewar!", sf::Style::Default, settings};
+    profilerSetThreadName("main");
 
-    AppPersistent appPersistentData{};
+    int headlessFramesCount = 0;
+    int traceFramesCount = 0;
+    std::string traceFilePath = "trace.json";
 
-    if (!appPersistentData.shipTexture.loadFromFile("images/ship.png"))
+    std::string benchmarkOutputPath{};
+    BenchmarkWorldSettings benchmarkSettings{};
+    int benchmarkIterations = 100;
+
+    std::string perfGateBaselinePath{};
+    std::string perfBaselineUpdatePath{};
+    float perfGateTolerance = 1.3f;
+
+    std::string replayFilePath{};
+    bool isRecordReplays = true;
+
+    int netplayLocalPort = 0;
+    std::string netplayRemoteAddress{};
+    int netplayRemotePort = 0;
+    int netplayLocalPlayerIndex = 0;
+    bool isLocalPlayerAi = false;
+    int botsCount = 0;
+    // the world is this many windows wide and high, the camera shows a part of it
+    float worldScale = 1.f;
+    int asteroidsCount = 0;
+    float tickRate = 0.f;
+    std::string gravityIntegratorName{};
+    bool isLookaheadAi = false;
+    bool isMctsAi = false;
+    int mctsThreadsCount = 0;
+
+    int serverPort = 0;
+    int serverTicksCount = 0;
+    int serverMatchesCount = 256;
+    std::string serverAddress{};
+    int serverRemotePort = 0;
+
+    int serverLoopbackTicksCount = 0;
+    float serverLoopbackLatency = 0.1f;
+    float serverLoopbackPacketLoss = 0.1f;
+    int snapshotBenchTicksCount = 0;
+    int matchHostBenchMatchesCount = 0;
+    float matchHostBenchSeconds = 10.f;
+    int matchHostBenchThreadsCount = 0;
+    int vecEnvBenchEnvsCount = 0;
+    int vecEnvBenchStepsCount = 0;
+    int vecEnvBenchTicksPerStep = 1;
+    int vecEnvBenchThreadsCount = 0;
+    int lookaheadBenchMatchesCount = 0;
+    int mctsBenchMatchesCount = 0;
+    int mctsBenchThreadsCount = 0;
+    float mctsBenchBudgetMs = AI_MCTS_DECISION_BUDGET_MS;
+    std::string policyFilePath{};
+    int policyBenchShipsCount = 0;
+    int policyBenchPassesCount = 1000;
+    int aiAgentsBenchShipsCount = 0;
+    int aiAgentsBenchTicksCount = 600;
+    std::string aiTournamentOutputPath{};
+    AiTournamentSettings aiTournamentSettings{};
+
+    int rollbackLoopbackTicksCount = 0;
+    float rollbackLoopbackLatency = 0.1f;
+    float rollbackLoopbackPacketLoss = 0.1f;
+
+    for (int i = 1; i < argc; ++i)
     {
-        return EXIT_FAILURE;
+        const std::string arg = argv[i];
+
+        if (arg == "--headless" && i + 1 < argc)
+        {
+            headlessFramesCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--trace" && i + 2 < argc)
+        {
+            traceFramesCount = std::atoi(argv[++i]);
+            traceFilePath = argv[++i];
+        }
+        else if (arg == "--bench" && i + 1 < argc)
+        {
+            benchmarkOutputPath = argv[++i];
+        }
+        else if (arg == "--iterations" && i + 1 < argc)
+        {
+            benchmarkIterations = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ships" && i + 1 < argc)
+        {
+            benchmarkSettings.shipsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--projectiles" && i + 1 < argc)
+        {
+            benchmarkSettings.projectilesCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--particles" && i + 1 < argc)
+        {
+            benchmarkSettings.particlesCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--colliders" && i + 1 < argc)
+        {
+            benchmarkSettings.collidersCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--asteroids" && i + 1 < argc)
+        {
+            asteroidsCount = std::max(0, std::atoi(argv[++i]));
+            benchmarkSettings.asteroidsCount = asteroidsCount;
+        }
+        else if (arg == "--tick-rate" && i + 1 < argc)
+        {
+            tickRate = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--integrator" && i + 1 < argc)
+        {
+            gravityIntegratorName = argv[++i];
+        }
+        else if (arg == "--wells" && i + 1 < argc)
+        {
+            benchmarkSettings.wellsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--perf-gate" && i + 1 < argc)
+        {
+            perfGateBaselinePath = argv[++i];
+        }
+        else if (arg == "--perf-baseline" && i + 1 < argc)
+        {
+            perfBaselineUpdatePath = argv[++i];
+        }
+        else if (arg == "--tolerance" && i + 1 < argc)
+        {
+            perfGateTolerance = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFilePath = argv[++i];
+        }
+        else if (arg == "--no-record")
+        {
+            isRecordReplays = false;
+        }
+        else if (arg == "--netplay" && i + 4 < argc)
+        {
+            netplayLocalPort = std::atoi(argv[++i]);
+            netplayRemoteAddress = argv[++i];
+            netplayRemotePort = std::atoi(argv[++i]);
+            netplayLocalPlayerIndex = std::atoi(argv[++i]) == 0 ? 0 : 1;
+        }
+        else if (arg == "--ai")
+        {
+            isLocalPlayerAi = true;
+        }
+        else if (arg == "--bots" && i + 1 < argc)
+        {
+            botsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--world-scale" && i + 1 < argc)
+        {
+            worldScale = std::max(1.f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--lookahead-ai")
+        {
+            isLookaheadAi = true;
+        }
+        else if (arg == "--lookahead-bench" && i + 1 < argc)
+        {
+            lookaheadBenchMatchesCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--mcts-ai" && i + 1 < argc)
+        {
+            isMctsAi = true;
+            mctsThreadsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--mcts-bench" && i + 3 < argc)
+        {
+            mctsBenchMatchesCount = std::atoi(argv[++i]);
+            mctsBenchThreadsCount = std::atoi(argv[++i]);
+            mctsBenchBudgetMs = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--policy-ai" && i + 1 < argc)
+        {
+            policyFilePath = argv[++i];
+        }
+        else if (arg == "--policy-bench" && i + 2 < argc)
+        {
+            policyBenchShipsCount = std::atoi(argv[++i]);
+            policyBenchPassesCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ai-agents-bench" && i + 2 < argc)
+        {
+            aiAgentsBenchShipsCount = std::atoi(argv[++i]);
+            aiAgentsBenchTicksCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--server" && i + 1 < argc)
+        {
+            serverPort = std::atoi(argv[++i]);
+        }
+        else if (arg == "--server-ticks" && i + 1 < argc)
+        {
+            serverTicksCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--server-matches" && i + 1 < argc)
+        {
+            serverMatchesCount = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--vec-env-bench" && i + 4 < argc)
+        {
+            vecEnvBenchEnvsCount = std::atoi(argv[++i]);
+            vecEnvBenchStepsCount = std::atoi(argv[++i]);
+            vecEnvBenchTicksPerStep = std::atoi(argv[++i]);
+            vecEnvBenchThreadsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ai-tournament" && i + 1 < argc)
+        {
+            aiTournamentOutputPath = argv[++i];
+        }
+        else if (arg == "--generations" && i + 1 < argc)
+        {
+            aiTournamentSettings.generationsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--population" && i + 1 < argc)
+        {
+            aiTournamentSettings.populationSize = std::atoi(argv[++i]);
+        }
+        else if (arg == "--tournament-threads" && i + 1 < argc)
+        {
+            aiTournamentSettings.threadsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--match-host-bench" && i + 3 < argc)
+        {
+            matchHostBenchMatchesCount = std::atoi(argv[++i]);
+            matchHostBenchSeconds = static_cast<float>(std::atof(argv[++i]));
+            matchHostBenchThreadsCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--connect" && i + 2 < argc)
+        {
+            serverAddress = argv[++i];
+            serverRemotePort = std::atoi(argv[++i]);
+        }
+        else if (arg == "--server-loopback" && i + 3 < argc)
+        {
+            serverLoopbackTicksCount = std::atoi(argv[++i]);
+            serverLoopbackLatency = static_cast<float>(std::atof(argv[++i])) / 1000.f;
+            serverLoopbackPacketLoss = static_cast<float>(std::atof(argv[++i])) / 100.f;
+        }
+        else if (arg == "--snapshot-bench" && i + 1 < argc)
+        {
+            snapshotBenchTicksCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--rollback-loopback" && i + 3 < argc)
+        {
+            rollbackLoopbackTicksCount = std::atoi(argv[++i]);
+            rollbackLoopbackLatency = static_cast<float>(std::atof(argv[++i])) / 1000.f;
+            rollbackLoopbackPacketLoss = static_cast<float>(std::atof(argv[++i])) / 100.f;
+        }
     }
 
-    if (!appPersistentData.font.loadFromFile("fonts/arial.ttf"))
+    if (!perfBaselineUpdatePath.empty())
     {
-        return EXIT_FAILURE;
+        return updatePerfBaseline(perfBaselineUpdatePath) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!perfGateBaselinePath.empty())
+    {
+        return runPerfGate(perfGateBaselinePath, perfGateTolerance) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!benchmarkOutputPath.empty())
+    {
+        return runBenchmarks(benchmarkSettings, benchmarkIterations, benchmarkOutputPath) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-    
-    appPersistentData.worldSize = Vec2{window.getSize()};
+
+    if (rollbackLoopbackTicksCount > 0)
+    {
+        return runRollbackLoopback(rollbackLoopbackTicksCount, rollbackLoopbackLatency, rollbackLoopbackPacketLoss, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (serverLoopbackTicksCount > 0)
+    {
+        return runServerLoopback(serverLoopbackTicksCount, serverLoopbackLatency, serverLoopbackPacketLoss, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (snapshotBenchTicksCount > 0)
+    {
+        return runSnapshotCompressionBench(snapshotBenchTicksCount, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (vecEnvBenchEnvsCount > 0)
+    {
+        return runVecEnvBench(vecEnvBenchEnvsCount, vecEnvBenchStepsCount, vecEnvBenchTicksPerStep, vecEnvBenchThreadsCount, true) ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+
+    if (lookaheadBenchMatchesCount > 0)
+    {
+        return runAiLookaheadBench(lookaheadBenchMatchesCount, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (mctsBenchMatchesCount > 0)
+    {
+        return runAiMctsBench(mctsBenchMatchesCount, mctsBenchThreadsCount, mctsBenchBudgetMs, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (policyBenchShipsCount > 0)
+    {
+        return runAiPolicyBench(policyBenchShipsCount, policyBenchPassesCount, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (aiAgentsBenchShipsCount > 0)
+    {
+        return runAiAgentsBench(aiAgentsBenchShipsCount, aiAgentsBenchTicksCount, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!aiTournamentOutputPath.empty())
+    {
+        return runAiTournamentToFile(aiTournamentSettings, aiTournamentOutputPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (matchHostBenchMatchesCount > 0)
+    {
+        return runMatchHostBench(matchHostBenchMatchesCount, matchHostBenchSeconds, matchHostBenchThreadsCount, true) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (serverPort > 0)
+    {
+        // same world as in the default window, clients take the size the server tells them
+        const bool isOk = runDedicatedServer(static_cast<unsigned short>(serverPort), Vec2{1000.f, 1000.f} * worldScale, serverMatchesCount,
+                                             serverTicksCount);
+        return isOk ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    AppPersistent appPersistentData{};
 
     appPersistentData.players = std::vector<Player>{
         {
@@ -47,7 +383,198 @@ int main()
         }
     };
 
-    appPersistentData.appStatePtr = std::make_unique<AppStateStarting>(appPersistentData.players.size());
+    if (botsCount > 0)
+    {
+        if (netplayLocalPort > 0 || !serverAddress.empty())
+        {
+            std::fprintf(stderr, "bots only play local rounds\n");
+            return EXIT_FAILURE;
+        }
+
+        const int playersCount = std::min(static_cast<int>(appPersistentData.players.size()) + botsCount, MAX_PLAYERS_COUNT);
+        while (static_cast<int>(appPersistentData.players.size()) < playersCount)
+        {
+            Player bot;
+            bot.name = "Bot " + std::to_string(appPersistentData.players.size() - 1);
+            bot.isAi = true;
+            bot.isBot = true;
+            appPersistentData.players.push_back(bot);
+        }
+    }
+
+    if (worldScale > 1.f && netplayLocalPort > 0)
+    {
+        std::fprintf(stderr, "netplay peers play in the default world\n");
+        return EXIT_FAILURE;
+    }
+
+    if (asteroidsCount > 0)
+    {
+        if (netplayLocalPort > 0 || !serverAddress.empty())
+        {
+            std::fprintf(stderr, "asteroid fields are only in local rounds\n");
+            return EXIT_FAILURE;
+        }
+
+        appPersistentData.asteroidsCount = asteroidsCount;
+    }
+
+    if (tickRate > 0.f || !gravityIntegratorName.empty())
+    {
+        if (netplayLocalPort > 0 || !serverAddress.empty())
+        {
+            std::fprintf(stderr, "the tick rate and the integrator are only set for local rounds\n");
+            return EXIT_FAILURE;
+        }
+
+        if (tickRate > 0.f)
+        {
+            appPersistentData.tickDt = 1.f / tickRate;
+        }
+
+        int integratorIndex = 0;
+        while (!gravityIntegratorName.empty() && integratorIndex < static_cast<int>(GravityIntegrator::Count) &&
+               gravityIntegratorName != getGravityIntegratorName(static_cast<GravityIntegrator>(integratorIndex)))
+        {
+            ++integratorIndex;
+        }
+        if (integratorIndex == static_cast<int>(GravityIntegrator::Count))
+        {
+            std::fprintf(stderr, "unknown integrator %s, it's euler, semi-implicit or verlet\n", gravityIntegratorName.c_str());
+            return EXIT_FAILURE;
+        }
+        appPersistentData.gravityIntegrator = static_cast<GravityIntegrator>(integratorIndex);
+    }
+
+    appPersistentData.isLookaheadAi = isLookaheadAi;
+    appPersistentData.isMctsAi = isMctsAi;
+    appPersistentData.mctsThreadsCount = mctsThreadsCount;
+
+    if (!policyFilePath.empty())
+    {
+        AiPolicy policy;
+        if (!loadAiPolicy(policyFilePath, policy))
+        {
+            std::fprintf(stderr, "can't load policy %s\n", policyFilePath.c_str());
+            return EXIT_FAILURE;
+        }
+        appPersistentData.policyNetwork = std::make_unique<AiPolicyNetwork>(policy);
+    }
+
+    if (isRecordReplays)
+    {
+        appPersistentData.replaysDirectory = "replays";
+    }
+
+    // the masks are made from the image, not the texture, so headless rounds collide ships the same way as windowed ones.
+    // The dedicated server has no image and collides ships as circles, a client predicts the same way
+    sf::Image shipImage;
+    if (serverAddress.empty() && shipImage.loadFromFile("images/ship.png"))
+    {
+        appPersistentData.shipHitMasks = std::make_unique<ShipHitMasks>(
+            createShipHitMasks(shipImage.getPixelsPtr(), static_cast<int>(shipImage.getSize().x), static_cast<int>(shipImage.getSize().y), SHIP_SIZE));
+    }
+
+    if (!replayFilePath.empty())
+    {
+        auto replay = std::make_shared<Replay>();
+        if (!loadReplay(replayFilePath, *replay) || replay->getPlayersCount() != static_cast<int>(appPersistentData.players.size()))
+        {
+            std::fprintf(stderr, "can't load replay %s\n", replayFilePath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (replay->isShipHitMasks && !appPersistentData.shipHitMasks)
+        {
+            std::fprintf(stderr, "replay %s collides ships by their silhouettes, they need images/ship.png\n", replayFilePath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        // seeking in the window starts from the keyframes saved with the replay, a replay saved without them is indexed once
+        const std::string keyframesFilePath = getReplayKeyframesFilePath(replayFilePath);
+        if (headlessFramesCount == 0 && !loadReplayKeyframes(keyframesFilePath, *replay, appPersistentData.replayKeyframes))
+        {
+            appPersistentData.replayKeyframes = replayCaptureKeyframes(*replay, appPersistentData.players, appPersistentData.shipHitMasks.get());
+            saveReplayKeyframes(*replay, appPersistentData.replayKeyframes, keyframesFilePath);
+        }
+        appPersistentData.replayToPlay = std::move(replay);
+    }
+
+    if (netplayLocalPort > 0)
+    {
+        auto transport = std::make_unique<UdpTransport>(static_cast<unsigned short>(netplayLocalPort), netplayRemoteAddress,
+                                                        static_cast<unsigned short>(netplayRemotePort));
+        if (!transport->isValid())
+        {
+            std::fprintf(stderr, "can't start netplay on port %d with %s:%d\n", netplayLocalPort, netplayRemoteAddress.c_str(), netplayRemotePort);
+            return EXIT_FAILURE;
+        }
+
+        appPersistentData.netplayTransport = std::move(transport);
+        appPersistentData.netplayLocalPlayerIndex = netplayLocalPlayerIndex;
+        appPersistentData.players[netplayLocalPlayerIndex].isAi = isLocalPlayerAi;
+    }
+
+    if (!serverAddress.empty())
+    {
+        auto transport = std::make_unique<UdpTransport>(UDP_ANY_PORT, serverAddress, static_cast<unsigned short>(serverRemotePort));
+        if (!transport->isValid())
+        {
+            std::fprintf(stderr, "can't connect to server %s:%d\n", serverAddress.c_str(), serverRemotePort);
+            return EXIT_FAILURE;
+        }
+
+        appPersistentData.serverTransport = std::move(transport);
+        // the server tells which player is local only when it welcomes us
+        for (Player& player : appPersistentData.players)
+        {
+            player.isAi = isLocalPlayerAi;
+        }
+    }
+
+    profilerStartTraceCapture(traceFramesCount, traceFilePath);
+
+    if (headlessFramesCount > 0)
+    {
+        // same world as in the default window
+        appPersistentData.worldSize = Vec2{1000.f, 1000.f} * worldScale;
+        runHeadless(appPersistentData, headlessFramesCount, 1.f / 60.f);
+        profilerFlushTrace();
+        return EXIT_SUCCESS;
+    }
+
+    sf::ContextSettings settings;
+    settings.antialiasingLevel = 8;
+    sf::RenderWindow window{sf::VideoMode{1000, 1000}, "Spacewar!", sf::Style::Default, settings};
+
+    if (!appPersistentData.shipTexture.loadFromFile("images/ship.png"))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!appPersistentData.font.loadFromFile("fonts/arial.ttf"))
+    {
+        return EXIT_FAILURE;
+    }
+    
+    appPersistentData.worldSize = Vec2{window.getSize()} * worldScale;
+
+    if (appPersistentData.serverTransport)
+    {
+        AppStateBase::switchState(appPersistentData, std::make_unique<AppStateClientGame>(appPersistentData));
+    }
+    else if (appPersistentData.netplayTransport)
+    {
+        AppStateBase::switchState(appPersistentData, std::make_unique<AppStateNetplayGame>(appPersistentData));
+    }
+    else if (appPersistentData.replayToPlay)
+    {
+        AppStateBase::switchState(appPersistentData, std::make_unique<AppStateGame>(appPersistentData, appPersistentData.replayToPlay));
+    }
+    else
+    {
+        AppStateBase::switchState(appPersistentData, std::make_unique<AppStateStarting>(appPersistentData.players.size()));
+    }
 
     sf::Clock timer;
     while (window.isOpen())
@@ -67,12 +594,32 @@ int main()
             appPersistentData.appStatePtr->processSfmlEvent(appPersistentData, event);
         }
 
-        appPersistentData.appStatePtr->updateFrame(appPersistentData, dt);
+        {
+            PROFILE_SCOPE("updateFrame");
+            appPersistentData.appStatePtr->updateFrame(appPersistentData, dt);
+        }
+
+        cameraUpdate(appPersistentData.camera, appPersistentData.registry, appPersistentData.worldSize, Vec2{window.getSize()}, dt);
+
+        {
+            PROFILE_SCOPE("drawFrame");
+            window.clear(sf::Color{5, 10, 30, 255});
+            appPersistentData.appStatePtr->drawFrame(appPersistentData, window);
+        }
+
+        if (appPersistentData.isProfilerRender)
+        {
+            drawProfilerUi(profilerGetStats(), window, appPersistentData.font);
+        }
+
+        {
+            PROFILE_SCOPE("display");
+            window.display();
+        }
 
-        window.clear(sf::Color{5, 10, 30, 255});
-        appPersistentData.appStatePtr->drawFrame(appPersistentData, window);
-        window.display();
+        profilerEndFrame();
     }
 
+    profilerFlushTrace();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,107 @@
+﻿#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+    const HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    // empty files can't be mapped
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        return;
+    }
+
+    m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mappingHandle)
+    {
+        return;
+    }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (m_data)
+    {
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mappingHandle)
+    {
+        CloseHandle(m_mappingHandle);
+    }
+
+    if (m_fileHandle)
+    {
+        CloseHandle(m_fileHandle);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+    const int file = open(filePath.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+
+    struct stat fileStat;
+    // empty files can't be mapped
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast<const uint8_t*>(data);
+            m_size = static_cast<size_t>(fileStat.st_size);
+        }
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+}
+
+#endif
+
+const uint8_t* MappedFile::getData() const
+{
+    return m_data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return m_size;
+}
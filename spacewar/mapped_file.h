@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory, pages are read by the OS on first access instead of being copied
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // null if the file can't be opened or is empty
+    const uint8_t* getData() const;
+    size_t getSize() const;
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
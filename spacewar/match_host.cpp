@@ -0,0 +1,299 @@
+﻿#include "match_host.h"
+#include "game_frame.h"
+#include "profiler.h"
+#include "replay.h"
+
+#include <SFML/System/Sleep.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+static MatchHostClock::duration getTickDuration()
+{
+    return std::chrono::duration_cast<MatchHostClock::duration>(std::chrono::duration<float>(GAME_TICK_DT));
+}
+
+static int64_t toNs(const MatchHostClock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+static void addMatchHostStats(MatchHostStats& stats, const MatchHostStats& other)
+{
+    stats.ticksCount += other.ticksCount;
+    stats.lateTicksCount += other.lateTicksCount;
+    stats.skippedTicksCount += other.skippedTicksCount;
+    stats.totalTickNs += other.totalTickNs;
+    stats.maxTickNs = std::max(stats.maxTickNs, other.maxTickNs);
+    stats.totalStartDelayNs += other.totalStartDelayNs;
+    stats.maxStartDelayNs = std::max(stats.maxStartDelayNs, other.maxStartDelayNs);
+}
+
+MatchHost::MatchHost(const int threadsCount) : m_pool(threadsCount)
+{
+}
+
+int MatchHost::addMatch(const Vec2 worldSize)
+{
+    const int matchIndex = static_cast<int>(m_matches.size());
+
+    auto match = std::make_unique<Match>();
+    match->server = std::make_unique<GameServer>(worldSize);
+    // golden ratio phases spread any number of matches evenly over the tick
+    const float phase = std::fmod(static_cast<float>(matchIndex) * 0.618034f, 1.f);
+    match->nextTickTime = MatchHostClock::now() + std::chrono::duration_cast<MatchHostClock::duration>(getTickDuration() * phase);
+    m_matches.push_back(std::move(match));
+
+    return matchIndex;
+}
+
+int MatchHost::getMatchesCount() const
+{
+    return static_cast<int>(m_matches.size());
+}
+
+GameServer& MatchHost::getIdleMatch(const int matchIndex)
+{
+    Match& match = *m_matches[matchIndex];
+    // ticks take a fraction of a millisecond, it's not worth sleeping
+    while (match.isTicking.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+
+    return *match.server;
+}
+
+MatchHostClock::time_point MatchHost::update()
+{
+    PROFILE_FUNCTION();
+
+    const auto now = MatchHostClock::now();
+    auto nextUpdateTime = now + getTickDuration();
+    bool isAnyTicking = false;
+
+    for (const std::unique_ptr<Match>& matchPtr : m_matches)
+    {
+        Match& match = *matchPtr;
+        if (match.isTicking.load(std::memory_order_acquire))
+        {
+            isAnyTicking = true;
+            continue;
+        }
+
+        collectMatchStats(match);
+
+        if (match.nextTickTime > now)
+        {
+            nextUpdateTime = std::min(nextUpdateTime, match.nextTickTime);
+            continue;
+        }
+
+        match.isTicking.store(true, std::memory_order_relaxed);
+        m_pool.submit([this, &match]()
+        {
+            tickMatch(match);
+            match.isTicking.store(false, std::memory_order_release);
+        });
+        isAnyTicking = true;
+    }
+
+    // when a running tick is over its match has a new due time, which isn't known yet
+    if (isAnyTicking)
+    {
+        nextUpdateTime = std::min(nextUpdateTime, now + std::chrono::milliseconds(1));
+    }
+
+    return nextUpdateTime;
+}
+
+void MatchHost::waitIdle()
+{
+    m_pool.waitIdle();
+
+    for (const std::unique_ptr<Match>& match : m_matches)
+    {
+        collectMatchStats(*match);
+    }
+}
+
+int MatchHost::getThreadsCount() const
+{
+    return m_pool.getThreadsCount();
+}
+
+const MatchHostStats& MatchHost::getStats() const
+{
+    return m_stats;
+}
+
+ThreadPoolStats MatchHost::getPoolStats() const
+{
+    return m_pool.getStats();
+}
+
+void MatchHost::tickMatch(Match& match)
+{
+    PROFILE_FUNCTION();
+
+    const auto tickDuration = getTickDuration();
+    MatchHostStats& stats = match.tickStats;
+
+    const auto start = MatchHostClock::now();
+    const int64_t startDelayNs = toNs(start - match.nextTickTime);
+    stats.totalStartDelayNs += startDelayNs;
+    stats.maxStartDelayNs = std::max(stats.maxStartDelayNs, startDelayNs);
+
+    const int64_t dueTicksCount = (start - match.nextTickTime) / tickDuration + 1;
+    if (dueTicksCount > MATCH_HOST_MAX_CATCH_UP_TICKS)
+    {
+        const int64_t skippedTicksCount = dueTicksCount - MATCH_HOST_MAX_CATCH_UP_TICKS;
+        stats.skippedTicksCount += skippedTicksCount;
+        match.nextTickTime += tickDuration * skippedTicksCount;
+    }
+
+    for (int i = 0; i < MATCH_HOST_MAX_CATCH_UP_TICKS && match.nextTickTime <= MatchHostClock::now(); ++i)
+    {
+        const auto tickStart = MatchHostClock::now();
+        match.server->tick();
+        const auto tickFinish = MatchHostClock::now();
+
+        const int64_t tickNs = toNs(tickFinish - tickStart);
+        ++stats.ticksCount;
+        stats.totalTickNs += tickNs;
+        stats.maxTickNs = std::max(stats.maxTickNs, tickNs);
+
+        match.nextTickTime += tickDuration;
+        if (tickFinish > match.nextTickTime)
+        {
+            ++stats.lateTicksCount;
+        }
+    }
+}
+
+void MatchHost::collectMatchStats(Match& match)
+{
+    addMatchHostStats(m_stats, match.tickStats);
+    match.tickStats = MatchHostStats{};
+}
+
+// In-process client that plays with AI input and doesn't keep a world, only the server side of a match costs anything
+class MatchHostBot : public NetTransport
+{
+public:
+    MatchHostBot(const GameServer& server, const int playerIndex) : m_server(server), m_playerIndex(playerIndex)
+    {
+    }
+
+    void send(const std::vector<uint8_t>& packet) override
+    {
+        if (!packet.empty() && packet[0] == static_cast<uint8_t>(NetPacketType::Welcome))
+        {
+            m_isWelcomed = true;
+        }
+
+        uint32_t snapshotTick = 0;
+        if (readSnapshotPacketTick(packet, snapshotTick))
+        {
+            m_lastSnapshotTick = std::max(m_lastSnapshotTick, snapshotTick);
+        }
+    }
+
+    // the server reads until there's nothing left once per tick, a bot has one packet for each of those reads
+    bool receive(std::vector<uint8_t>& outPacket) override
+    {
+        m_hasSentThisTick = !m_hasSentThisTick;
+        if (!m_hasSentThisTick)
+        {
+            return false;
+        }
+
+        if (!m_isWelcomed)
+        {
+            writeHelloPacket(outPacket);
+            return true;
+        }
+
+        const entt::registry& registry = m_server.getRegistry();
+        const entt::registry::entity_type ship = m_server.getPlayers()[m_playerIndex].shipEntity;
+        const uint8_t packedInput = packShipInput(registry.valid(ship) ? aiGenerateInput(registry, ship) : ShipInput{});
+        writeInputPacket(outPacket, m_lastSnapshotTick, ++m_lastInputSeq, &packedInput, 1);
+        return true;
+    }
+
+private:
+    const GameServer& m_server;
+    int m_playerIndex = 0;
+    bool m_isWelcomed = false;
+    bool m_hasSentThisTick = false;
+    uint32_t m_lastSnapshotTick = 0;
+    uint32_t m_lastInputSeq = 0;
+};
+
+bool runMatchHostBench(const int matchesCount, const float seconds, const int threadsCount, const bool verbose)
+{
+    std::vector<std::unique_ptr<MatchHostBot>> bots;
+    MatchHost host(threadsCount);
+
+    for (int i = 0; i < matchesCount; ++i)
+    {
+        GameServer& server = host.getIdleMatch(host.addMatch(Vec2{1000.f, 1000.f}));
+        for (int playerIndex = 0; playerIndex < NET_PLAYERS_COUNT; ++playerIndex)
+        {
+            bots.push_back(std::make_unique<MatchHostBot>(server, playerIndex));
+            server.setClientTransport(playerIndex, bots.back().get());
+        }
+    }
+
+    const auto start = MatchHostClock::now();
+    const auto finish = start + std::chrono::duration_cast<MatchHostClock::duration>(std::chrono::duration<float>(seconds));
+
+    for (auto now = start; now < finish; now = MatchHostClock::now())
+    {
+        const auto nextUpdateTime = std::min(host.update(), finish);
+        profilerEndFrame();
+
+        // sf::sleep raises the system timer resolution while sleeping, a plain sleep may oversleep by a whole tick on Windows
+        const auto sleepDuration = std::chrono::duration_cast<std::chrono::microseconds>(nextUpdateTime - MatchHostClock::now());
+        if (sleepDuration.count() > 0)
+        {
+            sf::sleep(sf::microseconds(sleepDuration.count()));
+        }
+    }
+    host.waitIdle();
+
+    const double elapsedSeconds = std::chrono::duration<double>(MatchHostClock::now() - start).count();
+    const MatchHostStats& stats = host.getStats();
+    const ThreadPoolStats poolStats = host.getPoolStats();
+
+    bool isOk = true;
+    int64_t snapshotBytesCount = 0;
+    for (int i = 0; i < host.getMatchesCount(); ++i)
+    {
+        const GameServer& server = host.getIdleMatch(i);
+        snapshotBytesCount += server.getStats().snapshotBytesSentCount;
+        isOk = isOk && server.getTick() > 0;
+    }
+
+    if (verbose)
+    {
+        const double expectedTicksCount = matchesCount * elapsedSeconds / GAME_TICK_DT;
+        const double avgTickMs = stats.ticksCount ? stats.totalTickNs / 1e6 / stats.ticksCount : 0.0;
+        const double utilization = poolStats.busyNs / (elapsedSeconds * 1e9 * host.getThreadsCount());
+
+        std::printf("match host: %d matches, %d threads, %.1f s\n", matchesCount, host.getThreadsCount(), elapsedSeconds);
+        std::printf("ticks: %lld of %.0f due, %lld late, %lld skipped\n", static_cast<long long>(stats.ticksCount), expectedTicksCount,
+                    static_cast<long long>(stats.lateTicksCount), static_cast<long long>(stats.skippedTicksCount));
+        std::printf("tick: %.3f ms avg, %.3f ms max, waited for a worker %.3f ms avg, %.3f ms max\n", avgTickMs, stats.maxTickNs / 1e6,
+                    stats.ticksCount ? stats.totalStartDelayNs / 1e6 / stats.ticksCount : 0.0, stats.maxStartDelayNs / 1e6);
+        std::printf("workers: %.1f%% busy, %lld jobs, %lld stolen\n", utilization * 100.0, static_cast<long long>(poolStats.jobsCount),
+                    static_cast<long long>(poolStats.stolenJobsCount));
+        std::printf("per match: %.3f ms of a core per second, snapshots %.1f KB/s, about %.0f matches per core\n",
+                    avgTickMs / GAME_TICK_DT, snapshotBytesCount / (elapsedSeconds * 1024.0 * matchesCount),
+                    avgTickMs > 0.0 ? GAME_TICK_DT * 1000.0 / avgTickMs : 0.0);
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include "game_server.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+using MatchHostClock = std::chrono::steady_clock;
+
+// a match that is further behind skips the lost ticks instead of simulating them in a burst
+constexpr int MATCH_HOST_MAX_CATCH_UP_TICKS = 4;
+
+struct MatchHostStats
+{
+    int64_t ticksCount = 0;
+    // ticks that were still running when the next tick of their match was due
+    int64_t lateTicksCount = 0;
+    // ticks that were never simulated, their match was too far behind
+    int64_t skippedTicksCount = 0;
+    int64_t totalTickNs = 0;
+    int64_t maxTickNs = 0;
+    // how long a due match waited for a free worker
+    int64_t totalStartDelayNs = 0;
+    int64_t maxStartDelayNs = 0;
+};
+
+// Runs many GameServers in one process. Every match ticks on its own schedule: when its tick is due, the tick goes to
+// the thread pool as a job, so a slow match doesn't hold the others back and the matches spread over all cores.
+// Matches start at different phases of a tick, so the load is even over time
+class MatchHost
+{
+public:
+    // threadsCount 0 means one worker per core
+    explicit MatchHost(int threadsCount = 0);
+
+    // returns the index of the new match, it's due right away
+    int addMatch(Vec2 worldSize);
+    int getMatchesCount() const;
+    // waits for the tick of the match to finish, the match can be changed until the next update()
+    GameServer& getIdleMatch(int matchIndex);
+
+    // submits ticks of the due matches and collects stats of the finished ones. Returns when to call it again
+    MatchHostClock::time_point update();
+    // waits for all running ticks
+    void waitIdle();
+
+    int getThreadsCount() const;
+    const MatchHostStats& getStats() const;
+    ThreadPoolStats getPoolStats() const;
+
+private:
+    struct Match
+    {
+        std::unique_ptr<GameServer> server{};
+        MatchHostClock::time_point nextTickTime{};
+        // set by update() when it submits the tick, cleared by the tick job when it's done
+        std::atomic<bool> isTicking{false};
+        // filled by the tick job, update() moves them into the host stats
+        MatchHostStats tickStats{};
+    };
+
+    void tickMatch(Match& match);
+    void collectMatchStats(Match& match);
+
+    std::vector<std::unique_ptr<Match>> m_matches{};
+    MatchHostStats m_stats{};
+    // the last member, so the workers are stopped before the matches their jobs refer to are destroyed
+    ThreadPool m_pool;
+};
+
+// Hosts matchesCount matches of two in-process AI bots for the given time and prints the host load and what a match costs
+// if verbose. threadsCount 0 means one worker per core. Returns false if some match didn't tick at all
+bool runMatchHostBench(int matchesCount, float seconds, int threadsCount, bool verbose);
@@ -0,0 +1,606 @@
+﻿#include "net_protocol.h"
+#include "game_frame.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr uint8_t NET_ENTITY_THRUSTING = 1 << 0;
+constexpr uint8_t NET_SNAPSHOT_ROUND_OVER = 1 << 0;
+
+// which fields of a changed entity follow its net id
+constexpr uint8_t NET_FIELD_NEW = 1 << 0;
+constexpr uint8_t NET_FIELD_FLAGS = 1 << 1;
+constexpr uint8_t NET_FIELD_POSITION = 1 << 2;
+constexpr uint8_t NET_FIELD_VELOCITY = 1 << 3;
+constexpr uint8_t NET_FIELD_ROTATION = 1 << 4;
+constexpr uint8_t NET_FIELD_IMPULSE = 1 << 5;
+
+constexpr float NET_VELOCITY_STEPS_PER_UNIT = 16.f;
+
+template <typename T>
+static void writeRaw(std::vector<uint8_t>& packet, const T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    packet.insert(packet.end(), std::begin(bytes), std::end(bytes));
+}
+
+static void writeVarint(std::vector<uint8_t>& packet, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        packet.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    packet.push_back(static_cast<uint8_t>(value));
+}
+
+static void writePacketType(std::vector<uint8_t>& packet, const NetPacketType type)
+{
+    packet.clear();
+    packet.push_back(static_cast<uint8_t>(type));
+}
+
+struct NetPacketReader
+{
+    const std::vector<uint8_t>& packet;
+    size_t offset = 0;
+    bool failed = false;
+
+    template <typename T>
+    T readRaw()
+    {
+        T value{};
+        if (offset + sizeof(T) > packet.size())
+        {
+            failed = true;
+            return value;
+        }
+        std::memcpy(&value, packet.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    uint32_t readVarint()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 7)
+        {
+            const uint8_t byte = readRaw<uint8_t>();
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (failed || !(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        failed = true;
+        return value;
+    }
+
+    size_t getBytesLeft() const
+    {
+        return packet.size() - offset;
+    }
+
+    // fails right away for a packet of another type
+    static NetPacketReader afterType(const std::vector<uint8_t>& packet, const NetPacketType type)
+    {
+        return NetPacketReader{packet, 1, packet.empty() || packet[0] != static_cast<uint8_t>(type)};
+    }
+};
+
+// the grid covers the range exactly once, so values outside of it wrap around
+static uint16_t quantizeWrapped(const float value, const float range)
+{
+    return static_cast<uint16_t>(static_cast<int32_t>(std::lround(value / range * 65536.f)));
+}
+
+static float dequantizeWrapped(const uint16_t value, const float range)
+{
+    return static_cast<float>(value) / 65536.f * range;
+}
+
+static int16_t quantizeVelocity(const float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -NET_MAX_SPEED, NET_MAX_SPEED) * NET_VELOCITY_STEPS_PER_UNIT));
+}
+
+NetQuantizedEntity quantizeNetEntity(const NetEntityState& state, const Vec2 worldSize)
+{
+    NetQuantizedEntity entity;
+    entity.netId = state.netId;
+    entity.kind = static_cast<uint8_t>(state.kind);
+    entity.playerIndex = state.playerIndex;
+    entity.flags = state.isThrusting ? NET_ENTITY_THRUSTING : 0;
+    entity.impulseCooldownTicks = static_cast<uint8_t>(std::clamp(std::lround(state.impulseCooldownLeft / GAME_TICK_DT), 0L, 255L));
+    entity.position[0] = quantizeWrapped(state.position.x, worldSize.x);
+    entity.position[1] = quantizeWrapped(state.position.y, worldSize.y);
+    entity.velocity[0] = quantizeVelocity(state.velocity.x);
+    entity.velocity[1] = quantizeVelocity(state.velocity.y);
+    entity.rotation = quantizeWrapped(state.rotation, 360.f);
+    return entity;
+}
+
+NetEntityState dequantizeNetEntity(const NetQuantizedEntity& entity, const Vec2 worldSize)
+{
+    NetEntityState state;
+    state.netId = entity.netId;
+    state.kind = static_cast<NetEntityKind>(entity.kind);
+    state.playerIndex = entity.playerIndex;
+    state.isThrusting = (entity.flags & NET_ENTITY_THRUSTING) != 0;
+    state.impulseCooldownLeft = entity.impulseCooldownTicks * GAME_TICK_DT;
+    state.position = Vec2{dequantizeWrapped(entity.position[0], worldSize.x), dequantizeWrapped(entity.position[1], worldSize.y)};
+    state.velocity = Vec2{entity.velocity[0] / NET_VELOCITY_STEPS_PER_UNIT, entity.velocity[1] / NET_VELOCITY_STEPS_PER_UNIT};
+    state.rotation = dequantizeWrapped(entity.rotation, 360.f);
+    return state;
+}
+
+static uint8_t getChangedNetFields(const NetQuantizedEntity& from, const NetQuantizedEntity& to)
+{
+    uint8_t fields = 0;
+
+    if (from.flags != to.flags)
+    {
+        fields |= NET_FIELD_FLAGS;
+    }
+    if (from.position[0] != to.position[0] || from.position[1] != to.position[1])
+    {
+        fields |= NET_FIELD_POSITION;
+    }
+    if (from.velocity[0] != to.velocity[0] || from.velocity[1] != to.velocity[1])
+    {
+        fields |= NET_FIELD_VELOCITY;
+    }
+    if (from.rotation != to.rotation)
+    {
+        fields |= NET_FIELD_ROTATION;
+    }
+    if (from.impulseCooldownTicks != to.impulseCooldownTicks)
+    {
+        fields |= NET_FIELD_IMPULSE;
+    }
+
+    return fields;
+}
+
+void captureNetSnapshot(const entt::registry& registry, NetSnapshot& snapshot)
+{
+    snapshot.entities.clear();
+
+    const auto shipsView = registry.view<const ShipComponent, const PositionComponent, const VelocityComponent, const RotationComponent,
+                                         const AccelerateByInputComponent, const AccelerateImpulseByInputComponent>();
+    for (auto [entity, ship, position, velocity, rotation, accelerate, impulse] : shipsView.each())
+    {
+        NetEntityState& state = snapshot.entities.emplace_back();
+        state.netId = entt::to_integral(entity);
+        state.kind = NetEntityKind::Ship;
+        state.playerIndex = static_cast<uint8_t>(ship.playerIndex);
+        state.isThrusting = accelerate.input;
+        state.position = position.vec;
+        state.velocity = velocity.vec;
+        state.rotation = rotation.angle;
+        state.impulseCooldownLeft = impulse.cooldownTimer.timeLeft;
+    }
+
+    const auto projectilesView = registry.view<const ProjectileComponent, const PositionComponent, const VelocityComponent, const RotationComponent>();
+    for (auto [entity, position, velocity, rotation] : projectilesView.each())
+    {
+        NetEntityState& state = snapshot.entities.emplace_back();
+        state.netId = entt::to_integral(entity);
+        state.kind = NetEntityKind::Projectile;
+        state.position = position.vec;
+        state.velocity = velocity.vec;
+        state.rotation = rotation.angle;
+    }
+
+    std::sort(snapshot.entities.begin(), snapshot.entities.end(), [](const NetEntityState& a, const NetEntityState& b)
+    {
+        return a.netId < b.netId;
+    });
+}
+
+void writeHelloPacket(std::vector<uint8_t>& packet)
+{
+    writePacketType(packet, NetPacketType::Hello);
+}
+
+void writeWelcomePacket(std::vector<uint8_t>& packet, const int playerIndex, const Vec2 worldSize)
+{
+    writePacketType(packet, NetPacketType::Welcome);
+    writeRaw<uint8_t>(packet, static_cast<uint8_t>(playerIndex));
+    writeRaw<float>(packet, worldSize.x);
+    writeRaw<float>(packet, worldSize.y);
+}
+
+bool readWelcomePacket(const std::vector<uint8_t>& packet, int& outPlayerIndex, Vec2& outWorldSize)
+{
+    NetPacketReader reader = NetPacketReader::afterType(packet, NetPacketType::Welcome);
+    const int playerIndex = reader.readRaw<uint8_t>();
+    const Vec2 worldSize{reader.readRaw<float>(), reader.readRaw<float>()};
+
+    if (reader.failed || playerIndex >= NET_PLAYERS_COUNT || !(worldSize.x > 0.f && worldSize.y > 0.f))
+    {
+        return false;
+    }
+
+    outPlayerIndex = playerIndex;
+    outWorldSize = worldSize;
+    return true;
+}
+
+void writeInputPacket(std::vector<uint8_t>& packet, const uint32_t ackedSnapshotTick, const uint32_t lastSeq, const uint8_t* packedInputs,
+                      const int inputsCount)
+{
+    writePacketType(packet, NetPacketType::Input);
+    writeRaw<uint32_t>(packet, ackedSnapshotTick);
+    writeRaw<uint32_t>(packet, lastSeq);
+    writeRaw<uint8_t>(packet, static_cast<uint8_t>(inputsCount));
+    packet.insert(packet.end(), packedInputs, packedInputs + inputsCount);
+}
+
+bool readInputPacket(const std::vector<uint8_t>& packet, uint32_t& outAckedSnapshotTick, uint32_t& outLastSeq, std::vector<uint8_t>& outPackedInputs)
+{
+    NetPacketReader reader = NetPacketReader::afterType(packet, NetPacketType::Input);
+    const uint32_t ackedSnapshotTick = reader.readRaw<uint32_t>();
+    const uint32_t lastSeq = reader.readRaw<uint32_t>();
+    const size_t inputsCount = reader.readRaw<uint8_t>();
+
+    if (reader.failed || reader.offset + inputsCount > packet.size() || inputsCount > lastSeq)
+    {
+        return false;
+    }
+
+    outAckedSnapshotTick = ackedSnapshotTick;
+    outLastSeq = lastSeq;
+    outPackedInputs.assign(packet.begin() + reader.offset, packet.begin() + reader.offset + inputsCount);
+    return true;
+}
+
+size_t getNaiveNetSnapshotSize(const NetSnapshot& snapshot)
+{
+    // type, round id, tick, acked input seq, flags, result, scores, entities count
+    size_t size = 1 + 4 + 4 + 4 + 1 + 1 + 2 * NET_PLAYERS_COUNT + 2;
+
+    for (const NetEntityState& state : snapshot.entities)
+    {
+        // net id, kind, player index, flags, position, velocity, rotation, impulse cooldown of ships
+        size += 4 + 1 + 1 + 1 + 8 + 8 + 4 + (state.kind == NetEntityKind::Ship ? 4 : 0);
+    }
+
+    return size;
+}
+
+// Snapshot packet: u32 round id, u32 tick, u32 baseline tick (0 for none), u32 acked input seq, u8 flags, i8 victorious player index,
+// u16 score per player, then changes from the baseline entities. Net ids go as varint differences from the previous one in the list:
+// varint removed entities count, their net ids, varint changed entities count, then per entity its net id, u8 changed fields mask
+// and the fields in the mask order. New entities have u8 kind and u8 player index first, their fields are compared with zeroes
+static void writeNetEntityFields(std::vector<uint8_t>& packet, const NetQuantizedEntity& entity, const uint8_t fields)
+{
+    packet.push_back(fields);
+
+    if (fields & NET_FIELD_NEW)
+    {
+        writeRaw<uint8_t>(packet, entity.kind);
+        writeRaw<uint8_t>(packet, entity.playerIndex);
+    }
+    if (fields & NET_FIELD_FLAGS)
+    {
+        writeRaw<uint8_t>(packet, entity.flags);
+    }
+    if (fields & NET_FIELD_POSITION)
+    {
+        writeRaw<uint16_t>(packet, entity.position[0]);
+        writeRaw<uint16_t>(packet, entity.position[1]);
+    }
+    if (fields & NET_FIELD_VELOCITY)
+    {
+        writeRaw<int16_t>(packet, entity.velocity[0]);
+        writeRaw<int16_t>(packet, entity.velocity[1]);
+    }
+    if (fields & NET_FIELD_ROTATION)
+    {
+        writeRaw<uint16_t>(packet, entity.rotation);
+    }
+    if (fields & NET_FIELD_IMPULSE)
+    {
+        writeRaw<uint8_t>(packet, entity.impulseCooldownTicks);
+    }
+}
+
+static void readNetEntityFields(NetPacketReader& reader, NetQuantizedEntity& entity, const uint8_t fields)
+{
+    if (fields & NET_FIELD_NEW)
+    {
+        entity.kind = reader.readRaw<uint8_t>();
+        entity.playerIndex = reader.readRaw<uint8_t>();
+    }
+    if (fields & NET_FIELD_FLAGS)
+    {
+        entity.flags = reader.readRaw<uint8_t>();
+    }
+    if (fields & NET_FIELD_POSITION)
+    {
+        entity.position[0] = reader.readRaw<uint16_t>();
+        entity.position[1] = reader.readRaw<uint16_t>();
+    }
+    if (fields & NET_FIELD_VELOCITY)
+    {
+        entity.velocity[0] = reader.readRaw<int16_t>();
+        entity.velocity[1] = reader.readRaw<int16_t>();
+    }
+    if (fields & NET_FIELD_ROTATION)
+    {
+        entity.rotation = reader.readRaw<uint16_t>();
+    }
+    if (fields & NET_FIELD_IMPULSE)
+    {
+        entity.impulseCooldownTicks = reader.readRaw<uint8_t>();
+    }
+}
+
+NetSnapshotEncoder::NetSnapshotEncoder(const Vec2 worldSize) : m_worldSize(worldSize)
+{
+}
+
+void NetSnapshotEncoder::addSnapshot(const NetSnapshot& snapshot)
+{
+    m_snapshot.roundId = snapshot.roundId;
+    m_snapshot.tick = snapshot.tick;
+    m_snapshot.isRoundOver = snapshot.isRoundOver;
+    m_snapshot.roundResult = snapshot.roundResult;
+    m_snapshot.scores = snapshot.scores;
+
+    m_latestIndex = (m_latestIndex + 1) % NET_SNAPSHOT_HISTORY_SIZE;
+    m_historyTicks[m_latestIndex] = snapshot.tick;
+
+    std::vector<NetQuantizedEntity>& entities = m_history[m_latestIndex];
+    entities.clear();
+    for (const NetEntityState& state : snapshot.entities)
+    {
+        entities.push_back(quantizeNetEntity(state, m_worldSize));
+    }
+}
+
+void NetSnapshotEncoder::writePacket(std::vector<uint8_t>& packet, const uint32_t ackedInputSeq, const uint32_t baselineTick)
+{
+    static const std::vector<NetQuantizedEntity> noEntities{};
+
+    const std::vector<NetQuantizedEntity>& entities = m_history[m_latestIndex];
+    const std::vector<NetQuantizedEntity>* baseline = &noEntities;
+    uint32_t usedBaselineTick = 0;
+
+    for (int i = 0; i < NET_SNAPSHOT_HISTORY_SIZE; ++i)
+    {
+        if (baselineTick != 0 && m_historyTicks[i] == baselineTick && i != m_latestIndex)
+        {
+            baseline = &m_history[i];
+            usedBaselineTick = baselineTick;
+            break;
+        }
+    }
+
+    writePacketType(packet, NetPacketType::Snapshot);
+    writeRaw<uint32_t>(packet, m_snapshot.roundId);
+    writeRaw<uint32_t>(packet, m_snapshot.tick);
+    writeRaw<uint32_t>(packet, usedBaselineTick);
+    writeRaw<uint32_t>(packet, ackedInputSeq);
+    writeRaw<uint8_t>(packet, m_snapshot.isRoundOver ? NET_SNAPSHOT_ROUND_OVER : 0);
+    writeRaw<int8_t>(packet, static_cast<int8_t>(m_snapshot.roundResult.victoriousPlayerIndex));
+    for (const uint16_t score : m_snapshot.scores)
+    {
+        writeRaw<uint16_t>(packet, score);
+    }
+
+    // both lists are sorted by net id
+    m_removedIds.clear();
+    m_changedEntitiesData.clear();
+    uint32_t changedCount = 0;
+    uint32_t lastChangedId = 0;
+
+    auto baselineIt = baseline->begin();
+    for (const NetQuantizedEntity& entity : entities)
+    {
+        for (; baselineIt != baseline->end() && baselineIt->netId < entity.netId; ++baselineIt)
+        {
+            m_removedIds.push_back(baselineIt->netId);
+        }
+
+        const bool isNew = baselineIt == baseline->end() || baselineIt->netId != entity.netId;
+        const uint8_t fields = isNew ? NET_FIELD_NEW | getChangedNetFields(NetQuantizedEntity{}, entity) : getChangedNetFields(*baselineIt, entity);
+        if (!isNew)
+        {
+            ++baselineIt;
+        }
+
+        if (fields == 0)
+        {
+            continue;
+        }
+
+        writeVarint(m_changedEntitiesData, entity.netId - lastChangedId);
+        writeNetEntityFields(m_changedEntitiesData, entity, fields);
+        lastChangedId = entity.netId;
+        ++changedCount;
+    }
+
+    for (; baselineIt != baseline->end(); ++baselineIt)
+    {
+        m_removedIds.push_back(baselineIt->netId);
+    }
+
+    writeVarint(packet, static_cast<uint32_t>(m_removedIds.size()));
+    uint32_t lastRemovedId = 0;
+    for (const uint32_t netId : m_removedIds)
+    {
+        writeVarint(packet, netId - lastRemovedId);
+        lastRemovedId = netId;
+    }
+
+    writeVarint(packet, changedCount);
+    packet.insert(packet.end(), m_changedEntitiesData.begin(), m_changedEntitiesData.end());
+}
+
+void NetSnapshotDecoder::reset(const Vec2 worldSize)
+{
+    m_worldSize = worldSize;
+    m_historyTicks.fill(0);
+    m_latestTick = 0;
+}
+
+bool NetSnapshotDecoder::readPacket(const std::vector<uint8_t>& packet, NetSnapshot& outSnapshot)
+{
+    static const std::vector<NetQuantizedEntity> noEntities{};
+
+    NetPacketReader reader = NetPacketReader::afterType(packet, NetPacketType::Snapshot);
+
+    NetSnapshot& snapshot = outSnapshot;
+    snapshot.roundId = reader.readRaw<uint32_t>();
+    snapshot.tick = reader.readRaw<uint32_t>();
+    const uint32_t baselineTick = reader.readRaw<uint32_t>();
+    snapshot.ackedInputSeq = reader.readRaw<uint32_t>();
+    snapshot.isRoundOver = (reader.readRaw<uint8_t>() & NET_SNAPSHOT_ROUND_OVER) != 0;
+    snapshot.roundResult.victoriousPlayerIndex = reader.readRaw<int8_t>();
+    for (uint16_t& score : snapshot.scores)
+    {
+        score = reader.readRaw<uint16_t>();
+    }
+
+    const int victoriousPlayerIndex = snapshot.roundResult.victoriousPlayerIndex;
+    if (reader.failed || snapshot.tick == 0 || victoriousPlayerIndex < -1 || victoriousPlayerIndex >= NET_PLAYERS_COUNT)
+    {
+        return false;
+    }
+
+    const std::vector<NetQuantizedEntity>* baseline = &noEntities;
+    if (baselineTick != 0)
+    {
+        const auto it = std::find(m_historyTicks.begin(), m_historyTicks.end(), baselineTick);
+        if (it == m_historyTicks.end())
+        {
+            return false;
+        }
+        baseline = &m_history[it - m_historyTicks.begin()];
+    }
+
+    const uint32_t removedCount = reader.readVarint();
+    if (reader.failed || removedCount > baseline->size())
+    {
+        return false;
+    }
+
+    // the lists are sorted, so baseline entities are taken in order and each one is either removed, changed or kept
+    m_entities.clear();
+    auto baselineIt = baseline->begin();
+    uint32_t removedId = 0;
+    const auto takeBaselineUntil = [&](const uint32_t netId, const bool isInclusive)
+    {
+        for (; baselineIt != baseline->end() && (baselineIt->netId < netId || (isInclusive && baselineIt->netId == netId)); ++baselineIt)
+        {
+            m_entities.push_back(*baselineIt);
+        }
+    };
+
+    for (uint32_t i = 0; i < removedCount; ++i)
+    {
+        const uint32_t idDiff = reader.readVarint();
+        if (reader.failed || (i > 0 && idDiff == 0))
+        {
+            return false;
+        }
+        removedId += idDiff;
+
+        takeBaselineUntil(removedId, false);
+        if (baselineIt == baseline->end() || baselineIt->netId != removedId)
+        {
+            return false;
+        }
+        // it's taken back out below, changed entities may still go before it
+        m_entities.push_back(*baselineIt);
+        m_entities.back().kind = UINT8_MAX;
+        ++baselineIt;
+    }
+    takeBaselineUntil(UINT32_MAX, true);
+
+    // what is left is the baseline without removed entities, the changed ones are merged into it
+    m_entities.erase(std::remove_if(m_entities.begin(), m_entities.end(), [](const NetQuantizedEntity& entity)
+    {
+        return entity.kind == UINT8_MAX;
+    }), m_entities.end());
+
+    const uint32_t changedCount = reader.readVarint();
+    // every changed entity takes at least two bytes
+    if (reader.failed || changedCount > reader.getBytesLeft() / 2)
+    {
+        return false;
+    }
+
+    m_mergedEntities.clear();
+    auto keptIt = m_entities.begin();
+    uint32_t changedId = 0;
+
+    for (uint32_t i = 0; i < changedCount; ++i)
+    {
+        const uint32_t idDiff = reader.readVarint();
+        const uint8_t fields = reader.readRaw<uint8_t>();
+        if (reader.failed || (i > 0 && idDiff == 0))
+        {
+            return false;
+        }
+        changedId += idDiff;
+
+        for (; keptIt != m_entities.end() && keptIt->netId < changedId; ++keptIt)
+        {
+            m_mergedEntities.push_back(*keptIt);
+        }
+
+        const bool isKept = keptIt != m_entities.end() && keptIt->netId == changedId;
+        if (isKept == ((fields & NET_FIELD_NEW) != 0))
+        {
+            return false;
+        }
+
+        NetQuantizedEntity entity = isKept ? *keptIt++ : NetQuantizedEntity{};
+        entity.netId = changedId;
+        readNetEntityFields(reader, entity, fields);
+
+        if (reader.failed || entity.kind > static_cast<uint8_t>(NetEntityKind::Projectile) || entity.playerIndex >= NET_PLAYERS_COUNT)
+        {
+            return false;
+        }
+        m_mergedEntities.push_back(entity);
+    }
+    m_mergedEntities.insert(m_mergedEntities.end(), keptIt, m_entities.end());
+
+    m_nextIndex = (m_nextIndex + 1) % NET_SNAPSHOT_HISTORY_SIZE;
+    m_historyTicks[m_nextIndex] = snapshot.tick;
+    m_history[m_nextIndex] = m_mergedEntities;
+    m_latestTick = std::max(m_latestTick, snapshot.tick);
+
+    snapshot.entities.clear();
+    for (const NetQuantizedEntity& entity : m_mergedEntities)
+    {
+        snapshot.entities.push_back(dequantizeNetEntity(entity, m_worldSize));
+    }
+
+    return true;
+}
+
+uint32_t NetSnapshotDecoder::getLatestTick() const
+{
+    return m_latestTick;
+}
+
+bool readSnapshotPacketTick(const std::vector<uint8_t>& packet, uint32_t& outTick)
+{
+    NetPacketReader reader = NetPacketReader::afterType(packet, NetPacketType::Snapshot);
+    reader.readRaw<uint32_t>();
+    const uint32_t tick = reader.readRaw<uint32_t>();
+    if (reader.failed)
+    {
+        return false;
+    }
+
+    outTick = tick;
+    return true;
+}
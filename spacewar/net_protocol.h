@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include "game_logic.h"
+
+#include <array>
+#include <vector>
+
+// Dedicated server protocol. Every packet starts with a NetPacketType byte, numbers are in native byte order
+constexpr int NET_PLAYERS_COUNT = 2;
+
+enum class NetPacketType : uint8_t
+{
+    // client asks for a player slot, sent until the welcome comes
+    Hello,
+    // u8 player index, f32 world width, f32 world height
+    Welcome,
+    // u32 tick of the newest snapshot received, u32 sequence number of the last input, u8 inputs count, packed inputs from the oldest one
+    Input,
+    Snapshot,
+};
+
+enum class NetEntityKind : uint8_t
+{
+    Ship,
+    Projectile,
+};
+
+struct NetEntityState
+{
+    // unique among the entities alive at once, entities are sorted by it
+    uint32_t netId = 0;
+    NetEntityKind kind = NetEntityKind::Ship;
+    uint8_t playerIndex = 0;
+    bool isThrusting = false;
+
+    Vec2 position{};
+    Vec2 velocity{};
+    float rotation = 0.f;
+    // ships only, the client needs it to predict its own ship
+    float impulseCooldownLeft = 0.f;
+};
+
+// Gameplay state of the server world after one tick, as one client sees it
+struct NetSnapshot
+{
+    uint32_t roundId = 0;
+    uint32_t tick = 0;
+    // the last input of the receiving client the server has simulated
+    uint32_t ackedInputSeq = 0;
+    // set once the round is over, the server keeps simulating it for a while before the next one
+    bool isRoundOver = false;
+    GameResult roundResult{};
+    std::array<uint16_t, NET_PLAYERS_COUNT> scores{};
+
+    std::vector<NetEntityState> entities{};
+};
+
+// Velocities are clamped to it on the wire
+constexpr float NET_MAX_SPEED = 2000.f;
+// snapshots both sides remember to encode changes against, about a second of them
+constexpr int NET_SNAPSHOT_HISTORY_SIZE = 32;
+
+// Entity state as it goes over the wire. Positions are on a 16 bit grid over the world, so they wrap around it by themselves,
+// angles take 16 bits too and velocities are 1/16 px/s steps within NET_MAX_SPEED
+struct NetQuantizedEntity
+{
+    uint32_t netId = 0;
+    uint8_t kind = 0;
+    uint8_t playerIndex = 0;
+    uint8_t flags = 0;
+    uint8_t impulseCooldownTicks = 0;
+    uint16_t position[2]{};
+    int16_t velocity[2]{};
+    uint16_t rotation = 0;
+};
+
+NetQuantizedEntity quantizeNetEntity(const NetEntityState& state, Vec2 worldSize);
+NetEntityState dequantizeNetEntity(const NetQuantizedEntity& entity, Vec2 worldSize);
+
+// Ships and projectiles of the world, ackedInputSeq and round fields are left as they are
+void captureNetSnapshot(const entt::registry& registry, NetSnapshot& snapshot);
+
+// Size of the snapshot with every field of every entity as full floats, for comparison with the encoded one
+size_t getNaiveNetSnapshotSize(const NetSnapshot& snapshot);
+
+// Server side of snapshot packets. It remembers the snapshots it has encoded, so each client gets only the entities
+// and fields that changed since the snapshot the client has acked
+class NetSnapshotEncoder
+{
+public:
+    explicit NetSnapshotEncoder(Vec2 worldSize);
+
+    // quantizes the snapshot, it's the one writePacket sends from now on
+    void addSnapshot(const NetSnapshot& snapshot);
+    // baselineTick is the newest snapshot the client has, 0 if none. A snapshot that is forgotten already can't be
+    // a baseline, the whole snapshot is sent then
+    void writePacket(std::vector<uint8_t>& packet, uint32_t ackedInputSeq, uint32_t baselineTick);
+
+private:
+    Vec2 m_worldSize{};
+    NetSnapshot m_snapshot{};
+    std::array<std::vector<NetQuantizedEntity>, NET_SNAPSHOT_HISTORY_SIZE> m_history{};
+    std::array<uint32_t, NET_SNAPSHOT_HISTORY_SIZE> m_historyTicks{};
+    int m_latestIndex = 0;
+    std::vector<uint32_t> m_removedIds{};
+    std::vector<uint8_t> m_changedEntitiesData{};
+};
+
+// Client side of snapshot packets, keeps decoded snapshots as baselines for the next ones
+class NetSnapshotDecoder
+{
+public:
+    // forgets all snapshots
+    void reset(Vec2 worldSize);
+
+    // returns false if the packet is damaged or its baseline is forgotten already
+    bool readPacket(const std::vector<uint8_t>& packet, NetSnapshot& outSnapshot);
+    // the newest snapshot read, it's the baseline the client acks
+    uint32_t getLatestTick() const;
+
+private:
+    Vec2 m_worldSize{};
+    std::array<std::vector<NetQuantizedEntity>, NET_SNAPSHOT_HISTORY_SIZE> m_history{};
+    std::array<uint32_t, NET_SNAPSHOT_HISTORY_SIZE> m_historyTicks{};
+    int m_nextIndex = 0;
+    uint32_t m_latestTick = 0;
+    std::vector<NetQuantizedEntity> m_entities{};
+    std::vector<NetQuantizedEntity> m_mergedEntities{};
+};
+
+void writeHelloPacket(std::vector<uint8_t>& packet);
+void writeWelcomePacket(std::vector<uint8_t>& packet, int playerIndex, Vec2 worldSize);
+bool readWelcomePacket(const std::vector<uint8_t>& packet, int& outPlayerIndex, Vec2& outWorldSize);
+// inputs go from the oldest one, the last of them has lastSeq
+void writeInputPacket(std::vector<uint8_t>& packet, uint32_t ackedSnapshotTick, uint32_t lastSeq, const uint8_t* packedInputs, int inputsCount);
+bool readInputPacket(const std::vector<uint8_t>& packet, uint32_t& outAckedSnapshotTick, uint32_t& outLastSeq, std::vector<uint8_t>& outPackedInputs);
+// only the tick from the snapshot header, for peers that don't keep the world
+bool readSnapshotPacketTick(const std::vector<uint8_t>& packet, uint32_t& outTick);
@@ -0,0 +1,47 @@
+﻿#include "net_transport.h"
+
+LoopbackNetwork::LoopbackNetwork(const float latency, const float packetLossRate, const uint32_t seed)
+    : m_latency(latency), m_lossDistribution(packetLossRate), m_lossRandomEngine(seed)
+{
+    m_ends[0] = std::make_unique<End>(*this, 0);
+    m_ends[1] = std::make_unique<End>(*this, 1);
+}
+
+void LoopbackNetwork::advanceTime(const float dt)
+{
+    m_time += dt;
+}
+
+NetTransport& LoopbackNetwork::getEnd(const int index)
+{
+    return *m_ends[index];
+}
+
+LoopbackNetwork::End::End(LoopbackNetwork& network, const int index) : m_network(network), m_index(index)
+{
+}
+
+void LoopbackNetwork::End::send(const std::vector<uint8_t>& packet)
+{
+    if (m_network.m_lossDistribution(m_network.m_lossRandomEngine))
+    {
+        return;
+    }
+
+    const int otherIndex = 1 - m_index;
+    m_network.m_pendingPackets[otherIndex].push_back(PendingPacket{m_network.m_time + m_network.m_latency, packet});
+}
+
+bool LoopbackNetwork::End::receive(std::vector<uint8_t>& outPacket)
+{
+    std::deque<PendingPacket>& pendingPackets = m_network.m_pendingPackets[m_index];
+
+    if (pendingPackets.empty() || pendingPackets.front().deliveryTime > m_network.m_time)
+    {
+        return false;
+    }
+
+    outPacket = std::move(pendingPackets.front().packet);
+    pendingPackets.pop_front();
+    return true;
+}
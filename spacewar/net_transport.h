@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Unreliable connection to one peer: packets may be lost, duplicated or come late, but never come damaged
+class NetTransport
+{
+public:
+    virtual ~NetTransport() = default;
+
+    virtual void send(const std::vector<uint8_t>& packet) = 0;
+    // returns false if there is no packet to receive now, never blocks
+    virtual bool receive(std::vector<uint8_t>& outPacket) = 0;
+};
+
+// Both ends of a connection inside one process, with simulated latency and packet loss, for testing on one machine.
+// Time only goes forward with advanceTime, so runs over it are reproducible
+class LoopbackNetwork
+{
+public:
+    LoopbackNetwork(float latency, float packetLossRate, uint32_t seed);
+
+    void advanceTime(float dt);
+    NetTransport& getEnd(int index);
+
+private:
+    struct PendingPacket
+    {
+        float deliveryTime = 0.f;
+        std::vector<uint8_t> packet{};
+    };
+
+    class End : public NetTransport
+    {
+    public:
+        End(LoopbackNetwork& network, int index);
+
+        void send(const std::vector<uint8_t>& packet) override;
+        bool receive(std::vector<uint8_t>& outPacket) override;
+
+    private:
+        LoopbackNetwork& m_network;
+        int m_index = 0;
+    };
+
+    float m_latency = 0.f;
+    float m_time = 0.f;
+    std::bernoulli_distribution m_lossDistribution;
+    std::mt19937 m_lossRandomEngine;
+
+    // packets on the way to each end, delivery times only grow since latency is constant
+    std::deque<PendingPacket> m_pendingPackets[2]{};
+    std::unique_ptr<End> m_ends[2]{};
+};
@@ -0,0 +1,225 @@
+﻿#include "perf_gate.h"
+#include "benchmark.h"
+#include "game_frame.h"
+#include "player.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+struct PerfScenario
+{
+    const char* name = nullptr;
+    BenchmarkWorldSettings settings{};
+    int ticksCount = 0;
+};
+
+struct PerfScenarioResult
+{
+    double medianNs = 0.0;
+    double p99Ns = 0.0;
+};
+
+constexpr float PERF_TICK_DT = 1.f / 60.f;
+constexpr int PERF_WARMUP_TICKS = 30;
+// every scenario is repeated and the best run is taken, to filter out noise from the rest of the machine
+constexpr int PERF_REPEATS = 3;
+
+static std::vector<PerfScenario> createPerfScenarios()
+{
+    std::vector<PerfScenario> scenarios;
+
+    {
+        PerfScenario scenario{"ships_idle_2"};
+        scenario.settings.shipsCount = 2;
+        scenario.settings.projectilesCount = 0;
+        scenario.settings.particlesCount = 0;
+        scenario.settings.collidersCount = 0;
+        scenario.settings.shipsActive = false;
+        scenario.ticksCount = 600;
+        scenarios.push_back(scenario);
+    }
+
+    {
+        PerfScenario scenario{"crossfire_500_projectiles"};
+        scenario.settings.shipsCount = 8;
+        scenario.settings.projectilesCount = 500;
+        scenario.settings.particlesCount = 0;
+        scenario.settings.collidersCount = 50;
+        scenario.ticksCount = 240;
+        scenarios.push_back(scenario);
+    }
+
+    {
+        PerfScenario scenario{"particle_storm_20k"};
+        scenario.settings.shipsCount = 2;
+        scenario.settings.projectilesCount = 0;
+        scenario.settings.particlesCount = 20000;
+        scenario.settings.collidersCount = 0;
+        scenario.ticksCount = 240;
+        scenarios.push_back(scenario);
+    }
+
+    {
+        // the biggest free for all lobby, every ship shooting all the time
+        PerfScenario scenario{"arena_64_ships"};
+        scenario.settings.shipsCount = MAX_PLAYERS_COUNT;
+        scenario.settings.projectilesCount = 5 * MAX_PLAYERS_COUNT;
+        scenario.settings.particlesCount = 0;
+        scenario.settings.collidersCount = 0;
+        scenario.ticksCount = 240;
+        scenarios.push_back(scenario);
+    }
+
+    {
+        // the large-N stress scenario: thousands of bodies colliding, falling into the well and breaking apart
+        PerfScenario scenario{"asteroid_field_5k"};
+        scenario.settings.shipsCount = 8;
+        scenario.settings.projectilesCount = 100;
+        scenario.settings.particlesCount = 0;
+        scenario.settings.collidersCount = 0;
+        scenario.settings.asteroidsCount = 5000;
+        scenario.settings.worldSize = Vec2{4000.f, 4000.f};
+        scenario.ticksCount = 240;
+        scenarios.push_back(scenario);
+    }
+
+    return scenarios;
+}
+
+static PerfScenarioResult runPerfScenario(const PerfScenario& scenario)
+{
+    PerfScenarioResult best{};
+    entt::registry registry;
+
+    for (int repeat = 0; repeat < PERF_REPEATS; ++repeat)
+    {
+        benchmarkPopulateWorld(registry, scenario.settings);
+
+        for (int tick = 0; tick < PERF_WARMUP_TICKS; ++tick)
+        {
+            gameFrameUpdate(registry, PERF_TICK_DT, scenario.settings.worldSize);
+        }
+
+        std::vector<double> samplesNs;
+        samplesNs.reserve(scenario.ticksCount);
+
+        for (int tick = 0; tick < scenario.ticksCount; ++tick)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            gameFrameUpdate(registry, PERF_TICK_DT, scenario.settings.worldSize);
+            const auto finish = std::chrono::steady_clock::now();
+            samplesNs.push_back(std::chrono::duration<double, std::nano>(finish - start).count());
+        }
+
+        const BenchmarkStats stats = benchmarkComputeStats(std::move(samplesNs));
+
+        if (repeat == 0 || stats.medianNs < best.medianNs)
+        {
+            best.medianNs = stats.medianNs;
+        }
+
+        if (repeat == 0 || stats.p99Ns < best.p99Ns)
+        {
+            best.p99Ns = stats.p99Ns;
+        }
+    }
+
+    return best;
+}
+
+// Baseline file format: one scenario per line, "name median_ns p99_ns", lines starting with # are comments
+static bool readPerfBaseline(const std::string& baselinePath, std::map<std::string, PerfScenarioResult>& outBaseline)
+{
+    std::ifstream file{baselinePath};
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream lineStream{line};
+        std::string name;
+        PerfScenarioResult result;
+        if (lineStream >> name >> result.medianNs >> result.p99Ns)
+        {
+            outBaseline[name] = result;
+        }
+    }
+
+    return true;
+}
+
+bool runPerfGate(const std::string& baselinePath, const float tolerance)
+{
+    std::map<std::string, PerfScenarioResult> baseline;
+    if (!readPerfBaseline(baselinePath, baseline))
+    {
+        std::fprintf(stderr, "perf gate: can't read baseline %s\n", baselinePath.c_str());
+        return false;
+    }
+
+    bool passed = true;
+
+    std::printf("%-28s %14s %14s %8s %14s %14s %8s\n", "scenario", "median_us", "base_us", "ratio", "p99_us", "base_us", "ratio");
+
+    for (const PerfScenario& scenario : createPerfScenarios())
+    {
+        const auto baselineIt = baseline.find(scenario.name);
+        if (baselineIt == baseline.end())
+        {
+            std::printf("%-28s missing in baseline\n", scenario.name);
+            passed = false;
+            continue;
+        }
+
+        const PerfScenarioResult& expected = baselineIt->second;
+        const PerfScenarioResult actual = runPerfScenario(scenario);
+
+        const double medianRatio = actual.medianNs / std::max(expected.medianNs, 1.0);
+        const double p99Ratio = actual.p99Ns / std::max(expected.p99Ns, 1.0);
+        const bool scenarioPassed = medianRatio <= tolerance && p99Ratio <= tolerance;
+        passed = passed && scenarioPassed;
+
+        std::printf("%-28s %14.1f %14.1f %8.2f %14.1f %14.1f %8.2f %s\n", scenario.name,
+                    actual.medianNs / 1000.0, expected.medianNs / 1000.0, medianRatio,
+                    actual.p99Ns / 1000.0, expected.p99Ns / 1000.0, p99Ratio,
+                    scenarioPassed ? "ok" : "REGRESSION");
+    }
+
+    std::printf("perf gate %s (tolerance %.2f)\n", passed ? "passed" : "FAILED", tolerance);
+    return passed;
+}
+
+bool updatePerfBaseline(const std::string& baselinePath)
+{
+    std::ofstream file{baselinePath};
+    if (!file)
+    {
+        std::fprintf(stderr, "perf gate: can't write baseline %s\n", baselinePath.c_str());
+        return false;
+    }
+
+    file << "# Tick time baseline for 'spacewar --perf-gate', regenerate with 'spacewar --perf-baseline <file>'\n";
+    file << "# scenario median_ns p99_ns\n";
+
+    for (const PerfScenario& scenario : createPerfScenarios())
+    {
+        const PerfScenarioResult result = runPerfScenario(scenario);
+        file << scenario.name << ' ' << static_cast<long long>(result.medianNs) << ' ' << static_cast<long long>(result.p99Ns) << '\n';
+        std::printf("%-28s median %.1f us, p99 %.1f us\n", scenario.name, result.medianNs / 1000.0, result.p99Ns / 1000.0);
+    }
+
+    return true;
+}
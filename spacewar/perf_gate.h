@@ -0,0 +1,10 @@
+﻿#pragma once
+
+#include <string>
+
+// Runs the fixed set of perf scenarios and compares median and p99 tick times against the baseline file.
+// Returns false if any scenario got slower than baseline * tolerance or the baseline can't be read.
+bool runPerfGate(const std::string& baselinePath, float tolerance);
+
+// Runs the same scenarios and overwrites the baseline file with the results
+bool updatePerfBaseline(const std::string& baselinePath);
@@ -32,7 +32,15 @@ ShipInput readPlayerInput(const PlayerKeymap& keymap)
     return result;
 }
 
-ShipInput aiGenerateInput(const entt::registry& registry, const entt::registry::entity_type selfShip)
+void applyShipInput(entt::registry& registry, const entt::registry::entity_type ship, const ShipInput& input)
+{
+    registry.get<AccelerateByInputComponent>(ship).input = input.thrust;
+    registry.get<RotateByInputComponent>(ship).input = input.rotate;
+    registry.get<ShootingComponent>(ship).input = input.shoot;
+    registry.get<AccelerateImpulseByInputComponent>(ship).input = input.thrustBurst;
+}
+
+ShipInput aiGenerateInput(const entt::registry& registry, const entt::registry::entity_type selfShip, const AiParams& params)
 {
     entt::registry::entity_type enemyShip = entt::null;
     {
@@ -47,6 +55,12 @@ ShipInput aiGenerateInput(const entt::registry& registry, const entt::registry::
             }
         }
     }
+    return aiGenerateInputForTarget(registry, selfShip, enemyShip, params);
+}
+
+ShipInput aiGenerateInputForTarget(const entt::registry& registry, const entt::registry::entity_type selfShip,
+                                   const entt::registry::entity_type enemyShip, const AiParams& params)
+{
     if (!registry.valid(enemyShip))
     {
         return {};
@@ -67,13 +81,13 @@ ShipInput aiGenerateInput(const entt::registry& registry, const entt::registry::
     
     result.rotate = angleDiff > 0 ? 1.f : -1.f;
     
-    if (angleDiffAbs < 40.f)
+    if (angleDiffAbs < params.thrustAngle)
     {
-        result.thrust = distToEnemy > 150.f;
-        result.thrustBurst = distToEnemy > 600.f;
+        result.thrust = distToEnemy > params.thrustDistance;
+        result.thrustBurst = distToEnemy > params.thrustBurstDistance;
     }
     
-    result.shoot = angleDiffAbs < 10.f;
+    result.shoot = angleDiffAbs < params.shootAngle;
     
     return result;
 }
@@ -22,12 +22,27 @@ struct ShipInput
     bool shoot = false;
 };
 
+// thresholds of the built-in AI, the defaults are the hand-tuned ones
+struct AiParams
+{
+    // thrust only when the enemy is within this angle of the nose
+    float thrustAngle = 40.f;
+    float thrustDistance = 150.f;
+    float thrustBurstDistance = 600.f;
+    float shootAngle = 10.f;
+};
+
+// the biggest free for all lobby
+constexpr int MAX_PLAYERS_COUNT = 64;
+
 struct Player
 {
     PlayerKeymap keymap{};
     std::string name{};
     sf::Keyboard::Key makeAiKey = sf::Keyboard::Unknown;
     bool isAi = false;
+    // bots have no keys, they are always AI and always ready
+    bool isBot = false;
 
     int score = 0;
     entt::registry::entity_type shipEntity = entt::null;
@@ -35,4 +50,8 @@ struct Player
 
 void forEachKeyInKeymap(const PlayerKeymap& keymap, const std::function<void(sf::Keyboard::Key)>& callback);
 ShipInput readPlayerInput(const PlayerKeymap& keymap);
-ShipInput aiGenerateInput(const entt::registry& registry, entt::registry::entity_type selfShip);
+void applyShipInput(entt::registry& registry, entt::registry::entity_type ship, const ShipInput& input);
+ShipInput aiGenerateInput(const entt::registry& registry, entt::registry::entity_type selfShip, const AiParams& params = AiParams{});
+// the same AI against a given ship instead of the first other one, no input if the target is gone
+ShipInput aiGenerateInputForTarget(const entt::registry& registry, entt::registry::entity_type selfShip, entt::registry::entity_type enemyShip,
+                                   const AiParams& params = AiParams{});
@@ -0,0 +1,301 @@
+﻿#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+struct ProfilerScopeData
+{
+    const char* name = nullptr;
+    // scopes may run on worker threads, so the per frame sum is atomic
+    std::atomic<long long> currentFrameNs{0};
+    std::array<float, PROFILER_HISTORY_FRAMES> historyMs{};
+};
+
+struct TraceEvent
+{
+    const char* name = nullptr;
+    char phase = 'X';
+    int threadIndex = 0;
+    long long startNs = 0;
+    long long durationNs = 0;
+};
+
+struct TraceCapture
+{
+    std::atomic<bool> isActive{false};
+    int framesLeft = 0;
+    std::string filePath{};
+    ProfilerTimePoint startTime{};
+
+    std::mutex mutex{};
+    std::vector<TraceEvent> events{};
+    std::vector<std::string> threadNames{};
+
+    std::thread writerThread{};
+};
+
+// the index of scopes registered when the table was full, their samples are dropped
+constexpr int PROFILER_NO_SCOPE = -1;
+
+struct Profiler
+{
+    std::array<ProfilerScopeData, PROFILER_MAX_SCOPES> scopes{};
+    // worker threads register their scopes on first use while the main thread reads the table,
+    // a scope is counted only after its name is written
+    std::mutex registerMutex{};
+    std::atomic<int> scopesCount{0};
+
+    // ring buffer cursor, shared by all scopes
+    int historyCursor = 0;
+    int historyFilled = 0;
+
+    std::atomic<int> threadsCount{0};
+    TraceCapture trace{};
+
+    ~Profiler()
+    {
+        profilerFlushTrace();
+    }
+};
+
+static Profiler profiler;
+
+static int getThreadIndex()
+{
+    thread_local const int threadIndex = profiler.threadsCount++;
+    return threadIndex;
+}
+
+static long long toTraceNs(const ProfilerTimePoint timePoint)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint - profiler.trace.startTime).count();
+}
+
+static void writeTraceFile(const std::string& filePath, const std::vector<TraceEvent>& events, const std::vector<std::string>& threadNames)
+{
+    FILE* file = std::fopen(filePath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "profiler: can't open trace file %s\n", filePath.c_str());
+        return;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+    bool first = true;
+    const auto separator = [&first]()
+    {
+        const char* result = first ? "" : ",\n";
+        first = false;
+        return result;
+    };
+
+    for (size_t threadIndex = 0; threadIndex < threadNames.size(); ++threadIndex)
+    {
+        if (!threadNames[threadIndex].empty())
+        {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                         separator(), static_cast<int>(threadIndex), threadNames[threadIndex].c_str());
+        }
+    }
+
+    for (const TraceEvent& event : events)
+    {
+        // trace-event timestamps are in microseconds
+        const double ts = event.startNs / 1000.0;
+
+        if (event.phase == 'X')
+        {
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         separator(), event.name, event.threadIndex, ts, event.durationNs / 1000.0);
+        }
+        else
+        {
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                         separator(), event.name, event.threadIndex, ts);
+        }
+    }
+
+    std::fputs("\n]}\n", file);
+    std::fclose(file);
+}
+
+static void pushTraceEvent(const TraceEvent& event)
+{
+    const std::lock_guard<std::mutex> lock{profiler.trace.mutex};
+    profiler.trace.events.push_back(event);
+}
+
+static void finishTraceCapture()
+{
+    TraceCapture& trace = profiler.trace;
+    trace.isActive = false;
+
+    std::vector<TraceEvent> events;
+    std::vector<std::string> threadNames;
+    {
+        const std::lock_guard<std::mutex> lock{trace.mutex};
+        events.swap(trace.events);
+        threadNames = trace.threadNames;
+    }
+
+    trace.writerThread = std::thread{[filePath = trace.filePath, events = std::move(events), threadNames = std::move(threadNames)]()
+    {
+        writeTraceFile(filePath, events, threadNames);
+    }};
+}
+
+int profilerRegisterScope(const char* name)
+{
+    const std::lock_guard<std::mutex> lock{profiler.registerMutex};
+
+    const int index = profiler.scopesCount.load(std::memory_order_relaxed);
+    if (index >= PROFILER_MAX_SCOPES)
+    {
+        std::fprintf(stderr, "profiler: more than %d scopes, %s isn't measured\n", PROFILER_MAX_SCOPES, name);
+        return PROFILER_NO_SCOPE;
+    }
+
+    profiler.scopes[index].name = name;
+    profiler.scopesCount.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+void profilerAddSample(const int scopeIndex, const ProfilerTimePoint start, const ProfilerTimePoint finish)
+{
+    if (scopeIndex == PROFILER_NO_SCOPE)
+    {
+        return;
+    }
+
+    const long long durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+    profiler.scopes[scopeIndex].currentFrameNs.fetch_add(durationNs, std::memory_order_relaxed);
+
+    if (profiler.trace.isActive.load(std::memory_order_relaxed))
+    {
+        pushTraceEvent(TraceEvent{profiler.scopes[scopeIndex].name, 'X', getThreadIndex(), toTraceNs(start), durationNs});
+    }
+}
+
+void profilerEndFrame()
+{
+    const int scopesCount = profiler.scopesCount.load(std::memory_order_acquire);
+    for (int i = 0; i < scopesCount; ++i)
+    {
+        ProfilerScopeData& scope = profiler.scopes[i];
+        scope.historyMs[profiler.historyCursor] = scope.currentFrameNs.exchange(0, std::memory_order_relaxed) / 1000000.f;
+    }
+
+    profiler.historyCursor = (profiler.historyCursor + 1) % PROFILER_HISTORY_FRAMES;
+    profiler.historyFilled = std::min(profiler.historyFilled + 1, PROFILER_HISTORY_FRAMES);
+
+    TraceCapture& trace = profiler.trace;
+    if (trace.isActive && --trace.framesLeft <= 0)
+    {
+        finishTraceCapture();
+    }
+}
+
+std::vector<ProfilerScopeStats> profilerGetStats()
+{
+    std::vector<ProfilerScopeStats> result;
+    const int scopesCount = profiler.scopesCount.load(std::memory_order_acquire);
+    result.reserve(scopesCount);
+
+    const int lastFrameIndex = (profiler.historyCursor + PROFILER_HISTORY_FRAMES - 1) % PROFILER_HISTORY_FRAMES;
+
+    for (int i = 0; i < scopesCount; ++i)
+    {
+        const ProfilerScopeData& scope = profiler.scopes[i];
+
+        ProfilerScopeStats stats;
+        stats.name = scope.name;
+
+        if (profiler.historyFilled > 0)
+        {
+            float sum = 0.f;
+            for (int frame = 0; frame < profiler.historyFilled; ++frame)
+            {
+                sum += scope.historyMs[frame];
+                stats.maxMs = std::max(stats.maxMs, scope.historyMs[frame]);
+            }
+
+            stats.avgMs = sum / profiler.historyFilled;
+            stats.lastMs = scope.historyMs[lastFrameIndex];
+        }
+
+        result.push_back(stats);
+    }
+
+    return result;
+}
+
+void profilerStartTraceCapture(const int framesCount, const std::string& filePath)
+{
+    TraceCapture& trace = profiler.trace;
+    if (trace.isActive || framesCount <= 0)
+    {
+        return;
+    }
+
+    // previous capture might still be writing
+    profilerFlushTrace();
+
+    {
+        const std::lock_guard<std::mutex> lock{trace.mutex};
+        trace.events.clear();
+        trace.events.reserve(static_cast<size_t>(framesCount) * profiler.scopesCount * 2);
+    }
+
+    trace.framesLeft = framesCount;
+    trace.filePath = filePath;
+    trace.startTime = std::chrono::steady_clock::now();
+    trace.isActive = true;
+}
+
+bool profilerIsTraceCaptureActive()
+{
+    return profiler.trace.isActive;
+}
+
+void profilerTraceInstant(const char* name)
+{
+    if (profiler.trace.isActive)
+    {
+        pushTraceEvent(TraceEvent{name, 'i', getThreadIndex(), toTraceNs(std::chrono::steady_clock::now()), 0});
+    }
+}
+
+void profilerSetThreadName(const std::string& name)
+{
+    const int threadIndex = getThreadIndex();
+
+    const std::lock_guard<std::mutex> lock{profiler.trace.mutex};
+    std::vector<std::string>& threadNames = profiler.trace.threadNames;
+    if (static_cast<int>(threadNames.size()) <= threadIndex)
+    {
+        threadNames.resize(threadIndex + 1);
+    }
+    threadNames[threadIndex] = name;
+}
+
+void profilerFlushTrace()
+{
+    if (profiler.trace.isActive)
+    {
+        finishTraceCapture();
+    }
+
+    if (profiler.trace.writerThread.joinable())
+    {
+        profiler.trace.writerThread.join();
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+// Set to 0 to compile all profiler scopes out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// scope sites past this many aren't measured
+constexpr int PROFILER_MAX_SCOPES = 128;
+constexpr int PROFILER_HISTORY_FRAMES = 120;
+
+struct ProfilerScopeStats
+{
+    const char* name = nullptr;
+    float lastMs = 0.f;
+    float avgMs = 0.f;
+    float maxMs = 0.f;
+};
+
+#if PROFILER_ENABLED
+
+using ProfilerTimePoint = std::chrono::steady_clock::time_point;
+
+int profilerRegisterScope(const char* name);
+void profilerAddSample(int scopeIndex, ProfilerTimePoint start, ProfilerTimePoint finish);
+void profilerEndFrame();
+std::vector<ProfilerScopeStats> profilerGetStats();
+
+// Trace capture records every scope of the next framesCount frames, from all threads, into memory.
+// When the capture is over, the events are written as Chrome trace-event json (chrome://tracing, ui.perfetto.dev)
+// by a background thread.
+void profilerStartTraceCapture(int framesCount, const std::string& filePath);
+bool profilerIsTraceCaptureActive();
+void profilerTraceInstant(const char* name);
+void profilerSetThreadName(const std::string& name);
+// Stops an unfinished capture and blocks until the trace file is written
+void profilerFlushTrace();
+
+class ProfilerScope
+{
+public:
+    explicit ProfilerScope(const int scopeIndex) : m_scopeIndex(scopeIndex), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ProfilerScope()
+    {
+        profilerAddSample(m_scopeIndex, m_start, std::chrono::steady_clock::now());
+    }
+
+    ProfilerScope(const ProfilerScope&) = delete;
+    ProfilerScope& operator=(const ProfilerScope&) = delete;
+
+private:
+    int m_scopeIndex = -1;
+    ProfilerTimePoint m_start;
+};
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name) \
+    static const int PROFILER_CONCAT(profilerScopeIndex, __LINE__) = profilerRegisterScope(name); \
+    const ProfilerScope PROFILER_CONCAT(profilerScope, __LINE__){PROFILER_CONCAT(profilerScopeIndex, __LINE__)}
+
+#else
+
+inline void profilerEndFrame()
+{
+}
+
+inline std::vector<ProfilerScopeStats> profilerGetStats()
+{
+    return {};
+}
+
+inline void profilerStartTraceCapture(int, const std::string&)
+{
+}
+
+inline bool profilerIsTraceCaptureActive()
+{
+    return false;
+}
+
+inline void profilerTraceInstant(const char*)
+{
+}
+
+inline void profilerSetThreadName(const std::string&)
+{
+}
+
+inline void profilerFlushTrace()
+{
+}
+
+#define PROFILE_SCOPE(name)
+
+#endif
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
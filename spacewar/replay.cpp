@@ -0,0 +1,478 @@
+﻿#include "replay.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// File layout, numbers in native byte order (little endian on every platform we ship):
+// "SWRP", u16 version, u8 players count, u8 per player is ai, u64 seed, f32 world width, f32 world height, f32 tick dt,
+// u32 asteroids count, u8 gravity integrator, u8 is ship hit masks, u32 ticks count, then runs of identical ticks:
+// varint run length followed by the players count packed inputs
+constexpr char REPLAY_MAGIC[4] = {'S', 'W', 'R', 'P'};
+constexpr uint16_t REPLAY_VERSION = 6;
+
+// limits of what a replay file may ask for, larger values come from damaged files and would allocate without bound
+constexpr uint64_t REPLAY_MAX_PACKED_INPUTS_SIZE = uint64_t{1} << 28;
+constexpr float REPLAY_MAX_WORLD_SIZE = 100000.f;
+constexpr uint32_t REPLAY_MAX_ASTEROIDS_COUNT = 1 << 20;
+
+// Keyframes file layout, in the same byte order: "SWKF", u16 version, u32 keyframe interval ticks, u64 replay seed,
+// u32 replay ticks count, u32 keyframes count, then per keyframe u64 size followed by the world snapshot bytes
+constexpr char REPLAY_KEYFRAMES_MAGIC[4] = {'S', 'W', 'K', 'F'};
+constexpr uint16_t REPLAY_KEYFRAMES_VERSION = 1;
+constexpr size_t REPLAY_KEYFRAMES_HEADER_SIZE = 26;
+
+constexpr uint8_t PACKED_ROTATE_POSITIVE = 1 << 0;
+constexpr uint8_t PACKED_ROTATE_NEGATIVE = 1 << 1;
+constexpr uint8_t PACKED_THRUST = 1 << 2;
+constexpr uint8_t PACKED_THRUST_BURST = 1 << 3;
+constexpr uint8_t PACKED_SHOOT = 1 << 4;
+
+int Replay::getPlayersCount() const
+{
+    return static_cast<int>(playersAi.size());
+}
+
+int Replay::getTicksCount() const
+{
+    return playersAi.empty() ? 0 : static_cast<int>(packedInputs.size() / playersAi.size());
+}
+
+ShipInput Replay::getInput(const int tick, const int playerIndex) const
+{
+    return unpackShipInput(packedInputs[tick * getPlayersCount() + playerIndex]);
+}
+
+void Replay::addInput(const ShipInput& input)
+{
+    packedInputs.push_back(packShipInput(input));
+}
+
+uint8_t packShipInput(const ShipInput& input)
+{
+    uint8_t result = 0;
+
+    if (input.rotate > 0.f)
+    {
+        result |= PACKED_ROTATE_POSITIVE;
+    }
+    else if (input.rotate < 0.f)
+    {
+        result |= PACKED_ROTATE_NEGATIVE;
+    }
+
+    if (input.thrust)
+    {
+        result |= PACKED_THRUST;
+    }
+
+    if (input.thrustBurst)
+    {
+        result |= PACKED_THRUST_BURST;
+    }
+
+    if (input.shoot)
+    {
+        result |= PACKED_SHOOT;
+    }
+
+    return result;
+}
+
+ShipInput unpackShipInput(const uint8_t packed)
+{
+    ShipInput result;
+
+    if (packed & PACKED_ROTATE_POSITIVE)
+    {
+        result.rotate = 1.f;
+    }
+    else if (packed & PACKED_ROTATE_NEGATIVE)
+    {
+        result.rotate = -1.f;
+    }
+
+    result.thrust = packed & PACKED_THRUST;
+    result.thrustBurst = packed & PACKED_THRUST_BURST;
+    result.shoot = packed & PACKED_SHOOT;
+
+    return result;
+}
+
+Replay replayCreate(const uint64_t seed, const Vec2 worldSize, const float tickDt, const std::vector<Player>& players)
+{
+    Replay replay;
+    replay.seed = seed;
+    replay.worldSize = worldSize;
+    replay.tickDt = tickDt;
+
+    for (const Player& player : players)
+    {
+        replay.playersAi.push_back(player.isAi);
+    }
+
+    return replay;
+}
+
+void replayCreateWorld(entt::registry& registry, std::vector<Player>& players, const Replay& replay, const ShipHitMasks* shipHitMasks)
+{
+    randomSeed(replay.seed);
+    recreateGameWorld(registry, players, replay.worldSize);
+    registry.set<GravityIntegratorSettings>(GravityIntegratorSettings{replay.gravityIntegrator});
+    if (replay.isShipHitMasks)
+    {
+        assert(shipHitMasks != nullptr);
+        registry.set<ShipHitMasks>(*shipHitMasks);
+    }
+    else
+    {
+        registry.unset<ShipHitMasks>();
+    }
+    createAsteroidEntities(registry, replay.asteroidsCount, replay.worldSize);
+}
+
+void replaySimulateTick(entt::registry& registry, const std::vector<Player>& players, const Replay& replay, const int tick)
+{
+    for (int i = 0; i < replay.getPlayersCount(); ++i)
+    {
+        const entt::registry::entity_type ship = players[i].shipEntity;
+        if (registry.valid(ship))
+        {
+            applyShipInput(registry, ship, replay.getInput(tick, i));
+        }
+    }
+
+    gameFrameUpdate(registry, replay.tickDt, replay.worldSize);
+}
+
+void replayTryCaptureKeyframe(ReplayKeyframes& keyframes, const entt::registry& registry, const int tick)
+{
+    const int nextKeyframeTick = static_cast<int>(keyframes.snapshots.size()) * REPLAY_KEYFRAME_INTERVAL_TICKS;
+    if (tick == nextKeyframeTick)
+    {
+        keyframes.snapshots.push_back(worldSnapshotCapture(registry));
+    }
+}
+
+int replaySeek(entt::registry& registry, const std::vector<Player>& players, const Replay& replay, ReplayKeyframes& keyframes,
+               const int targetTick)
+{
+    assert(!keyframes.snapshots.empty());
+
+    const int clampedTargetTick = std::clamp(targetTick, 0, replay.getTicksCount());
+    const int keyframeIndex = std::min(clampedTargetTick / REPLAY_KEYFRAME_INTERVAL_TICKS, static_cast<int>(keyframes.snapshots.size()) - 1);
+
+    worldSnapshotRestore(registry, keyframes.snapshots[keyframeIndex]);
+
+    for (int tick = keyframeIndex * REPLAY_KEYFRAME_INTERVAL_TICKS; tick < clampedTargetTick; ++tick)
+    {
+        replayTryCaptureKeyframe(keyframes, registry, tick);
+        replaySimulateTick(registry, players, replay, tick);
+    }
+
+    return clampedTargetTick;
+}
+
+ReplayKeyframes replayCaptureKeyframes(const Replay& replay, std::vector<Player> players, const ShipHitMasks* shipHitMasks)
+{
+    entt::registry registry;
+    replayCreateWorld(registry, players, replay, shipHitMasks);
+
+    ReplayKeyframes keyframes;
+    for (int tick = 0; tick < replay.getTicksCount(); ++tick)
+    {
+        replayTryCaptureKeyframe(keyframes, registry, tick);
+        replaySimulateTick(registry, players, replay, tick);
+    }
+
+    return keyframes;
+}
+
+template <typename T>
+static void writeRaw(std::vector<uint8_t>& buffer, const T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    buffer.insert(buffer.end(), std::begin(bytes), std::end(bytes));
+}
+
+static void writeVarint(std::vector<uint8_t>& buffer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads from a byte buffer, every read after the end of the buffer fails and leaves the reader failed
+struct ReplayReader
+{
+    const std::vector<uint8_t>& buffer;
+    size_t offset = 0;
+    bool failed = false;
+
+    template <typename T>
+    T readRaw()
+    {
+        T value{};
+        if (offset + sizeof(T) > buffer.size())
+        {
+            failed = true;
+            return value;
+        }
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    uint32_t readVarint()
+    {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 7)
+        {
+            const uint8_t byte = readRaw<uint8_t>();
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (failed || !(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        failed = true;
+        return value;
+    }
+};
+
+bool saveReplay(const Replay& replay, const std::string& filePath)
+{
+    const int playersCount = replay.getPlayersCount();
+    const int ticksCount = replay.getTicksCount();
+
+    std::vector<uint8_t> buffer;
+    buffer.insert(buffer.end(), std::begin(REPLAY_MAGIC), std::end(REPLAY_MAGIC));
+    writeRaw(buffer, REPLAY_VERSION);
+    writeRaw(buffer, static_cast<uint8_t>(playersCount));
+    for (const bool isAi : replay.playersAi)
+    {
+        writeRaw(buffer, static_cast<uint8_t>(isAi));
+    }
+    writeRaw(buffer, replay.seed);
+    writeRaw(buffer, replay.worldSize.x);
+    writeRaw(buffer, replay.worldSize.y);
+    writeRaw(buffer, replay.tickDt);
+    writeRaw(buffer, static_cast<uint32_t>(replay.asteroidsCount));
+    writeRaw(buffer, static_cast<uint8_t>(replay.gravityIntegrator));
+    writeRaw(buffer, static_cast<uint8_t>(replay.isShipHitMasks));
+    writeRaw(buffer, static_cast<uint32_t>(ticksCount));
+
+    // players hold the same keys for many ticks in a row, so runs of identical ticks are stored once
+    const auto sameTicks = [&replay, playersCount](const int a, const int b)
+    {
+        const auto aIt = replay.packedInputs.begin() + a * playersCount;
+        return std::equal(aIt, aIt + playersCount, replay.packedInputs.begin() + b * playersCount);
+    };
+
+    int tick = 0;
+    while (tick < ticksCount)
+    {
+        int runLength = 1;
+        while (tick + runLength < ticksCount && sameTicks(tick, tick + runLength))
+        {
+            ++runLength;
+        }
+
+        writeVarint(buffer, static_cast<uint32_t>(runLength));
+        const auto tickIt = replay.packedInputs.begin() + tick * playersCount;
+        buffer.insert(buffer.end(), tickIt, tickIt + playersCount);
+
+        tick += runLength;
+    }
+
+    std::ofstream file{filePath, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return static_cast<bool>(file);
+}
+
+bool loadReplay(const std::string& filePath, Replay& outReplay)
+{
+    std::ifstream file{filePath, std::ios::binary};
+    if (!file)
+    {
+        return false;
+    }
+
+    const std::vector<uint8_t> buffer{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    ReplayReader reader{buffer};
+
+    for (const char magicChar : REPLAY_MAGIC)
+    {
+        if (reader.readRaw<char>() != magicChar)
+        {
+            return false;
+        }
+    }
+
+    if (reader.readRaw<uint16_t>() != REPLAY_VERSION)
+    {
+        return false;
+    }
+
+    Replay replay;
+
+    const int playersCount = reader.readRaw<uint8_t>();
+    for (int i = 0; i < playersCount; ++i)
+    {
+        replay.playersAi.push_back(reader.readRaw<uint8_t>() != 0);
+    }
+    replay.seed = reader.readRaw<uint64_t>();
+    replay.worldSize.x = reader.readRaw<float>();
+    replay.worldSize.y = reader.readRaw<float>();
+    replay.tickDt = reader.readRaw<float>();
+    const uint32_t asteroidsCount = reader.readRaw<uint32_t>();
+    const uint8_t gravityIntegrator = reader.readRaw<uint8_t>();
+    replay.gravityIntegrator = static_cast<GravityIntegrator>(gravityIntegrator);
+    const uint8_t isShipHitMasks = reader.readRaw<uint8_t>();
+    replay.isShipHitMasks = isShipHitMasks != 0;
+    const uint32_t ticksCount = reader.readRaw<uint32_t>();
+
+    const auto isWorldSideValid = [](const float side)
+    {
+        return side > 0.f && side <= REPLAY_MAX_WORLD_SIZE;
+    };
+
+    if (reader.failed || playersCount == 0 || playersCount > MAX_PLAYERS_COUNT || !isWorldSideValid(replay.worldSize.x) ||
+        !isWorldSideValid(replay.worldSize.y) || !(replay.tickDt > 0.f) || !std::isfinite(replay.tickDt) ||
+        asteroidsCount > REPLAY_MAX_ASTEROIDS_COUNT || gravityIntegrator >= static_cast<uint8_t>(GravityIntegrator::Count) || isShipHitMasks > 1)
+    {
+        return false;
+    }
+    replay.asteroidsCount = static_cast<int>(asteroidsCount);
+
+    // a few bytes of runs can stand for any ticks count, so it's capped by the inputs it unpacks to. Any ticks need one run at least
+    const size_t remainingSize = buffer.size() - reader.offset;
+    if (static_cast<uint64_t>(ticksCount) * playersCount > REPLAY_MAX_PACKED_INPUTS_SIZE ||
+        (ticksCount > 0 && remainingSize < 1 + static_cast<size_t>(playersCount)))
+    {
+        return false;
+    }
+
+    uint32_t tick = 0;
+    while (tick < ticksCount)
+    {
+        const uint32_t runLength = reader.readVarint();
+        const size_t tickOffset = reader.offset;
+        reader.offset += playersCount;
+
+        if (reader.failed || runLength == 0 || runLength > ticksCount - tick || reader.offset > buffer.size())
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < runLength; ++i)
+        {
+            replay.packedInputs.insert(replay.packedInputs.end(), buffer.begin() + tickOffset, buffer.begin() + reader.offset);
+        }
+
+        tick += runLength;
+    }
+
+    outReplay = std::move(replay);
+    return true;
+}
+
+std::string getReplayKeyframesFilePath(const std::string& replayFilePath)
+{
+    return std::filesystem::path{replayFilePath}.replace_extension(".swkf").string();
+}
+
+bool saveReplayKeyframes(const Replay& replay, const ReplayKeyframes& keyframes, const std::string& filePath)
+{
+    std::vector<uint8_t> header;
+    header.reserve(REPLAY_KEYFRAMES_HEADER_SIZE);
+    header.insert(header.end(), std::begin(REPLAY_KEYFRAMES_MAGIC), std::end(REPLAY_KEYFRAMES_MAGIC));
+    writeRaw(header, REPLAY_KEYFRAMES_VERSION);
+    writeRaw(header, static_cast<uint32_t>(REPLAY_KEYFRAME_INTERVAL_TICKS));
+    writeRaw(header, replay.seed);
+    writeRaw(header, static_cast<uint32_t>(replay.getTicksCount()));
+    writeRaw(header, static_cast<uint32_t>(keyframes.snapshots.size()));
+
+    // snapshots are written as they are, without copying them into one buffer
+    std::ofstream file{filePath, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    for (const WorldSnapshot& snapshot : keyframes.snapshots)
+    {
+        const uint64_t size = snapshot.bytes.size();
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(snapshot.bytes.data()), snapshot.bytes.size());
+    }
+    return static_cast<bool>(file);
+}
+
+bool loadReplayKeyframes(const std::string& filePath, const Replay& replay, ReplayKeyframes& outKeyframes)
+{
+    const MappedFile file{filePath};
+    if (!file.getData())
+    {
+        return false;
+    }
+
+    const std::vector<uint8_t> header{file.getData(), file.getData() + std::min(file.getSize(), REPLAY_KEYFRAMES_HEADER_SIZE)};
+    ReplayReader reader{header};
+
+    for (const char magicChar : REPLAY_KEYFRAMES_MAGIC)
+    {
+        if (reader.readRaw<char>() != magicChar)
+        {
+            return false;
+        }
+    }
+
+    const uint16_t version = reader.readRaw<uint16_t>();
+    const uint32_t intervalTicks = reader.readRaw<uint32_t>();
+    const uint64_t seed = reader.readRaw<uint64_t>();
+    const uint32_t ticksCount = reader.readRaw<uint32_t>();
+    const uint32_t keyframesCount = reader.readRaw<uint32_t>();
+
+    // keyframe 0 is always there, the last one is before the last tick
+    const int maxKeyframesCount = std::max(replay.getTicksCount() - 1, 0) / REPLAY_KEYFRAME_INTERVAL_TICKS + 1;
+    if (reader.failed || version != REPLAY_KEYFRAMES_VERSION || intervalTicks != REPLAY_KEYFRAME_INTERVAL_TICKS || seed != replay.seed ||
+        ticksCount != static_cast<uint32_t>(replay.getTicksCount()) || keyframesCount == 0 ||
+        keyframesCount > static_cast<uint32_t>(maxKeyframesCount))
+    {
+        return false;
+    }
+
+    ReplayKeyframes keyframes;
+    keyframes.snapshots.resize(keyframesCount);
+
+    size_t offset = reader.offset;
+    for (WorldSnapshot& snapshot : keyframes.snapshots)
+    {
+        uint64_t size = 0;
+        if (file.getSize() - offset < sizeof(size))
+        {
+            return false;
+        }
+        std::memcpy(&size, file.getData() + offset, sizeof(size));
+        offset += sizeof(size);
+
+        const uint8_t* bytes = file.getData() + offset;
+        if (size > file.getSize() - offset || !worldSnapshotIsValid(bytes, size))
+        {
+            return false;
+        }
+        snapshot.bytes.assign(bytes, bytes + size);
+        offset += size;
+    }
+
+    outKeyframes = std::move(keyframes);
+    return true;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "player.h"
+#include "ship_hit_mask.h"
+#include "world_snapshot.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything needed to reproduce a game round: the world parameters, the random seed
+// and the input of every player for every fixed tick
+struct Replay
+{
+    uint64_t seed = 0;
+    Vec2 worldSize{};
+    float tickDt = 0.f;
+    std::vector<bool> playersAi{};
+    // the asteroid field the round was played in, none in the default game
+    int asteroidsCount = 0;
+    GravityIntegrator gravityIntegrator = GravityIntegrator::Euler;
+    // ships collided by the ShipHitMasks of their texture, otherwise as circles
+    bool isShipHitMasks = false;
+
+    // tick-major: packed inputs of all players for tick 0, then for tick 1 and so on
+    std::vector<uint8_t> packedInputs{};
+
+    int getPlayersCount() const;
+    int getTicksCount() const;
+    ShipInput getInput(int tick, int playerIndex) const;
+    void addInput(const ShipInput& input);
+};
+
+// Only the sign of rotate is kept. Ships are always driven by the unpacked input, so the recorded round and its replay match exactly
+uint8_t packShipInput(const ShipInput& input);
+ShipInput unpackShipInput(uint8_t packed);
+
+Replay replayCreate(uint64_t seed, Vec2 worldSize, float tickDt, const std::vector<Player>& players);
+
+// Creates the world the round starts in, recording and playback both start from it.
+// shipHitMasks are only read if the replay collides ships by them, it can't be null then
+void replayCreateWorld(entt::registry& registry, std::vector<Player>& players, const Replay& replay, const ShipHitMasks* shipHitMasks);
+
+// Applies the inputs recorded for the tick to the ships and advances the world by one tick
+void replaySimulateTick(entt::registry& registry, const std::vector<Player>& players, const Replay& replay, int tick);
+
+// Keyframe i is the world right before tick i * REPLAY_KEYFRAME_INTERVAL_TICKS, so seeking simulates less than the interval
+constexpr int REPLAY_KEYFRAME_INTERVAL_TICKS = 240;
+
+// Taken while the round is recorded and saved next to the replay. Seeking past the last keyframe simulates up to the target
+// and adds keyframes on the way
+struct ReplayKeyframes
+{
+    std::vector<WorldSnapshot> snapshots{};
+};
+
+// Captures a keyframe if the world is at the tick of the next missing keyframe
+void replayTryCaptureKeyframe(ReplayKeyframes& keyframes, const entt::registry& registry, int tick);
+
+// Restores the nearest keyframe before targetTick and simulates the remaining ticks, keyframe for tick 0 must be captured.
+// Returns the tick the world is at now, it's targetTick clamped to the replay length
+int replaySeek(entt::registry& registry, const std::vector<Player>& players, const Replay& replay, ReplayKeyframes& keyframes, int targetTick);
+
+// Simulates the whole replay in a world of its own, for replays saved without keyframes
+ReplayKeyframes replayCaptureKeyframes(const Replay& replay, std::vector<Player> players, const ShipHitMasks* shipHitMasks);
+
+bool saveReplay(const Replay& replay, const std::string& filePath);
+bool loadReplay(const std::string& filePath, Replay& outReplay);
+
+// The keyframes file of a replay file, it has the same name and its own extension
+std::string getReplayKeyframesFilePath(const std::string& replayFilePath);
+bool saveReplayKeyframes(const Replay& replay, const ReplayKeyframes& keyframes, const std::string& filePath);
+// Fails if the keyframes were taken from another replay
+bool loadReplayKeyframes(const std::string& filePath, const Replay& replay, ReplayKeyframes& outKeyframes);
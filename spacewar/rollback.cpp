@@ -0,0 +1,366 @@
+﻿#include "rollback.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Packet: u32 round id, u32 first tick, u32 ticks count of remote input received so far, u8 inputs count, packed inputs
+constexpr size_t ROLLBACK_PACKET_HEADER_SIZE = 13;
+constexpr int ROLLBACK_MAX_INPUTS_PER_PACKET = 255;
+
+static void writeU32(std::vector<uint8_t>& packet, const uint32_t value)
+{
+    uint8_t bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    packet.insert(packet.end(), std::begin(bytes), std::end(bytes));
+}
+
+static uint32_t readU32(const std::vector<uint8_t>& packet, const size_t offset)
+{
+    uint32_t value;
+    std::memcpy(&value, packet.data() + offset, sizeof(value));
+    return value;
+}
+
+static double getMsSince(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+RollbackSession::RollbackSession(NetTransport& transport, const entt::registry& registry, const int localPlayerIndex, const uint32_t roundId,
+                                 const Replay& roundReplay, const int inputDelayTicks)
+    : m_transport(transport),
+      m_localPlayerIndex(localPlayerIndex),
+      m_remotePlayerIndex(1 - localPlayerIndex),
+      m_roundId(roundId),
+      m_inputDelayTicks(inputDelayTicks),
+      m_replay(roundReplay)
+{
+    assert(m_replay.getPlayersCount() == 2);
+
+    // nobody has pressed anything during the first delayed ticks
+    m_localInputs.assign(m_inputDelayTicks, 0);
+
+    worldSnapshotCapture(registry, getSavedState(0));
+    m_randomState = randomGetState();
+}
+
+bool RollbackSession::advanceTick(entt::registry& registry, const std::vector<Player>& players, const ShipInput& localInput)
+{
+    PROFILE_FUNCTION();
+
+    receiveAndRollback(registry, players);
+
+    if (m_currentTick - static_cast<int>(m_remoteInputs.size()) >= ROLLBACK_MAX_PREDICTION_TICKS)
+    {
+        ++m_stats.stalledTicksCount;
+        sendLocalInputs();
+        return false;
+    }
+
+    m_localInputs.push_back(packShipInput(localInput));
+
+    randomSetState(m_randomState);
+    simulateTick(registry, players);
+    m_randomState = randomGetState();
+
+    sendLocalInputs();
+    return true;
+}
+
+void RollbackSession::synchronize(entt::registry& registry, const std::vector<Player>& players)
+{
+    receiveAndRollback(registry, players);
+    flushLocalInputs();
+}
+
+void RollbackSession::flushLocalInputs()
+{
+    receiveRemoteInputs();
+
+    // the last packets could be lost, they are repeated until the remote confirms them
+    if (m_remoteAckedTicksCount < static_cast<int>(m_localInputs.size()))
+    {
+        sendLocalInputs();
+    }
+}
+
+void RollbackSession::receiveAndRollback(entt::registry& registry, const std::vector<Player>& players)
+{
+    const int firstPredictedTick = getConfirmedTick();
+    receiveRemoteInputs();
+
+    // predictions are only compared from the first predicted tick, earlier ticks already had real input
+    int rollbackTick = m_currentTick;
+    for (int tick = firstPredictedTick; tick < m_currentTick; ++tick)
+    {
+        if (m_replay.packedInputs[tick * 2 + m_remotePlayerIndex] != getRemoteInputForTick(tick))
+        {
+            rollbackTick = tick;
+            break;
+        }
+    }
+
+    if (rollbackTick == m_currentTick)
+    {
+        return;
+    }
+
+    PROFILE_SCOPE("rollback");
+    const auto start = std::chrono::steady_clock::now();
+
+    const int targetTick = m_currentTick;
+    worldSnapshotRestore(registry, getSavedState(rollbackTick));
+    m_currentTick = rollbackTick;
+
+    while (m_currentTick < targetTick)
+    {
+        simulateTick(registry, players);
+    }
+    m_randomState = randomGetState();
+
+    const int rollbackTicks = targetTick - rollbackTick;
+    ++m_stats.rollbacksCount;
+    m_stats.resimulatedTicksCount += rollbackTicks;
+    m_stats.maxRollbackTicks = std::max(m_stats.maxRollbackTicks, rollbackTicks);
+    m_stats.maxRollbackMs = std::max(m_stats.maxRollbackMs, getMsSince(start));
+}
+
+int RollbackSession::getCurrentTick() const
+{
+    return m_currentTick;
+}
+
+int RollbackSession::getConfirmedTick() const
+{
+    return std::min(m_currentTick, static_cast<int>(m_remoteInputs.size()));
+}
+
+const Replay& RollbackSession::getReplay() const
+{
+    return m_replay;
+}
+
+const RollbackStats& RollbackSession::getStats() const
+{
+    return m_stats;
+}
+
+void RollbackSession::receiveRemoteInputs()
+{
+    while (m_transport.receive(m_packet))
+    {
+        if (m_packet.size() < ROLLBACK_PACKET_HEADER_SIZE || readU32(m_packet, 0) != m_roundId)
+        {
+            continue;
+        }
+
+        const int firstTick = static_cast<int>(readU32(m_packet, 4));
+        const int ackedTicksCount = static_cast<int>(readU32(m_packet, 8));
+        const int inputsCount = m_packet[12];
+
+        if (m_packet.size() < ROLLBACK_PACKET_HEADER_SIZE + inputsCount)
+        {
+            continue;
+        }
+
+        m_remoteAckedTicksCount = std::max(m_remoteAckedTicksCount, ackedTicksCount);
+
+        // packets may come in any order, only inputs right after the known ones are taken
+        for (int i = 0; i < inputsCount; ++i)
+        {
+            if (firstTick + i == static_cast<int>(m_remoteInputs.size()))
+            {
+                m_remoteInputs.push_back(m_packet[ROLLBACK_PACKET_HEADER_SIZE + i]);
+            }
+        }
+    }
+}
+
+void RollbackSession::simulateTick(entt::registry& registry, const std::vector<Player>& players)
+{
+    const int tick = m_currentTick;
+
+    {
+        const auto start = std::chrono::steady_clock::now();
+        worldSnapshotCapture(registry, getSavedState(tick));
+        m_stats.totalSaveMs += getMsSince(start);
+        ++m_stats.savesCount;
+    }
+
+    // after a rollback the replay still has inputs of the ticks being simulated again
+    m_replay.packedInputs.resize(tick * 2);
+    for (int playerIndex = 0; playerIndex < 2; ++playerIndex)
+    {
+        m_replay.packedInputs.push_back(playerIndex == m_localPlayerIndex ? m_localInputs[tick] : getRemoteInputForTick(tick));
+    }
+
+    replaySimulateTick(registry, players, m_replay, tick);
+    ++m_currentTick;
+}
+
+void RollbackSession::sendLocalInputs()
+{
+    const int localTicksCount = static_cast<int>(m_localInputs.size());
+    const int firstTick = std::max(m_remoteAckedTicksCount, localTicksCount - ROLLBACK_MAX_INPUTS_PER_PACKET);
+
+    m_packet.clear();
+    writeU32(m_packet, m_roundId);
+    writeU32(m_packet, static_cast<uint32_t>(firstTick));
+    writeU32(m_packet, static_cast<uint32_t>(m_remoteInputs.size()));
+    m_packet.push_back(static_cast<uint8_t>(localTicksCount - firstTick));
+    m_packet.insert(m_packet.end(), m_localInputs.begin() + firstTick, m_localInputs.end());
+
+    m_transport.send(m_packet);
+}
+
+uint8_t RollbackSession::getRemoteInputForTick(const int tick) const
+{
+    if (tick < static_cast<int>(m_remoteInputs.size()))
+    {
+        return m_remoteInputs[tick];
+    }
+
+    // players mostly hold the same keys, so the last known input is the best guess
+    return m_remoteInputs.empty() ? 0 : m_remoteInputs.back();
+}
+
+WorldSnapshot& RollbackSession::getSavedState(const int tick)
+{
+    return m_savedStates[tick % m_savedStates.size()];
+}
+
+struct RollbackLoopbackPeer
+{
+    entt::registry registry{};
+    std::vector<Player> players{};
+    std::unique_ptr<RollbackSession> session{};
+};
+
+static bool isSameWorld(const entt::registry& expected, const entt::registry& actual)
+{
+    if (expected.alive() != actual.alive())
+    {
+        return false;
+    }
+
+    for (auto [entity, pos] : expected.view<const PositionComponent>().each())
+    {
+        if (!actual.valid(entity) || !actual.has<PositionComponent>(entity) || actual.get<PositionComponent>(entity).vec != pos.vec)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static ShipInput getLoopbackPeerInput(const RollbackLoopbackPeer& peer, const int playerIndex)
+{
+    const entt::registry::entity_type ship = peer.players[playerIndex].shipEntity;
+    return peer.registry.valid(ship) ? aiGenerateInput(peer.registry, ship) : ShipInput{};
+}
+
+static void printRollbackStats(const int peerIndex, const RollbackSession& session)
+{
+    const RollbackStats& stats = session.getStats();
+    std::printf("peer %d: rollbacks %d, avg %.1f ticks, max %d ticks, max %.3f ms, stalls %d, avg save %.1f us\n", peerIndex,
+                stats.rollbacksCount, stats.rollbacksCount ? static_cast<double>(stats.resimulatedTicksCount) / stats.rollbacksCount : 0.0,
+                stats.maxRollbackTicks, stats.maxRollbackMs, stats.stalledTicksCount,
+                stats.savesCount ? stats.totalSaveMs * 1000.0 / stats.savesCount : 0.0);
+}
+
+bool runRollbackLoopback(const int ticksCount, const float latency, const float packetLossRate, const bool verbose)
+{
+    const uint64_t seed = 1;
+    const uint32_t roundId = 1;
+    const int inputDelayTicks = 2;
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    LoopbackNetwork network{latency, packetLossRate, 1};
+    RollbackLoopbackPeer peers[2];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        RollbackLoopbackPeer& peer = peers[i];
+        peer.players.resize(2);
+
+        randomSeed(seed);
+        recreateGameWorld(peer.registry, peer.players, worldSize);
+        const Replay roundReplay = replayCreate(seed, worldSize, GAME_TICK_DT, peer.players);
+        peer.session = std::make_unique<RollbackSession>(network.getEnd(i), peer.registry, i, roundId, roundReplay, inputDelayTicks);
+    }
+
+    for (int tick = 0; tick < ticksCount; ++tick)
+    {
+        network.advanceTime(GAME_TICK_DT);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            peers[i].session->advanceTick(peers[i].registry, peers[i].players, getLoopbackPeerInput(peers[i], i));
+        }
+    }
+
+    // the peer that is behind catches up, then both wait for the last inputs of each other
+    const int targetTick = std::max(peers[0].session->getCurrentTick(), peers[1].session->getCurrentTick());
+    const auto isDone = [&peers, targetTick]()
+    {
+        return std::all_of(std::begin(peers), std::end(peers), [targetTick](const RollbackLoopbackPeer& peer)
+        {
+            return peer.session->getCurrentTick() == targetTick && peer.session->getConfirmedTick() == targetTick;
+        });
+    };
+
+    for (int step = 0; step < 100000 && !isDone(); ++step)
+    {
+        network.advanceTime(GAME_TICK_DT);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            RollbackLoopbackPeer& peer = peers[i];
+            if (peer.session->getCurrentTick() < targetTick)
+            {
+                peer.session->advanceTick(peer.registry, peer.players, getLoopbackPeerInput(peer, i));
+            }
+            else
+            {
+                peer.session->synchronize(peer.registry, peer.players);
+            }
+        }
+    }
+
+    if (!isDone())
+    {
+        std::printf("rollback loopback: peers didn't synchronize\n");
+        return false;
+    }
+
+    // the same inputs played without any rollbacks
+    const Replay& replay = peers[0].session->getReplay();
+    entt::registry replayed;
+    std::vector<Player> replayedPlayers(2);
+    randomSeed(replay.seed);
+    recreateGameWorld(replayed, replayedPlayers, replay.worldSize);
+    for (int tick = 0; tick < targetTick; ++tick)
+    {
+        replaySimulateTick(replayed, replayedPlayers, replay, tick);
+    }
+
+    const bool sameInputs = peers[0].session->getReplay().packedInputs == peers[1].session->getReplay().packedInputs;
+    const bool sameWorlds = isSameWorld(replayed, peers[0].registry) && isSameWorld(replayed, peers[1].registry);
+
+    if (verbose)
+    {
+        std::printf("rollback loopback: %d ticks, latency %.0f ms, packet loss %.0f%%\n", targetTick, latency * 1000.f, packetLossRate * 100.f);
+        printRollbackStats(0, *peers[0].session);
+        printRollbackStats(1, *peers[1].session);
+        std::printf("inputs %s, worlds %s\n", sameInputs ? "match" : "DIFFER", sameWorlds ? "match" : "DIFFER");
+    }
+
+    return sameInputs && sameWorlds;
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "net_transport.h"
+#include "replay.h"
+#include "world_snapshot.h"
+
+#include <array>
+
+// How far the local world may run ahead of the last known remote input before it waits
+constexpr int ROLLBACK_MAX_PREDICTION_TICKS = 8;
+
+struct RollbackStats
+{
+    int rollbacksCount = 0;
+    int resimulatedTicksCount = 0;
+    int maxRollbackTicks = 0;
+    int stalledTicksCount = 0;
+    // restore and re-simulation of the longest rollback
+    double maxRollbackMs = 0.0;
+    double totalSaveMs = 0.0;
+    int savesCount = 0;
+};
+
+// Two player rollback. Local input is used right away and remote input is predicted to repeat the last known one.
+// When real remote input comes and differs from the prediction, the world goes back to that tick and is simulated again.
+// Every packet carries all local inputs the remote hasn't confirmed yet, so lost packets need no resends
+class RollbackSession
+{
+public:
+    // The world must be already created from the seed, both peers must start with the same world and roundId
+    RollbackSession(NetTransport& transport, const entt::registry& registry, int localPlayerIndex, uint32_t roundId, const Replay& roundReplay,
+                    int inputDelayTicks);
+
+    // Receives remote input, rolls back if it was mispredicted and simulates the next tick.
+    // Returns false without simulating while the remote peer is ROLLBACK_MAX_PREDICTION_TICKS behind
+    bool advanceTick(entt::registry& registry, const std::vector<Player>& players, const ShipInput& localInput);
+
+    // Receives remote input and rolls back if needed without simulating a new tick, resends inputs the remote hasn't confirmed
+    void synchronize(entt::registry& registry, const std::vector<Player>& players);
+
+    // Sends local inputs the remote hasn't confirmed yet without touching the world,
+    // for a finished round that the remote may still be simulating
+    void flushLocalInputs();
+
+    int getCurrentTick() const;
+    // ticks before it were simulated with real input of both players and won't change anymore
+    int getConfirmedTick() const;
+    // inputs of all simulated ticks, the ones from getConfirmedTick on are predicted
+    const Replay& getReplay() const;
+    const RollbackStats& getStats() const;
+
+private:
+    void receiveAndRollback(entt::registry& registry, const std::vector<Player>& players);
+    void receiveRemoteInputs();
+    void simulateTick(entt::registry& registry, const std::vector<Player>& players);
+    void sendLocalInputs();
+    uint8_t getRemoteInputForTick(int tick) const;
+    WorldSnapshot& getSavedState(int tick);
+
+    NetTransport& m_transport;
+    int m_localPlayerIndex = 0;
+    int m_remotePlayerIndex = 1;
+    uint32_t m_roundId = 0;
+    int m_inputDelayTicks = 0;
+
+    Replay m_replay{};
+    int m_currentTick = 0;
+
+    // indexed by tick, local ones are ahead of the current tick by the input delay
+    std::vector<uint8_t> m_localInputs{};
+    std::vector<uint8_t> m_remoteInputs{};
+    // how many of our inputs the remote has received
+    int m_remoteAckedTicksCount = 0;
+
+    // the state before every tick that can still be rolled back to
+    std::array<WorldSnapshot, ROLLBACK_MAX_PREDICTION_TICKS + 2> m_savedStates{};
+
+    // the random generator is global, the session keeps its own state, so worlds of several sessions can run in one process
+    uint64_t m_randomState = 0;
+
+    RollbackStats m_stats{};
+    std::vector<uint8_t> m_packet{};
+};
+
+// Runs two sessions over a LoopbackNetwork with AI players, then lets them catch up with each other and checks
+// that both ended up with the same world as a plain replay of the confirmed inputs. Prints stats if verbose
+bool runRollbackLoopback(int ticksCount, float latency, float packetLossRate, bool verbose);
@@ -0,0 +1,157 @@
+﻿#include "ship_hit_mask.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float SHIP_HIT_MASK_HALF_SIZE = SHIP_HIT_MASK_SIZE / 2.f;
+
+// bits x0 to x1 of a row, both included, the parts outside the row are cut
+static uint64_t getRowSpanBits(int x0, int x1)
+{
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, SHIP_HIT_MASK_SIZE - 1);
+    if (x0 > x1)
+    {
+        return 0;
+    }
+
+    const int width = x1 - x0 + 1;
+    const uint64_t bits = width == SHIP_HIT_MASK_SIZE ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+    return bits << x0;
+}
+
+static ShipHitMask createShipHitMask(const uint8_t* rgbaPixels, const int width, const int height, const float shipSize, const float angle)
+{
+    // the texture points up and is drawn turned by angle + 90 like drawShipTexture does, the center of every unit of the mask
+    // is turned back into the texture
+    const float rad = degToRad(angle + 90.f);
+    const float cosAngle = std::cos(rad);
+    const float sinAngle = std::sin(rad);
+
+    ShipHitMask mask;
+    mask.minRow = SHIP_HIT_MASK_SIZE;
+    for (int y = 0; y < SHIP_HIT_MASK_SIZE; ++y)
+    {
+        for (int x = 0; x < SHIP_HIT_MASK_SIZE; ++x)
+        {
+            const Vec2 world{x + 0.5f - SHIP_HIT_MASK_HALF_SIZE, y + 0.5f - SHIP_HIT_MASK_HALF_SIZE};
+            const Vec2 local{world.x * cosAngle + world.y * sinAngle, -world.x * sinAngle + world.y * cosAngle};
+            const int pixelX = static_cast<int>(std::floor((local.x / shipSize + 0.5f) * width));
+            const int pixelY = static_cast<int>(std::floor((local.y / shipSize + 0.5f) * height));
+
+            if (pixelX >= 0 && pixelX < width && pixelY >= 0 && pixelY < height &&
+                rgbaPixels[(pixelY * width + pixelX) * 4 + 3] >= SHIP_HIT_MASK_ALPHA_THRESHOLD)
+            {
+                mask.rows[y] |= uint64_t{1} << x;
+                mask.minRow = std::min(mask.minRow, y);
+                mask.maxRow = y + 1;
+            }
+        }
+    }
+    mask.minRow = std::min(mask.minRow, mask.maxRow);
+
+    return mask;
+}
+
+ShipHitMasks createShipHitMasks(const uint8_t* rgbaPixels, const int width, const int height, const float shipSize)
+{
+    ShipHitMasks masks;
+    for (int i = 0; i < SHIP_HIT_MASK_ANGLES_COUNT; ++i)
+    {
+        masks.angles.push_back(createShipHitMask(rgbaPixels, width, height, shipSize, 360.f * i / SHIP_HIT_MASK_ANGLES_COUNT));
+    }
+    return masks;
+}
+
+const ShipHitMask& getShipHitMask(const ShipHitMasks& masks, const float angle)
+{
+    const int index = static_cast<int>(std::lround(floatWrap(angle, 360.f) / 360.f * SHIP_HIT_MASK_ANGLES_COUNT));
+    return masks.angles[index % SHIP_HIT_MASK_ANGLES_COUNT];
+}
+
+bool isShipHitMaskOverlap(const ShipHitMask& mask1, const Vec2 center1, const ShipHitMask& mask2, const Vec2 center2)
+{
+    // the second mask is moved onto the first one by whole units, rows are shifted by the columns
+    const int offsetX = static_cast<int>(std::lround(center2.x - center1.x));
+    const int offsetY = static_cast<int>(std::lround(center2.y - center1.y));
+    if (std::abs(offsetX) >= SHIP_HIT_MASK_SIZE)
+    {
+        return false;
+    }
+
+    const int minRow = std::max(mask1.minRow, mask2.minRow + offsetY);
+    const int maxRow = std::min(mask1.maxRow, mask2.maxRow + offsetY);
+    for (int y = minRow; y < maxRow; ++y)
+    {
+        const uint64_t row2 = mask2.rows[y - offsetY];
+        const uint64_t shifted = offsetX >= 0 ? row2 << offsetX : row2 >> -offsetX;
+        if ((mask1.rows[y] & shifted) != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isShipHitMaskHitByCircle(const ShipHitMask& mask, const Vec2 center, const Vec2 circleCenter, const float circleRadius)
+{
+    const Vec2 local = circleCenter - center + Vec2{SHIP_HIT_MASK_HALF_SIZE, SHIP_HIT_MASK_HALF_SIZE};
+    const int minRow = std::max(mask.minRow, static_cast<int>(std::floor(local.y - circleRadius)));
+    const int maxRow = std::min(mask.maxRow, static_cast<int>(std::floor(local.y + circleRadius)) + 1);
+
+    for (int y = minRow; y < maxRow; ++y)
+    {
+        // the widest part of the circle in the row is where it's closest to the center
+        const float rowDist = std::max(std::abs(local.y - (y + 0.5f)) - 0.5f, 0.f);
+        const float halfWidthSq = circleRadius * circleRadius - rowDist * rowDist;
+        if (halfWidthSq < 0.f)
+        {
+            continue;
+        }
+
+        const float halfWidth = std::sqrt(halfWidthSq);
+        const uint64_t span = getRowSpanBits(static_cast<int>(std::floor(local.x - halfWidth)), static_cast<int>(std::floor(local.x + halfWidth)));
+        if ((mask.rows[y] & span) != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isShipHitMaskHitBySegment(const ShipHitMask& mask, const Vec2 center, const Vec2 segmentP1, const Vec2 segmentP2)
+{
+    const Vec2 offset = Vec2{SHIP_HIT_MASK_HALF_SIZE, SHIP_HIT_MASK_HALF_SIZE} - center;
+    const Vec2 p1 = segmentP1 + offset;
+    const Vec2 p2 = segmentP2 + offset;
+    const Vec2 segment = p2 - p1;
+
+    const int minRow = std::max(mask.minRow, static_cast<int>(std::floor(std::min(p1.y, p2.y))));
+    const int maxRow = std::min(mask.maxRow, static_cast<int>(std::floor(std::max(p1.y, p2.y))) + 1);
+
+    for (int y = minRow; y < maxRow; ++y)
+    {
+        // the part of the segment inside the row
+        float t0 = 0.f;
+        float t1 = 1.f;
+        if (segment.y != 0.f)
+        {
+            const float rowStartT = (y - p1.y) / segment.y;
+            const float rowEndT = (y + 1 - p1.y) / segment.y;
+            t0 = std::max(std::min(rowStartT, rowEndT), 0.f);
+            t1 = std::min(std::max(rowStartT, rowEndT), 1.f);
+        }
+
+        const float x0 = p1.x + segment.x * t0;
+        const float x1 = p1.x + segment.x * t1;
+        const uint64_t span = getRowSpanBits(static_cast<int>(std::floor(std::min(x0, x1))), static_cast<int>(std::floor(std::max(x0, x1))));
+        if ((mask.rows[y] & span) != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include "game_math.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// bits in a row and rows of a mask, a bit is a world unit, enough for the diagonal of a rotated ship
+constexpr int SHIP_HIT_MASK_SIZE = 64;
+constexpr int SHIP_HIT_MASK_ANGLES_COUNT = 64;
+// pixels of the texture with less alpha are see-through
+constexpr uint8_t SHIP_HIT_MASK_ALPHA_THRESHOLD = 128;
+
+// The silhouette of a ship at one angle. Bit x of row y is the world unit at (x, y) - SHIP_HIT_MASK_SIZE / 2 from the ship center
+struct ShipHitMask
+{
+    std::array<uint64_t, SHIP_HIT_MASK_SIZE> rows{};
+    // rows outside [minRow, maxRow) are empty
+    int minRow = 0;
+    int maxRow = 0;
+};
+
+// Registry context variable, the ship texture alpha pre-rotated for SHIP_HIT_MASK_ANGLES_COUNT angles. The collision systems
+// test ships against it after their circles touch, worlds without it collide ships as circles
+struct ShipHitMasks
+{
+    std::vector<ShipHitMask> angles{};
+};
+
+// rgbaPixels of the texture pointing up, it's drawn as a square of shipSize turned like the ship is
+ShipHitMasks createShipHitMasks(const uint8_t* rgbaPixels, int width, int height, float shipSize);
+const ShipHitMask& getShipHitMask(const ShipHitMasks& masks, float angle);
+
+bool isShipHitMaskOverlap(const ShipHitMask& mask1, Vec2 center1, const ShipHitMask& mask2, Vec2 center2);
+bool isShipHitMaskHitByCircle(const ShipHitMask& mask, Vec2 center, Vec2 circleCenter, float circleRadius);
+bool isShipHitMaskHitBySegment(const ShipHitMask& mask, Vec2 center, Vec2 segmentP1, Vec2 segmentP2);
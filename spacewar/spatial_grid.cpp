@@ -0,0 +1,53 @@
+﻿#include "spatial_grid.h"
+
+#include <cmath>
+
+static int getCellIndex(const SpatialGrid& grid, const Vec2 position)
+{
+    const int cellX = std::clamp(static_cast<int>(position.x / grid.cellSize), 0, grid.cellsCountX - 1);
+    const int cellY = std::clamp(static_cast<int>(position.y / grid.cellSize), 0, grid.cellsCountY - 1);
+    return cellY * grid.cellsCountX + cellX;
+}
+
+void spatialGridStart(SpatialGrid& grid, const Vec2 worldSize, const float cellSize)
+{
+    grid.worldSize = worldSize;
+    grid.cellSize = cellSize;
+    grid.cellsCountX = std::max(1, static_cast<int>(std::ceil(worldSize.x / cellSize)));
+    grid.cellsCountY = std::max(1, static_cast<int>(std::ceil(worldSize.y / cellSize)));
+
+    grid.cellStarts.assign(grid.cellsCountX * grid.cellsCountY + 1, 0);
+    grid.unsortedEntries.clear();
+    grid.unsortedCells.clear();
+}
+
+void spatialGridAdd(SpatialGrid& grid, const entt::registry::entity_type entity, const Vec2 position, const float radius,
+                    const uint32_t filterBits)
+{
+    const int cell = getCellIndex(grid, position);
+    grid.unsortedEntries.push_back({entity, position, radius, filterBits});
+    grid.unsortedCells.push_back(cell);
+    ++grid.cellStarts[cell + 1];
+}
+
+void spatialGridFinish(SpatialGrid& grid)
+{
+    const int cellsCount = grid.cellsCountX * grid.cellsCountY;
+    for (int i = 1; i <= cellsCount; ++i)
+    {
+        grid.cellStarts[i] += grid.cellStarts[i - 1];
+    }
+
+    // filling a cell moves its start to the start of the next one, shifted back after
+    grid.entries.resize(grid.unsortedEntries.size());
+    for (size_t i = 0; i < grid.unsortedEntries.size(); ++i)
+    {
+        grid.entries[grid.cellStarts[grid.unsortedCells[i]]++] = grid.unsortedEntries[i];
+    }
+
+    for (int i = cellsCount; i > 0; --i)
+    {
+        grid.cellStarts[i] = grid.cellStarts[i - 1];
+    }
+    grid.cellStarts[0] = 0;
+}
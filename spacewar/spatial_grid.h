@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "game_math.h"
+#include "entt.hpp"
+
+#include <SFML/Graphics/Rect.hpp>
+#include <algorithm>
+#include <vector>
+
+// A uniform grid of entity positions over the world. Entities are added in any order and sorted into cells by counting
+// sort on spatialGridFinish, the arrays are reused so rebuilding every frame doesn't allocate once they stop growing
+struct SpatialGrid
+{
+    struct Entry
+    {
+        entt::registry::entity_type entity = entt::null;
+        Vec2 position{};
+        // of what's at the position, for the users that need it
+        float radius = 0.f;
+        // what the users filter entries by before looking at them closer, like the collision layers of colliders
+        uint32_t filterBits = 0;
+    };
+
+    Vec2 worldSize{};
+    float cellSize = 0.f;
+    int cellsCountX = 0;
+    int cellsCountY = 0;
+    // entries of cell i are [cellStarts[i], cellStarts[i + 1])
+    std::vector<int> cellStarts{};
+    std::vector<Entry> entries{};
+    // entities in the order they were added with their cells, the input of the sort
+    std::vector<Entry> unsortedEntries{};
+    std::vector<int> unsortedCells{};
+};
+
+void spatialGridStart(SpatialGrid& grid, Vec2 worldSize, float cellSize);
+// position must be wrapped into the world
+void spatialGridAdd(SpatialGrid& grid, entt::registry::entity_type entity, Vec2 position, float radius = 0.f, uint32_t filterBits = 0);
+void spatialGridFinish(SpatialGrid& grid);
+
+// Calls func(worldOffset, localRect) for every copy of the wrapped world that rect touches once grown by margin. localRect
+// is the part of the grown rect inside that copy, in world coordinates, things in it are seen at their position plus
+// worldOffset. A rect within the world only touches the copy with zero offset
+template <typename Func>
+void forEachWorldCopyInRect(const Vec2 worldSize, const sf::FloatRect& rect, const float margin, Func&& func)
+{
+    for (int copyY = -1; copyY <= 1; ++copyY)
+    {
+        for (int copyX = -1; copyX <= 1; ++copyX)
+        {
+            const Vec2 worldOffset{worldSize.x * copyX, worldSize.y * copyY};
+
+            const float left = std::max(rect.left - margin - worldOffset.x, 0.f);
+            const float top = std::max(rect.top - margin - worldOffset.y, 0.f);
+            const float right = std::min(rect.left + rect.width + margin - worldOffset.x, worldSize.x);
+            const float bottom = std::min(rect.top + rect.height + margin - worldOffset.y, worldSize.y);
+
+            if (left < right && top < bottom)
+            {
+                func(worldOffset, sf::FloatRect{left, top, right - left, bottom - top});
+            }
+        }
+    }
+}
+
+// Calls func(entry, position) for every entity seen in rect grown by margin, once per copy of the wrapped world it is
+// seen in, position is where it's seen. Only the cells under rect are visited
+template <typename Func>
+void spatialGridQueryWrapped(const SpatialGrid& grid, const sf::FloatRect& rect, const float margin, Func&& func)
+{
+    if (grid.entries.empty())
+    {
+        return;
+    }
+
+    forEachWorldCopyInRect(grid.worldSize, rect, margin, [&](const Vec2 worldOffset, const sf::FloatRect& localRect)
+    {
+        const int minX = std::clamp(static_cast<int>(localRect.left / grid.cellSize), 0, grid.cellsCountX - 1);
+        const int minY = std::clamp(static_cast<int>(localRect.top / grid.cellSize), 0, grid.cellsCountY - 1);
+        const int maxX = std::clamp(static_cast<int>((localRect.left + localRect.width) / grid.cellSize), 0, grid.cellsCountX - 1);
+        const int maxY = std::clamp(static_cast<int>((localRect.top + localRect.height) / grid.cellSize), 0, grid.cellsCountY - 1);
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const int rowStart = y * grid.cellsCountX;
+            for (int i = grid.cellStarts[rowStart + minX]; i < grid.cellStarts[rowStart + maxX + 1]; ++i)
+            {
+                const SpatialGrid::Entry& entry = grid.entries[i];
+                if (localRect.contains(entry.position))
+                {
+                    func(entry, entry.position + worldOffset);
+                }
+            }
+        }
+    });
+}
@@ -1,8 +1,30 @@
 ﻿#include <assert.h>
 
+#include "ai_agents.h"
+#include "ai_lookahead.h"
+#include "ai_mcts.h"
+#include "ai_policy.h"
+#include "ai_tournament.h"
+#include "camera.h"
+#include "game_client.h"
 #include "game_entities.h"
 #include "game_frame.h"
 #include "game_logic.h"
+#include "game_visual.h"
+#include "match_host.h"
+#include "replay.h"
+#include "rollback.h"
+#include "ship_hit_mask.h"
+#include "spatial_grid.h"
+#include "vec_env.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
 
 static void testFloatWrap()
 {
@@ -54,6 +76,122 @@ static void testIsCircleIntersectCircle()
     assert(isCircleIntersectCircle(Vec2{-5.f, -5.f}, 5.f, Vec2{0.0f, 0.f}, 3.f));
 }
 
+// the segment test as it was before it went without square roots, through the closest point of the line and isPointOnSegment
+static bool isSegmentIntersectCircleThroughPointOnSegment(const Vec2 segmentP1, const Vec2 segmentP2, const Vec2 circleCenter,
+                                                          const float circleRadius)
+{
+    if (isPointInsideCircle(segmentP1, circleCenter, circleRadius) || isPointInsideCircle(segmentP2, circleCenter, circleRadius))
+    {
+        return true;
+    }
+
+    const float dot = vec2Dot(circleCenter - segmentP1, segmentP2 - segmentP1) / vec2DistSq(segmentP1, segmentP2);
+    const Vec2 closest = segmentP1 + dot * (segmentP2 - segmentP1);
+    return isPointOnSegment(closest, segmentP1, segmentP2) && isPointInsideCircle(closest, circleCenter, circleRadius);
+}
+
+// the distance from the circle center to the segment in doubles, to leave out the cases that only rounding decides
+static double getSegmentDistanceForTest(const Vec2 segmentP1, const Vec2 segmentP2, const Vec2 point)
+{
+    const double segmentX = static_cast<double>(segmentP2.x) - segmentP1.x;
+    const double segmentY = static_cast<double>(segmentP2.y) - segmentP1.y;
+    const double toPointX = static_cast<double>(point.x) - segmentP1.x;
+    const double toPointY = static_cast<double>(point.y) - segmentP1.y;
+    const double lengthSq = segmentX * segmentX + segmentY * segmentY;
+    const double t = lengthSq > 0.0 ? std::clamp((toPointX * segmentX + toPointY * segmentY) / lengthSq, 0.0, 1.0) : 0.0;
+    return std::hypot(toPointX - segmentX * t, toPointY - segmentY * t);
+}
+
+static void testBatchedCircleTestsAgree()
+{
+    // every segment between points of a grid against every circle of a finer grid, also zero length ones
+    const float radii[] = {0.5f, 1.f, 1.7f, 3.f};
+    int checkedCount = 0;
+    for (int p1 = 0; p1 < 9; ++p1)
+    {
+        const Vec2 segmentP1{static_cast<float>(p1 % 3 * 2 - 2), static_cast<float>(p1 / 3 * 2 - 2)};
+        for (int p2 = 0; p2 < 25; ++p2)
+        {
+            const Vec2 segmentP2{static_cast<float>(p2 % 5 * 2 - 4), static_cast<float>(p2 / 5 * 2 - 4)};
+            for (int center = 0; center < 17 * 17; ++center)
+            {
+                const Vec2 circleCenter{(center % 17) * 0.75f - 6.f, (center / 17) * 0.75f - 6.f};
+                for (const float radius : radii)
+                {
+                    const double distance = getSegmentDistanceForTest(segmentP1, segmentP2, circleCenter);
+                    if (std::abs(distance - radius) < 0.001)
+                    {
+                        continue;
+                    }
+
+                    const bool isHit = distance < radius;
+                    assert(isSegmentIntersectCircle(segmentP1, segmentP2, circleCenter, radius) == isHit);
+                    assert(segmentP1 == segmentP2 || isSegmentIntersectCircleThroughPointOnSegment(segmentP1, segmentP2, circleCenter, radius) == isHit);
+                    ++checkedCount;
+                }
+            }
+        }
+    }
+    assert(checkedCount > 200000);
+
+    // the batches find the first circle the scalar tests find, for counts that aren't whole registers too
+    randomSeed(49);
+    std::vector<float> centersX;
+    std::vector<float> centersY;
+    std::vector<float> circleRadii;
+    for (int test = 0; test < 2000; ++test)
+    {
+        const int count = test % 13;
+        centersX.resize(count);
+        centersY.resize(count);
+        circleRadii.resize(count);
+        for (int i = 0; i < count; ++i)
+        {
+            centersX[i] = randomFloatRange(-50.f, 50.f);
+            centersY[i] = randomFloatRange(-50.f, 50.f);
+            circleRadii[i] = randomFloatRange(1.f, 20.f);
+        }
+
+        const Vec2 from{randomFloatRange(-60.f, 60.f), randomFloatRange(-60.f, 60.f)};
+        const Vec2 to = test % 7 == 0 ? from : Vec2{randomFloatRange(-60.f, 60.f), randomFloatRange(-60.f, 60.f)};
+        const float radius = randomFloatRange(0.f, 20.f);
+
+        int firstSegmentHit = -1;
+        int firstCircleHit = -1;
+        for (int i = count - 1; i >= 0; --i)
+        {
+            const Vec2 circleCenter{centersX[i], centersY[i]};
+            firstSegmentHit = isSegmentIntersectCircle(from, to, circleCenter, circleRadii[i]) ? i : firstSegmentHit;
+            firstCircleHit = isCircleIntersectCircle(from, radius, circleCenter, circleRadii[i]) ? i : firstCircleHit;
+        }
+
+        assert(findFirstCircleHitBySegment(from, to, centersX.data(), centersY.data(), circleRadii.data(), count) == firstSegmentHit);
+        assert(findFirstCircleHitByCircle(from, radius, centersX.data(), centersY.data(), circleRadii.data(), count) == firstCircleHit);
+    }
+}
+
+static void testIsSweptCircleIntersectCircle()
+{
+    float time = -1.f;
+
+    // head on, they pass through each other between the ends
+    assert(isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{10.f, 0.f}, 1.f, Vec2{10.f, 0.f}, Vec2{0.f, 0.f}, 1.f, &time));
+    assert(floatEq(time, 0.4f));
+    assert(!isCircleIntersectCircle(Vec2{10.f, 0.f}, 1.f, Vec2{0.f, 0.f}, 1.f));
+
+    // one standing, the other one stops short of it or flies by
+    assert(!isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{0.f, 0.f}, 1.f, Vec2{10.f, 0.f}, Vec2{2.5f, 0.f}, 1.f));
+    assert(isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{0.f, 0.f}, 1.f, Vec2{10.f, 0.f}, Vec2{1.f, 0.f}, 1.f, &time));
+    assert(floatEq(time, 8.f / 9.f));
+    assert(!isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{0.f, 0.f}, 1.f, Vec2{-10.f, 3.f}, Vec2{10.f, 3.f}, 1.f));
+    assert(isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{0.f, 0.f}, 1.f, Vec2{-10.f, 1.5f}, Vec2{10.f, 1.5f}, 1.f));
+
+    // moving together, or apart after touching at the start
+    assert(!isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{10.f, 0.f}, 1.f, Vec2{5.f, 0.f}, Vec2{15.f, 0.f}, 1.f));
+    assert(isSweptCircleIntersectCircle(Vec2{0.f, 0.f}, Vec2{-5.f, 0.f}, 1.f, Vec2{1.f, 0.f}, Vec2{6.f, 0.f}, 1.f, &time));
+    assert(time == 0.f);
+}
+
 static void testColorLerp()
 {
     const ColorRange range = ColorRange{sf::Color{255, 0, 0, 150}, sf::Color{255, 255, 0, 150}};
@@ -188,6 +326,1246 @@ static void testPlayerWinsGameWithKill()
     assert(!registry.valid(ship2));
 }
 
+static void testShipSpawnsForFullLobby()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    // the duel starts where it always did, so old replays still play back
+    assert(getShipSpawn(0, 2, worldSize).position == Vec2(250.f, 250.f) && getShipSpawn(0, 2, worldSize).rotation == 225.f);
+    assert(getShipSpawn(1, 2, worldSize).position == Vec2(750.f, 750.f) && getShipSpawn(1, 2, worldSize).rotation == 45.f);
+
+    for (int i = 0; i < MAX_PLAYERS_COUNT; ++i)
+    {
+        const Vec2 position = getShipSpawn(i, MAX_PLAYERS_COUNT, worldSize).position;
+        assert(position.x > 0.f && position.x < worldSize.x && position.y > 0.f && position.y < worldSize.y);
+
+        for (int j = 0; j < i; ++j)
+        {
+            // further apart than two ship colliders and the well's reach into the center
+            assert(vec2Length(getShipSpawn(j, MAX_PLAYERS_COUNT, worldSize).position - position) > 45.f);
+        }
+        assert(vec2Length(position - worldSize / 2.f) > 200.f);
+    }
+}
+
+static void testLastShipStandingWinsFreeForAll()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    constexpr int playersCount = 5;
+
+    entt::registry registry;
+    std::vector<Player> players(playersCount);
+    recreateGameWorld(registry, players, worldSize);
+    assert(registry.size<ShipComponent>() == playersCount);
+    assert(!tryGetGameResult(registry, playersCount).has_value());
+
+    for (int i = 0; i < playersCount - 1; ++i)
+    {
+        assert(!tryGetGameResult(registry, playersCount).has_value());
+        if (i != 3)
+        {
+            registry.destroy(players[i].shipEntity);
+        }
+    }
+    registry.destroy(players[4].shipEntity);
+
+    const std::optional<GameResult> result = tryGetGameResult(registry, playersCount);
+    assert(result.has_value() && result->victoriousPlayerIndex == 3);
+}
+
+// the largest relative change of the distance to the well over a few turns of a circular orbit around it
+static float getOrbitRadiusErrorForTest(const GravityIntegrator integrator, const float dt)
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    const Vec2 wellPos{500.f, 500.f};
+    const float radius = 60.f;
+
+    entt::registry registry;
+    registry.set<GravityIntegratorSettings>(GravityIntegratorSettings{integrator});
+
+    GravityWellComponent well;
+    well.maxRadius = vec2Length(wellPos);
+    well.maxPower = 1500.f;
+    const auto wellEntity = registry.create();
+    registry.emplace<PositionComponent>(wellEntity, wellPos);
+    registry.emplace<GravityWellComponent>(wellEntity, well);
+
+    const float speed = std::sqrt(gameGetGravityWellPowerAtRadius(well, radius) * radius);
+    const auto body = registry.create();
+    registry.emplace<PositionComponent>(body, wellPos + Vec2{radius, 0.f});
+    registry.emplace<VelocityComponent>(body, Vec2{0.f, speed});
+    registry.emplace<SusceptibleToGravityWellComponent>(body);
+
+    const float period = 2.f * PI * radius / speed;
+    float maxError = 0.f;
+    for (float time = 0.f; time < 3.f * period; time += dt)
+    {
+        gameLogicFrameUpdate(registry, dt, worldSize);
+        const float error = std::abs(vec2Dist(registry.get<PositionComponent>(body).vec, wellPos) - radius) / radius;
+        maxError = std::max(maxError, error);
+    }
+    return maxError;
+}
+
+static void testGravityIntegratorsKeepOrbitAtLowTickRate()
+{
+    // a server tick rate of 10 Hz, a tick is a sixth of the way around
+    const float dt = 0.1f;
+
+    const float eulerError = getOrbitRadiusErrorForTest(GravityIntegrator::Euler, dt);
+    const float semiImplicitError = getOrbitRadiusErrorForTest(GravityIntegrator::SemiImplicitEuler, dt);
+    const float verletError = getOrbitRadiusErrorForTest(GravityIntegrator::VelocityVerlet, dt);
+    assert(semiImplicitError < 0.04f && semiImplicitError < eulerError);
+    assert(verletError < 0.01f && verletError < semiImplicitError);
+
+    // only the steep part of the field is substepped
+    entt::registry registry;
+    const auto well = createGravityWellEntity(registry, Vec2{1000.f, 1000.f});
+    const Vec2 wellPos = registry.get<PositionComponent>(well).vec;
+    assert(getGravitySubstepsCount(registry, wellPos + Vec2{400.f, 0.f}, Vec2{0.f, 100.f}, GAME_TICK_DT) == 1);
+    assert(getGravitySubstepsCount(registry, wellPos + Vec2{20.f, 0.f}, Vec2{0.f, 300.f}, dt) > 1);
+}
+
+static void testShipInputPacking()
+{
+    ShipInput input;
+    input.rotate = -1.f;
+    input.thrustBurst = true;
+    input.shoot = true;
+
+    const ShipInput unpacked = unpackShipInput(packShipInput(input));
+    assert(unpacked.rotate == -1.f);
+    assert(!unpacked.thrust);
+    assert(unpacked.thrustBurst);
+    assert(unpacked.shoot);
+
+    assert(unpackShipInput(packShipInput(ShipInput{0.3f, true})).rotate == 1.f);
+    assert(packShipInput(ShipInput{}) == 0);
+}
+
+// processes started together run the tests at the same time, so each of them writes its own files
+static std::string getTempFilePathForTest(const std::string& extension)
+{
+    static const std::string processTag = []
+    {
+        std::random_device device;
+        return std::to_string((uint64_t{device()} << 32) | device());
+    }();
+    return (std::filesystem::temp_directory_path() / ("spacewar_test_" + processTag + extension)).string();
+}
+
+static void testReplaySaveLoad()
+{
+    Replay replay;
+    replay.seed = 0x0123456789abcdefull;
+    replay.worldSize = Vec2{800.f, 600.f};
+    replay.tickDt = GAME_TICK_DT;
+    replay.playersAi = {false, true};
+    replay.asteroidsCount = 5000;
+    replay.gravityIntegrator = GravityIntegrator::VelocityVerlet;
+    replay.isShipHitMasks = true;
+
+    for (int tick = 0; tick < 1000; ++tick)
+    {
+        replay.addInput(ShipInput{tick < 500 ? 1.f : 0.f, tick % 100 < 50});
+        replay.addInput(ShipInput{0.f, false, false, tick % 7 == 0});
+    }
+
+    const std::string filePath = getTempFilePathForTest(".swrp");
+    const bool isSaved = saveReplay(replay, filePath);
+    assert(isSaved);
+
+    Replay loaded;
+    const bool isLoaded = loadReplay(filePath, loaded);
+    assert(isLoaded);
+    std::filesystem::remove(filePath);
+
+    assert(loaded.seed == replay.seed);
+    assert(loaded.worldSize == replay.worldSize);
+    assert(loaded.tickDt == replay.tickDt);
+    assert(loaded.playersAi == replay.playersAi);
+    assert(loaded.asteroidsCount == replay.asteroidsCount);
+    assert(loaded.gravityIntegrator == replay.gravityIntegrator);
+    assert(loaded.isShipHitMasks == replay.isShipHitMasks);
+    assert(loaded.packedInputs == replay.packedInputs);
+    assert(loaded.getTicksCount() == 1000);
+}
+
+static void testReplayLoadRejectsDamagedHeader()
+{
+    Replay replay;
+    replay.worldSize = Vec2{800.f, 600.f};
+    replay.tickDt = GAME_TICK_DT;
+    replay.playersAi = {false, true};
+    replay.addInput(ShipInput{});
+    replay.addInput(ShipInput{});
+
+    const std::string filePath = getTempFilePathForTest(".swrp");
+    const auto saveAndLoad = [&filePath](const Replay& damaged)
+    {
+        Replay loaded;
+        const bool isSaved = saveReplay(damaged, filePath);
+        const bool isLoaded = loadReplay(filePath, loaded);
+        std::filesystem::remove(filePath);
+        assert(isSaved);
+        return isLoaded;
+    };
+    assert(saveAndLoad(replay));
+
+    Replay damaged = replay;
+    damaged.worldSize.x = 0.f;
+    assert(!saveAndLoad(damaged));
+    damaged = replay;
+    damaged.worldSize.y = std::nanf("");
+    assert(!saveAndLoad(damaged));
+    damaged = replay;
+    damaged.asteroidsCount = -1;
+    assert(!saveAndLoad(damaged));
+
+    // a ticks count of a single run that would unpack to gigabytes
+    const bool isSaved = saveReplay(replay, filePath);
+    assert(isSaved);
+    std::vector<char> bytes(std::filesystem::file_size(filePath));
+    std::ifstream{filePath, std::ios::binary}.read(bytes.data(), bytes.size());
+    const size_t ticksCountOffset = bytes.size() - 4 - 1 - replay.getPlayersCount();
+    const uint32_t ticksCount = 0xffffffff;
+    std::memcpy(bytes.data() + ticksCountOffset, &ticksCount, sizeof(ticksCount));
+    const uint8_t runLength[] = {0xff, 0xff, 0xff, 0xff, 0x0f};
+    bytes.erase(bytes.begin() + ticksCountOffset + sizeof(ticksCount), bytes.begin() + ticksCountOffset + sizeof(ticksCount) + 1);
+    bytes.insert(bytes.begin() + ticksCountOffset + sizeof(ticksCount), std::begin(runLength), std::end(runLength));
+    std::ofstream{filePath, std::ios::binary}.write(bytes.data(), bytes.size());
+
+    Replay loaded;
+    const bool isLoaded = loadReplay(filePath, loaded);
+    std::filesystem::remove(filePath);
+    assert(!isLoaded);
+}
+
+static void testReplayReproducesRound()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    const uint64_t seed = 42;
+    const int ticksCount = 600;
+
+    std::vector<Player> players(2);
+    players[0].isAi = true;
+    players[1].isAi = true;
+
+    entt::registry registry;
+    Replay replay = replayCreate(seed, worldSize, GAME_TICK_DT, players);
+
+    randomSeed(seed);
+    recreateGameWorld(registry, players, worldSize);
+    for (int tick = 0; tick < ticksCount; ++tick)
+    {
+        for (const Player& player : players)
+        {
+            replay.addInput(registry.valid(player.shipEntity) ? aiGenerateInput(registry, player.shipEntity) : ShipInput{});
+        }
+        replaySimulateTick(registry, players, replay, tick);
+    }
+
+    std::vector<Vec2> recordedPositions;
+    for (const Player& player : players)
+    {
+        recordedPositions.push_back(registry.valid(player.shipEntity) ? registry.get<PositionComponent>(player.shipEntity).vec : Vec2{});
+    }
+
+    randomSeed(replay.seed);
+    recreateGameWorld(registry, players, replay.worldSize);
+    for (int tick = 0; tick < replay.getTicksCount(); ++tick)
+    {
+        replaySimulateTick(registry, players, replay, tick);
+    }
+
+    for (size_t i = 0; i < players.size(); ++i)
+    {
+        const Vec2 pos = registry.valid(players[i].shipEntity) ? registry.get<PositionComponent>(players[i].shipEntity).vec : Vec2{};
+        assert(pos == recordedPositions[i]);
+    }
+}
+
+// a round of two AI players, recorded the way testReplayReproducesRound does
+static Replay recordAiRoundForTest(entt::registry& registry, std::vector<Player>& players, const int ticksCount)
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    players.assign(2, Player{});
+    players[0].isAi = true;
+    players[1].isAi = true;
+    Replay replay = replayCreate(42, worldSize, GAME_TICK_DT, players);
+
+    randomSeed(replay.seed);
+    recreateGameWorld(registry, players, worldSize);
+    for (int tick = 0; tick < ticksCount; ++tick)
+    {
+        for (const Player& player : players)
+        {
+            replay.addInput(registry.valid(player.shipEntity) ? aiGenerateInput(registry, player.shipEntity) : ShipInput{});
+        }
+        replaySimulateTick(registry, players, replay, tick);
+    }
+
+    return replay;
+}
+
+static bool isSameWorldForTest(const entt::registry& expected, const entt::registry& actual)
+{
+    if (expected.alive() != actual.alive() || expected.size<ParticleComponent>() != actual.size<ParticleComponent>())
+    {
+        return false;
+    }
+
+    for (auto [entity, pos] : expected.view<const PositionComponent>().each())
+    {
+        if (!actual.valid(entity) || !actual.has<PositionComponent>(entity) || actual.get<PositionComponent>(entity).vec != pos.vec)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testWorldSnapshotRestore()
+{
+    std::vector<Player> players;
+    entt::registry registry;
+    const Replay replay = recordAiRoundForTest(registry, players, 240);
+
+    // replay the first half, snapshot, replay the second half twice: before and after restoring the snapshot
+    entt::registry replayed;
+    randomSeed(replay.seed);
+    recreateGameWorld(replayed, players, replay.worldSize);
+    for (int tick = 0; tick < 120; ++tick)
+    {
+        replaySimulateTick(replayed, players, replay, tick);
+    }
+
+    const WorldSnapshot snapshot = worldSnapshotCapture(replayed);
+
+    for (int tick = 120; tick < 240; ++tick)
+    {
+        replaySimulateTick(replayed, players, replay, tick);
+    }
+    assert(isSameWorldForTest(registry, replayed));
+
+    worldSnapshotRestore(replayed, snapshot);
+    for (int tick = 120; tick < 240; ++tick)
+    {
+        replaySimulateTick(replayed, players, replay, tick);
+    }
+    assert(isSameWorldForTest(registry, replayed));
+}
+
+static void testWorldSnapshotFile()
+{
+    std::vector<Player> players;
+    entt::registry registry;
+    const Replay replay = recordAiRoundForTest(registry, players, 300);
+    // the world goes on with the integrator it was saved with
+    registry.set<GravityIntegratorSettings>(GravityIntegratorSettings{GravityIntegrator::VelocityVerlet});
+
+    const WorldSnapshot snapshot = worldSnapshotCapture(registry);
+    const std::string filePath = getTempFilePathForTest(".swsn");
+    const bool isSaved = worldSnapshotSave(snapshot, filePath);
+    assert(isSaved);
+
+    // a fresh registry has no projectile factories yet, ships must still be able to shoot after load
+    entt::registry loaded;
+    const bool isLoaded = worldSnapshotLoad(loaded, filePath);
+    assert(isLoaded);
+    std::filesystem::remove(filePath);
+    assert(isSameWorldForTest(registry, loaded));
+    assert(loaded.ctx<GravityIntegratorSettings>().integrator == GravityIntegrator::VelocityVerlet);
+
+    for (int tick = 0; tick < 300; ++tick)
+    {
+        gameFrameUpdate(registry, GAME_TICK_DT, replay.worldSize);
+    }
+    worldSnapshotRestore(loaded, snapshot);
+    for (int tick = 0; tick < 300; ++tick)
+    {
+        gameFrameUpdate(loaded, GAME_TICK_DT, replay.worldSize);
+    }
+    assert(isSameWorldForTest(registry, loaded));
+
+    // damaged data is rejected and the world is left as it was
+    WorldSnapshot damaged = snapshot;
+    damaged.bytes.resize(damaged.bytes.size() / 2);
+    assert(!worldSnapshotRestore(loaded, damaged.bytes.data(), damaged.bytes.size()));
+    assert(isSameWorldForTest(registry, loaded));
+}
+
+static void testReplaySeek()
+{
+    std::vector<Player> players;
+    entt::registry registry;
+    const Replay replay = recordAiRoundForTest(registry, players, 600);
+
+    entt::registry replayed;
+    ReplayKeyframes keyframes;
+    randomSeed(replay.seed);
+    recreateGameWorld(replayed, players, replay.worldSize);
+    replayTryCaptureKeyframe(keyframes, replayed, 0);
+
+    // forward past the captured keyframes, then back and forward again using them
+    assert(replaySeek(replayed, players, replay, keyframes, 600) == 600);
+    assert(static_cast<int>(keyframes.snapshots.size()) == 1 + 599 / REPLAY_KEYFRAME_INTERVAL_TICKS);
+    assert(isSameWorldForTest(registry, replayed));
+
+    assert(replaySeek(replayed, players, replay, keyframes, 250) == 250);
+    assert(replaySeek(replayed, players, replay, keyframes, 5000) == 600);
+    assert(isSameWorldForTest(registry, replayed));
+
+    // keyframes saved with the replay seek the same way, they can't be used with another replay
+    const std::string filePath = getTempFilePathForTest(".swkf");
+    const bool isSaved = saveReplayKeyframes(replay, keyframes, filePath);
+    assert(isSaved);
+
+    ReplayKeyframes loaded;
+    Replay otherReplay = replay;
+    ++otherReplay.seed;
+    const bool isOtherLoaded = loadReplayKeyframes(filePath, otherReplay, loaded);
+    const bool isLoaded = loadReplayKeyframes(filePath, replay, loaded);
+    std::filesystem::remove(filePath);
+    assert(!isOtherLoaded && isLoaded);
+    assert(loaded.snapshots.size() == keyframes.snapshots.size());
+
+    assert(replaySeek(replayed, players, replay, loaded, 0) == 0);
+    assert(replaySeek(replayed, players, replay, loaded, 600) == 600);
+    assert(loaded.snapshots.size() == keyframes.snapshots.size());
+    assert(isSameWorldForTest(registry, replayed));
+
+    // a replay saved without keyframes gets the same ones by simulating it
+    ReplayKeyframes captured = replayCaptureKeyframes(replay, players, nullptr);
+    assert(captured.snapshots.size() == keyframes.snapshots.size());
+    assert(replaySeek(replayed, players, replay, captured, 600) == 600);
+    assert(captured.snapshots.size() == keyframes.snapshots.size());
+    assert(isSameWorldForTest(registry, replayed));
+}
+
+static void testReplayCreateWorldAppliesShipHitMasks()
+{
+    constexpr int textureSize = 8;
+    const std::vector<uint8_t> pixels(textureSize * textureSize * 4, 255);
+    const ShipHitMasks masks = createShipHitMasks(pixels.data(), textureSize, textureSize, SHIP_SIZE);
+
+    std::vector<Player> players(2);
+    Replay replay = replayCreate(42, Vec2{1000.f, 1000.f}, GAME_TICK_DT, players);
+    entt::registry registry;
+
+    replay.isShipHitMasks = true;
+    replayCreateWorld(registry, players, replay, &masks);
+    assert(registry.try_ctx<ShipHitMasks>() != nullptr);
+
+    // the masks of the previous round stay in the context after the entities are cleared
+    replay.isShipHitMasks = false;
+    replayCreateWorld(registry, players, replay, &masks);
+    assert(registry.try_ctx<ShipHitMasks>() == nullptr);
+    const WorldSnapshot circlesSnapshot = worldSnapshotCapture(registry);
+
+    // snapshots don't carry the masks, a world that had them needs them in the registry it's restored to
+    replay.isShipHitMasks = true;
+    replayCreateWorld(registry, players, replay, &masks);
+    const WorldSnapshot masksSnapshot = worldSnapshotCapture(registry);
+
+    entt::registry restored;
+    assert(!worldSnapshotRestore(restored, masksSnapshot.bytes.data(), masksSnapshot.bytes.size()));
+    restored.set<ShipHitMasks>(masks);
+    assert(worldSnapshotRestore(restored, masksSnapshot.bytes.data(), masksSnapshot.bytes.size()));
+    assert(isSameWorldForTest(registry, restored));
+
+    worldSnapshotRestore(restored, circlesSnapshot);
+    assert(restored.try_ctx<ShipHitMasks>() == nullptr);
+}
+
+static void testRollbackOverLossyLoopback()
+{
+    assert(runRollbackLoopback(240, 0.1f, 0.2f, false));
+}
+
+static void testSnapshotPacket()
+{
+    entt::registry registry;
+    std::vector<Player> players;
+    recordAiRoundForTest(registry, players, 300);
+
+    NetSnapshot snapshot;
+    captureNetSnapshot(registry, snapshot);
+    snapshot.roundId = 3;
+    snapshot.tick = 300;
+    snapshot.ackedInputSeq = 290;
+    snapshot.scores = {1, 2};
+    assert(snapshot.entities.size() == registry.size<ShipComponent>() + registry.size<ProjectileComponent>());
+
+    const Vec2 worldSize{1000.f, 1000.f};
+    NetSnapshotEncoder encoder(worldSize);
+    NetSnapshotDecoder decoder;
+    decoder.reset(worldSize);
+    encoder.addSnapshot(snapshot);
+
+    std::vector<uint8_t> packet;
+    encoder.writePacket(packet, 290, 0);
+
+    NetSnapshot loaded;
+    assert(decoder.readPacket(packet, loaded));
+    assert(loaded.roundId == 3 && loaded.tick == 300 && loaded.ackedInputSeq == 290 && loaded.scores == snapshot.scores);
+    assert(loaded.entities.size() == snapshot.entities.size());
+    for (size_t i = 0; i < loaded.entities.size(); ++i)
+    {
+        assert(loaded.entities[i].netId == snapshot.entities[i].netId);
+        assert(vec2Length(loaded.entities[i].position - snapshot.entities[i].position) < 0.1f);
+        assert(std::abs(loaded.entities[i].rotation - snapshot.entities[i].rotation) < 0.1f);
+    }
+
+    // only the moved ship goes against the snapshot the client has
+    const size_t fullPacketSize = packet.size();
+    snapshot.tick = 302;
+    snapshot.entities[0].position.x += 10.f;
+    encoder.addSnapshot(snapshot);
+    encoder.writePacket(packet, 291, 300);
+    assert(packet.size() < fullPacketSize);
+    assert(decoder.readPacket(packet, loaded));
+    assert(loaded.tick == 302 && decoder.getLatestTick() == 302 && loaded.entities.size() == snapshot.entities.size());
+    assert(std::abs(loaded.entities[0].position.x - snapshot.entities[0].position.x) < 0.1f);
+
+    // a delta from a snapshot the decoder doesn't have can't be read
+    NetSnapshotDecoder otherDecoder;
+    otherDecoder.reset(worldSize);
+    assert(!otherDecoder.readPacket(packet, loaded));
+
+    packet.pop_back();
+    assert(!decoder.readPacket(packet, loaded));
+}
+
+static void testSnapshotCompression()
+{
+    assert(runSnapshotCompressionBench(120, false));
+}
+
+static void testThreadPoolRunsNestedJobs()
+{
+    ThreadPool pool(4);
+    std::atomic<int> doneJobsCount{0};
+
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.submit([&pool, &doneJobsCount]()
+        {
+            for (int j = 0; j < 10; ++j)
+            {
+                pool.submit([&doneJobsCount]()
+                {
+                    ++doneJobsCount;
+                });
+            }
+            ++doneJobsCount;
+        });
+    }
+
+    pool.waitIdle();
+    assert(doneJobsCount == 1100);
+    assert(pool.getStats().jobsCount == 1100);
+}
+
+static void testMatchHostTicksAllMatches()
+{
+    constexpr int matchesCount = 16;
+    MatchHost host(2);
+    for (int i = 0; i < matchesCount; ++i)
+    {
+        host.addMatch(Vec2{1000.f, 1000.f});
+    }
+
+    // the first match is due right away, the others later in the tick. runMatchHostBench ticks them all in real time
+    host.update();
+    host.waitIdle();
+
+    // a match is a job per due tick, not a thread
+    assert(host.getThreadsCount() == 2 && host.getPoolStats().jobsCount >= 1 && host.getStats().ticksCount >= 1);
+    for (int i = 0; i < matchesCount; ++i)
+    {
+        // matches without clients wait for them
+        assert(host.getIdleMatch(i).getTick() == 0);
+    }
+}
+
+static void testVecEnvIsDeterministicAcrossThreads()
+{
+    constexpr int envsCount = 4;
+    SpacewarVecEnv* env = spacewarVecEnvCreate(envsCount, 4, 3, 7);
+    SpacewarVecEnv* singleThreadEnv = spacewarVecEnvCreate(envsCount, 4, 1, 7);
+    assert(spacewarVecEnvGetCount(env) == envsCount);
+
+    std::vector<float> observations(envsCount * SPACEWAR_ENV_OBSERVATION_SIZE);
+    std::vector<float> singleThreadObservations(observations.size());
+    std::vector<int32_t> actions(envsCount);
+    std::vector<float> rewards(envsCount);
+    std::vector<uint8_t> dones(envsCount);
+
+    spacewarVecEnvReset(env, observations.data());
+    spacewarVecEnvReset(singleThreadEnv, singleThreadObservations.data());
+    assert(observations == singleThreadObservations);
+    // both ships are alive
+    assert(observations[0] == 1.f && observations[SPACEWAR_ENV_SHIP_OBSERVATION_SIZE] == 1.f);
+
+    // a few seconds of play, the runs split into jobs differently from the first step on
+    for (int step = 0; step < 64; ++step)
+    {
+        for (int i = 0; i < envsCount; ++i)
+        {
+            actions[i] = (step / 10 + i) % SPACEWAR_ENV_ACTIONS_COUNT;
+        }
+
+        spacewarVecEnvStep(env, actions.data(), observations.data(), rewards.data(), dones.data());
+        for (int i = 0; i < envsCount; ++i)
+        {
+            assert(dones[i] || rewards[i] == 0.f);
+        }
+
+        spacewarVecEnvStep(singleThreadEnv, actions.data(), singleThreadObservations.data(), rewards.data(), dones.data());
+        assert(observations == singleThreadObservations);
+    }
+
+    spacewarVecEnvDestroy(env);
+    spacewarVecEnvDestroy(singleThreadEnv);
+}
+
+static void testAiMatchReusesRegistry()
+{
+    entt::registry registry;
+    std::vector<Player> players;
+    const AiParams passiveParams{0.f, 0.f, 0.f, 0.f};
+
+    randomSeed(11);
+    const AiMatchResult result = playAiMatch(registry, players, AiParams{}, passiveParams, Vec2{1000.f, 1000.f}, 48);
+    // too short for a kill, it ends as a tie
+    assert(result.victoriousPlayerIndex == -1 && result.ticksCount == 48);
+    const Vec2 shipPosition = registry.get<PositionComponent>(players[0].shipEntity).vec;
+
+    // the second match recreates the world in the same registry and plays out the same way
+    randomSeed(11);
+    const AiMatchResult replayedResult = playAiMatch(registry, players, AiParams{}, passiveParams, Vec2{1000.f, 1000.f}, 48);
+    assert(replayedResult.victoriousPlayerIndex == result.victoriousPlayerIndex && replayedResult.ticksCount == result.ticksCount);
+    assert(registry.get<PositionComponent>(players[0].shipEntity).vec == shipPosition);
+
+    assert(std::abs(aiTournamentExpectedScore(1500.f, 1500.f) - 0.5f) < 1e-6f);
+    assert(aiTournamentExpectedScore(1900.f, 1500.f) > 0.9f);
+}
+
+static void testAiTournamentIsDeterministicAcrossThreads()
+{
+    AiTournamentSettings settings;
+    settings.generationsCount = 1;
+    settings.populationSize = 4;
+    settings.evaluationMatchesPerSide = 2;
+    settings.maxMatchTicks = 48;
+    settings.seed = 5;
+
+    settings.threadsCount = 3;
+    AiTournamentStats stats;
+    const std::vector<AiTournamentEntry> population = runAiTournament(settings, stats, false);
+
+    settings.threadsCount = 1;
+    AiTournamentStats singleThreadStats;
+    const std::vector<AiTournamentEntry> singleThreadPopulation = runAiTournament(settings, singleThreadStats, false);
+
+    // a round robin of 4 on both sides for every generation, then the evaluation
+    assert(stats.matchesCount == 12 + 4);
+    assert(stats.ticksCount == singleThreadStats.ticksCount);
+    assert(population.size() == singleThreadPopulation.size());
+    for (size_t i = 0; i < population.size(); ++i)
+    {
+        assert(population[i].rating == singleThreadPopulation[i].rating);
+        assert(population[i].params.shootAngle == singleThreadPopulation[i].params.shootAngle);
+        assert(population[i].winsCount == singleThreadPopulation[i].winsCount);
+    }
+    assert(population.front().rating >= population.back().rating);
+}
+
+static void testLookaheadIntegratorMatchesGameSystems()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    entt::registry registry;
+    std::vector<Player> players(2);
+    recreateGameWorld(registry, players, worldSize);
+
+    const entt::registry::entity_type ship = players[0].shipEntity;
+    ShipInput input;
+    input.rotate = 1.f;
+    input.thrust = true;
+    applyShipInput(registry, ship, input);
+
+    // every lane flies the same ship, each register must give the same result
+    AiTrajectoryBatch batch;
+    const Vec2 direction = vec2AngleToDir(registry.get<RotationComponent>(ship).angle);
+    const float turn = degToRad(registry.get<RotateByInputComponent>(ship).rotationSpeed * GAME_TICK_DT);
+    for (int i = 0; i < AI_LOOKAHEAD_CANDIDATES_COUNT; ++i)
+    {
+        batch.positionX[i] = registry.get<PositionComponent>(ship).vec.x;
+        batch.positionY[i] = registry.get<PositionComponent>(ship).vec.y;
+        batch.directionX[i] = direction.x;
+        batch.directionY[i] = direction.y;
+        batch.acceleration[i] = registry.get<AccelerateByInputComponent>(ship).acceleration;
+        batch.turnCos[i] = std::cos(turn);
+        batch.turnSin[i] = std::sin(turn);
+    }
+
+    AiLookaheadWell well;
+    for (auto [entity, wellComponent, position] : registry.view<const GravityWellComponent, const PositionComponent>().each())
+    {
+        well = AiLookaheadWell{position.vec, wellComponent};
+    }
+
+    for (int tick = 0; tick < 120; ++tick)
+    {
+        gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+        aiIntegrateTrajectories(batch, &well, 1, AI_LOOKAHEAD_CANDIDATES_COUNT, worldSize, GAME_TICK_DT);
+    }
+
+    const Vec2 position = registry.get<PositionComponent>(ship).vec;
+    const Vec2 velocity = registry.get<VelocityComponent>(ship).vec;
+    for (int i = 0; i < AI_LOOKAHEAD_CANDIDATES_COUNT; ++i)
+    {
+        assert(vec2Length(vec2WrappedDiff(position, Vec2{batch.positionX[i], batch.positionY[i]}, worldSize)) < 0.1f);
+        assert(vec2Length(velocity - Vec2{batch.velocityX[i], batch.velocityY[i]}) < 0.1f);
+    }
+}
+
+static void testLookaheadAiKillsPassiveShip()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    entt::registry registry;
+    std::vector<Player> players(2);
+    randomSeed(3);
+    recreateGameWorld(registry, players, worldSize);
+
+    std::optional<GameResult> result;
+    for (int tick = 0; tick < 60 * 60 && !result.has_value(); ++tick)
+    {
+        const entt::registry::entity_type ship = players[0].shipEntity;
+        applyShipInput(registry, ship, aiGenerateLookaheadInput(registry, ship, worldSize));
+        gameLogicFrameUpdate(registry, GAME_TICK_DT, worldSize);
+        result = tryGetGameResult(registry, 2);
+    }
+
+    assert(result.has_value() && result->victoriousPlayerIndex == 0);
+}
+
+static void testMctsTreeShootsEnemyAhead()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    entt::registry registry;
+    std::vector<Player> players(2);
+    recreateGameWorld(registry, players, worldSize);
+
+    // the enemy looks away and needs a second to turn around, a shot now is there sooner
+    registry.get<PositionComponent>(players[0].shipEntity).vec = Vec2{300.f, 200.f};
+    registry.get<RotationComponent>(players[0].shipEntity).angle = 0.f;
+    registry.get<PositionComponent>(players[1].shipEntity).vec = Vec2{480.f, 200.f};
+    registry.get<RotationComponent>(players[1].shipEntity).angle = 0.f;
+
+    AiMctsState state;
+    assert(aiMctsCaptureState(registry, players[0].shipEntity, worldSize, state));
+
+    AiMctsTree tree{1};
+    tree.reset(state);
+    tree.runIterations(3000);
+    assert(aiMctsGetActionInput(tree.getBestAction()).shoot);
+
+    // the first iteration only rolls out from the root
+    uint32_t rootVisitsCount = 0;
+    for (int action = 0; action < AI_MCTS_ACTIONS_COUNT; ++action)
+    {
+        rootVisitsCount += tree.getRootVisits(action);
+    }
+    assert(rootVisitsCount == 3000 - 1);
+}
+
+static void testMctsSearcherPublishesWithoutBlocking()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    entt::registry registry;
+    std::vector<Player> players(2);
+    recreateGameWorld(registry, players, worldSize);
+
+    AiMctsState state;
+    assert(aiMctsCaptureState(registry, players[0].shipEntity, worldSize, state));
+
+    // neither call waits for the workers, whether they started searching or not. The destructor stops a running search.
+    // runAiMctsBench checks that the searches run
+    AiMctsSearcher searcher{2, 2.f};
+    searcher.publishState(state);
+    searcher.getBestInput();
+    searcher.publishState(state);
+    searcher.getBestInput();
+    assert(searcher.getThreadsCount() == 2);
+}
+
+static void testAiShipGridPrefersThreats()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    const Vec2 selfPos{500.f, 500.f};
+    const Vec2 nearPos{600.f, 500.f};
+    const Vec2 threatPos{500.f, 320.f};
+
+    entt::registry registry;
+    const auto self = createShipEntity(registry, selfPos, 0.f, sf::Color::White, 0);
+    const auto nearShip = createShipEntity(registry, nearPos, vec2DirToAngle(nearPos - selfPos), sf::Color::White, 1);
+    const auto threatShip = createShipEntity(registry, threatPos, vec2DirToAngle(selfPos - threatPos), sf::Color::White, 2);
+    createShipEntity(registry, Vec2{950.f, 950.f}, 0.f, sf::Color::White, 3);
+
+    AiShipGrid grid;
+    aiShipGridRebuild(grid, registry, worldSize);
+    assert(aiShipGridFindTarget(grid, self, selfPos, 2000.f) == threatShip);
+    assert(aiShipGridFindTarget(grid, self, selfPos, 50.f) == entt::null);
+
+    // looking away it's just the farther one
+    registry.get<RotationComponent>(threatShip).angle = vec2DirToAngle(threatPos - selfPos);
+    aiShipGridRebuild(grid, registry, worldSize);
+    assert(aiShipGridFindTarget(grid, self, selfPos, 2000.f) == nearShip);
+}
+
+static void testAiAgentsStaggerDecisions()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+    constexpr int shipsCount = 4 * AI_AGENT_DECISION_PERIOD_TICKS;
+
+    entt::registry registry;
+    for (int i = 0; i < shipsCount; ++i)
+    {
+        createShipEntity(registry, Vec2{50.f + 60.f * i, 100.f + 40.f * i}, 10.f * i, sf::Color::White, i);
+    }
+    attachAiAgents(registry);
+
+    for (int tick = 1; tick <= AI_AGENT_DECISION_PERIOD_TICKS; ++tick)
+    {
+        aiAgentsSystem(registry, worldSize);
+
+        int decidedCount = 0;
+        for (auto [entity, agent] : registry.view<const AiAgentComponent>().each())
+        {
+            decidedCount += registry.valid(agent.target) ? 1 : 0;
+            // agents that didn't decide yet still apply their input
+            assert(registry.get<RotateByInputComponent>(entity).input == agent.input.rotate);
+        }
+        assert(decidedCount == tick * shipsCount / AI_AGENT_DECISION_PERIOD_TICKS);
+    }
+}
+
+static void testAiPolicyMatchesScalarForwardPass()
+{
+    // sizes that aren't whole registers
+    const AiPolicy policy = createRandomAiPolicy(37, 2, 5);
+    assert(isAiPolicyValid(policy));
+
+    // a block of eight ships and a block of four of the kernels, then single ships
+    constexpr int shipsCount = 13;
+    randomSeed(11);
+    std::vector<float> observations(shipsCount * SPACEWAR_ENV_OBSERVATION_SIZE);
+    for (float& value : observations)
+    {
+        value = randomFloatRange(-1.f, 1.f);
+    }
+
+    AiPolicyNetwork network{policy};
+    std::vector<int32_t> actions(shipsCount);
+    network.evaluate(observations.data(), shipsCount, actions.data());
+
+    for (int ship = 0; ship < shipsCount; ++ship)
+    {
+        std::vector<float> values(observations.begin() + ship * SPACEWAR_ENV_OBSERVATION_SIZE,
+                                  observations.begin() + (ship + 1) * SPACEWAR_ENV_OBSERVATION_SIZE);
+        for (size_t layerIndex = 0; layerIndex < policy.layers.size(); ++layerIndex)
+        {
+            const AiPolicyLayer& layer = policy.layers[layerIndex];
+            std::vector<float> outputs(layer.biases);
+            for (int output = 0; output < layer.outputsCount; ++output)
+            {
+                for (int input = 0; input < layer.inputsCount; ++input)
+                {
+                    outputs[output] += layer.weights[output * layer.inputsCount + input] * values[input];
+                }
+                if (layerIndex + 1 < policy.layers.size())
+                {
+                    outputs[output] = std::max(outputs[output], 0.f);
+                }
+            }
+            values = std::move(outputs);
+        }
+
+        for (int action = 0; action < SPACEWAR_ENV_ACTIONS_COUNT; ++action)
+        {
+            assert(std::abs(network.getOutputs(ship)[action] - values[action]) < 1e-4f);
+        }
+        assert(actions[ship] == std::max_element(values.begin(), values.end()) - values.begin());
+    }
+
+    // the AVX2 kernels add in the same order as the SSE ones, both pick the same actions on any CPU
+    AiPolicyNetwork sseNetwork{policy, false};
+    std::vector<int32_t> sseActions(shipsCount);
+    sseNetwork.evaluate(observations.data(), shipsCount, sseActions.data());
+    assert(!sseNetwork.isAvx2() && sseActions == actions);
+    for (int ship = 0; ship < shipsCount; ++ship)
+    {
+        assert(std::memcmp(sseNetwork.getOutputs(ship), network.getOutputs(ship), SPACEWAR_ENV_ACTIONS_COUNT * sizeof(float)) == 0);
+    }
+}
+
+static void testAiPolicySaveLoad()
+{
+    const AiPolicy policy = createRandomAiPolicy(16, 1, 3);
+    const std::string filePath = getTempFilePathForTest(".swnn");
+    const bool isSaved = saveAiPolicy(policy, filePath);
+    assert(isSaved);
+
+    AiPolicy loaded;
+    const bool isLoaded = loadAiPolicy(filePath, loaded);
+    assert(isLoaded);
+    assert(loaded.layers.size() == policy.layers.size());
+    for (size_t i = 0; i < policy.layers.size(); ++i)
+    {
+        assert(loaded.layers[i].weights == policy.layers[i].weights);
+        assert(loaded.layers[i].biases == policy.layers[i].biases);
+    }
+
+    // a cut off file is rejected
+    std::filesystem::resize_file(filePath, std::filesystem::file_size(filePath) - 4);
+    const bool isCutOffLoaded = loadAiPolicy(filePath, loaded);
+    assert(!isCutOffLoaded);
+    std::filesystem::remove(filePath);
+
+    // a policy for other observations can't be saved
+    AiPolicy invalid = policy;
+    invalid.layers.front().inputsCount = 10;
+    const bool isInvalidSaved = saveAiPolicy(invalid, filePath);
+    assert(!isInvalidSaved);
+}
+
+static void testServerOverLossyLoopback()
+{
+    assert(runServerLoopback(300, 0.05f, 0.1f, false));
+}
+
+static void testSpatialGridQueriesWrappedCopies()
+{
+    const Vec2 worldSize{4000.f, 4000.f};
+
+    entt::registry registry;
+    const auto nearLeftEdge = registry.create();
+    const auto nearRightEdge = registry.create();
+    const auto farAway = registry.create();
+
+    SpatialGrid grid;
+    spatialGridStart(grid, worldSize, 250.f);
+    spatialGridAdd(grid, nearLeftEdge, Vec2{20.f, 2050.f});
+    spatialGridAdd(grid, nearRightEdge, Vec2{3990.f, 2000.f});
+    spatialGridAdd(grid, farAway, Vec2{2000.f, 2000.f});
+    spatialGridFinish(grid);
+
+    struct Seen
+    {
+        entt::registry::entity_type entity = entt::null;
+        Vec2 position{};
+    };
+    std::vector<Seen> seen;
+    const auto query = [&](const sf::FloatRect& rect, const float margin)
+    {
+        seen.clear();
+        spatialGridQueryWrapped(grid, rect, margin, [&](const SpatialGrid::Entry& entry, const Vec2 position)
+        {
+            seen.push_back({entry.entity, position});
+        });
+    };
+
+    // across the right edge the left one is seen past it
+    query(sf::FloatRect{3900.f, 1900.f, 300.f, 300.f}, 0.f);
+    assert(seen.size() == 2);
+    for (const Seen& s : seen)
+    {
+        assert(s.entity != farAway);
+        assert(s.entity != nearLeftEdge || s.position == Vec2(4020.f, 2050.f));
+        assert(s.entity != nearRightEdge || s.position == Vec2(3990.f, 2000.f));
+    }
+
+    // the margin lets in what's just out of the rect
+    query(sf::FloatRect{2010.f, 2010.f, 300.f, 300.f}, 0.f);
+    assert(seen.empty());
+    query(sf::FloatRect{2010.f, 2010.f, 300.f, 300.f}, 20.f);
+    assert(seen.size() == 1 && seen[0].entity == farAway);
+
+    // a view of the whole world sees everything once, and what's at the edges a second time around them
+    query(sf::FloatRect{0.f, 0.f, 4000.f, 4000.f}, 50.f);
+    assert(seen.size() == 5);
+}
+
+static void testCameraFollowsShipsAroundWorldEdge()
+{
+    const Vec2 viewportSize{1000.f, 1000.f};
+
+    entt::registry registry;
+    createShipEntity(registry, Vec2{100.f, 2000.f}, 0.f, sf::Color::White, 0);
+    createShipEntity(registry, Vec2{3900.f, 2200.f}, 0.f, sf::Color::White, 1);
+
+    // the ships are close over the edge, the camera is there at the closest zoom
+    Camera camera;
+    cameraUpdate(camera, registry, Vec2{4000.f, 4000.f}, viewportSize, GAME_TICK_DT);
+    assert(floatEq(camera.zoom, CAMERA_MIN_ZOOM));
+    assert(floatEq(vec2Length(vec2WrappedDiff(camera.center, Vec2{0.f, 2100.f}, Vec2{4000.f, 4000.f})), 0.f, 0.01f));
+    const sf::FloatRect bounds = cameraGetBounds(camera, viewportSize);
+    assert(floatEq(bounds.width, 1000.f) && floatEq(bounds.height, 1000.f));
+
+    // zoomed out by the wheel it moves there smoothly
+    cameraZoomByWheel(camera, -10.f);
+    cameraUpdate(camera, registry, Vec2{4000.f, 4000.f}, viewportSize, GAME_TICK_DT);
+    const float firstZoom = camera.zoom;
+    assert(firstZoom > CAMERA_MIN_ZOOM);
+    for (int i = 0; i < 600; ++i)
+    {
+        cameraUpdate(camera, registry, Vec2{4000.f, 4000.f}, viewportSize, GAME_TICK_DT);
+    }
+    assert(camera.zoom > firstZoom && camera.zoom <= 4.f);
+
+    // a world the size of the window is shown whole and still as it always was
+    Camera smallWorldCamera;
+    cameraUpdate(smallWorldCamera, registry, viewportSize, viewportSize, GAME_TICK_DT);
+    assert(floatEq(smallWorldCamera.zoom, 1.f));
+    assert(smallWorldCamera.center == viewportSize / 2.f);
+}
+
+static void testLargeWorldWrapsAndCollides()
+{
+    const Vec2 worldSize{16000.f, 16000.f};
+
+    entt::registry registry;
+    const auto crossingShip = createShipEntity(registry, Vec2{15995.f, 300.f}, 0.f, sf::Color::White, 0);
+    registry.get<VelocityComponent>(crossingShip).vec = Vec2{600.f, 0.f};
+    createShipEntity(registry, Vec2{15000.f, 15000.f}, 0.f, sf::Color::White, 1);
+    createShipEntity(registry, Vec2{15010.f, 15000.f}, 180.f, sf::Color::White, 2);
+
+    gameFrameUpdate(registry, GAME_TICK_DT, worldSize);
+
+    assert(registry.valid(crossingShip) && registry.has<ShipComponent>(crossingShip));
+    const Vec2 crossedPos = registry.get<PositionComponent>(crossingShip).vec;
+    assert(crossedPos.x >= 0.f && crossedPos.x < 100.f);
+    assert(registry.size<ShipComponent>() == 1);
+}
+
+static void testCollisionGridMatchesAllPairs()
+{
+    entt::registry registry;
+    randomSeed(7);
+
+    std::vector<entt::registry::entity_type> colliders;
+    for (int i = 0; i < 400; ++i)
+    {
+        const auto entity = registry.create();
+        registry.emplace<PositionComponent>(entity, Vec2{randomFloatRange(0.f, 1500.f), randomFloatRange(-200.f, 900.f)});
+        registry.emplace<CircleColliderComponent>(entity, randomFloatRange(2.f, 30.f));
+        colliders.push_back(entity);
+    }
+
+    circleVsCircleCollisionSystem(registry, GAME_TICK_DT);
+
+    for (const auto a : colliders)
+    {
+        bool isColliding = false;
+        for (const auto b : colliders)
+        {
+            isColliding = isColliding || (a != b && isCircleIntersectCircle(registry.get<PositionComponent>(a).vec, registry.get<CircleColliderComponent>(a).radius,
+                                                                            registry.get<PositionComponent>(b).vec, registry.get<CircleColliderComponent>(b).radius));
+        }
+        assert(registry.has<CollisionHappenedOneshotComponent>(a) == isColliding);
+    }
+
+    // a projectile finds the collider its move goes through among all of them
+    registry.clear<CollisionHappenedOneshotComponent>();
+    const auto target = colliders[123];
+    const Vec2 targetPos = registry.get<PositionComponent>(target).vec;
+    const auto projectile = registry.create();
+    registry.emplace<ProjectileComponent>(projectile);
+    registry.emplace<PositionComponent>(projectile, targetPos - Vec2{0.f, 40.f});
+    registry.emplace<VelocityComponent>(projectile, Vec2{0.f, 80.f / GAME_TICK_DT});
+
+    projectileMoveSystem(registry, GAME_TICK_DT);
+    assert(registry.has<CollisionHappenedOneshotComponent>(projectile));
+    assert(registry.size<CollisionHappenedOneshotComponent>() == 2);
+}
+
+static void testCollisionLayersRejectPairs()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    // ships of a team that can't ram each other
+    entt::registry registry;
+    const auto teammate = createShipEntity(registry, Vec2{200.f, 200.f}, 0.f, sf::Color::White, 0);
+    const auto otherTeammate = createShipEntity(registry, Vec2{210.f, 200.f}, 0.f, sf::Color::White, 1);
+    registry.get<CircleColliderComponent>(teammate).mask &= ~COLLISION_LAYER_SHIP;
+    registry.get<CircleColliderComponent>(otherTeammate).mask &= ~COLLISION_LAYER_SHIP;
+
+    circleVsCircleCollisionSystem(registry, GAME_TICK_DT);
+    assert(registry.size<CollisionHappenedOneshotComponent>() == 0);
+
+    // a ship flies into its fresh shot and through it
+    registry.clear();
+    const auto shooter = createShipEntity(registry, Vec2{500.f, 500.f}, 0.f, sf::Color::White, 0);
+    registry.get<ShootingComponent>(shooter).input = true;
+    shootingSystem(registry, GAME_TICK_DT);
+    registry.get<ShootingComponent>(shooter).input = false;
+
+    const auto shot = *registry.view<const ProjectileComponent>().begin();
+    assert(registry.get<ProjectileCollisionComponent>(shot).owner == shooter);
+    const Vec2 shotDir = vec2AngleToDir(registry.get<RotationComponent>(shooter).angle);
+    registry.get<VelocityComponent>(shooter).vec = shotDir * 600.f;
+
+    for (int tick = 0; tick < 10; ++tick)
+    {
+        gameFrameUpdate(registry, GAME_TICK_DT, worldSize);
+    }
+    assert(registry.valid(shooter) && registry.valid(shot));
+    assert(vec2Dot(registry.get<PositionComponent>(shooter).vec - registry.get<PositionComponent>(shot).vec, shotDir) > 0.f);
+
+    // once the shot is old the ship doesn't pass through it
+    registry.get<VelocityComponent>(shooter).vec = Vec2{};
+    const auto oldShot = createProjectileEntity(registry);
+    registry.get<ProjectileCollisionComponent>(oldShot).owner = shooter;
+    registry.emplace<PositionComponent>(oldShot, registry.get<PositionComponent>(shooter).vec - shotDir * 30.f);
+    registry.emplace<RotationComponent>(oldShot, 0.f);
+    registry.emplace<VelocityComponent>(oldShot, shotDir * (60.f / GAME_TICK_DT));
+
+    gameFrameUpdate(registry, GAME_TICK_DT, worldSize);
+    assert(!registry.valid(shooter) && !registry.valid(oldShot));
+}
+
+static void testFastShipsDontPassThroughEachOther()
+{
+    // a server tick rate of 10 Hz, the ships move more than their size in a tick
+    const float dt = 0.1f;
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    entt::registry registry;
+    const auto left = createShipEntity(registry, Vec2{400.f, 500.f}, 0.f, sf::Color::White, 0);
+    const auto right = createShipEntity(registry, Vec2{460.f, 500.f}, 180.f, sf::Color::White, 1);
+    const auto passing = createShipEntity(registry, Vec2{400.f, 800.f}, 0.f, sf::Color::White, 2);
+    const auto passed = createShipEntity(registry, Vec2{460.f, 840.f}, 180.f, sf::Color::White, 3);
+    registry.get<VelocityComponent>(left).vec = Vec2{600.f, 0.f};
+    registry.get<VelocityComponent>(right).vec = Vec2{-600.f, 0.f};
+    registry.get<VelocityComponent>(passing).vec = Vec2{600.f, 0.f};
+    registry.get<VelocityComponent>(passed).vec = Vec2{-600.f, 0.f};
+
+    gameFrameUpdate(registry, dt, worldSize);
+
+    assert(!registry.valid(left) && !registry.valid(right));
+    assert(registry.valid(passing) && registry.valid(passed));
+}
+
+static void testShipHitMasksAfterCircleHit()
+{
+    // a triangle texture pointing up, drawn pointing along the ship angle
+    constexpr int textureSize = 32;
+    std::vector<uint8_t> pixels(textureSize * textureSize * 4, 0);
+    for (int y = 0; y < textureSize; ++y)
+    {
+        for (int x = 0; x < textureSize; ++x)
+        {
+            if (std::abs(x + 0.5f - textureSize / 2.f) * 2.f <= y + 0.5f)
+            {
+                pixels[(y * textureSize + x) * 4 + 3] = 255;
+            }
+        }
+    }
+    const ShipHitMasks masks = createShipHitMasks(pixels.data(), textureSize, textureSize, SHIP_SIZE);
+
+    // the nose is hit at every angle, the circle next to it only hits the ship's circle
+    for (float angle = 0.f; angle < 360.f; angle += 45.f)
+    {
+        const ShipHitMask& mask = getShipHitMask(masks, angle);
+        const Vec2 dir = vec2AngleToDir(angle);
+        assert(isShipHitMaskHitByCircle(mask, Vec2{}, dir * 15.f, 1.f));
+        assert(!isShipHitMaskHitByCircle(mask, Vec2{}, dir * 13.f + Vec2{-dir.y, dir.x} * 8.f, 1.f));
+    }
+
+    // noses past each other, the circles touch and the triangles don't
+    entt::registry registry;
+    const auto left = createShipEntity(registry, Vec2{500.f, 500.f}, 0.f, sf::Color::White, 0);
+    const auto right = createShipEntity(registry, Vec2{525.f, 510.f}, 180.f, sf::Color::White, 1);
+    assert(isShipHitMaskOverlap(getShipHitMask(masks, 0.f), Vec2{500.f, 500.f}, getShipHitMask(masks, 180.f), Vec2{525.f, 500.f}));
+    assert(!isShipHitMaskOverlap(getShipHitMask(masks, 0.f), Vec2{500.f, 500.f}, getShipHitMask(masks, 180.f), Vec2{525.f, 510.f}));
+
+    circleVsCircleCollisionSystem(registry, GAME_TICK_DT);
+    assert(registry.size<CollisionHappenedOneshotComponent>() == 2);
+
+    registry.clear<CollisionHappenedOneshotComponent>();
+    registry.set<ShipHitMasks>(masks);
+    circleVsCircleCollisionSystem(registry, GAME_TICK_DT);
+    assert(registry.size<CollisionHappenedOneshotComponent>() == 0);
+
+    // a shot by the side of the nose goes into the circle and misses the ship, a bit lower it hits
+    const auto shootDown = [&registry](const Vec2 from, const float length)
+    {
+        const auto projectile = createProjectileEntity(registry);
+        registry.emplace<PositionComponent>(projectile, from);
+        registry.emplace<RotationComponent>(projectile, 90.f);
+        registry.emplace<VelocityComponent>(projectile, Vec2{0.f, length / GAME_TICK_DT});
+        return projectile;
+    };
+    registry.destroy(right);
+    const auto missed = shootDown(Vec2{508.f, 470.f}, 22.f);
+    projectileMoveSystem(registry, GAME_TICK_DT);
+    assert(!registry.has<CollisionHappenedOneshotComponent>(missed) && !registry.has<CollisionHappenedOneshotComponent>(left));
+    registry.destroy(missed);
+
+    const auto hit = shootDown(Vec2{508.f, 470.f}, 27.f);
+    projectileMoveSystem(registry, GAME_TICK_DT);
+    assert(registry.has<CollisionHappenedOneshotComponent>(hit) && registry.has<CollisionHappenedOneshotComponent>(left));
+}
+
+static void testAsteroidsSplitOnHit()
+{
+    const Vec2 worldSize{1000.f, 1000.f};
+
+    entt::registry registry;
+    const auto big = createAsteroidEntity(registry, Vec2{200.f, 200.f}, Vec2{}, 32.f);
+    // asteroids pass through each other
+    createAsteroidEntity(registry, Vec2{700.f, 700.f}, Vec2{}, 20.f);
+    createAsteroidEntity(registry, Vec2{710.f, 700.f}, Vec2{}, 20.f);
+    const auto smallest = createAsteroidEntity(registry, Vec2{200.f, 700.f}, Vec2{}, ASTEROID_MIN_RADIUS);
+
+    const auto shootAt = [&registry](const Vec2 pos)
+    {
+        const auto projectile = createProjectileEntity(registry);
+        registry.emplace<PositionComponent>(projectile, pos - Vec2{50.f, 0.f});
+        registry.emplace<RotationComponent>(projectile, 0.f);
+        registry.emplace<VelocityComponent>(projectile, Vec2{50.f / GAME_TICK_DT, 0.f});
+    };
+    shootAt(Vec2{200.f, 200.f});
+    shootAt(Vec2{200.f, 700.f});
+
+    gameFrameUpdate(registry, GAME_TICK_DT, worldSize);
+
+    assert(!registry.valid(big) && !registry.valid(smallest));
+    assert(registry.size<ProjectileComponent>() == 0);
+
+    std::vector<entt::registry::entity_type> pieces;
+    for (auto [entity, pos, collider] : registry.view<const AsteroidComponent, const PositionComponent, const CircleColliderComponent>().each())
+    {
+        if (vec2Dist(pos.vec, Vec2{200.f, 200.f}) < 100.f)
+        {
+            assert(floatEq(collider.radius, 32.f * ASTEROID_PIECE_RADIUS_FACTOR));
+            pieces.push_back(entity);
+        }
+    }
+    assert(pieces.size() == ASTEROID_PIECES_COUNT);
+    assert(registry.size<AsteroidComponent>() == ASTEROID_PIECES_COUNT + 2);
+
+    // the pieces fly apart without breaking each other
+    for (int tick = 0; tick < 60; ++tick)
+    {
+        gameFrameUpdate(registry, GAME_TICK_DT, worldSize);
+    }
+    assert(registry.size<AsteroidComponent>() == ASTEROID_PIECES_COUNT + 2);
+}
+
 void runTests()
 {
     // math tests
@@ -196,6 +1574,8 @@ void runTests()
     testIsPointOnSegment();
     testIsSegmentIntersectCircle();
     testIsCircleIntersectCircle();
+    testIsSweptCircleIntersectCircle();
+    testBatchedCircleTestsAgree();
     testColorLerp();
 
     // game simulation tests
@@ -203,4 +1583,62 @@ void runTests()
     testShipsKillEachOtherWithProjectiles();
     testShipShipCollisionKillsBoth();
     testPlayerWinsGameWithKill();
+    testShipSpawnsForFullLobby();
+    testLastShipStandingWinsFreeForAll();
+    testGravityIntegratorsKeepOrbitAtLowTickRate();
+
+    // replay tests
+    testShipInputPacking();
+    testReplaySaveLoad();
+    testReplayLoadRejectsDamagedHeader();
+    testReplayReproducesRound();
+    testWorldSnapshotRestore();
+    testWorldSnapshotFile();
+    testReplaySeek();
+    testReplayCreateWorldAppliesShipHitMasks();
+
+    // netcode tests
+    testRollbackOverLossyLoopback();
+    testSnapshotPacket();
+    testSnapshotCompression();
+
+    // server hosting tests
+    testThreadPoolRunsNestedJobs();
+    testMatchHostTicksAllMatches();
+    testServerOverLossyLoopback();
+
+    // training environment tests
+    testVecEnvIsDeterministicAcrossThreads();
+    testAiMatchReusesRegistry();
+    testAiTournamentIsDeterministicAcrossThreads();
+
+    // lookahead ai tests
+    testLookaheadIntegratorMatchesGameSystems();
+    testLookaheadAiKillsPassiveShip();
+
+    // mcts ai tests
+    testMctsTreeShootsEnemyAhead();
+    testMctsSearcherPublishesWithoutBlocking();
+
+    // ai agents tests
+    testAiShipGridPrefersThreats();
+    testAiAgentsStaggerDecisions();
+
+    // policy ai tests
+    testAiPolicyMatchesScalarForwardPass();
+    testAiPolicySaveLoad();
+
+    // large world tests
+    testSpatialGridQueriesWrappedCopies();
+    testCameraFollowsShipsAroundWorldEdge();
+    testLargeWorldWrapsAndCollides();
+
+    // asteroid field tests
+    testCollisionGridMatchesAllPairs();
+    testCollisionLayersRejectPairs();
+    testFastShipsDontPassThroughEachOther();
+    testAsteroidsSplitOnHit();
+
+    // ship hit mask tests
+    testShipHitMasksAfterCircleHit();
 }
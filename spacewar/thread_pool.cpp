@@ -0,0 +1,170 @@
+﻿#include "thread_pool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+// lets submit() from a job go to the queue of the worker running it
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+ThreadPool::ThreadPool(const int threadsCount)
+{
+    const int workersCount = threadsCount > 0 ? threadsCount : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    for (int i = 0; i < workersCount; ++i)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    // the queues must all be there before any worker looks for a job to steal
+    for (int i = 0; i < workersCount; ++i)
+    {
+        m_workers[i]->thread = std::thread{[this, i]()
+        {
+            workerLoop(i);
+        }};
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock{m_mutex};
+        m_isStopping = true;
+    }
+    m_jobsCondition.notify_all();
+
+    for (const std::unique_ptr<Worker>& worker : m_workers)
+    {
+        worker->thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    const int queueIndex = currentPool == this
+                               ? currentWorkerIndex
+                               : static_cast<int>(m_nextQueueIndex++ % static_cast<unsigned>(m_workers.size()));
+
+    ++m_unfinishedJobsCount;
+    {
+        Worker& worker = *m_workers[queueIndex];
+        const std::lock_guard<std::mutex> lock{worker.mutex};
+
+        if (worker.jobsCount == worker.jobs.size())
+        {
+            std::vector<std::function<void()>> jobs(std::max<size_t>(16, worker.jobs.size() * 2));
+            for (size_t i = 0; i < worker.jobsCount; ++i)
+            {
+                jobs[i] = std::move(worker.jobs[(worker.firstJobIndex + i) % worker.jobs.size()]);
+            }
+            worker.jobs = std::move(jobs);
+            worker.firstJobIndex = 0;
+        }
+
+        worker.jobs[(worker.firstJobIndex + worker.jobsCount) % worker.jobs.size()] = std::move(job);
+        ++worker.jobsCount;
+    }
+    {
+        // under the mutex, so a worker that has just found nothing can't miss it before it starts waiting
+        const std::lock_guard<std::mutex> lock{m_mutex};
+        ++m_queuedJobsCount;
+    }
+    m_jobsCondition.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idleCondition.wait(lock, [this]()
+    {
+        return m_unfinishedJobsCount == 0;
+    });
+}
+
+int ThreadPool::getThreadsCount() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+ThreadPoolStats ThreadPool::getStats() const
+{
+    ThreadPoolStats stats;
+    stats.jobsCount = m_jobsCount;
+    stats.stolenJobsCount = m_stolenJobsCount;
+    stats.busyNs = m_busyNs;
+    return stats;
+}
+
+void ThreadPool::workerLoop(const int workerIndex)
+{
+    currentPool = this;
+    currentWorkerIndex = workerIndex;
+    profilerSetThreadName("worker " + std::to_string(workerIndex));
+
+    std::function<void()> job;
+    while (true)
+    {
+        if (!tryTakeJob(workerIndex, job))
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_jobsCondition.wait(lock, [this]()
+            {
+                return m_queuedJobsCount > 0 || m_isStopping;
+            });
+
+            // jobs submitted before the pool is destroyed still run
+            if (m_isStopping && m_queuedJobsCount == 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        job();
+        job = nullptr;
+        m_busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ++m_jobsCount;
+
+        if (--m_unfinishedJobsCount == 0)
+        {
+            const std::lock_guard<std::mutex> lock{m_mutex};
+            m_idleCondition.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::tryTakeJob(const int workerIndex, std::function<void()>& outJob)
+{
+    const int workersCount = static_cast<int>(m_workers.size());
+
+    for (int i = 0; i < workersCount; ++i)
+    {
+        Worker& worker = *m_workers[(workerIndex + i) % workersCount];
+        const std::lock_guard<std::mutex> lock{worker.mutex};
+        if (worker.jobsCount == 0)
+        {
+            continue;
+        }
+
+        const size_t jobIndex = i == 0 ? worker.firstJobIndex : (worker.firstJobIndex + worker.jobsCount - 1) % worker.jobs.size();
+        outJob = std::move(worker.jobs[jobIndex]);
+        worker.jobs[jobIndex] = nullptr;
+        --worker.jobsCount;
+
+        if (i == 0)
+        {
+            worker.firstJobIndex = (worker.firstJobIndex + 1) % worker.jobs.size();
+        }
+        else
+        {
+            ++m_stolenJobsCount;
+        }
+        --m_queuedJobsCount;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolStats
+{
+    int64_t jobsCount = 0;
+    // jobs a worker took from the queue of another one
+    int64_t stolenJobsCount = 0;
+    // sum over all workers of the time spent in jobs
+    int64_t busyNs = 0;
+};
+
+// Work stealing pool. Every worker has its own queue and takes its jobs in order, so under load no job waits much longer
+// than the others. A worker with an empty queue takes the newest job of somebody else's queue, the one that would wait
+// the longest there. Jobs submitted from outside the pool are spread over the queues in turns, jobs submitted by a job
+// go to the queue of its worker
+class ThreadPool
+{
+public:
+    // threadsCount 0 means one worker per core
+    explicit ThreadPool(int threadsCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> job);
+    // blocks until all submitted jobs are done, including the ones submitted by jobs
+    void waitIdle();
+    // splits [0, itemsCount) into a range per worker, runs body(begin, end) for all of them and waits.
+    // Can't be called from a job, it waits for the whole pool
+    template <typename Body>
+    void parallelFor(int itemsCount, const Body& body);
+
+    int getThreadsCount() const;
+    ThreadPoolStats getStats() const;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex{};
+        // ring buffer that only grows, so submitting doesn't allocate once the pool is warmed up
+        std::vector<std::function<void()>> jobs{};
+        size_t firstJobIndex = 0;
+        size_t jobsCount = 0;
+        std::thread thread{};
+    };
+
+    void workerLoop(int workerIndex);
+    bool tryTakeJob(int workerIndex, std::function<void()>& outJob);
+
+    std::vector<std::unique_ptr<Worker>> m_workers{};
+
+    std::mutex m_mutex{};
+    std::condition_variable m_jobsCondition{};
+    std::condition_variable m_idleCondition{};
+    // jobs in the queues
+    std::atomic<int> m_queuedJobsCount{0};
+    // jobs submitted and not finished yet
+    std::atomic<int> m_unfinishedJobsCount{0};
+    std::atomic<bool> m_isStopping{false};
+    std::atomic<unsigned> m_nextQueueIndex{0};
+
+    std::atomic<int64_t> m_jobsCount{0};
+    std::atomic<int64_t> m_stolenJobsCount{0};
+    std::atomic<int64_t> m_busyNs{0};
+};
+
+template <typename Body>
+void ThreadPool::parallelFor(const int itemsCount, const Body& body)
+{
+    const int rangesCount = std::min(itemsCount, getThreadsCount());
+
+    for (int i = 0; i < rangesCount; ++i)
+    {
+        const int begin = itemsCount * i / rangesCount;
+        const int end = itemsCount * (i + 1) / rangesCount;
+        // small enough for the function's own storage, a parallel loop doesn't allocate
+        submit([&body, begin, end]()
+        {
+            body(begin, end);
+        });
+    }
+
+    waitIdle();
+}
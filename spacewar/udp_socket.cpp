@@ -0,0 +1,171 @@
+﻿#include "udp_socket.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+using SocketLength = int;
+
+// Winsock has to be started before the first socket call, it stays started until the process exits
+static bool startSockets()
+{
+    static const bool isStarted = []
+    {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return isStarted;
+}
+
+UdpSocket::UdpSocket()
+{
+    if (!startSockets())
+    {
+        return;
+    }
+
+    const SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    m_handle = static_cast<uintptr_t>(handle);
+    u_long isNonBlocking = 1;
+    m_isOpen = ioctlsocket(handle, FIONBIO, &isNonBlocking) == 0;
+}
+
+UdpSocket::~UdpSocket()
+{
+    if (m_handle != 0)
+    {
+        closesocket(static_cast<SOCKET>(m_handle));
+    }
+}
+
+#else
+
+using SocketLength = socklen_t;
+
+static bool startSockets()
+{
+    return true;
+}
+
+UdpSocket::UdpSocket()
+{
+    const int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0)
+    {
+        return;
+    }
+
+    m_handle = handle;
+    m_isOpen = fcntl(handle, F_SETFL, fcntl(handle, F_GETFL) | O_NONBLOCK) == 0;
+}
+
+UdpSocket::~UdpSocket()
+{
+    if (m_handle >= 0)
+    {
+        close(m_handle);
+    }
+}
+
+#endif
+
+static sockaddr_in toSocketAddress(const UdpAddress& address)
+{
+    sockaddr_in result{};
+    result.sin_family = AF_INET;
+    result.sin_port = htons(address.port);
+    result.sin_addr.s_addr = htonl(address.ip);
+    return result;
+}
+
+bool udpResolveAddress(const std::string& host, const uint16_t port, UdpAddress& outAddress)
+{
+    if (!startSockets())
+    {
+        return false;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &results) != 0 || results == nullptr)
+    {
+        return false;
+    }
+
+    sockaddr_in resolved{};
+    std::memcpy(&resolved, results->ai_addr, sizeof(resolved));
+    freeaddrinfo(results);
+
+    outAddress.ip = ntohl(resolved.sin_addr.s_addr);
+    outAddress.port = port;
+    return true;
+}
+
+std::string udpAddressToString(const UdpAddress& address)
+{
+    return std::to_string((address.ip >> 24) & 0xff) + "." + std::to_string((address.ip >> 16) & 0xff) + "." +
+        std::to_string((address.ip >> 8) & 0xff) + "." + std::to_string(address.ip & 0xff);
+}
+
+bool UdpSocket::bind(const uint16_t localPort)
+{
+    const sockaddr_in address = toSocketAddress(UdpAddress{INADDR_ANY, localPort});
+    return m_isOpen && ::bind(m_handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+}
+
+void UdpSocket::send(const uint8_t* data, const size_t size, const UdpAddress& address)
+{
+    if (!m_isOpen)
+    {
+        return;
+    }
+
+    const sockaddr_in socketAddress = toSocketAddress(address);
+    sendto(m_handle, reinterpret_cast<const char*>(data), static_cast<int>(size), 0, reinterpret_cast<const sockaddr*>(&socketAddress),
+           sizeof(socketAddress));
+}
+
+bool UdpSocket::receive(uint8_t* buffer, const size_t bufferSize, size_t& outSize, UdpAddress& outSender)
+{
+    if (!m_isOpen)
+    {
+        return false;
+    }
+
+    sockaddr_in sender{};
+    SocketLength senderSize = sizeof(sender);
+    const auto receivedSize = recvfrom(m_handle, reinterpret_cast<char*>(buffer), static_cast<int>(bufferSize), 0,
+                                       reinterpret_cast<sockaddr*>(&sender), &senderSize);
+    // nothing waiting and errors of earlier sends, such as an unreachable peer, are told the same way
+    if (receivedSize < 0)
+    {
+        return false;
+    }
+
+    outSize = static_cast<size_t>(receivedSize);
+    outSender.ip = ntohl(sender.sin_addr.s_addr);
+    outSender.port = ntohs(sender.sin_port);
+    return true;
+}
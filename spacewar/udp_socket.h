@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// largest payload of an IPv4 UDP datagram
+constexpr size_t UDP_MAX_DATAGRAM_SIZE = 65507;
+// binding to it lets the system pick a free port
+constexpr uint16_t UDP_ANY_PORT = 0;
+
+// IPv4 address and port, both in host byte order
+struct UdpAddress
+{
+    uint32_t ip = 0;
+    uint16_t port = 0;
+
+    bool operator==(const UdpAddress& other) const
+    {
+        return ip == other.ip && port == other.port;
+    }
+};
+
+// A dotted address or a host name, false if it can't be resolved to an IPv4 address
+bool udpResolveAddress(const std::string& host, uint16_t port, UdpAddress& outAddress);
+std::string udpAddressToString(const UdpAddress& address);
+
+// Non-blocking IPv4 UDP socket on the system socket API (Winsock on Windows)
+class UdpSocket
+{
+public:
+    UdpSocket();
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    bool bind(uint16_t localPort);
+
+    // a datagram that doesn't fit into the send buffer is lost like any other
+    void send(const uint8_t* data, size_t size, const UdpAddress& address);
+    // false if no datagram is waiting
+    bool receive(uint8_t* buffer, size_t bufferSize, size_t& outSize, UdpAddress& outSender);
+
+private:
+#ifdef _WIN32
+    uintptr_t m_handle = 0;
+#else
+    int m_handle = -1;
+#endif
+    bool m_isOpen = false;
+};
@@ -0,0 +1,38 @@
+﻿#include "udp_transport.h"
+
+UdpTransport::UdpTransport(const unsigned short localPort, const std::string& remoteAddress, const unsigned short remotePort)
+{
+    m_isBound = m_socket.bind(localPort);
+    m_isResolved = udpResolveAddress(remoteAddress, remotePort, m_remoteAddress);
+}
+
+bool UdpTransport::isValid() const
+{
+    return m_isBound && m_isResolved;
+}
+
+void UdpTransport::send(const std::vector<uint8_t>& packet)
+{
+    // the socket is non-blocking, a packet that doesn't fit into the send buffer is lost like any other
+    m_socket.send(packet.data(), packet.size(), m_remoteAddress);
+}
+
+bool UdpTransport::receive(std::vector<uint8_t>& outPacket)
+{
+    while (true)
+    {
+        std::size_t receivedSize = 0;
+        UdpAddress sender;
+
+        if (!m_socket.receive(m_receiveBuffer.data(), m_receiveBuffer.size(), receivedSize, sender))
+        {
+            return false;
+        }
+
+        if (sender == m_remoteAddress)
+        {
+            outPacket.assign(m_receiveBuffer.begin(), m_receiveBuffer.begin() + receivedSize);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "net_transport.h"
+#include "udp_socket.h"
+
+#include <string>
+
+// NetTransport over a non-blocking UDP socket, packets from anyone except the remote peer are dropped
+class UdpTransport : public NetTransport
+{
+public:
+    UdpTransport(unsigned short localPort, const std::string& remoteAddress, unsigned short remotePort);
+
+    bool isValid() const;
+
+    void send(const std::vector<uint8_t>& packet) override;
+    bool receive(std::vector<uint8_t>& outPacket) override;
+
+private:
+    UdpSocket m_socket{};
+    UdpAddress m_remoteAddress{};
+    bool m_isBound = false;
+    bool m_isResolved = false;
+    std::vector<uint8_t> m_receiveBuffer = std::vector<uint8_t>(UDP_MAX_DATAGRAM_SIZE);
+};
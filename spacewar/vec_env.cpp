@@ -0,0 +1,205 @@
+﻿#include "vec_env.h"
+#include "ai_policy.h"
+#include "game_entities.h"
+#include "game_frame.h"
+#include "player.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+constexpr int VEC_ENV_PLAYERS_COUNT = 2;
+
+struct VecEnvMatch
+{
+    entt::registry registry{};
+    std::vector<Player> players{};
+    uint64_t randomState = 0;
+    int episodeTicks = 0;
+};
+
+struct SpacewarVecEnv
+{
+    Vec2 worldSize{};
+    int ticksPerStep = 1;
+    std::vector<VecEnvMatch> matches{};
+    ThreadPool pool;
+
+    explicit SpacewarVecEnv(const int threadsCount) : pool(threadsCount)
+    {
+    }
+};
+
+static void resetMatch(VecEnvMatch& match, const Vec2 worldSize)
+{
+    randomSetState(match.randomState);
+    recreateGameWorld(match.registry, match.players, worldSize);
+    match.randomState = randomGetState();
+    match.episodeTicks = 0;
+}
+
+static void writeObservation(float* out, const VecEnvMatch& match, const Vec2 worldSize)
+{
+    aiPolicyWriteObservation(out, match.registry, match.players[0].shipEntity, match.players[1].shipEntity, worldSize);
+}
+
+// returns true if the episode is over
+static bool stepMatch(VecEnvMatch& match, const ShipInput& agentInput, const SpacewarVecEnv& env, float& outReward)
+{
+    outReward = 0.f;
+    randomSetState(match.randomState);
+
+    bool isDone = false;
+    for (int tick = 0; tick < env.ticksPerStep && !isDone; ++tick)
+    {
+        entt::registry& registry = match.registry;
+        const entt::registry::entity_type agentShip = match.players[0].shipEntity;
+        const entt::registry::entity_type aiShip = match.players[1].shipEntity;
+        if (registry.valid(agentShip))
+        {
+            applyShipInput(registry, agentShip, agentInput);
+        }
+        if (registry.valid(aiShip))
+        {
+            applyShipInput(registry, aiShip, aiGenerateInput(registry, aiShip));
+        }
+
+        gameLogicFrameUpdate(registry, GAME_TICK_DT, env.worldSize);
+        ++match.episodeTicks;
+
+        const std::optional<GameResult> result = tryGetGameResult(registry, VEC_ENV_PLAYERS_COUNT);
+        if (result.has_value())
+        {
+            outReward = result->isTie() ? 0.f : result->victoriousPlayerIndex == 0 ? 1.f : -1.f;
+            isDone = true;
+        }
+        isDone = isDone || match.episodeTicks >= SPACEWAR_ENV_MAX_EPISODE_TICKS;
+    }
+
+    match.randomState = randomGetState();
+    return isDone;
+}
+
+SpacewarVecEnv* spacewarVecEnvCreate(const int envsCount, const int ticksPerStep, const int threadsCount, const uint64_t seed)
+{
+    SpacewarVecEnv* env = new SpacewarVecEnv(threadsCount);
+    // same world as in the default window
+    env->worldSize = Vec2{1000.f, 1000.f};
+    env->ticksPerStep = std::max(1, ticksPerStep);
+    env->matches.resize(std::max(0, envsCount));
+
+    const uint64_t callerRandomState = randomGetState();
+    for (size_t i = 0; i < env->matches.size(); ++i)
+    {
+        VecEnvMatch& match = env->matches[i];
+        match.players.resize(VEC_ENV_PLAYERS_COUNT);
+        randomSeed(seed + i);
+        match.randomState = randomGetState();
+        resetMatch(match, env->worldSize);
+    }
+    randomSetState(callerRandomState);
+
+    return env;
+}
+
+void spacewarVecEnvDestroy(SpacewarVecEnv* env)
+{
+    delete env;
+}
+
+int spacewarVecEnvGetCount(const SpacewarVecEnv* env)
+{
+    return static_cast<int>(env->matches.size());
+}
+
+void spacewarVecEnvReset(SpacewarVecEnv* env, float* outObservations)
+{
+    env->pool.parallelFor(spacewarVecEnvGetCount(env), [env, outObservations](const int begin, const int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            resetMatch(env->matches[i], env->worldSize);
+            writeObservation(outObservations + i * SPACEWAR_ENV_OBSERVATION_SIZE, env->matches[i], env->worldSize);
+        }
+    });
+}
+
+void spacewarVecEnvStep(SpacewarVecEnv* env, const int32_t* actions, float* outObservations, float* outRewards, uint8_t* outDones)
+{
+    env->pool.parallelFor(spacewarVecEnvGetCount(env), [env, actions, outObservations, outRewards, outDones](const int begin, const int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            VecEnvMatch& match = env->matches[i];
+            const bool isDone = stepMatch(match, aiPolicyGetActionInput(actions[i]), *env, outRewards[i]);
+            if (isDone)
+            {
+                resetMatch(match, env->worldSize);
+            }
+
+            outDones[i] = isDone ? 1 : 0;
+            writeObservation(outObservations + i * SPACEWAR_ENV_OBSERVATION_SIZE, match, env->worldSize);
+        }
+    });
+}
+
+bool runVecEnvBench(const int envsCount, const int stepsCount, const int ticksPerStep, const int threadsCount, const bool verbose)
+{
+    SpacewarVecEnv* env = spacewarVecEnvCreate(envsCount, ticksPerStep, threadsCount, 1);
+
+    std::vector<int32_t> actions(envsCount);
+    std::vector<float> observations(static_cast<size_t>(envsCount) * SPACEWAR_ENV_OBSERVATION_SIZE);
+    std::vector<float> rewards(envsCount);
+    std::vector<uint8_t> dones(envsCount);
+
+    spacewarVecEnvReset(env, observations.data());
+
+    int64_t episodesCount = 0;
+    int64_t winsCount = 0;
+    int64_t lossesCount = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int step = 0; step < stepsCount; ++step)
+    {
+        for (int32_t& action : actions)
+        {
+            action = static_cast<int32_t>(randomFloatRange(0.f, static_cast<float>(SPACEWAR_ENV_ACTIONS_COUNT))) % SPACEWAR_ENV_ACTIONS_COUNT;
+        }
+
+        spacewarVecEnvStep(env, actions.data(), observations.data(), rewards.data(), dones.data());
+
+        for (int i = 0; i < envsCount; ++i)
+        {
+            episodesCount += dones[i];
+            winsCount += rewards[i] > 0.f ? 1 : 0;
+            lossesCount += rewards[i] < 0.f ? 1 : 0;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const int threadsUsedCount = env->pool.getThreadsCount();
+    spacewarVecEnvDestroy(env);
+
+    const bool isOk = episodesCount > 0 &&
+        std::all_of(observations.begin(), observations.end(), [](const float value)
+        {
+            return std::isfinite(value);
+        });
+
+    if (verbose)
+    {
+        const double stepsPerSecond = static_cast<double>(envsCount) * stepsCount / seconds;
+        std::printf("vector env: %d envs, %d steps of %d ticks, %d threads, %.2f s\n", envsCount, stepsCount, ticksPerStep, threadsUsedCount,
+                    seconds);
+        std::printf("%.0f env steps per second, %.1f million per hour, %.0f ticks per second\n", stepsPerSecond, stepsPerSecond * 3600.0 / 1e6,
+                    stepsPerSecond * ticksPerStep);
+        std::printf("episodes: %lld, random agent won %lld, lost %lld\n", static_cast<long long>(episodesCount), static_cast<long long>(winsCount),
+                    static_cast<long long>(lossesCount));
+        std::printf("%s\n", isOk ? "OK" : "FAILED");
+    }
+
+    return isOk;
+}
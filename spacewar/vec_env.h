@@ -0,0 +1,69 @@
+﻿#pragma once
+
+// Vectorized reinforcement learning environment with a C interface, for training AIs without the real time loop.
+// Every env is an independent headless match: the agent plays the first ship, the built-in AI plays the second one.
+// All buffers are flat and owned by the caller. Stepping only allocates when entt grows its pools, mostly on episode resets
+
+#include <stdint.h>
+
+// spacewar_env.vcxproj builds these functions into a dll with SPACEWAR_ENV_EXPORTS, the game links them in
+#ifndef SPACEWAR_ENV_API
+#if defined(SPACEWAR_ENV_EXPORTS) && defined(_WIN32)
+#define SPACEWAR_ENV_API __declspec(dllexport)
+#elif defined(SPACEWAR_ENV_EXPORTS)
+#define SPACEWAR_ENV_API __attribute__((visibility("default")))
+#else
+#define SPACEWAR_ENV_API
+#endif
+#endif
+
+enum
+{
+    // rotate (left, none, right) x thrust x impulse x shoot, see spacewarVecEnvStep
+    SPACEWAR_ENV_ACTIONS_COUNT = 24,
+
+    // ship: alive, position x, y, velocity x, y, direction x, y, shot cooldown, impulse cooldown.
+    // The own position is in world fractions, the enemy one is relative to the own ship
+    SPACEWAR_ENV_SHIP_OBSERVATION_SIZE = 9,
+    // well: position relative to the own ship x, y, distance
+    SPACEWAR_ENV_WELL_OBSERVATION_SIZE = 3,
+    // projectile: present, position relative to the own ship x, y, velocity x, y
+    SPACEWAR_ENV_PROJECTILE_OBSERVATION_SIZE = 5,
+    // the nearest ones, in order of distance
+    SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT = 8,
+
+    // own ship, enemy ship, well, projectiles
+    SPACEWAR_ENV_OBSERVATION_SIZE = 2 * SPACEWAR_ENV_SHIP_OBSERVATION_SIZE + SPACEWAR_ENV_WELL_OBSERVATION_SIZE +
+        SPACEWAR_ENV_OBSERVED_PROJECTILES_COUNT * SPACEWAR_ENV_PROJECTILE_OBSERVATION_SIZE,
+
+    // an episode that lasts longer is over with no reward
+    SPACEWAR_ENV_MAX_EPISODE_TICKS = 60 * 60,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SpacewarVecEnv SpacewarVecEnv;
+
+// The action of a step is held for ticksPerStep ticks. threadsCount 0 means one worker per core.
+// The seed only changes what the simulation draws at random, matches of different envs are independent
+SPACEWAR_ENV_API SpacewarVecEnv* spacewarVecEnvCreate(int envsCount, int ticksPerStep, int threadsCount, uint64_t seed);
+SPACEWAR_ENV_API void spacewarVecEnvDestroy(SpacewarVecEnv* env);
+SPACEWAR_ENV_API int spacewarVecEnvGetCount(const SpacewarVecEnv* env);
+
+// starts new episodes everywhere, outObservations has SPACEWAR_ENV_OBSERVATION_SIZE floats per env
+SPACEWAR_ENV_API void spacewarVecEnvReset(SpacewarVecEnv* env, float* outObservations);
+
+// actions has an action per env: rotate is action % 3 - 1, thrust is action / 3 % 2, impulse is action / 6 % 2,
+// shoot is action / 12. Reward is 1 for a win, -1 for a loss, 0 otherwise. An env whose episode is done is reset
+// right away, its observation is the first one of the new episode
+SPACEWAR_ENV_API void spacewarVecEnvStep(SpacewarVecEnv* env, const int32_t* actions, float* outObservations, float* outRewards,
+                                         uint8_t* outDones);
+
+#ifdef __cplusplus
+}
+
+// Steps envsCount envs with random actions and prints the throughput if verbose. Returns false if no episode was finished
+bool runVecEnvBench(int envsCount, int stepsCount, int ticksPerStep, int threadsCount, bool verbose);
+#endif
@@ -0,0 +1,291 @@
+﻿#include "world_snapshot.h"
+#include "game_entities.h"
+#include "game_logic.h"
+#include "game_visual.h"
+#include "mapped_file.h"
+#include "ship_hit_mask.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+// Layout, numbers in native byte order (little endian on every platform we ship):
+// SnapshotHeader, SnapshotArray per component type in SnapshotComponents order, entities of the registry,
+// then per component type its entities and its components in pool order. Arrays start at SNAPSHOT_ALIGNMENT
+constexpr char SNAPSHOT_MAGIC[4] = {'S', 'W', 'S', 'N'};
+// has to be bumped when a component, the header or a stored context variable is added, removed or changes its fields
+constexpr uint32_t SNAPSHOT_VERSION = 5;
+constexpr size_t SNAPSHOT_ALIGNMENT = 16;
+
+struct SnapshotHeader
+{
+    char magic[4] = {};
+    uint32_t version = 0;
+    uint32_t componentTypesCount = 0;
+    uint32_t entitiesCount = 0;
+    uint64_t entitiesOffset = 0;
+    uint64_t randomState = 0;
+    entt::registry::entity_type destroyed = entt::null;
+    // the GravityIntegratorSettings context variable, restored with the world
+    uint8_t gravityIntegrator = 0;
+    // whether the world had the ShipHitMasks context variable, they are too big to be stored with every snapshot
+    uint8_t isShipHitMasks = 0;
+    uint8_t padding[2] = {};
+};
+
+struct SnapshotArray
+{
+    // 0 for empty components, only their entities are stored
+    uint32_t componentSize = 0;
+    uint32_t count = 0;
+    uint64_t entitiesOffset = 0;
+    uint64_t componentsOffset = 0;
+};
+
+template <typename... Component>
+struct ComponentTypeList
+{
+    static constexpr size_t COUNT = sizeof...(Component);
+};
+
+// Every component of the game, a new component must be added here or it's lost on restore
+using SnapshotComponents = ComponentTypeList<
+    PositionComponent,
+    WrapPositionAroundWorldComponent,
+    VelocityComponent,
+    RotationComponent,
+    RotationSpeedComponent,
+    AccelerateByInputComponent,
+    AccelerateImpulseByInputComponent,
+    AccelerateImpulseAppliedOneshotComponent,
+    RotateByInputComponent,
+    ShootingComponent,
+    CircleColliderComponent,
+    ProjectileComponent,
+    ProjectileCollisionComponent,
+    CollisionHappenedOneshotComponent,
+    DestroyByCollisionComponent,
+    DestroyTimerComponent,
+    GravityWellComponent,
+    SusceptibleToGravityWellComponent,
+    TeleportComponent,
+    TeleportableComponent,
+    ShipComponent,
+    AsteroidComponent,
+    ParticleComponent,
+    ParticleEmitterComponent,
+    DrawUsingShipTextureComponent,
+    EnableParticleEmitterByAccelerateInputComponent,
+    ParticleEmitterOnAccelerateImpulseComponent,
+    DeadShipPieceComponent,
+    StarComponent>;
+
+// Calls func(Component*, index) for every component type, the pointer is null and only carries the type
+template <typename... Component, typename Func>
+static void forEachComponentType(ComponentTypeList<Component...>, Func&& func)
+{
+    static_assert((std::is_trivially_copyable_v<Component> && ...), "Snapshot components must be plain data");
+
+    size_t index = 0;
+    (func(static_cast<Component*>(nullptr), index++), ...);
+}
+
+template <typename Component>
+constexpr uint32_t getSnapshotComponentSize()
+{
+    return std::is_empty_v<Component> ? 0 : static_cast<uint32_t>(sizeof(Component));
+}
+
+static size_t alignSnapshotOffset(const size_t offset)
+{
+    return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(SNAPSHOT_ALIGNMENT - 1);
+}
+
+static void copyToSnapshot(WorldSnapshot& snapshot, const uint64_t offset, const void* data, const size_t size)
+{
+    if (size > 0)
+    {
+        std::memcpy(snapshot.bytes.data() + offset, data, size);
+    }
+}
+
+void worldSnapshotCapture(const entt::registry& registry, WorldSnapshot& snapshot)
+{
+    using EntityType = entt::registry::entity_type;
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.componentTypesCount = static_cast<uint32_t>(SnapshotComponents::COUNT);
+    header.entitiesCount = static_cast<uint32_t>(registry.size());
+    header.randomState = randomGetState();
+    header.destroyed = registry.destroyed();
+    const GravityIntegratorSettings* integratorSettings = registry.try_ctx<GravityIntegratorSettings>();
+    header.gravityIntegrator = static_cast<uint8_t>(integratorSettings ? integratorSettings->integrator : GravityIntegrator::Euler);
+    header.isShipHitMasks = registry.try_ctx<ShipHitMasks>() != nullptr;
+
+    // lay out all arrays first, so the buffer is allocated once and every array is written with one copy
+    SnapshotArray arrays[SnapshotComponents::COUNT];
+    size_t size = sizeof(SnapshotHeader) + sizeof(arrays);
+
+    header.entitiesOffset = alignSnapshotOffset(size);
+    size = header.entitiesOffset + header.entitiesCount * sizeof(EntityType);
+
+    forEachComponentType(SnapshotComponents{}, [&registry, &arrays, &size](auto* type, const size_t index)
+    {
+        using Component = std::remove_pointer_t<decltype(type)>;
+
+        SnapshotArray& array = arrays[index];
+        array.componentSize = getSnapshotComponentSize<Component>();
+        array.count = static_cast<uint32_t>(registry.size<Component>());
+        array.entitiesOffset = alignSnapshotOffset(size);
+        size = array.entitiesOffset + array.count * sizeof(EntityType);
+        array.componentsOffset = alignSnapshotOffset(size);
+        size = array.componentsOffset + array.count * array.componentSize;
+    });
+
+    // keeps the capacity, capturing into the same snapshot again doesn't allocate
+    snapshot.bytes.clear();
+    snapshot.bytes.resize(size);
+
+    copyToSnapshot(snapshot, 0, &header, sizeof(header));
+    copyToSnapshot(snapshot, sizeof(header), arrays, sizeof(arrays));
+    copyToSnapshot(snapshot, header.entitiesOffset, registry.data(), header.entitiesCount * sizeof(EntityType));
+
+    forEachComponentType(SnapshotComponents{}, [&registry, &arrays, &snapshot](auto* type, const size_t index)
+    {
+        using Component = std::remove_pointer_t<decltype(type)>;
+
+        const SnapshotArray& array = arrays[index];
+        copyToSnapshot(snapshot, array.entitiesOffset, registry.data<Component>(), array.count * sizeof(EntityType));
+
+        // empty components have no storage
+        if constexpr (!std::is_empty_v<Component>)
+        {
+            copyToSnapshot(snapshot, array.componentsOffset, registry.raw<Component>(), array.count * sizeof(Component));
+        }
+    });
+}
+
+WorldSnapshot worldSnapshotCapture(const entt::registry& registry)
+{
+    WorldSnapshot snapshot;
+    worldSnapshotCapture(registry, snapshot);
+    return snapshot;
+}
+
+static bool isSnapshotArrayInside(const uint64_t offset, const uint64_t count, const uint64_t elementSize, const size_t size)
+{
+    return offset % SNAPSHOT_ALIGNMENT == 0 && offset <= size && count * elementSize <= size - offset;
+}
+
+// Reads the header and the arrays, false if they don't describe a snapshot of this version that fits into size
+static bool readSnapshotLayout(const uint8_t* bytes, const size_t size, SnapshotHeader& header, SnapshotArray (&arrays)[SnapshotComponents::COUNT])
+{
+    using EntityType = entt::registry::entity_type;
+
+    if (!bytes || size < sizeof(header) + sizeof(arrays))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, bytes, sizeof(header));
+    std::memcpy(arrays, bytes + sizeof(header), sizeof(arrays));
+
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.componentTypesCount != SnapshotComponents::COUNT || header.gravityIntegrator >= static_cast<uint8_t>(GravityIntegrator::Count) ||
+        header.isShipHitMasks > 1 ||
+        !isSnapshotArrayInside(header.entitiesOffset, header.entitiesCount, sizeof(EntityType), size))
+    {
+        return false;
+    }
+
+    bool arraysValid = true;
+    forEachComponentType(SnapshotComponents{}, [&arrays, &arraysValid, size](auto* type, const size_t index)
+    {
+        using Component = std::remove_pointer_t<decltype(type)>;
+
+        const SnapshotArray& array = arrays[index];
+        arraysValid = arraysValid && array.componentSize == getSnapshotComponentSize<Component>() &&
+            isSnapshotArrayInside(array.entitiesOffset, array.count, sizeof(EntityType), size) &&
+            isSnapshotArrayInside(array.componentsOffset, array.count, array.componentSize, size);
+    });
+
+    return arraysValid;
+}
+
+bool worldSnapshotIsValid(const uint8_t* bytes, const size_t size)
+{
+    SnapshotHeader header;
+    SnapshotArray arrays[SnapshotComponents::COUNT];
+    return readSnapshotLayout(bytes, size, header, arrays);
+}
+
+bool worldSnapshotRestore(entt::registry& registry, const uint8_t* bytes, const size_t size)
+{
+    using EntityType = entt::registry::entity_type;
+
+    SnapshotHeader header;
+    SnapshotArray arrays[SnapshotComponents::COUNT];
+    // ships of the world collided by their masks, they would collide as circles without them
+    if (!readSnapshotLayout(bytes, size, header, arrays) || (header.isShipHitMasks && !registry.try_ctx<ShipHitMasks>()))
+    {
+        return false;
+    }
+
+    // clear leaves all pools empty, which assign requires
+    registry.clear();
+
+    const auto* entities = reinterpret_cast<const EntityType*>(bytes + header.entitiesOffset);
+    registry.assign(entities, entities + header.entitiesCount, header.destroyed);
+
+    // components are inserted straight from the snapshot arrays, there's nothing to parse
+    forEachComponentType(SnapshotComponents{}, [&registry, &arrays, bytes](auto* type, const size_t index)
+    {
+        using Component = std::remove_pointer_t<decltype(type)>;
+
+        const SnapshotArray& array = arrays[index];
+        const auto* arrayEntities = reinterpret_cast<const EntityType*>(bytes + array.entitiesOffset);
+
+        if constexpr (std::is_empty_v<Component>)
+        {
+            registry.insert<Component>(arrayEntities, arrayEntities + array.count);
+        }
+        else
+        {
+            const auto* components = reinterpret_cast<const Component*>(bytes + array.componentsOffset);
+            registry.insert<Component>(arrayEntities, arrayEntities + array.count, components, components + array.count);
+        }
+    });
+
+    // factories are functions, they are not part of the snapshot
+    registerProjectileFactories(registry);
+    // the settings are only assigned if the registry has them, restoring every tick doesn't allocate
+    registry.ctx_or_set<GravityIntegratorSettings>().integrator = static_cast<GravityIntegrator>(header.gravityIntegrator);
+    if (!header.isShipHitMasks)
+    {
+        registry.unset<ShipHitMasks>();
+    }
+    randomSetState(header.randomState);
+    return true;
+}
+
+void worldSnapshotRestore(entt::registry& registry, const WorldSnapshot& snapshot)
+{
+    [[maybe_unused]] const bool restored = worldSnapshotRestore(registry, snapshot.bytes.data(), snapshot.bytes.size());
+    assert(restored);
+}
+
+bool worldSnapshotSave(const WorldSnapshot& snapshot, const std::string& filePath)
+{
+    std::ofstream file{filePath, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(snapshot.bytes.data()), snapshot.bytes.size());
+    return static_cast<bool>(file);
+}
+
+bool worldSnapshotLoad(entt::registry& registry, const std::string& filePath)
+{
+    const MappedFile file{filePath};
+    return worldSnapshotRestore(registry, file.getData(), file.getSize());
+}
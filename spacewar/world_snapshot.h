@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "entt.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The whole game world in one buffer: all entities with all their components and the random generator state.
+// Restoring it brings back exactly the same world, the simulation then goes on as it did from that moment.
+// Every component type is stored as one contiguous array, so the same bytes are used in memory and on disk
+struct WorldSnapshot
+{
+    std::vector<uint8_t> bytes{};
+};
+
+WorldSnapshot worldSnapshotCapture(const entt::registry& registry);
+// Reuses the buffer of the snapshot, for snapshots taken every tick
+void worldSnapshotCapture(const entt::registry& registry, WorldSnapshot& snapshot);
+void worldSnapshotRestore(entt::registry& registry, const WorldSnapshot& snapshot);
+
+// Returns false and leaves the registry untouched if the bytes are not a snapshot of this version.
+// A world that had ShipHitMasks only restores into a registry that has them, a world without them removes them
+bool worldSnapshotRestore(entt::registry& registry, const uint8_t* bytes, size_t size);
+// Whether worldSnapshotRestore would take the bytes, without touching any registry
+bool worldSnapshotIsValid(const uint8_t* bytes, size_t size);
+
+bool worldSnapshotSave(const WorldSnapshot& snapshot, const std::string& filePath);
+// Restores straight from the memory mapped file
+bool worldSnapshotLoad(entt::registry& registry, const std::string& filePath);